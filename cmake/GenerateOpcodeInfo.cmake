@@ -0,0 +1,101 @@
+# Generates OpcodeInfo.inc from resources/Opcodes.json at configure time.
+#
+# Each entry holds a disassembly template, the instruction length and its
+# T-cycle counts. Operand placeholders in the template:
+#   %n  8-bit immediate (n8)        %N  16-bit immediate (n16)
+#   %a  high-page address (a8)      %A  16-bit address (a16)
+#   %e  signed 8-bit value (e8)     %o  signed offset with its sign (SP+e8)
+#   %r  relative jump target (JR e8)
+
+function(generate_opcode_info JSON_FILE OUTPUT_FILE)
+    file(READ "${JSON_FILE}" opcodesJson)
+    set(content "// Generated from ${JSON_FILE} by cmake/GenerateOpcodeInfo.cmake. Do not edit.\n")
+
+    foreach(table unprefixed cbprefixed)
+        string(JSON tableJson GET "${opcodesJson}" ${table})
+        if(table STREQUAL "unprefixed")
+            set(tableName OPCODE_INFO)
+        else()
+            set(tableName CB_OPCODE_INFO)
+        endif()
+        string(APPEND content "\nconstexpr std::array<OpcodeInfo, 256> ${tableName} = {{\n")
+
+        foreach(opcode RANGE 255)
+            # Keys look like "0x0A"
+            math(EXPR hex "${opcode}" OUTPUT_FORMAT HEXADECIMAL)
+            string(SUBSTRING "${hex}" 2 -1 hex)
+            string(TOUPPER "${hex}" hex)
+            string(LENGTH "${hex}" hexLength)
+            if(hexLength EQUAL 1)
+                set(hex "0${hex}")
+            endif()
+
+            string(JSON entry GET "${tableJson}" "0x${hex}")
+            string(JSON mnemonic GET "${entry}" mnemonic)
+            string(JSON length GET "${entry}" bytes)
+            string(JSON cycles GET "${entry}" cycles 0)
+            string(JSON cycleCount LENGTH "${entry}" cycles)
+            set(cyclesNotTaken 0)
+            if(cycleCount GREATER 1)
+                string(JSON cyclesNotTaken GET "${entry}" cycles 1)
+            endif()
+
+            # Build the operand list
+            set(text "${mnemonic}")
+            set(separator " ")
+            set(offsetFollows OFF)
+            string(JSON operandCount LENGTH "${entry}" operands)
+            if(operandCount GREATER 0)
+                math(EXPR lastOperand "${operandCount} - 1")
+                foreach(index RANGE ${lastOperand})
+                    string(JSON name GET "${entry}" operands ${index} name)
+                    string(JSON immediate GET "${entry}" operands ${index} immediate)
+                    string(JSON increment ERROR_VARIABLE noIncrement GET "${entry}" operands ${index} increment)
+                    string(JSON decrement ERROR_VARIABLE noDecrement GET "${entry}" operands ${index} decrement)
+
+                    if(name STREQUAL "n8")
+                        set(name "%n")
+                    elseif(name STREQUAL "n16")
+                        set(name "%N")
+                    elseif(name STREQUAL "a8")
+                        set(name "%a")
+                    elseif(name STREQUAL "a16")
+                        set(name "%A")
+                    elseif(name STREQUAL "e8" AND mnemonic STREQUAL "JR")
+                        set(name "%r")
+                    elseif(name STREQUAL "e8" AND offsetFollows)
+                        set(name "%o")
+                    elseif(name STREQUAL "e8")
+                        set(name "%e")
+                    endif()
+
+                    # "SP+" followed by an offset is written as SP%o (LD HL,SP+e8)
+                    if(NOT noIncrement AND increment AND immediate AND index LESS lastOperand)
+                        set(offsetFollows ON)
+                    elseif(NOT noIncrement AND increment)
+                        string(APPEND name "+")
+                    elseif(NOT noDecrement AND decrement)
+                        string(APPEND name "-")
+                    endif()
+
+                    if(NOT immediate)
+                        set(name "(${name})")
+                    endif()
+
+                    string(APPEND text "${separator}${name}")
+                    if(offsetFollows)
+                        set(separator "")
+                    else()
+                        set(separator ",")
+                    endif()
+                endforeach()
+            endif()
+
+            string(APPEND content "    {\"${text}\", ${length}, ${cycles}, ${cyclesNotTaken}},  // 0x${hex}\n")
+        endforeach()
+
+        string(APPEND content "}};\n")
+    endforeach()
+
+    file(CONFIGURE OUTPUT "${OUTPUT_FILE}" CONTENT "${content}")
+endfunction()
@@ -2,17 +2,29 @@
 
 #include "Common.h"
 #include "Memory.h"
+#include "Metrics.h"
 #include "json.hpp"
 #include <functional>
 
+class CodeAnalysis;
+class ExecutionTraceWriter;
+
+// Bus timing, fixed at build time (GBWV2_MCYCLE_TIMING). Lump-sum timing
+// advances the devices by an instruction's cycles after it has run; M-cycle
+// timing advances them by 4 cycles at every bus access, before it happens,
+// and by the rest of the instruction's cycles after it
+enum class BusTiming : u8 { LUMP_SUM, MCYCLE };
+
+#ifdef GBWV2_MCYCLE_TIMING
+constexpr BusTiming BUS_TIMING = BusTiming::MCYCLE;
+#else
+constexpr BusTiming BUS_TIMING = BusTiming::LUMP_SUM;
+#endif
+
 // CPU class
 class CPU {
 public:
-    // Meyer's Singleton pattern
-    static CPU& getInstance() {
-        static CPU instance;
-        return instance;
-    }
+    explicit CPU(Memory& memory);
 
     // Delete copy constructor and assignment operator
     CPU(const CPU&) = delete;
@@ -66,7 +78,38 @@ public:
 
     // CPU control
     void reset();
-    void step();
+
+    // Execute one instruction; a copy or fill loop at PC may instead run
+    // whole iterations in bulk, up to maxCycles and the event horizon
+    void step(u32 maxCycles = 0);
+
+    // Advances the devices at bus accesses (M-cycle timing only; with
+    // lump-sum timing the caller advances them after each step)
+    using BusTick = void (*)(void* context, u32 cycles);
+    void setBusTick(BusTick tick, void* context) {
+        m_busTick = tick;
+        m_busTickContext = context;
+    }
+
+    // Cycles until the next device event, the furthest a loop may run in
+    // bulk without changing what the devices see (unset: no bulk loops)
+    void setEventHorizon(std::function<u32()> horizon) { m_eventHorizon = std::move(horizon); }
+
+    // Start at 0x0100 with the post-boot registers (fast boot)
+    void skipBootROM(u8 headerChecksum);
+
+    // Plain state block (suspend files)
+    struct State {
+        Registers registers;
+        u32 cycles;
+        bool halted;
+        bool stopped;
+        bool interruptsEnabled;
+        bool pendingInterruptEnable;
+    };
+
+    void saveState(State& state) const;
+    void loadState(const State& state);
     u32 getCycles() const { return m_cycles; }
 
     // Interrupt handling
@@ -79,46 +122,137 @@ public:
     // Debug
     const Registers& getRegisters() const { return m_registers; }
 
-    // Load opcodes from JSON
-    void parseOpcodeJson(const nlohmann::json& json);
-    void mapOpcodeToFunction(u8 opcode, const std::string& mnemonic, bool isCB);
+    // Metrics
+    const CPUCounters& getCounters() const { return m_counters; }
+    const UnimplementedOpcodeCounters& getUnimplementedOpcodes() const;
+
+    // Record every executed instruction (nullptr to stop)
+    void setExecutionTrace(ExecutionTraceWriter* writer) { m_executionTrace = writer; }
+
+    // Code analysis of the loaded ROM (nullptr: none). Its idle loops are
+    // skipped up to the event horizon, and code reached at run time (JP HL,
+    // jumps into another bank) is added to it
+    void setCodeAnalysis(CodeAnalysis* analysis) {
+        m_codeAnalysis = analysis;
+        m_idleProbe = {};
+    }
 
 private:
-    // Private constructor for singleton
-    CPU();
+    // Opcode tables for one opcode file. They hold member function pointers,
+    // not this CPU, so they are built once and shared by every CPU
+    using OpcodeFunction = void (CPU::*)();
+    
+    struct OpcodeEntry {
+        OpcodeFunction function;
+        std::string mnemonic;
+    };
+
+    struct OpcodeTables {
+        std::array<OpcodeEntry, 256> unprefixed;
+        std::array<OpcodeEntry, 256> cbPrefixed;
+        bool loopIdioms = false;        // The loop idiom opcodes map to their handlers
+    };
 
-    // CPU state
+    // Hot state first: what every instruction touches
     Registers m_registers;
     bool m_halted;
     bool m_stopped;
     bool m_interruptsEnabled;
     bool m_pendingInterruptEnable;
     u32 m_cycles;
+    Memory& m_memory;
+    const OpcodeTables* m_opcodes;      // Shared, never null
+    CPUCounters m_counters;
 
-    // Opcode tables
-    using OpcodeFunction = std::function<void()>;
-    
-    struct OpcodeEntry {
-        OpcodeFunction function;
-        std::string mnemonic;
+    // Instruction fetches and stack accesses skip the bus while PC and SP
+    // stay in plain memory (the fetch window is dropped when the mapping
+    // generation changes)
+    Memory::Window m_fetchWindow;
+    Memory::Window m_stackWindow;
+    u32 m_mappingGeneration;
+
+    // Device clock under M-cycle timing: cycles already ticked in this step
+    BusTick m_busTick;
+    void* m_busTickContext;
+    u32 m_tickedCycles;
+
+    // Execution trace (optional)
+    ExecutionTraceWriter* m_executionTrace;
+    void traceInstruction();
+
+    // Allocated on the first unimplemented opcode
+    std::unique_ptr<UnimplementedOpcodeCounters> m_unimplementedOpcodes;
+
+    // Copy and fill loops run in bulk
+    std::function<u32()> m_eventHorizon;
+    bool runLoopIdiom(u32 maxCycles);
+    static bool hasLoopIdiomHandlers(const OpcodeTables& tables);
+
+    // Idle loops: one pass runs instruction by instruction, and if it leaves
+    // the registers as it found them the passes that fit before anything it
+    // reads can change are only counted
+    struct IdleProbe {
+        bool active = false;
+        bool verified = false;              // passCycles and passReads hold a pass
+        bool readsDevices = false;          // I/O or cartridge RAM
+        bool interruptsEnabled = false;
+        u16 pc = 0;
+        u16 passInstructions = 0;
+        Registers registers{};
+        u32 cycles = 0;                     // At the start of the pass
+        u32 stableCycles = 0;               // From there, before the horizon or LY moves
+        u32 passCycles = 0;
+        u32 resumeCycles = 0;               // Where the last skip left the CPU
+        u64 instructions = 0;
+        std::array<u64, BUS_REGION_COUNT> reads{};
+        std::array<u32, BUS_REGION_COUNT> passReads{};
     };
-    
-    std::array<OpcodeEntry, 256> m_opcodeTable;
-    std::array<OpcodeEntry, 256> m_cbOpcodeTable;
 
-    // Memory reference
-    Memory& m_memory;
+    CodeAnalysis* m_codeAnalysis;
+    IdleProbe m_idleProbe;
+    bool skipIdleLoop(u32 maxCycles);
+    bool idleLoopReadsDevices(u16 pc, u32 offset, u16 length) const;
+
+    // Load opcodes from JSON
+    static const OpcodeTables& emptyOpcodeTables();
+    static void parseOpcodeJson(const nlohmann::json& json, OpcodeTables& tables);
+    static void mapOpcodeToFunction(OpcodeTables& tables, u8 opcode, const std::string& mnemonic, bool isCB);
 
     // Opcode implementation
-    void initializeOpcodes();
+    void unimplementedOpcode();
+    void unimplementedCBOpcode();
+    void recordUnimplementedOpcode(u8 opcode, bool isCB);
     void executeOpcode(u8 opcode);
     void executeCBOpcode(u8 opcode);
 
+    // Run one instruction, or a loop in bulk (step adds the device clock)
+    void execute(u32 maxCycles);
+
+    // One machine cycle of the instruction being run: the devices advance 4
+    // cycles under M-cycle timing and nothing happens under lump sums. Every
+    // bus access the CPU makes goes through here first
+    void tick() {
+        if constexpr (BUS_TIMING == BusTiming::MCYCLE) {
+            m_busTick(m_busTickContext, 4);
+            m_tickedCycles += 4;
+        }
+    }
+    u8 busRead(u16 address) {
+        tick();
+        return m_memory.read(address);
+    }
+    void busWrite(u16 address, u8 value) {
+        tick();
+        m_memory.write(address, value);
+    }
+
     // Helper methods for opcode implementation
     u8 readPC();
     u16 readPC16();
     void push(u16 value);
     u16 pop();
+    u8 readPCFromBus();
+    bool refreshStackWindow();
 
     // Flag operations
     bool getFlag(Flags flag) const;
@@ -189,141 +323,13 @@ private:
     void DEC_A();      // 0x3D
     void LD_A_n8();    // 0x3E
     void CCF();        // 0x3F
-    void LD_B_B();     // 0x40
-    void LD_B_C();     // 0x41
-    void LD_B_D();     // 0x42
-    void LD_B_E();     // 0x43
-    void LD_B_H();     // 0x44
-    void LD_B_L();     // 0x45
-    void LD_B_HLm();   // 0x46
-    void LD_B_A();     // 0x47
-    void LD_C_B();     // 0x48
-    void LD_C_C();     // 0x49
-    void LD_C_D();     // 0x4A
-    void LD_C_E();     // 0x4B
-    void LD_C_H();     // 0x4C
-    void LD_C_L();     // 0x4D
-    void LD_C_HLm();   // 0x4E
-    void LD_C_A();     // 0x4F
-    void LD_D_B();     // 0x50
-    void LD_D_C();     // 0x51
-    void LD_D_D();     // 0x52
-    void LD_D_E();     // 0x53
-    void LD_D_H();     // 0x54
-    void LD_D_L();     // 0x55
-    void LD_D_HLm();   // 0x56
-    void LD_D_A();     // 0x57
-    void LD_E_B();     // 0x58
-    void LD_E_C();     // 0x59
-    void LD_E_D();     // 0x5A
-    void LD_E_E();     // 0x5B
-    void LD_E_H();     // 0x5C
-    void LD_E_L();     // 0x5D
-    void LD_E_HLm();   // 0x5E
-    void LD_E_A();     // 0x5F
-    void LD_H_B();     // 0x60
-    void LD_H_C();     // 0x61
-    void LD_H_D();     // 0x62
-    void LD_H_E();     // 0x63
-    void LD_H_H();     // 0x64
-    void LD_H_L();     // 0x65
-    void LD_H_HLm();   // 0x66
-    void LD_H_A();     // 0x67
-    void LD_L_B();     // 0x68
-    void LD_L_C();     // 0x69
-    void LD_L_D();     // 0x6A
-    void LD_L_E();     // 0x6B
-    void LD_L_H();     // 0x6C
-    void LD_L_L();     // 0x6D
-    void LD_L_HLm();   // 0x6E
-    void LD_L_A();     // 0x6F
-    void LD_HLm_B();   // 0x70
-    void LD_HLm_C();   // 0x71
-    void LD_HLm_D();   // 0x72
-    void LD_HLm_E();   // 0x73
-    void LD_HLm_H();   // 0x74
-    void LD_HLm_L();   // 0x75
     void HALT();       // 0x76
-    void LD_HLm_A();    // 0x77
-    void LD_A_B();      // 0x78
-    void LD_A_C();      // 0x79
-    void LD_A_D();      // 0x7A
-    void LD_A_E();      // 0x7B
-    void LD_A_H();      // 0x7C
-    void LD_A_L();      // 0x7D
-    void LD_A_HLm();    // 0x7E
-    void LD_A_A();      // 0x7F
-    void ADD_A_B();     // 0x80
-    void ADD_A_C();     // 0x81
-    void ADD_A_D();     // 0x82
-    void ADD_A_E();     // 0x83
-    void ADD_A_H();     // 0x84
-    void ADD_A_L();     // 0x85
-    void ADD_A_HLm();   // 0x86
-    void ADD_A_A();     // 0x87
-    void ADC_A_B();     // 0x88
-    void ADC_A_C();     // 0x89
-    void ADC_A_D();     // 0x8A
-    void ADC_A_E();     // 0x8B
-    void ADC_A_H();     // 0x8C
-    void ADC_A_L();     // 0x8D
-    void ADC_A_HLm();   // 0x8E
-    void ADC_A_A();     // 0x8F
-    void SUB_A_B();       // 0x90
-    void SUB_A_C();       // 0x91
-    void SUB_A_D();       // 0x92
-    void SUB_A_E();       // 0x93
-    void SUB_A_H();       // 0x94
-    void SUB_A_L();       // 0x95
-    void SUB_A_HLm();     // 0x96
-    void SUB_A_A();       // 0x97
-    void SBC_A_B();     // 0x98
-    void SBC_A_C();     // 0x99
-    void SBC_A_D();     // 0x9A
-    void SBC_A_E();     // 0x9B
-    void SBC_A_H();     // 0x9C
-    void SBC_A_L();     // 0x9D
-    void SBC_A_HLm();   // 0x9E
-    void SBC_A_A();     // 0x9F
-    void AND_B();       // 0xA0
-    void AND_C();       // 0xA1
-    void AND_D();       // 0xA2
-    void AND_E();       // 0xA3
-    void AND_H();       // 0xA4
-    void AND_L();       // 0xA5
-    void AND_HLm();     // 0xA6
-    void AND_A();       // 0xA7
-    void XOR_B();       // 0xA8
-    void XOR_C();       // 0xA9
-    void XOR_D();       // 0xAA
-    void XOR_E();       // 0xAB
-    void XOR_H();       // 0xAC
-    void XOR_L();       // 0xAD
-    void XOR_HLm();     // 0xAE
-    void XOR_A();       // 0xAF
-    void OR_B();        // 0xB0
-    void OR_C();        // 0xB1
-    void OR_D();        // 0xB2
-    void OR_E();        // 0xB3
-    void OR_H();        // 0xB4
-    void OR_L();        // 0xB5
-    void OR_HLm();      // 0xB6
-    void OR_A();        // 0xB7
-    void CP_B();        // 0xB8
-    void CP_C();        // 0xB9
-    void CP_D();        // 0xBA
-    void CP_E();        // 0xBB
-    void CP_H();        // 0xBC
-    void CP_L();        // 0xBD
-    void CP_HLm();      // 0xBE
-    void CP_A();        // 0xBF
     void RET_NZ();      // 0xC0
     void POP_BC();      // 0xC1
     void JP_NZ_a16();   // 0xC2
     void JP_a16();      // 0xC3
     void CALL_NZ_a16(); // 0xC4
     void PUSH_BC();     // 0xC5
-    void ADD_A_n8();    // 0xC6
     void RST_00H();     // 0xC7
     void RET_Z();       // 0xC8
     void RET();         // 0xC9
@@ -331,302 +337,59 @@ private:
     void PREFIX_CB();   // 0xCB
     void CALL_Z_a16();  // 0xCC
     void CALL_a16();    // 0xCD
-    void ADC_A_n8();    // 0xCE
     void RST_08H();     // 0xCF
     void RET_NC();      // 0xD0
     void POP_DE();      // 0xD1
     void JP_NC_a16();   // 0xD2
     void CALL_NC_a16(); // 0xD4
     void PUSH_DE();     // 0xD5
-    void SUB_n8();      // 0xD6
     void RST_10H();     // 0xD7
     void RET_C();       // 0xD8
     void RETI();        // 0xD9
     void JP_C_a16();    // 0xDA
     void CALL_C_a16();  // 0xDC
-    void SBC_A_n8();    // 0xDE
     void RST_18H();     // 0xDF
     void LDH_a8_A();    // 0xE0
     void POP_HL();      // 0xE1
     void LDH_C_A();      // 0xE2
     void PUSH_HL();     // 0xE5
-    void AND_n8();      // 0xE6
     void RST_20H();     // 0xE7
     void ADD_SP_e8();   // 0xE8
     void JP_HL();       // 0xE9
     void LD_a16_A();    // 0xEA
-    void XOR_n8();      // 0xEE
     void RST_28H();     // 0xEF
     void LDH_A_a8();    // 0xF0
     void POP_AF();      // 0xF1
     void LDH_A_C();      // 0xF2
     void DI();          // 0xF3
     void PUSH_AF();     // 0xF5
-    void OR_n8();       // 0xF6
     void RST_30H();     // 0xF7
     void LD_HL_SP_e8(); // 0xF8
     void LD_SP_HL();    // 0xF9
     void LD_A_a16();    // 0xFA
     void EI();          // 0xFB
-    void CP_n8();       // 0xFE
     void RST_38H();     // 0xFF
 
-    // CB Prefixed Instructions
-    void RLC_B();       // 0x00 (CB)
-    void RLC_C();       // 0x01 (CB)
-    void RLC_D();       // 0x02 (CB)
-    void RLC_E();       // 0x03 (CB)
-    void RLC_H();       // 0x04 (CB)
-    void RLC_L();       // 0x05 (CB)
-    void RLC_HLm();     // 0x06 (CB)
-    void RLC_A();       // 0x07 (CB)
-    void RRC_B();       // 0x08 (CB)
-    void RRC_C();       // 0x09 (CB)
-    void RRC_D();       // 0x0A (CB)
-    void RRC_E();       // 0x0B (CB)
-    void RRC_H();       // 0x0C (CB)
-    void RRC_L();       // 0x0D (CB)
-    void RRC_HLm();     // 0x0E (CB)
-    void RRC_A();       // 0x0F (CB)
-    void RL_B();        // 0x10 (CB)
-    void RL_C();        // 0x11 (CB)
-    void RL_D();        // 0x12 (CB)
-    void RL_E();        // 0x13 (CB)
-    void RL_H();        // 0x14 (CB)
-    void RL_L();        // 0x15 (CB)
-    void RL_HLm();      // 0x16 (CB)
-    void RL_A();        // 0x17 (CB)
-    void RR_B();        // 0x18 (CB)
-    void RR_C();        // 0x19 (CB)
-    void RR_D();        // 0x1A (CB)
-    void RR_E();        // 0x1B (CB)
-    void RR_H();        // 0x1C (CB)
-    void RR_L();        // 0x1D (CB)
-    void RR_HLm();      // 0x1E (CB)
-    void RR_A();        // 0x1F (CB)
-    void SLA_B();       // 0x20 (CB)
-    void SLA_C();       // 0x21 (CB)
-    void SLA_D();       // 0x22 (CB)
-    void SLA_E();       // 0x23 (CB)
-    void SLA_H();       // 0x24 (CB)
-    void SLA_L();       // 0x25 (CB)
-    void SLA_HLm();     // 0x26 (CB)
-    void SLA_A();       // 0x27 (CB)
-    void SRA_B();       // 0x28 (CB)
-    void SRA_C();       // 0x29 (CB)
-    void SRA_D();       // 0x2A (CB)
-    void SRA_E();       // 0x2B (CB)
-    void SRA_H();       // 0x2C (CB)
-    void SRA_L();       // 0x2D (CB)
-    void SRA_HLm();     // 0x2E (CB)
-    void SRA_A();       // 0x2F (CB)
-    void SWAP_B();      // 0x30 (CB)
-    void SWAP_C();      // 0x31 (CB)
-    void SWAP_D();      // 0x32 (CB)
-    void SWAP_E();      // 0x33 (CB)
-    void SWAP_H();      // 0x34 (CB)
-    void SWAP_L();      // 0x35 (CB)
-    void SWAP_HLm();    // 0x36 (CB)
-    void SWAP_A();      // 0x37 (CB)
-    void SRL_B();       // 0x38 (CB)
-    void SRL_C();       // 0x39 (CB)
-    void SRL_D();       // 0x3A (CB)
-    void SRL_E();       // 0x3B (CB)
-    void SRL_H();       // 0x3C (CB)
-    void SRL_L();       // 0x3D (CB)
-    void SRL_HLm();     // 0x3E (CB)
-    void SRL_A();       // 0x3F (CB)
-    void BIT_0_B();     // 0x40 (CB)
-    void BIT_0_C();     // 0x41 (CB)
-    void BIT_0_D();     // 0x42 (CB)
-    void BIT_0_E();     // 0x43 (CB)
-    void BIT_0_H();     // 0x44 (CB)
-    void BIT_0_L();     // 0x45 (CB)
-    void BIT_0_HLm();   // 0x46 (CB)
-    void BIT_0_A();     // 0x47 (CB)
-    void BIT_1_B();     // 0x48 (CB)
-    void BIT_1_C();     // 0x49 (CB)
-    void BIT_1_D();     // 0x4A (CB)
-    void BIT_1_E();     // 0x4B (CB)
-    void BIT_1_H();     // 0x4C (CB)
-    void BIT_1_L();     // 0x4D (CB)
-    void BIT_1_HLm();   // 0x4E (CB)
-    void BIT_1_A();     // 0x4F (CB)
-    void BIT_2_B();     // 0x50 (CB)
-    void BIT_2_C();     // 0x51 (CB)
-    void BIT_2_D();     // 0x52 (CB)
-    void BIT_2_E();     // 0x53 (CB)
-    void BIT_2_H();     // 0x54 (CB)
-    void BIT_2_L();     // 0x55 (CB)
-    void BIT_2_HLm();   // 0x56 (CB)
-    void BIT_2_A();     // 0x57 (CB)
-    void BIT_3_B();     // 0x58 (CB)
-    void BIT_3_C();     // 0x59 (CB)
-    void BIT_3_D();     // 0x5A (CB)
-    void BIT_3_E();     // 0x5B (CB)
-    void BIT_3_H();     // 0x5C (CB)
-    void BIT_3_L();     // 0x5D (CB)
-    void BIT_3_HLm();   // 0x5E (CB)
-    void BIT_3_A();     // 0x5F (CB)
-    void BIT_4_B();     // 0x60 (CB)
-    void BIT_4_C();     // 0x61 (CB)
-    void BIT_4_D();     // 0x62 (CB)
-    void BIT_4_E();     // 0x63 (CB)
-    void BIT_4_H();     // 0x64 (CB)
-    void BIT_4_L();     // 0x65 (CB)
-    void BIT_4_HLm();   // 0x66 (CB)
-    void BIT_4_A();     // 0x67 (CB)
-    void BIT_5_B();     // 0x68 (CB)
-    void BIT_5_C();     // 0x69 (CB)
-    void BIT_5_D();     // 0x6A (CB)
-    void BIT_5_E();     // 0x6B (CB)
-    void BIT_5_H();     // 0x6C (CB)
-    void BIT_5_L();     // 0x6D (CB)
-    void BIT_5_HLm();   // 0x6E (CB)
-    void BIT_5_A();     // 0x6F (CB)
-    void BIT_6_B();     // 0x70 (CB)
-    void BIT_6_C();     // 0x71 (CB)
-    void BIT_6_D();     // 0x72 (CB)
-    void BIT_6_E();     // 0x73 (CB)
-    void BIT_6_H();     // 0x74 (CB)
-    void BIT_6_L();     // 0x75 (CB)
-    void BIT_6_HLm();   // 0x76 (CB)
-    void BIT_6_A();     // 0x77 (CB)
-    void BIT_7_B();     // 0x78 (CB)
-    void BIT_7_C();     // 0x79 (CB)
-    void BIT_7_D();     // 0x7A (CB)
-    void BIT_7_E();     // 0x7B (CB)
-    void BIT_7_H();     // 0x7C (CB)
-    void BIT_7_L();     // 0x7D (CB)
-    void BIT_7_HLm();   // 0x7E (CB)
-    void BIT_7_A();     // 0x7F (CB)
-    void RES_0_B();     // 0x80 (CB)
-    void RES_0_C();     // 0x81 (CB)
-    void RES_0_D();     // 0x82 (CB)
-    void RES_0_E();     // 0x83 (CB)
-    void RES_0_H();     // 0x84 (CB)
-    void RES_0_L();     // 0x85 (CB)
-    void RES_0_HLm();   // 0x86 (CB)
-    void RES_0_A();     // 0x87 (CB)
-    void RES_1_B();     // 0x88 (CB)
-    void RES_1_C();     // 0x89 (CB)
-    void RES_1_D();     // 0x8A (CB)
-    void RES_1_E();     // 0x8B (CB)
-    void RES_1_H();     // 0x8C (CB)
-    void RES_1_L();     // 0x8D (CB)
-    void RES_1_HLm();   // 0x8E (CB)
-    void RES_1_A();     // 0x8F (CB)
-    void RES_2_B();     // 0x90 (CB)
-    void RES_2_C();     // 0x91 (CB)
-    void RES_2_D();     // 0x92 (CB)
-    void RES_2_E();     // 0x93 (CB)
-    void RES_2_H();     // 0x94 (CB)
-    void RES_2_L();     // 0x95 (CB)
-    void RES_2_HLm();   // 0x96 (CB)
-    void RES_2_A();     // 0x97 (CB)
-    void RES_3_B();     // 0x98 (CB)
-    void RES_3_C();     // 0x99 (CB)
-    void RES_3_D();     // 0x9A (CB)
-    void RES_3_E();     // 0x9B (CB)
-    void RES_3_H();     // 0x9C (CB)
-    void RES_3_L();     // 0x9D (CB)
-    void RES_3_HLm();   // 0x9E (CB)
-    void RES_3_A();     // 0x9F (CB)
-    void RES_4_B();     // 0xA0 (CB)
-    void RES_4_C();     // 0xA1 (CB)
-    void RES_4_D();     // 0xA2 (CB)
-    void RES_4_E();     // 0xA3 (CB)
-    void RES_4_H();     // 0xA4 (CB)
-    void RES_4_L();     // 0xA5 (CB)
-    void RES_4_HLm();   // 0xA6 (CB)
-    void RES_4_A();     // 0xA7 (CB)
-    void RES_5_B();     // 0xA8 (CB)
-    void RES_5_C();     // 0xA9 (CB)
-    void RES_5_D();     // 0xAA (CB)
-    void RES_5_E();     // 0xAB (CB)
-    void RES_5_H();     // 0xAC (CB)
-    void RES_5_L();     // 0xAD (CB)
-    void RES_5_HLm();   // 0xAE (CB)
-    void RES_5_A();     // 0xAF (CB)
-    void RES_6_B();     // 0xB0 (CB)
-    void RES_6_C();     // 0xB1 (CB)
-    void RES_6_D();     // 0xB2 (CB)
-    void RES_6_E();     // 0xB3 (CB)
-    void RES_6_H();     // 0xB4 (CB)
-    void RES_6_L();     // 0xB5 (CB)
-    void RES_6_HLm();   // 0xB6 (CB)
-    void RES_6_A();     // 0xB7 (CB)
-    void RES_7_B();     // 0xB8 (CB)
-    void RES_7_C();     // 0xB9 (CB)
-    void RES_7_D();     // 0xBA (CB)
-    void RES_7_E();     // 0xBB (CB)
-    void RES_7_H();     // 0xBC (CB)
-    void RES_7_L();     // 0xBD (CB)
-    void RES_7_HLm();   // 0xBE (CB)
-    void RES_7_A();     // 0xBF (CB)
-    void SET_0_B();     // 0xC0 (CB)
-    void SET_0_C();     // 0xC1 (CB)
-    void SET_0_D();     // 0xC2 (CB)
-    void SET_0_E();     // 0xC3 (CB)
-    void SET_0_H();     // 0xC4 (CB)
-    void SET_0_L();     // 0xC5 (CB)
-    void SET_0_HLm();   // 0xC6 (CB)
-    void SET_0_A();     // 0xC7 (CB)
-    void SET_1_B();     // 0xC8 (CB)
-    void SET_1_C();     // 0xC9 (CB)
-    void SET_1_D();     // 0xCA (CB)
-    void SET_1_E();     // 0xCB (CB)
-    void SET_1_H();     // 0xCC (CB)
-    void SET_1_L();     // 0xCD (CB)
-    void SET_1_HLm();   // 0xCE (CB)
-    void SET_1_A();     // 0xCF (CB)
-    void SET_2_B();     // 0xD0 (CB)
-    void SET_2_C();     // 0xD1 (CB)
-    void SET_2_D();     // 0xD2 (CB)
-    void SET_2_E();     // 0xD3 (CB)
-    void SET_2_H();     // 0xD4 (CB)
-    void SET_2_L();     // 0xD5 (CB)
-    void SET_2_HLm();   // 0xD6 (CB)
-    void SET_2_A();     // 0xD7 (CB)
-    void SET_3_B();     // 0xD8 (CB)
-    void SET_3_C();     // 0xD9 (CB)
-    void SET_3_D();     // 0xDA (CB)
-    void SET_3_E();     // 0xDB (CB)
-    void SET_3_H();     // 0xDC (CB)
-    void SET_3_L();     // 0xDD (CB)
-    void SET_3_HLm();   // 0xDE (CB)
-    void SET_3_A();     // 0xDF (CB)
-    void SET_4_B();     // 0xE0 (CB)
-    void SET_4_C();     // 0xE1 (CB)
-    void SET_4_D();     // 0xE2 (CB)
-    void SET_4_E();     // 0xE3 (CB)
-    void SET_4_H();     // 0xE4 (CB)
-    void SET_4_L();     // 0xE5 (CB)
-    void SET_4_HLm();   // 0xE6 (CB)
-    void SET_4_A();     // 0xE7 (CB)
-    void SET_5_B();     // 0xE8 (CB)
-    void SET_5_C();     // 0xE9 (CB)
-    void SET_5_D();     // 0xEA (CB)
-    void SET_5_E();     // 0xEB (CB)
-    void SET_5_H();     // 0xEC (CB)
-    void SET_5_L();     // 0xED (CB)
-    void SET_5_HLm();   // 0xEE (CB)
-    void SET_5_A();     // 0xEF (CB)
-    void SET_6_B();     // 0xF0 (CB)
-    void SET_6_C();     // 0xF1 (CB)
-    void SET_6_D();     // 0xF2 (CB)
-    void SET_6_E();     // 0xF3 (CB)
-    void SET_6_H();     // 0xF4 (CB)
-    void SET_6_L();     // 0xF5 (CB)
-    void SET_6_HLm();   // 0xF6 (CB)
-    void SET_6_A();     // 0xF7 (CB)
-    void SET_7_B();     // 0xF8 (CB)
-    void SET_7_C();     // 0xF9 (CB)
-    void SET_7_D();     // 0xFA (CB)
-    void SET_7_E();     // 0xFB (CB)
-    void SET_7_H();     // 0xFC (CB)
-    void SET_7_L();     // 0xFD (CB)
-    void SET_7_HLm();   // 0xFE (CB)
-    void SET_7_A();     // 0xFF (CB)
+    // Register families, generated from templates. Operands are numbered
+    // as in the opcode encoding; OPERAND_HLm is the byte at (HL)
+    enum Operand : u8 {
+        OPERAND_B, OPERAND_C, OPERAND_D, OPERAND_E, OPERAND_H, OPERAND_L, OPERAND_HLm, OPERAND_A
+    };
+    enum class AluOp : u8 { ADD, ADC, SUB, SBC, AND, XOR, OR, CP };
+    enum class ShiftOp : u8 { RLC, RRC, RL, RR, SLA, SRA, SWAP, SRL };
+
+    static void addOpcodeFamilies(std::unordered_map<std::string, OpcodeFunction>& mapping);
+
+    template <u8 Operand> u8 readOperand();
+    template <u8 Operand> void writeOperand(u8 value);
+    template <AluOp Op> void alu(u8 value);
+    template <ShiftOp Op> u8 shift(u8 value);
 
+    template <u8 Dst, u8 Src> void LD_r_r();            // 0x40-0x7F but 0x76
+    template <AluOp Op, u8 Src> void ALU_A_r();         // 0x80-0xBF
+    template <AluOp Op> void ALU_A_n8();                // 0xC6-0xFE
+    template <ShiftOp Op, u8 Operand> void SHIFT_r();   // CB 0x00-0x3F
+    template <u8 Bit, u8 Operand> void BIT_n_r();       // CB 0x40-0x7F
+    template <u8 Bit, u8 Operand> void RES_n_r();       // CB 0x80-0xBF
+    template <u8 Bit, u8 Operand> void SET_n_r();       // CB 0xC0-0xFF
 };
\ No newline at end of file
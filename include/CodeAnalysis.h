@@ -0,0 +1,99 @@
+#pragma once
+
+#include "Common.h"
+
+// Code layout of one ROM image, found by walking reachable code from the
+// entry points (0x0100, the RST and interrupt vectors) through jumps, calls
+// and branches across ROM banks. Targets the walk cannot see (JP HL, calls
+// into a bank switched at run time) are added while the game runs. It keeps
+// the instruction starts and lengths, the basic blocks, and the idle loops:
+// blocks that only read and jump back to their own start, which the CPU can
+// skip in bulk once it has seen one pass leave its registers unchanged.
+//
+// Everything is addressed by ROM offset: bank 0 is 0x0000 - 0x3FFF, bank n
+// at 0x4000 - 0x7FFF is offset n * 0x4000 + (address - 0x4000).
+class CodeAnalysis {
+public:
+    // How a basic block ends
+    enum class BlockEnd : u8 {
+        FALLTHROUGH,            // Runs into the next block
+        JUMP,                   // JP, JR
+        BRANCH,                 // Conditional JP, JR or RET
+        CALL,                   // CALL, RST
+        RETURN,                 // RET, RETI
+        INDIRECT,               // JP HL
+        INVALID                 // Illegal opcode, or runs off its bank
+    };
+
+    struct Block {
+        u32 offset;             // ROM offset of the first instruction
+        u16 length;             // Bytes
+        u16 instructions;
+        BlockEnd end;
+        bool idleLoop;          // Jumps back to its own start, stores nothing
+    };
+
+    struct Stats {
+        size_t instructions = 0;
+        size_t blocks = 0;
+        size_t idleLoops = 0;
+        size_t entryPoints = 0;         // Added while running
+        size_t codeBytes = 0;
+    };
+
+    // The ROM image must outlive the analysis
+    CodeAnalysis(const std::vector<u8>& rom, u64 romHash);
+
+    // Walk from the fixed entry points
+    void analyze();
+
+    // Code reached at run time at address with romBank mapped at 0x4000;
+    // walks on from there if it is new. True if new code was found
+    bool addEntryPoint(u16 address, u8 romBank);
+
+    // Idle loop starting at address (romBank mapped at 0x4000), nullptr if none.
+    // mayBeIdleLoop is a quick filter over the address alone
+    bool mayBeIdleLoop(u16 address) const { return (m_idleAddresses[address >> 6] >> (address & 63)) & 1; }
+    const Block* findIdleLoop(u16 address, u8 romBank) const;
+
+    // Length of the instruction at a ROM offset, 0 where none was found
+    u8 getInstructionLength(u32 offset) const { return offset < m_map.size() ? m_map[offset] & LENGTH_MASK : 0; }
+
+    const std::vector<Block>& getBlocks() const { return m_blocks; }
+    const std::vector<u32>& getEntryPoints() const { return m_entryPoints; }
+    Stats getStats() const;
+
+    // Cache file keyed by the ROM hash; load fails (leaving the analysis
+    // empty) when the file is missing, damaged or made for another ROM
+    bool load(const std::string& filename);
+    bool save(const std::string& filename) const;
+    bool isFromCache() const { return m_fromCache; }
+
+private:
+    // Per ROM byte: instruction length at its start, then flags
+    static constexpr u8 LENGTH_MASK = 0x03;
+    static constexpr u8 CODE = 0x04;            // Part of a decoded instruction
+    static constexpr u8 BLOCK_START = 0x08;
+
+    // Where the walk goes next: code in a bank, with the bank it assumes at 0x4000
+    struct Location {
+        u16 address;
+        u8 bank;
+        u8 mapped;
+    };
+
+    const std::vector<u8>& m_rom;
+    u64 m_romHash;
+    std::vector<u8> m_map;
+    std::vector<Block> m_blocks;                // Sorted by offset
+    std::vector<u32> m_entryPoints;
+    std::vector<u64> m_idleAddresses;           // Bit per CPU address with an idle loop in some bank
+    std::vector<bool> m_dirtyBanks;
+    bool m_fromCache;
+
+    bool toOffset(u8 bank, u16 address, u32& offset) const;
+    void walk(std::vector<Location>& pending);
+    void decodeBlock(const Block& block);
+    void rebuildBlocks();
+    void rebuildIdleFilter();
+};
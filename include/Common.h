@@ -12,14 +12,17 @@
 #include <sstream>
 #include <algorithm>
 #include <stdexcept>
+#include <chrono>
 
 // Type definitions for GameBoy hardware
 using u8 = uint8_t;
 using u16 = uint16_t;
 using u32 = uint32_t;
+using u64 = uint64_t;
 using i8 = int8_t;
 using i16 = int16_t;
 using i32 = int32_t;
+using i64 = int64_t;
 using s8 = i8;  // Signed 8-bit type for relative jumps
 
 // Constants
@@ -35,6 +38,10 @@ constexpr u16 HRAM_SIZE = 0x7F;        // 127 bytes
 constexpr u16 SCREEN_WIDTH = 160;
 constexpr u16 SCREEN_HEIGHT = 144;
 
+// Frame timing (4194304 Hz / 70224 cycles per frame = ~59.73 Hz)
+constexpr u32 CYCLES_PER_FRAME = 70224;
+constexpr auto FRAME_DURATION = std::chrono::nanoseconds(16742706);
+
 // GameBoy boot ROM (first 256 bytes)
 constexpr std::array<u8, 256> BOOT_ROM = {
     0x31, 0xFE, 0xFF, 0xAF, 0x21, 0xFF, 0x9F, 0x32, 0xCB, 0x7C, 0x20, 0xFB, 0x21, 0x26, 0xFF, 0x0E,
@@ -0,0 +1,113 @@
+#pragma once
+
+#include "Common.h"
+
+class SymbolTable;
+
+// Opcode metadata generated from resources/Opcodes.json at configure time
+struct OpcodeInfo {
+    const char* format;     // Disassembly template, operands as %n %N %a %A %e %r
+    u8 length;              // Instruction length in bytes (including the 0xCB prefix)
+    u8 cycles;              // T-cycles (branch taken for conditional instructions)
+    u8 cyclesNotTaken;      // T-cycles when the condition fails (0 if unconditional)
+};
+
+// Table-driven SM83 disassembler. Decoding writes into a caller-provided
+// buffer and never allocates, so it can be used from trace hooks and worker
+// threads. Addresses are replaced with names when a symbol table is set.
+class Disassembler {
+public:
+    explicit Disassembler(const SymbolTable* symbols = nullptr) : m_symbols(symbols) {}
+
+    // Longest text decode() produces without symbols, including the NUL
+    static constexpr size_t MAX_TEXT_LENGTH = 20;
+
+    // Metadata of an opcode (cb selects the 0xCB-prefixed table)
+    static const OpcodeInfo& getInfo(u8 opcode, bool cb = false);
+
+    // Metadata of the instruction starting with these bytes (two needed for 0xCB)
+    static const OpcodeInfo& getInfo(const u8* bytes);
+
+    // Decode the instruction in bytes (at least its length) located at pc.
+    // romBank is the bank mapped at 0x4000 - 0x7FFF and selects symbols.
+    // Writes NUL-terminated text truncated to outSize, returns its length.
+    size_t decode(const u8* bytes, u16 pc, u8 romBank, char* out, size_t outSize) const;
+
+    // Symbol for an address given the mapped ROM bank, nullptr if none
+    const char* findSymbol(u16 address, u8 romBank) const;
+
+    void setSymbols(const SymbolTable* symbols) { m_symbols = symbols; }
+
+private:
+    const SymbolTable* m_symbols;
+};
+
+// Appends text to a fixed buffer, truncating and keeping room for the NUL
+class TextWriter {
+public:
+    TextWriter(char* out, size_t size)
+        : m_begin(out), m_pos(out), m_end(size ? out + size - 1 : out), m_terminate(size > 0) {}
+
+    void put(char c) {
+        if (m_pos < m_end) {
+            *m_pos++ = c;
+        }
+    }
+
+    void put(const char* text) {
+        while (*text && m_pos < m_end) {
+            *m_pos++ = *text++;
+        }
+    }
+
+    // Upper-case hex with a fixed number of digits
+    void hex(u32 value, int digits) {
+        static constexpr char HEX_DIGITS[] = "0123456789ABCDEF";
+        for (int shift = (digits - 1) * 4; shift >= 0; shift -= 4) {
+            put(HEX_DIGITS[(value >> shift) & 0xF]);
+        }
+    }
+
+    // Signed decimal
+    void decimal(int value) {
+        if (value < 0) {
+            put('-');
+            value = -value;
+        }
+        char digits[12];
+        int count = 0;
+        do {
+            digits[count++] = static_cast<char>('0' + value % 10);
+            value /= 10;
+        } while (value);
+        while (count) {
+            put(digits[--count]);
+        }
+    }
+
+    // Pad with spaces up to a column
+    void padTo(size_t column) {
+        while (length() < column) {
+            put(' ');
+            if (m_pos == m_end) {
+                break;
+            }
+        }
+    }
+
+    // Terminate and return the length
+    size_t finish() {
+        if (m_terminate) {
+            *m_pos = '\0';
+        }
+        return length();
+    }
+
+    size_t length() const { return static_cast<size_t>(m_pos - m_begin); }
+
+private:
+    char* m_begin;
+    char* m_pos;
+    char* m_end;
+    bool m_terminate;
+};
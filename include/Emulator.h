@@ -1,9 +1,8 @@
 #pragma once
 
 #include "Common.h"
-#include "CPU.h"
-#include "Memory.h"
-#include "PPU.h"
+#include "GameBoy.h"
+#include "Histogram.h"
 #include <WebView2.h>
 #include <wrl.h>
 #include <windows.h>
@@ -35,6 +34,23 @@ public:
     bool isPaused() const { return m_paused; }
     void togglePause() { m_paused = !m_paused; }
 
+    // Metrics, readable from any thread
+    const MetricsPublisher& getMetrics() const { return m_gameBoy.getMetrics(); }
+
+    // Frame timing histograms
+    const FrameTimeStats& getFrameStats() const { return m_frameStats; }
+    void dumpFrameStats(std::ostream& out) const { m_frameStats.dump(out); }
+    void resetFrameStats() { m_frameStats.reset(); }
+
+    // Host input event, timed until the next presented frame
+    void notifyInput();
+
+    // Write the recorded trace events as Chrome trace-event JSON
+    bool exportTrace(const std::string& filename) const;
+
+    // Write the machine state to the suspend file (GBWV2_SUSPEND)
+    bool suspend() const;
+
     // WebView2 event handlers
     HRESULT OnCreateWebView2ControlCompleted(HRESULT result, ICoreWebView2Controller* controller);
     HRESULT OnWebMessageReceived(ICoreWebView2* sender, ICoreWebView2WebMessageReceivedEventArgs* args);
@@ -47,6 +63,17 @@ private:
     bool m_initialized;
     bool m_paused;
     std::chrono::time_point<std::chrono::high_resolution_clock> m_lastFrameTime;
+
+    // Frame timing histograms
+    FrameTimeStats m_frameStats;
+    bool m_inputPending;
+    std::chrono::steady_clock::time_point m_inputTime;
+
+    // Trace file written on shutdown (GBWV2_TRACE)
+    std::string m_traceFile;
+    
+    // Suspend file written on shutdown and resumed on ROM load
+    std::string m_suspendFile;
     
     // WebView2 components
     Microsoft::WRL::ComPtr<ICoreWebView2Environment> m_webViewEnvironment;
@@ -55,8 +82,7 @@ private:
     HWND m_hwnd;
     
     // References to other components
-    CPU& m_cpu;
-    Memory& m_memory;
+    GameBoy& m_gameBoy;
     PPU& m_ppu;
     
     // Emulation methods
@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Common.h"
+
+// Binary execution trace: an ExecutionTraceHeader followed by one
+// ExecutionTraceEntry per executed instruction, in host (little-endian)
+// byte order. Decoded by the disassembler's TraceDecoder.
+
+// File header
+struct ExecutionTraceHeader {
+    char magic[4];      // "GBXT"
+    u16 version;
+    u16 entrySize;      // sizeof(ExecutionTraceEntry)
+};
+
+// One executed instruction, registers as they were before execution
+struct ExecutionTraceEntry {
+    u16 pc;
+    u8 romBank;         // ROM bank mapped at 0x4000 - 0x7FFF
+    u8 bytes[3];        // Instruction bytes, opcode first
+    u16 af;
+    u16 bc;
+    u16 de;
+    u16 hl;
+    u16 sp;
+};
+
+static_assert(sizeof(ExecutionTraceHeader) == 8, "ExecutionTraceHeader must be packed");
+static_assert(sizeof(ExecutionTraceEntry) == 16, "ExecutionTraceEntry must be packed");
+
+constexpr char EXECUTION_TRACE_MAGIC[4] = {'G', 'B', 'X', 'T'};
+constexpr u16 EXECUTION_TRACE_VERSION = 1;
+
+// Buffered writer for binary execution traces
+class ExecutionTraceWriter {
+public:
+    ExecutionTraceWriter() = default;
+    ~ExecutionTraceWriter();
+
+    // Delete copy constructor and assignment operator
+    ExecutionTraceWriter(const ExecutionTraceWriter&) = delete;
+    ExecutionTraceWriter& operator=(const ExecutionTraceWriter&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+    bool isOpen() const { return m_file.is_open(); }
+
+    // Append one entry
+    void record(const ExecutionTraceEntry& entry) {
+        m_buffer.push_back(entry);
+        if (m_buffer.size() == BUFFER_ENTRIES) {
+            flush();
+        }
+    }
+
+    u64 getEntryCount() const { return m_entryCount; }
+
+private:
+    static constexpr size_t BUFFER_ENTRIES = 4096;
+
+    std::ofstream m_file;
+    std::vector<ExecutionTraceEntry> m_buffer;
+    u64 m_entryCount = 0;
+
+    void flush();
+};
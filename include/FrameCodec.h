@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Common.h"
+
+// Frame encoding of the streaming server: shades packed at 2 bits per pixel
+// (pixel i in bits 2*(i%4) of byte i/4) and deltas between packed frames as
+// runs of changed bytes, each run {u16 skip, u16 length, length bytes}
+// little-endian, skip counted from the end of the previous run.
+
+constexpr size_t PACKED_FRAME_SIZE = static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT / 4;
+
+// Streaming protocol messages (first byte of every binary WebSocket message)
+enum StreamMessage : u8 {
+    STREAM_KEY_FRAME = 0x01,    // Server: header + packed frame
+    STREAM_DELTA_FRAME = 0x02,  // Server: header + runs against the previous frame sent
+    STREAM_ACK = 0x10,          // Client: 3 reserved bytes, u32 frame number, u64 send time of a frame it drew
+    STREAM_INPUT = 0x20         // Client: one byte of buttons held down (JoypadButton mask)
+};
+
+// Frame message header: type, 3 reserved bytes, u32 frame number, u32
+// checksum of the packed frame after decoding (low half of hashBytes), u64
+// server send time in microseconds (echoed back in the ack)
+constexpr size_t STREAM_HEADER_SIZE = 20;
+constexpr size_t STREAM_ACK_SIZE = 16;
+
+// Pack SCREEN_WIDTH x SCREEN_HEIGHT shades into PACKED_FRAME_SIZE bytes, and back
+void packFrame(const u8* shades, u8* packed);
+void unpackFrame(const u8* packed, u8* shades);
+
+// Runs of bytes that differ from the previous frame; returns the payload size,
+// or 0 when it would not be smaller than the packed frame (send that instead).
+// out needs PACKED_FRAME_SIZE bytes
+size_t encodeDelta(const u8* previous, const u8* current, u8* out);
+
+// Apply a delta payload to a packed frame; false if it is malformed
+bool applyDelta(const u8* delta, size_t size, u8* packed);
@@ -0,0 +1,134 @@
+#pragma once
+
+#include "Common.h"
+#include "Metrics.h"
+#include <atomic>
+
+// Frame ring in POSIX shared memory: the emulator publishes every completed
+// frame with a small header, and recorders, analyzers and overlays in other
+// processes read it without locks. Each slot is a seqlock (odd sequence =
+// write in progress), so the writer never waits for a reader; a reader that
+// falls more than a ring behind loses the oldest frames and sees it from the
+// frame numbers.
+
+constexpr u32 FRAME_RING_MAGIC = 0x52464247;    // "GBFR"
+constexpr u16 FRAME_RING_VERSION = 1;
+constexpr u32 FRAME_RING_DEFAULT_SLOTS = 8;
+constexpr size_t FRAME_PIXELS = static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT;
+
+static_assert(std::atomic<u64>::is_always_lock_free && std::atomic<u32>::is_always_lock_free,
+              "Shared-memory atomics must be lock-free");
+
+// What the emulator knew when the frame completed
+struct FrameInfo {
+    u64 frame = 0;              // Frames since the machine was created (the first is 1)
+    u64 cycles = 0;             // T-cycles run since the machine was created
+    u64 publishNanos = 0;       // CLOCK_MONOTONIC at publication
+    u64 checksum = 0;           // hashBytes of the pixels
+    u8 input = 0;               // Buttons held down (JoypadButton mask)
+    MachineMetrics metrics;
+};
+
+static_assert(std::is_trivially_copyable_v<FrameInfo>, "FrameInfo is copied with memcpy");
+
+// Start of the shared region, followed by slotCount slots of slotSize bytes
+struct FrameRingHeader {
+    u32 magic;
+    u16 version;
+    u16 headerSize;
+    u32 slotCount;
+    u32 slotSize;
+    u16 width;
+    u16 height;
+    u32 writerPid;
+    alignas(64) std::atomic<u64> latest;        // Last frame completely written (0 = none yet)
+    std::atomic<u32> closed;                    // Set when the writer is done
+};
+
+// One frame: the sequence is odd while the writer is inside the slot
+struct FrameSlot {
+    alignas(64) std::atomic<u32> sequence;
+    alignas(64) FrameInfo info;
+    alignas(64) u8 pixels[FRAME_PIXELS];        // Shades, 0 = lightest
+};
+
+// Publishes frames into a named ring (emulation thread only)
+class FrameRingWriter {
+public:
+    FrameRingWriter() = default;
+    ~FrameRingWriter();
+
+    // Delete copy constructor and assignment operator
+    FrameRingWriter(const FrameRingWriter&) = delete;
+    FrameRingWriter& operator=(const FrameRingWriter&) = delete;
+
+    // Create the ring ("/name"), replacing a stale one; close() marks it
+    // closed for readers and unlinks the name
+    bool open(const std::string& name, u32 slotCount = FRAME_RING_DEFAULT_SLOTS);
+    void close();
+    bool isOpen() const { return m_header != nullptr; }
+
+    // Copy a completed frame into the next slot; never waits for readers
+    void publish(const FrameInfo& info, const u8* pixels);
+
+private:
+    std::string m_name;
+    FrameRingHeader* m_header = nullptr;
+    u8* m_slots = nullptr;
+    size_t m_size = 0;
+};
+
+// Result of a read attempt
+enum class FrameReadStatus : u8 {
+    OK,
+    NOT_READY,      // The frame has not been published yet
+    OVERWRITTEN,    // The writer has moved past the frame
+    TORN            // The writer was inside the slot; try again
+};
+
+// Reads frames from a named ring (any number of processes)
+class FrameRingReader {
+public:
+    // Zero-copy view of a slot. The pixels may be rewritten at any time, so
+    // whatever was derived from them only counts if validate() still succeeds
+    struct View {
+        const FrameSlot* slot = nullptr;
+        u32 sequence = 0;
+        FrameInfo info;
+    };
+
+    FrameRingReader() = default;
+    ~FrameRingReader();
+
+    // Delete copy constructor and assignment operator
+    FrameRingReader(const FrameRingReader&) = delete;
+    FrameRingReader& operator=(const FrameRingReader&) = delete;
+
+    bool open(const std::string& name);
+    void close();
+
+    // Ring state
+    u32 getSlotCount() const { return m_header->slotCount; }
+    u64 getLatest() const { return m_header->latest.load(std::memory_order_acquire); }
+    bool isClosed() const { return m_header->closed.load(std::memory_order_acquire) != 0; }
+    u32 getWriterPid() const { return m_header->writerPid; }
+
+    // Start reading a frame in place; the info is copied and already consistent
+    FrameReadStatus acquire(u64 frame, View& view) const;
+
+    // Whether the slot still holds the frame the view was acquired for
+    bool validate(const View& view) const;
+
+    // Copy a frame out (retries torn reads)
+    FrameReadStatus read(u64 frame, FrameInfo& info, u8* pixels) const;
+
+private:
+    const FrameRingHeader* m_header = nullptr;
+    const u8* m_slots = nullptr;
+    size_t m_size = 0;
+
+    const FrameSlot* slot(u64 frame) const;
+};
+
+// CLOCK_MONOTONIC in nanoseconds (comparable between processes)
+u64 monotonicNanos();
@@ -0,0 +1,159 @@
+#pragma once
+
+#include "Common.h"
+#include "CodeAnalysis.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "PPU.h"
+#include "Scheduler.h"
+#include "Metrics.h"
+
+class FrameRingWriter;
+class PerfCounters;
+struct MachineState;
+
+// Portable emulation core: loads ROMs, runs frames and publishes metrics.
+// Frontends (the WebView2 window, the headless runner) drive it and only
+// add presentation on top. Every GameBoy is an independent machine.
+//
+// The object is the machine's whole mutable state in one cache-line-aligned
+// block, hottest first: the memory's control registers, I/O and HRAM, the
+// CPU's registers and counters, then the PPU (its mode ahead of the screen)
+// and the scheduler. The metrics bookkeeping follows, and the memory banks
+// (VRAM, WRAM, OAM and the bus counters) come last. What never changes
+// (opcode tables, ROM images) is shared by every machine in the process;
+// the cartridge RAM is the only other per-machine allocation.
+class alignas(64) GameBoy {
+public:
+    GameBoy();
+
+    // Shared machine driven by the frontend and the command line tools
+    static GameBoy& getInstance() {
+        static GameBoy instance;
+        return instance;
+    }
+
+    // Delete copy constructor and assignment operator
+    GameBoy(const GameBoy&) = delete;
+    GameBoy& operator=(const GameBoy&) = delete;
+
+    // Default opcode description file
+    static constexpr const char* DEFAULT_OPCODES_FILE = "resources/Opcodes.json";
+
+    // Emulation control
+    bool loadROM(const std::string& filename, const std::string& opcodesFile = DEFAULT_OPCODES_FILE);
+    bool loadROM(const u8* data, size_t size, const std::string& opcodesFile = DEFAULT_OPCODES_FILE);
+    void reset();
+    void emulateFrame();
+
+    // Run at least this many cycles (whole instructions), without frame
+    // bookkeeping; returns the cycles run
+    u32 runCycles(u32 cycles);
+
+    // Buttons held down (JoypadButton mask)
+    void setJoypad(u8 buttons) { m_memory.setJoypad(buttons); }
+
+    // Skip the boot ROM on the next reset, starting at 0x0100 with the post-boot state
+    void setFastBoot(bool enabled) { m_fastBoot = enabled; }
+    bool isFastBoot() const { return m_fastBoot; }
+
+    // Recognise copy and fill loops and run them as host copies (on by
+    // default; the machine state is the same either way)
+    void setLoopIdioms(bool enabled);
+
+    // Run the CPU, the PPU and the LY clock as coroutines on a shared
+    // scheduler instead of the callback loop (off by default; the machine
+    // state is the same either way). Runs with a serial device attached, or
+    // under M-cycle timing, keep the callback loop
+    void setCoroutineScheduling(bool enabled) { m_coroutineScheduling = enabled; }
+    bool isCoroutineScheduling() const { return m_coroutineScheduling && BUS_TIMING == BusTiming::LUMP_SUM; }
+    const Scheduler& getScheduler() const { return m_scheduler; }
+
+    // Analyse the loaded ROM's code so the CPU skips its idle loops (off
+    // until called; needs loop idioms on). A cache file, if given and made
+    // for this ROM, replaces the walk; saveCodeCache writes it back with the
+    // code found while running
+    bool analyzeCode(const std::string& cacheFile = "");
+    bool saveCodeCache(const std::string& filename) const;
+    const CodeAnalysis* getCodeAnalysis() const { return m_codeAnalysis.get(); }
+
+    // Suspend file with the full machine state; resume needs the same ROM loaded
+    bool suspend(const std::string& filename) const;
+    bool resume(const std::string& filename);
+
+    // The same image in a caller buffer (aligned to 8 bytes): size for the
+    // loaded ROM, save and load; 0 or false when there is no ROM or it does not fit
+    size_t getStateSize() const;
+    size_t saveState(u8* buffer, size_t size) const;
+    bool loadState(const u8* buffer, size_t size);
+
+    // Host time and frames from the last reset or resume to the end of the
+    // first frame run entirely by the game (0 until then)
+    std::chrono::nanoseconds getStartupTime() const { return std::chrono::nanoseconds(m_startupNanos); }
+    u64 getStartupFrames() const { return m_startupFrames; }
+
+    // Components
+    CPU& getCPU() { return m_cpu; }
+    Memory& getMemory() { return m_memory; }
+    PPU& getPPU() { return m_ppu; }
+    const PPU& getPPU() const { return m_ppu; }
+
+    // Metrics
+    u64 getFrameCount() const { return m_frameCount; }
+    u64 getCycleCount() const { return m_cycleCount; }
+    void addPresentTime(std::chrono::nanoseconds duration);
+    const MetricsPublisher& getMetrics() const { return m_metricsPublisher; }
+    bool startMetricsExport(const std::string& target, std::chrono::milliseconds interval);
+    void stopMetricsExport() { m_metricsExporter.stop(); }
+
+    // Hardware performance counters sampled around the PPU phase (optional)
+    void setPerfCounters(PerfCounters* perfCounters);
+
+    // Shared-memory ring every completed frame is published to; nullptr detaches
+    void setFrameRing(FrameRingWriter* frameRing) { m_frameRing = frameRing; }
+
+    // Device on the link port (serial capture, link cable); nullptr detaches
+    void setSerialDevice(SerialDevice* device) { m_memory.setSerialDevice(device); }
+
+private:
+    // Components; the memory comes first because the others are built
+    // with a reference to it. Its banks are at the end of the object
+    Memory m_memory;
+    CPU m_cpu;
+    PPU m_ppu;
+    Scheduler m_scheduler;
+    bool m_coroutineScheduling;
+
+    // Boot
+    bool m_fastBoot;
+    std::chrono::steady_clock::time_point m_resetTime;
+    u64 m_startupNanos;
+    u64 m_startupFrames;
+    u64 m_resetFrame;
+    u64 m_romHash;
+
+    // Code analysis of the loaded ROM (optional)
+    std::unique_ptr<CodeAnalysis> m_codeAnalysis;
+
+    // Metrics
+    u64 m_frameCount;
+    u64 m_cycleCount;
+    u64 m_frameNanos;
+    u64 m_presentNanos;
+    MetricsPublisher m_metricsPublisher;
+    MetricsExporter m_metricsExporter;
+    FrameRingWriter* m_frameRing;
+
+    // Large memories and bus counters the memory points into (cold)
+    MemoryBanks m_banks;
+
+    // Advance the PPU and the serial port (after each step, or at each bus
+    // access under M-cycle timing)
+    void advanceDevices(u32 cycles);
+    static void tickDevices(void* context, u32 cycles) { static_cast<GameBoy*>(context)->advanceDevices(cycles); }
+
+    void publishMetrics();
+    bool finishLoad(const std::string& opcodesFile);
+    void captureState(MachineState& state) const;
+    void restoreState(const MachineState& state, const u8* ram);
+};
@@ -0,0 +1,67 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <chrono>
+
+// Log-bucketed latency histogram in the style of HdrHistogram. Every power of
+// two is split into 16 linear sub-buckets, so any recorded value is reported
+// with less than 6.25% relative error across the whole u64 range.
+// Recording is lock-free and meant for a single writer; summaries can be
+// taken from any thread.
+class LatencyHistogram {
+public:
+    static constexpr u32 SUB_BUCKET_BITS = 4;
+    static constexpr u32 SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+    static constexpr u32 BUCKET_COUNT = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_COUNT;
+
+    // Percentile summary (values in the recorded unit)
+    struct Summary {
+        u64 count;
+        u64 p50;
+        u64 p90;
+        u64 p99;
+        u64 max;
+    };
+
+    LatencyHistogram();
+
+    // Delete copy constructor and assignment operator
+    LatencyHistogram(const LatencyHistogram&) = delete;
+    LatencyHistogram& operator=(const LatencyHistogram&) = delete;
+
+    // Record a value
+    void record(u64 value);
+    void record(std::chrono::nanoseconds duration) { record(static_cast<u64>(std::max<i64>(duration.count(), 0))); }
+
+    // Clear all buckets
+    void reset();
+
+    // Statistics
+    u64 count() const;
+    u64 max() const { return m_max.load(std::memory_order_relaxed); }
+    u64 percentile(double percent) const;
+    Summary summarize() const;
+
+    // Bucket mapping
+    static u32 bucketIndex(u64 value);
+    static u64 bucketUpperBound(u32 index);
+
+private:
+    std::array<std::atomic<u64>, BUCKET_COUNT> m_buckets;
+    std::atomic<u64> m_max;
+};
+
+// Frame timing histograms kept by the emulation loop (nanoseconds)
+struct FrameTimeStats {
+    LatencyHistogram emulation;       // emulateFrame
+    LatencyHistogram presentation;    // updateScreen
+    LatencyHistogram pacingError;     // |frame interval - target interval|
+    LatencyHistogram inputToPresent;  // host input event to the next presented frame
+
+    // Clear all histograms
+    void reset();
+
+    // Write a p50/p90/p99/max table in microseconds
+    void dump(std::ostream& out) const;
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include "Common.h"
+
+// CRC-32 (IEEE 802.3, as used by gzip and zip); pass the previous value to continue
+u32 crc32(const u8* data, size_t size, u32 crc = 0);
+
+// Raw DEFLATE (RFC 1951) decoder. The whole output buffer doubles as the
+// history window, so the caller sizes it up front and nothing is allocated
+// while decoding.
+class Inflater {
+public:
+    // Decode one stream. On success written holds the output size and
+    // consumed the compressed bytes read; on failure error says why.
+    static bool inflate(const u8* input, size_t inputSize, u8* output, size_t outputSize,
+                        size_t& written, size_t& consumed, std::string& error);
+};
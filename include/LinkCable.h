@@ -0,0 +1,80 @@
+#pragma once
+
+#include "Common.h"
+#include "Memory.h"
+#include "Serial.h"
+#include <atomic>
+
+class GameBoy;
+
+// Link cable between two machines in the same process, each emulated on its
+// own thread. The machines are kept in step conservatively: neither runs
+// more than the quantum ahead of the other's published cycle count, and
+// they only meet at slice boundaries (a scanline of cycles) instead of every
+// instruction. A transfer on the internal clock is posted to the other end
+// when it starts, so that end stops exactly at its completion, shifts the
+// byte into a transfer waiting on the external clock (or answers 0xFF when
+// there is none) and hands its own byte back. With a quantum of at most one
+// transfer time every exchange happens at the same cycle count on both
+// machines, whatever the thread scheduling. All handoffs are single-writer
+// atomics.
+class LinkCable {
+public:
+    static constexpr u32 DEFAULT_QUANTUM = Memory::SERIAL_TRANSFER_CYCLES;
+
+    // Plug both machines in (replaces their serial devices)
+    LinkCable(GameBoy& first, GameBoy& second, u32 quantum = DEFAULT_QUANTUM);
+    ~LinkCable();
+
+    // Delete copy constructor and assignment operator
+    LinkCable(const LinkCable&) = delete;
+    LinkCable& operator=(const LinkCable&) = delete;
+
+    // A machine that stops emulating must leave, or the other waits for it
+    // forever; the other end then runs free and its transfers read 0xFF
+    void leave(u32 side);
+
+    // Counters of one end (read once its thread has stopped)
+    struct Stats {
+        u64 sent = 0;               // Transfers on the internal clock
+        u64 received = 0;           // Transfers clocked by the other end
+        u64 waits = 0;              // Slices that had to wait for the other end
+        u64 waitNanos = 0;
+    };
+    const Stats& getStats(u32 side) const { return m_ports[side].stats; }
+
+private:
+    static constexpr u64 NO_EVENT = ~0ull;
+    static constexpr u32 NO_REPLY = 0x100;
+
+    // One end of the cable, the serial device of its machine
+    class Port : public SerialDevice {
+    public:
+        GameBoy* gameBoy = nullptr;
+        Port* other = nullptr;
+        u64 base = 0;               // Machine cycle count when plugged in
+        u32 quantum = DEFAULT_QUANTUM;
+        bool sending = false;
+        Stats stats;
+
+        // Written by this end: cycles run since plugged in (NO_EVENT once it left)
+        alignas(64) std::atomic<u64> cycles{0};
+        std::atomic<bool> left{false};
+
+        // Written by the other end: a transfer it clocks at eventCycles (our
+        // cycles), and the reply to ours
+        alignas(64) std::atomic<u64> eventCycles{NO_EVENT};
+        std::atomic<u8> eventData{0xFF};
+        std::atomic<u32> reply{NO_REPLY};
+
+        u8 transfer(u8 outgoing) override;
+        void startTransfer(u8 outgoing) override;
+        u64 synchronize(u64 now) override;
+
+    private:
+        void service(u64 now);
+        void wait(u32& spins);
+    };
+
+    Port m_ports[2];
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common.h"
+
+// 64-bit hash of a byte range, a word at a time (ROM identity, checksums)
+u64 hashBytes(const void* data, size_t size, u64 seed = 0);
+
+// Read-only memory-mapped file (read into memory where mmap is unavailable)
+class MappedFile {
+public:
+    MappedFile() = default;
+    ~MappedFile();
+
+    // Delete copy constructor and assignment operator
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    bool open(const std::string& filename);
+    void close();
+
+    const u8* data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+private:
+    const u8* m_data = nullptr;
+    size_t m_size = 0;
+    bool m_mapped = false;
+    std::vector<u8> m_buffer;
+};
@@ -1,19 +1,41 @@
 #pragma once
 
 #include "Common.h"
+#include "Metrics.h"
 
 // Forward declarations
 class Cartridge;
 class PPU;
+class SerialDevice;
+
+// Joypad buttons (bit mask for setJoypad, set = pressed)
+enum JoypadButton : u8 {
+    JOYPAD_RIGHT = 0x01,
+    JOYPAD_LEFT = 0x02,
+    JOYPAD_UP = 0x04,
+    JOYPAD_DOWN = 0x08,
+    JOYPAD_A = 0x10,
+    JOYPAD_B = 0x20,
+    JOYPAD_SELECT = 0x40,
+    JOYPAD_START = 0x80
+};
+
+// Large memories and bus counters of one machine. They are touched far
+// less often than the memory's registers, so the owner keeps them apart
+// from the hot state (GameBoy declares them after all of its components)
+struct MemoryBanks {
+    std::array<u8, OAM_SIZE> oam;       // Object Attribute Memory (160B)
+    std::array<u8, VRAM_SIZE> vram;     // Video RAM (8KB)
+    std::array<u8, WRAM_SIZE> wram;     // Work RAM (8KB)
+    BusCounters busCounters;
+};
 
 // Memory Management Unit (MMU) class
 class Memory {
 public:
-    // Meyer's Singleton pattern
-    static Memory& getInstance() {
-        static Memory instance;
-        return instance;
-    }
+    // Only keeps the banks, which may not be constructed yet (hence the
+    // pointer); nothing is usable before reset()
+    explicit Memory(MemoryBanks* banks);
 
     // Delete copy constructor and assignment operator
     Memory(const Memory&) = delete;
@@ -23,40 +45,167 @@ public:
     u8 read(u16 address) const;
     void write(u16 address, u8 value);
 
+    // Read without counting the access (tracing, debuggers)
+    u8 peek(u16 address) const;
+
+    // ROM bank currently mapped at 0x4000 - 0x7FFF
+    u8 getMappedROMBank() const;
+
+    // Plain region around an address: boot ROM, cartridge ROM (read only),
+    // VRAM, WRAM or HRAM, which the bus accesses without side effects. The
+    // CPU fetches and stacks through windows; accesses made that way bump
+    // the region's bus counters. RAM windows never move, ROM windows move
+    // when the mapping generation changes (bank switches, boot ROM unmapped)
+    struct Window {
+        u16 base = 0;
+        u16 size = 0;                   // 0: no plain region there
+        const u8* data = nullptr;       // Byte at base
+        u8* writable = nullptr;         // Same bytes, nullptr for ROM
+        u64* reads = nullptr;
+        u64* writes = nullptr;
+    };
+
+    Window getWindow(u16 address);
+    u32 getMappingGeneration() const { return m_mappingGeneration; }
+
+    // Host pointer to length bytes of one plain region (writes: RAM only);
+    // nullptr when the run leaves it. Accesses made through a span are
+    // counted with countAccesses
+    const u8* getReadSpan(u16 address, u32 length);
+    u8* getWriteSpan(u16 address, u32 length);
+    void countAccesses(u16 address, u32 reads, u32 writes);
+
+    // Count the reads of one pass of a loop again, times over (skipped idle loops)
+    void repeatReads(const std::array<u32, BUS_REGION_COUNT>& reads, u32 times) {
+        for (size_t i = 0; i < BUS_REGION_COUNT; i++) {
+            m_banks.busCounters.reads[i] += static_cast<u64>(reads[i]) * times;
+        }
+    }
+
     // Load ROM file
     bool loadROM(const std::string& filename);
 
+    // Load a ROM image (plain, gzip or zip) from memory
+    bool loadROM(const u8* data, size_t size);
+
     // Boot ROM control
     void disableBootROM();
     bool isBootROMEnabled() const { return m_bootROMEnabled; }
 
+    // Seed the post-boot I/O registers and logo tiles and unmap the boot ROM
+    void skipBootROM();
+
     // Reset memory
     void reset();
     
     // PPU timing (kept for compatibility)
     void updatePPU(u32 cycles);
 
+    // Cycles until the VBlank interrupt or the serial port next change anything
+    u32 cyclesUntilEvent() const;
+
+    // Cycles until LY next changes
+    u32 cyclesUntilNextLine() const { return SCANLINE_CYCLES - m_ppuCycles % SCANLINE_CYCLES; }
+
+    // On the line where every update requests VBlank
+    bool isVBlankLine() const { return m_ppuCycles % (SCANLINE_CYCLES * SCANLINE_COUNT) / SCANLINE_CYCLES == VBLANK_START; }
+
+    // Serial transfer timing (8 bits at 8192 Hz)
+    static constexpr u32 SERIAL_TRANSFER_CYCLES = 4096;
+    void updateSerial(u32 cycles) {
+        if (m_serialCycles != 0) {
+            clockSerial(cycles);
+        }
+    }
+
+    // Device on the link port (nullptr: no cable, transfers read 0xFF)
+    void setSerialDevice(SerialDevice* device) { m_serialDevice = device; }
+
+    // External clock: the other end shifted a byte in; returns the byte shifted out
+    u8 receiveSerial(u8 incoming);
+    SerialDevice* getSerialDevice() const { return m_serialDevice; }
+
+    // Interrupts both requested (IF) and enabled (IE), kept up to date on
+    // every change so the CPU never has to read the registers
+    u8 getPendingInterrupts() const { return m_pendingInterrupts; }
+
+    // Set or clear an IF bit (0 VBlank, 1 STAT, 2 timer, 3 serial, 4 joypad)
+    void requestInterrupt(u8 interrupt);
+    void acknowledgeInterrupt(u8 interrupt);
+
+    // Buttons held down (JoypadButton mask); pressing a selected button requests the joypad interrupt
+    void setJoypad(u8 buttons);
+    u8 getJoypad() const { return m_joypad; }
+
+    // RAM regions, valid for the lifetime of this Memory (IF written through
+    // getIO is only seen by the CPU after the next IF or IE change)
+    u8* getVRAM() { return m_banks.vram.data(); }
+    u8* getWRAM() { return m_banks.wram.data(); }
+    u8* getOAM() { return m_banks.oam.data(); }
+    u8* getIO() { return m_io.data(); }
+    u8* getHRAM() { return m_hram.data(); }
+
+    // Metrics
+    const BusCounters& getBusCounters() const { return m_banks.busCounters; }
+
+    // Loaded cartridge (nullptr before a ROM is loaded)
+    const Cartridge* getCartridge() const { return m_cartridge.get(); }
+    Cartridge* getCartridge() { return m_cartridge.get(); }
+
+    // Plain state block (suspend files); cartridge RAM is kept by the cartridge
+    struct State {
+        std::array<u8, VRAM_SIZE> vram;
+        std::array<u8, WRAM_SIZE> wram;
+        std::array<u8, OAM_SIZE> oam;
+        std::array<u8, IO_SIZE> io;
+        std::array<u8, HRAM_SIZE> hram;
+        u8 ie;
+        bool bootROMEnabled;
+        u32 ppuCycles;
+        u32 serialCycles;
+    };
+
+    void saveState(State& state) const;
+    void loadState(const State& state);
+
     // Friend class
     friend class PPU;
 
 private:
-    // Private constructor for singleton
-    Memory();
+    // Cold part: large memories and bus counters (written by const reads
+    // too, which the reference allows)
+    MemoryBanks& m_banks;
 
-    // Memory regions
+    // Hot state: cartridge, control registers, I/O and HRAM
     std::unique_ptr<Cartridge> m_cartridge;
-    std::array<u8, VRAM_SIZE> m_vram;     // Video RAM (8KB)
-    std::array<u8, WRAM_SIZE> m_wram;     // Work RAM (8KB)
-    std::array<u8, OAM_SIZE> m_oam;       // Object Attribute Memory (160B)
-    std::array<u8, IO_SIZE> m_io;         // I/O Registers (128B)
-    std::array<u8, HRAM_SIZE> m_hram;     // High RAM (127B)
     u8 m_ie;                              // Interrupt Enable register
+    u8 m_pendingInterrupts;               // IF & IE
+    void updatePendingInterrupts() { m_pendingInterrupts = m_io[0x0F] & m_ie & 0x1F; }
 
     // Boot ROM control
     bool m_bootROMEnabled;
+
+    // Bumped whenever different ROM bytes appear in the address space
+    u32 m_mappingGeneration;
+
+    // Joypad: buttons held down; P1 (FF00) shows the groups it selects
+    u8 m_joypad;
+    void updateJoypad();
     
     // PPU state (kept for compatibility)
     u32 m_ppuCycles;                      // PPU cycle counter
+
+    // Serial port: cycles until the current transfer completes (0 = idle)
+    u32 m_serialCycles;
+    SerialDevice* m_serialDevice;
+    void clockSerial(u32 cycles);
+
+    std::array<u8, IO_SIZE> m_io;         // I/O Registers (128B)
+    std::array<u8, HRAM_SIZE> m_hram;     // High RAM (127B)
+
+    // Address decoding shared by read and peek
+    template <bool CountAccess>
+    u8 readBus(u16 address) const;
     
     // PPU constants
     static constexpr u32 SCANLINE_CYCLES = 456;  // Cycles per scanline
@@ -76,33 +225,82 @@ public:
         UNKNOWN
     };
 
-    Cartridge(const std::vector<u8>& romData);
+    // Cartridge header fields (0x0134 - 0x014F)
+    struct Header {
+        std::string title;
+        Type type;
+        u8 cartridgeType;           // Raw type code (0x0147)
+        u8 romSizeCode;             // 0x0148
+        u8 ramSizeCode;             // 0x0149
+        u8 romBanks;
+        u8 ramBanks;
+        u8 headerChecksum;          // 0x014D
+        u16 globalChecksum;         // 0x014E - 0x014F
+        bool headerChecksumValid;
+        bool globalChecksumValid;
+    };
+
+    // Parse the header of a ROM image; false if it is too small to have one
+    static bool parseHeader(const u8* data, size_t size, Header& header);
+
+    // Decode the type (0x0147) and size (0x0148, 0x0149) codes into a header
+    static void setHeaderCodes(u8 cartridgeType, u8 romSizeCode, u8 ramSizeCode, Header& header);
+
+    static const char* typeName(Type type);
+
+    // Mappers with bank switching emulated (the others keep bank 1 at 0x4000)
+    static bool isSupported(Type type);
+
+    Cartridge(std::vector<u8> romData);
     ~Cartridge() = default;
 
     // Memory access
     u8 read(u16 address) const;
     void write(u16 address, u8 value);
 
+    // ROM bytes mapped at an address (nullptr if the run leaves its bank or the image)
+    const u8* getROMSpan(u16 address, u32 length) const;
+
     // Cartridge info
     Type getType() const { return m_type; }
+    u8 getCartridgeType() const { return m_cartridgeType; }
     const std::string& getTitle() const { return m_title; }
     u8 getROMBanks() const { return m_romBanks; }
     u8 getRAMBanks() const { return m_ramBanks; }
+    u8 getROMBank() const { return m_romBank; }
+    u8 getRAMBank() const { return m_ramBank; }
 
-private:
-    // ROM and RAM data
-    std::vector<u8> m_rom;
-    std::vector<u8> m_ram;
+    // Cartridge contents (the ROM image is shared by every cartridge loaded from it)
+    const std::vector<u8>& getROM() const { return *m_rom; }
+    std::vector<u8>& getRAM() { return m_ram; }
+    const std::vector<u8>& getRAM() const { return m_ram; }
 
-    // Cartridge info
-    Type m_type;
-    std::string m_title;
-    u8 m_romBanks;
-    u8 m_ramBanks;
+    // Plain state block (suspend files); RAM contents are stored separately
+    struct State {
+        u8 romBank;
+        u8 ramBank;
+        bool ramEnabled;
+        bool romBankingMode;
+    };
+
+    void saveState(State& state) const;
+    void loadState(const State& state);
 
-    // MBC state
+private:
+    // Hot state first: ROM bytes and MBC state
+    const u8* m_romData;
+    size_t m_romSize;
     u8 m_romBank;
     u8 m_ramBank;
     bool m_ramEnabled;
     bool m_romBankingMode;
+    Type m_type;
+    u8 m_ramBanks;
+    std::vector<u8> m_ram;
+
+    // Cartridge info
+    std::shared_ptr<const std::vector<u8>> m_rom;
+    u8 m_cartridgeType;
+    std::string m_title;
+    u8 m_romBanks;
 }; 
\ No newline at end of file
@@ -0,0 +1,144 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <type_traits>
+
+// Bus regions tracked by the memory counters
+enum class BusRegion : u8 {
+    BOOT_ROM = 0,
+    ROM_BANK0,
+    ROM_BANKN,
+    VRAM,
+    EXTERNAL_RAM,
+    WRAM,
+    OAM,
+    UNUSABLE,
+    IO,
+    HRAM,
+    IE,
+    COUNT
+};
+
+constexpr size_t BUS_REGION_COUNT = static_cast<size_t>(BusRegion::COUNT);
+
+// Interrupt sources in IF/IE bit order
+constexpr size_t INTERRUPT_COUNT = 5;
+
+// Names used when exporting the counters
+const char* busRegionName(BusRegion region);
+const char* interruptName(size_t interrupt);
+
+// CPU counters, owned and updated by the emulation thread
+struct CPUCounters {
+    u64 instructions = 0;
+    u64 haltedCycles = 0;
+    u64 loopIterations = 0;         // Copy and fill loop iterations run in bulk
+    u64 idleIterations = 0;         // Idle loop passes skipped
+    std::array<u64, INTERRUPT_COUNT> interrupts{};
+};
+
+// Opcodes executed without an implementation (they run as NOP), indexed by
+// opcode with the CB-prefixed ones at 256 + opcode
+constexpr size_t OPCODE_SLOTS = 512;
+
+struct UnimplementedOpcodeCounters {
+    std::array<u64, OPCODE_SLOTS> hits{};
+    std::array<u16, OPCODE_SLOTS> firstPC{};    // Address of the first execution
+};
+
+// Bus counters for guest (CPU) accesses, owned and updated by the emulation
+// thread; the PPU reads and updates its registers without counting
+struct BusCounters {
+    std::array<u64, BUS_REGION_COUNT> reads{};
+    std::array<u64, BUS_REGION_COUNT> writes{};
+    u64 bankSwitches = 0;
+    std::array<u64, IO_SIZE> unhandledIOWrites{};   // Registers that are stored but not emulated
+};
+
+// PPU counters, owned and updated by the emulation thread
+struct PPUCounters {
+    u64 scanlinesRendered = 0;
+    u64 scanlinesSkipped = 0;
+    u64 renderNanos = 0;
+};
+
+// Snapshot of all machine counters, published once per frame.
+// Every field is a monotonically increasing u64 so the struct can be
+// copied word by word through the publisher.
+struct MachineMetrics {
+    u64 frames = 0;
+    u64 instructions = 0;
+    u64 haltedCycles = 0;
+    std::array<u64, BUS_REGION_COUNT> busReads{};
+    std::array<u64, BUS_REGION_COUNT> busWrites{};
+    u64 bankSwitches = 0;
+    u64 scanlinesRendered = 0;
+    u64 scanlinesSkipped = 0;
+    std::array<u64, INTERRUPT_COUNT> interrupts{};
+    u64 cpuNanos = 0;
+    u64 ppuNanos = 0;
+    u64 presentNanos = 0;
+};
+
+static_assert(std::is_trivially_copyable_v<MachineMetrics>, "MachineMetrics is copied with memcpy");
+static_assert(sizeof(MachineMetrics) % sizeof(u64) == 0, "MachineMetrics must be made of u64 words");
+
+// Single-writer, multi-reader metrics slot. The emulation thread publishes a
+// snapshot at the end of every frame; any other thread can read a consistent
+// copy without locking (seqlock over relaxed atomic words).
+class MetricsPublisher {
+public:
+    MetricsPublisher();
+
+    // Publish a new snapshot (emulation thread only)
+    void publish(const MachineMetrics& metrics);
+
+    // Read the latest consistent snapshot (any thread)
+    MachineMetrics snapshot() const;
+
+private:
+    static constexpr size_t WORD_COUNT = sizeof(MachineMetrics) / sizeof(u64);
+
+    std::atomic<u32> m_sequence;
+    std::array<std::atomic<u64>, WORD_COUNT> m_words;
+};
+
+// Periodically writes the published metrics in the Prometheus text format.
+// The target is either a file path (rewritten atomically every interval) or
+// "unix:<path>", a Unix socket that serves the latest snapshot to every
+// client that connects.
+class MetricsExporter {
+public:
+    explicit MetricsExporter(const MetricsPublisher& publisher);
+    ~MetricsExporter();
+
+    // Delete copy constructor and assignment operator
+    MetricsExporter(const MetricsExporter&) = delete;
+    MetricsExporter& operator=(const MetricsExporter&) = delete;
+
+    // Start and stop the exporter thread
+    bool start(const std::string& target, std::chrono::milliseconds interval);
+    void stop();
+    bool isRunning() const { return m_running; }
+
+    // Format a snapshot in the Prometheus text exposition format
+    static std::string format(const MachineMetrics& metrics);
+
+private:
+    const MetricsPublisher& m_publisher;
+    std::string m_target;
+    std::chrono::milliseconds m_interval;
+    std::atomic<bool> m_running;
+    std::thread m_thread;
+    int m_socket;
+
+    // Exporter thread body
+    void exportLoop();
+    bool writeFile(const std::string& text);
+    bool openSocket(const std::string& path);
+    void serveSocket();
+    void closeSocket();
+};
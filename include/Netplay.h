@@ -0,0 +1,179 @@
+#pragma once
+
+#include "Common.h"
+#include "Histogram.h"
+#include <deque>
+#include <random>
+
+class GameBoy;
+
+// UDP link to the other peer of a netplay session, with optional simulated
+// delay, jitter and loss on the outgoing side for testing over loopback.
+// Non-blocking; POSIX only.
+class NetplaySocket {
+public:
+    NetplaySocket() = default;
+    ~NetplaySocket();
+
+    // Delete copy constructor and assignment operator
+    NetplaySocket(const NetplaySocket&) = delete;
+    NetplaySocket& operator=(const NetplaySocket&) = delete;
+
+    bool open(const std::string& localAddress, u16 localPort, const std::string& remoteAddress, u16 remotePort);
+    void close();
+
+    // Delay every packet by delay +- jitter and drop a fraction of them
+    void setImpairment(u32 delayMillis, u32 jitterMillis, double lossRate, u32 seed);
+
+    // Send a datagram (possibly delayed or dropped); receive one, 0 when none is waiting
+    void send(const u8* data, size_t size);
+    size_t receive(u8* buffer, size_t capacity);
+
+    // Send delayed packets that are due
+    void flush();
+
+    // Datagrams
+    u64 getSent() const { return m_sent; }
+    u64 getDropped() const { return m_dropped; }
+    u64 getReceived() const { return m_received; }
+
+private:
+    struct DelayedPacket {
+        std::chrono::steady_clock::time_point due;
+        std::vector<u8> data;
+    };
+
+    int m_socket = -1;
+    u32 m_delayMillis = 0;
+    u32 m_jitterMillis = 0;
+    double m_lossRate = 0.0;
+    std::mt19937 m_random;
+    std::deque<DelayedPacket> m_delayed;
+    u64 m_sent = 0;
+    u64 m_dropped = 0;
+    u64 m_received = 0;
+
+    void transmit(const u8* data, size_t size);
+};
+
+// Session settings; both peers must use the same input delay
+struct NetplayConfig {
+    u8 localPlayer = 0;             // 0 or 1; the other peer is the other player
+    u32 inputDelay = 1;             // Frames between reading local input and using it
+    u32 maxRollback = 8;            // Frames simulated ahead of the remote input before stalling
+    u32 checksumInterval = 30;      // Frames between state checksums exchanged to detect desync
+};
+
+// Rollback counters (histograms in frames and nanoseconds)
+struct NetplayStats {
+    u64 frames = 0;                 // Frames simulated for the first time
+    u64 stalls = 0;                 // Host frames spent waiting for the remote peer
+    u64 rollbacks = 0;
+    u64 resimulatedFrames = 0;
+    u64 mispredictions = 0;         // Remote inputs that differed from the prediction
+    u64 overBudget = 0;             // Host frames whose rollback took longer than a frame
+    u64 saves = 0;
+    u64 restores = 0;
+    u64 saveNanos = 0;
+    u64 restoreNanos = 0;
+    u64 checksumsCompared = 0;
+    LatencyHistogram rollbackDepth;
+    LatencyHistogram resimulationNanos;     // Per host frame with a rollback
+};
+
+// Rollback netplay over two machines, one per player, each driven by its
+// player's buttons. Local input is used at once; the remote player's input
+// is predicted (the last confirmed one) and, when the real input arrives
+// and differs, the machines go back to the saved state of that frame and
+// simulate forward again within the same host frame. Every packet carries
+// all local inputs the peer has not acknowledged (losses are covered by the
+// next packet), plus the latest confirmed state checksum so desyncs show up.
+// States live in a ring of preallocated suspend images.
+class NetplaySession {
+public:
+    NetplaySession(GameBoy& player1, GameBoy& player2, NetplaySocket& socket, const NetplayConfig& config);
+
+    // Delete copy constructor and assignment operator
+    NetplaySession(const NetplaySession&) = delete;
+    NetplaySession& operator=(const NetplaySession&) = delete;
+
+    // Size the state ring for the loaded ROMs; false if a machine has no ROM
+    bool start();
+
+    // Run one host frame with the local buttons; false if it stalled waiting
+    // for the remote peer (the input is kept for the next call)
+    bool advanceFrame(u8 localInput);
+
+    // Receive and send without simulating (while shutting down)
+    void poll();
+
+    // Next frame to simulate, and frames with both inputs confirmed
+    u64 getFrame() const { return m_frame; }
+    u64 getConfirmedFrames() const { return std::min(m_frame, m_remoteFrames); }
+
+    // Checksum of the confirmed state at the start of a frame (a multiple
+    // of the checksum interval still in the history); false if not known
+    bool getChecksum(u64 frame, u64& checksum) const;
+
+    // First frame whose checksum differed between the peers
+    bool isDesynced() const { return m_desynced; }
+    u64 getDesyncFrame() const { return m_desyncFrame; }
+
+    size_t getStateSize() const { return m_imageSize * 2; }
+    const NetplayStats& getStats() const { return m_stats; }
+
+private:
+    // Frames of input and checksums kept
+    static constexpr u32 INPUT_HISTORY = 256;
+    static constexpr u32 CHECKSUM_HISTORY = 16;
+    static constexpr u32 MAX_INPUTS_PER_PACKET = 64;
+
+    struct FrameInput {
+        u64 frame = ~0ull;          // Frame the entry currently holds
+        u8 buttons[2] = {0, 0};
+        u8 used[2] = {0, 0};        // What the frame was simulated with
+        bool confirmed[2] = {false, false};
+    };
+
+    std::array<GameBoy*, 2> m_machines;
+    NetplaySocket& m_socket;
+    NetplayConfig m_config;
+    u8 m_remotePlayer;
+
+    // Inputs by frame (ring), local frames filled and remote frames confirmed in order
+    std::array<FrameInput, INPUT_HISTORY> m_inputs;
+    u64 m_frame;
+    u64 m_localFrames;
+    u64 m_remoteFrames;
+    u64 m_peerAcked;                // Local frames the peer has confirmed
+    u64 m_rollbackFrame;            // Earliest mispredicted frame (m_frame when none)
+
+    // States at the start of the last frames (ring of both machines' images,
+    // each padded to m_imageSize)
+    std::array<size_t, 2> m_imageSizes;
+    size_t m_imageSize;
+    u32 m_stateSlots;
+    std::vector<u64> m_states;
+
+    // Confirmed checksums, ours and the peer's
+    std::deque<std::pair<u64, u64>> m_checksums;
+    std::deque<std::pair<u64, u64>> m_peerChecksums;
+    u64 m_nextChecksum;
+    u64 m_checkedFrames;            // Peer checksums before this frame were compared
+    bool m_desynced;
+    u64 m_desyncFrame;
+
+    NetplayStats m_stats;
+
+    FrameInput& input(u64 frame);
+    u8* stateSlot(u64 frame);
+
+    void receivePackets();
+    void sendPacket();
+    void saveFrame(u64 frame);
+    void loadFrame(u64 frame);
+    void simulateFrame(u64 frame);
+    void rollback();
+    void recordChecksums();
+    void compareChecksums();
+};
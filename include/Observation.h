@@ -0,0 +1,94 @@
+#pragma once
+
+#include "Common.h"
+
+// Observation layout: a crop of the screen resampled to width x height, with
+// the last stack frames side by side
+struct ObservationConfig {
+    u16 cropX = 0;
+    u16 cropY = 0;
+    u16 cropWidth = SCREEN_WIDTH;
+    u16 cropHeight = SCREEN_HEIGHT;
+    u16 width = 84;
+    u16 height = 84;
+    u8 stack = 4;               // Frames per observation
+    bool maxPool = false;       // Pixel-wise max with the previous frame seen
+};
+
+// Turns PPU shade buffers into frame-stacked grayscale observations for
+// training jobs: stack x height x width bytes, oldest frame first, 255 for
+// the lightest shade. Each frame is cropped, max-pooled with the previous
+// one if enabled and area-resampled in fixed point (vertical pass, then
+// horizontal) into a ring of the last stack frames. Buffers and filter taps
+// are set up by the constructor, so observing never allocates. AVX2 is used
+// when the CPU has it; the scalar path gives identical results.
+class ObservationPipeline {
+public:
+    explicit ObservationPipeline(const ObservationConfig& config);
+
+    // Delete copy constructor and assignment operator
+    ObservationPipeline(const ObservationPipeline&) = delete;
+    ObservationPipeline& operator=(const ObservationPipeline&) = delete;
+
+    // Whether the crop fits the screen and every size is non-zero
+    bool isValid() const { return m_valid; }
+    const ObservationConfig& getConfig() const { return m_config; }
+
+    // Bytes written by observe() (stack x height x width)
+    size_t getObservationSize() const { return m_planeSize * m_config.stack; }
+
+    // Forget earlier frames; the next observation repeats its frame stack times
+    void reset();
+
+    // Remember a frame for max-pooling without observing it (the frame
+    // before the observed one when skipping frames)
+    void capture(const u8* screen);
+
+    // Add a frame (SCREEN_WIDTH x SCREEN_HEIGHT shades) and write the stack
+    void observe(const u8* screen, u8* out);
+
+    // Vectorized path (on by default when the CPU supports AVX2)
+    static bool hasAVX2();
+    void setVectorized(bool enabled) { m_vectorized = enabled && hasAVX2(); }
+    bool isVectorized() const { return m_vectorized; }
+
+private:
+    // Area filter of one axis: per output, the first source index and
+    // tapCount weights (8.8 fixed point, summing to 256)
+    struct AxisFilter {
+        u32 tapCount = 0;
+        std::vector<i32> starts;
+        std::vector<i16> weights;
+    };
+
+    static void buildFilter(u32 sourceSize, u32 outputSize, AxisFilter& filter);
+
+    ObservationConfig m_config;
+    bool m_valid;
+    bool m_vectorized;
+    size_t m_planeSize;
+
+    AxisFilter m_vertical;
+    AxisFilter m_horizontal;
+
+    // Horizontal weights in pairs, [pair][output] for 8-wide loads
+    u32 m_pairCount;
+    u32 m_paddedWidth;
+    std::vector<i32> m_pairWeights;
+
+    // Max-pool: last frame seen and the pooled crop
+    bool m_hasPrevious;
+    std::vector<u8> m_previous;
+    std::vector<u8> m_pooled;
+
+    // One vertically filtered row (padded for the horizontal taps)
+    std::vector<u16> m_line;
+
+    // Last stack resampled frames; m_newest is the slot of the latest
+    std::vector<u8> m_ring;
+    u32 m_newest;
+    u32 m_frames;
+
+    void poolFrame(const u8* screen);
+    void resample(const u8* source, size_t stride, u8* plane);
+};
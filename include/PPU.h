@@ -2,15 +2,14 @@
 
 #include "Common.h"
 #include "Memory.h"
+#include "Scheduler.h"
+
+class PerfCounters;
 
 // GameBoy PPU (Picture Processing Unit) class
 class PPU {
 public:
-    // Meyer's Singleton pattern
-    static PPU& getInstance() {
-        static PPU instance;
-        return instance;
-    }
+    explicit PPU(Memory& memory);
 
     // Delete copy constructor and assignment operator
     PPU(const PPU&) = delete;
@@ -24,6 +23,15 @@ public:
     
     // Update PPU state based on CPU cycles
     void update(u32 cycles);
+
+    // Cycles until the next mode change (~0u while the LCD is off)
+    u32 cyclesUntilEvent() const;
+
+    // Scheduled runs: the mode cycle as a coroutine on the scheduler's LCD
+    // clock, and the clocks it kept handed back at the end of the run
+    Scheduler::Task run(Scheduler& scheduler);
+    u32 getModeClock() const { return m_modeClock; }
+    void endScheduledRun(u32 modeClock, u32 disabledCycles);
     
     // Get screen buffer
     const std::array<u8, SCREEN_WIDTH * SCREEN_HEIGHT>& getScreenBuffer() const { return m_screenBuffer; }
@@ -42,21 +50,47 @@ public:
     // Get current scanline
     u8 getCurrentScanline() const { return m_scanline; }
 
+    // Metrics
+    const PPUCounters& getCounters() const { return m_counters; }
+
+    // Hardware counters switched to the PPU phase while rendering (optional)
+    void setPerfCounters(PerfCounters* perfCounters) { m_perfCounters = perfCounters; }
+
+    // Plain state block (suspend files)
+    struct State {
+        std::array<u8, SCREEN_WIDTH * SCREEN_HEIGHT> screenBuffer;
+        Mode mode;
+        u8 scanline;
+        u32 modeClock;
+        u32 disabledClock;
+    };
+
+    void saveState(State& state) const;
+    void loadState(const State& state);
+
 private:
-    // Private constructor for singleton
-    PPU();
-    
+    // Mode lengths in cycles
+    static constexpr u32 OAM_SCAN_CYCLES = 80;
+    static constexpr u32 PIXEL_TRANSFER_CYCLES = 172;
+    static constexpr u32 HBLANK_CYCLES = 204;
+    static constexpr u32 SCANLINE_CYCLES = 456;
+
     // Reference to memory
     Memory& m_memory;
     
-    // Screen buffer (160x144 pixels, 2 bits per pixel)
-    std::array<u8, SCREEN_WIDTH * SCREEN_HEIGHT> m_screenBuffer;
-    
     // PPU state
     Mode m_mode;
     u8 m_scanline;
     u32 m_modeClock;
     
+    // Metrics counters
+    PPUCounters m_counters;
+    u32 m_disabledClock;
+    PerfCounters* m_perfCounters;
+
+    // Screen buffer (160x144 pixels, 2 bits per pixel), after the state
+    std::array<u8, SCREEN_WIDTH * SCREEN_HEIGHT> m_screenBuffer;
+    
     // LCD Control register (LCDC) - 0xFF40
     bool isLCDEnabled() const;
     bool isWindowTileMapHigh() const;
@@ -69,6 +103,15 @@ private:
     
     // LCD Status register (STAT) - 0xFF41
     void updateLCDStatus();
+
+    // End of each mode, on to the next one
+    void finishOAMScan();
+    void finishPixelTransfer();
+    void finishHBlank();
+    void finishVBlankLine();
+
+    // Cycles gone by with the LCD off
+    void countDisabledCycles(u32 cycles);
     
     // Rendering methods
     void renderScanline();
@@ -0,0 +1,82 @@
+#pragma once
+
+#include "Common.h"
+
+// Emulation phases the hardware counters are attributed to
+enum class PerfPhase : u8 {
+    CPU = 0,    // Instruction dispatch and bus accesses
+    PPU,        // Scanline rendering
+    COUNT
+};
+
+constexpr size_t PERF_PHASE_COUNT = static_cast<size_t>(PerfPhase::COUNT);
+
+// Hardware counters opened through perf_event_open
+enum class PerfEvent : u8 {
+    CYCLES = 0,
+    INSTRUCTIONS,
+    BRANCH_MISSES,
+    L1D_MISSES,
+    L1I_MISSES,
+    LLC_MISSES,
+    COUNT
+};
+
+constexpr size_t PERF_EVENT_COUNT = static_cast<size_t>(PerfEvent::COUNT);
+
+// Linux hardware performance counters for the calling thread, attributed to
+// emulation phases. Counters that cannot be opened (containers, missing
+// PMU support, perf_event_paranoid) are skipped individually; on other
+// platforms nothing is available and the emulator runs unmeasured.
+class PerfCounters {
+public:
+    PerfCounters();
+    ~PerfCounters();
+
+    // Delete copy constructor and assignment operator
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // Open the counters for the calling thread; false if none are available
+    bool open();
+    void close();
+    bool isAvailable(PerfEvent event) const { return m_fds[static_cast<size_t>(event)] >= 0; }
+    bool anyAvailable() const;
+    const std::string& getError(PerfEvent event) const { return m_errors[static_cast<size_t>(event)]; }
+
+    // Attribute the counts since the last switch to the current phase and enter a new one
+    void switchPhase(PerfPhase phase);
+    PerfPhase getPhase() const { return m_phase; }
+
+    // Accumulated counts, scaled up where the group was multiplexed
+    u64 get(PerfPhase phase, PerfEvent event) const { return m_totals[static_cast<size_t>(phase)][static_cast<size_t>(event)]; }
+    void resetTotals();
+
+    // Report per emulated frame and per million guest instructions
+    void report(std::ostream& out, u64 frames, u64 guestInstructions) const;
+
+    // Names used in reports
+    static const char* eventName(PerfEvent event);
+    static const char* phaseName(PerfPhase phase);
+
+private:
+    std::array<int, PERF_EVENT_COUNT> m_fds;
+    std::array<std::string, PERF_EVENT_COUNT> m_errors;
+    int m_groupFd;
+
+    // Position of each open counter in a group read
+    std::array<int, PERF_EVENT_COUNT> m_groupIndex;
+    size_t m_groupSize;
+
+    PerfPhase m_phase;
+    std::array<u64, PERF_EVENT_COUNT> m_last;
+    u64 m_lastEnabled;
+    u64 m_lastRunning;
+    std::array<std::array<u64, PERF_EVENT_COUNT>, PERF_PHASE_COUNT> m_totals;
+
+    // Nanoseconds each phase had the group enabled, and on the PMU
+    std::array<u64, PERF_PHASE_COUNT> m_timeEnabled;
+    std::array<u64, PERF_PHASE_COUNT> m_timeRunning;
+
+    bool readGroup(std::array<u64, PERF_EVENT_COUNT>& values, u64& timeEnabled, u64& timeRunning) const;
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include "Common.h"
+
+// Runs independent jobs in child processes, several at a time, so a ROM
+// that crashes takes down only its child, and one that hangs is killed when
+// it runs past the time limit. Each job returns a byte string that the child
+// writes back to the parent through a pipe. Without fork (Windows) the jobs
+// run one after another in the calling process, with no time limit.
+class ProcessPool {
+public:
+    // Job body: runs in the child and returns its result
+    using Job = std::function<std::string(size_t index)>;
+
+    // Outcome of one job
+    struct Result {
+        bool completed = false;     // Child exited normally after returning its result
+        int exitSignal = 0;         // Signal that ended the child (0 if none)
+        bool timedOut = false;      // Killed for running past the time limit
+        double seconds = 0.0;       // Wall time from fork to exit
+        std::string output;
+    };
+
+    // Run jobs 0..count-1 on up to workers processes (0 = hardware threads),
+    // killing a child after timeLimit wall-clock seconds (0 = no limit).
+    // onDone is called in the parent as each job finishes, in completion order.
+    static std::vector<Result> run(size_t count, unsigned workers, double timeLimit, const Job& job,
+                                   const std::function<void(size_t, const Result&)>& onDone = nullptr);
+};
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Common.h"
+#include "Memory.h"
+
+// One ROM in the library
+struct RomInfo {
+    std::string path;               // Relative to the library root
+    u64 modifiedTime;               // File modification time (filesystem clock ticks)
+    u64 fileSize;
+    u64 contentHash;                // hashBytes of the ROM image (decompressed for archives)
+    bool headerValid;               // Large enough to have a cartridge header
+    bool readable;                  // False when the file could not be read or decoded
+    Cartridge::Header header;
+};
+
+// Index file layout: RomIndexHeader, entryCount RomIndexEntry records, then
+// the NUL-separated paths. Fixed-size records in host byte order, so opening
+// the library is one read. Files that could not be read get a record too
+// (ROM_INDEX_UNREADABLE), so they are not retried until they change.
+struct RomIndexHeader {
+    char magic[8];                  // "GBROMIDX"
+    u32 version;
+    u32 entryCount;
+    u64 pathBytes;
+};
+
+struct RomIndexEntry {
+    u64 modifiedTime;
+    u64 fileSize;
+    u64 contentHash;
+    u32 pathOffset;
+    u16 pathLength;
+    u16 globalChecksum;
+    char title[16];
+    u8 cartridgeType;
+    u8 romSizeCode;
+    u8 ramSizeCode;
+    u8 headerChecksum;
+    u8 flags;                       // ROM_INDEX_* flags
+    u8 reserved[11];
+};
+
+static_assert(sizeof(RomIndexHeader) == 24, "RomIndexHeader must be packed");
+static_assert(sizeof(RomIndexEntry) == 64, "RomIndexEntry must be 64 bytes");
+
+constexpr char ROM_INDEX_MAGIC[8] = {'G', 'B', 'R', 'O', 'M', 'I', 'D', 'X'};
+constexpr u32 ROM_INDEX_VERSION = 2;
+constexpr u8 ROM_INDEX_HEADER_VALID = 0x01;
+constexpr u8 ROM_INDEX_HEADER_CHECKSUM_VALID = 0x02;
+constexpr u8 ROM_INDEX_GLOBAL_CHECKSUM_VALID = 0x04;
+constexpr u8 ROM_INDEX_UNREADABLE = 0x08;
+
+// ROM library indexer. Scans a directory tree for ROM images, maps each new
+// or changed file on a pool of worker threads to read its cartridge header
+// and hash its contents, and keeps the results in a binary index file.
+// Files whose modification time and size match the index are not reopened,
+// whether they were read or failed to read.
+class RomLibrary {
+public:
+    // Summary of a scan
+    struct ScanStats {
+        size_t files = 0;           // ROM files found
+        size_t reused = 0;          // Unchanged, taken from the index
+        size_t indexed = 0;         // New or changed, read and hashed
+        size_t removed = 0;         // In the index but no longer on disk
+        size_t failed = 0;          // Could not be read (now or, unchanged, before)
+        u64 bytesHashed = 0;
+    };
+
+    explicit RomLibrary(const std::string& root);
+
+    // Load a previously saved index (missing or stale files are not an error)
+    bool load(const std::string& indexFile);
+    bool save(const std::string& indexFile) const;
+
+    // Bring the library up to date with the directory tree (0 threads = hardware threads)
+    ScanStats scan(unsigned threads = 0);
+
+    const std::string& getRoot() const { return m_root; }
+    const std::vector<RomInfo>& getEntries() const { return m_entries; }
+    const std::vector<RomInfo>& getUnreadable() const { return m_unreadable; }
+
+    // Files considered ROM images
+    static bool isROMFile(const std::string& path);
+
+private:
+    std::string m_root;
+    std::vector<RomInfo> m_entries;     // Sorted by path
+    std::vector<RomInfo> m_unreadable;  // Files that failed, sorted by path
+
+    static bool indexFile(const std::string& filename, RomInfo& info);
+};
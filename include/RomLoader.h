@@ -0,0 +1,38 @@
+#pragma once
+
+#include "Common.h"
+
+// Containers a ROM image can be stored in
+enum class RomContainer {
+    RAW,
+    GZIP,
+    ZIP
+};
+
+// ROM image loader. Maps the file and, for gzip and zip archives (stored or
+// deflate), decompresses straight into the ROM buffer. The buffer is sized
+// once from the archive header (gzip ISIZE, zip central directory), and the
+// CRC-32 of the result is checked against the archive.
+class RomLoader {
+public:
+    // Largest image accepted (MBC5: 512 banks of 16 KB)
+    static constexpr size_t MAX_ROM_SIZE = 512 * ROM_BANK_SIZE;
+
+    // Load a ROM image from a plain, gzip or zip file
+    static bool load(const std::string& filename, std::vector<u8>& rom, std::string& error);
+
+    // Same, from bytes already in memory
+    static bool decode(const u8* data, size_t size, std::vector<u8>& rom, std::string& error);
+
+    // Container format from the leading magic bytes
+    static RomContainer detect(const u8* data, size_t size);
+
+    static const char* containerName(RomContainer container);
+
+    // Archive extensions accepted next to .gb and .gbc
+    static bool isArchiveExtension(const std::string& extension);
+
+private:
+    static bool decodeGzip(const u8* data, size_t size, std::vector<u8>& rom, std::string& error);
+    static bool decodeZip(const u8* data, size_t size, std::vector<u8>& rom, std::string& error);
+};
@@ -0,0 +1,177 @@
+#pragma once
+
+#include "Common.h"
+#include <coroutine>
+#include <cstddef>
+#include <utility>
+
+class CPU;
+class Memory;
+class PPU;
+
+// Fixed block one machine's coroutine frames are carved from. Nothing is
+// freed on its own: a run starts its coroutines on an empty arena
+class CoroutineArena {
+public:
+    static constexpr size_t SIZE = 1024;
+
+    // nullptr when the block is full
+    void* allocate(size_t size);
+    void reset() { m_used = 0; }
+    size_t getUsed() const { return m_used; }
+
+private:
+    alignas(std::max_align_t) std::array<std::byte, SIZE> m_buffer;
+    size_t m_used = 0;
+};
+
+// Optional execution model for GameBoy::runCycles. The CPU, the PPU and the
+// LY clock are coroutines that co_await cycle deadlines on one shared clock;
+// a component is not touched between its deadlines, and the CPU runs
+// instructions back to back until the earliest one. The PPU measures its
+// modes on the LCD clock (cycles run with the LCD on), so switching the LCD
+// off simply stops its time. Each run starts the coroutines from the
+// component state and hands the clocks back at the end, so the machine
+// state matches the callback loop's after every run.
+class Scheduler {
+public:
+    // Coroutine whose frame lives in the scheduler's arena. The scheduler is
+    // the coroutine's object or, for a member of another component, its
+    // first argument
+    class Task {
+    public:
+        struct promise_type {
+            Task get_return_object() { return Task(std::coroutine_handle<promise_type>::from_promise(*this)); }
+            static Task get_return_object_on_allocation_failure() { return Task(); }
+            std::suspend_always initial_suspend() noexcept { return {}; }
+            std::suspend_always final_suspend() noexcept { return {}; }
+            void return_void() {}
+            void unhandled_exception() { std::terminate(); }
+
+            template <typename... Args>
+            static void* operator new(size_t size, Scheduler& scheduler, Args&...) noexcept {
+                return scheduler.m_arena.allocate(size);
+            }
+            template <typename Object, typename... Args>
+            static void* operator new(size_t size, Object&, Scheduler& scheduler, Args&...) noexcept {
+                return scheduler.m_arena.allocate(size);
+            }
+            static void operator delete(void*, size_t) noexcept {}
+        };
+
+        Task() = default;
+        Task(Task&& other) noexcept : m_handle(std::exchange(other.m_handle, nullptr)) {}
+        Task& operator=(Task&& other) noexcept {
+            if (this != &other) {
+                reset();
+                m_handle = std::exchange(other.m_handle, nullptr);
+            }
+            return *this;
+        }
+        ~Task() { reset(); }
+
+        explicit operator bool() const { return static_cast<bool>(m_handle); }
+        std::coroutine_handle<> getHandle() const { return m_handle; }
+        void reset() {
+            if (m_handle) {
+                m_handle.destroy();
+                m_handle = nullptr;
+            }
+        }
+
+    private:
+        explicit Task(std::coroutine_handle<promise_type> handle) : m_handle(handle) {}
+        std::coroutine_handle<promise_type> m_handle;
+    };
+
+    // Wait until the shared clock reaches a deadline (or the LCD clock, for
+    // the PPU); ready at once when it already has
+    struct Deadline {
+        Scheduler& scheduler;
+        u64 cycles;
+        bool lcdClock;
+
+        bool await_ready() const noexcept { return (lcdClock ? scheduler.m_lcdNow : scheduler.m_now) >= cycles; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { scheduler.park(handle, cycles, lcdClock); }
+        void await_resume() const noexcept {}
+    };
+
+    // Wait until the current PPU mode has run length cycles on the LCD
+    // clock; the next mode starts where this one ended
+    struct LCDCycles {
+        Scheduler& scheduler;
+        u64 cycles;
+
+        bool await_ready() const noexcept { return scheduler.m_lcdNow >= cycles; }
+        void await_suspend(std::coroutine_handle<> handle) noexcept { scheduler.park(handle, cycles, true); }
+        void await_resume() const noexcept { scheduler.m_modeStart = cycles; }
+    };
+
+    Scheduler(CPU& cpu, Memory& memory, PPU& ppu) : m_cpu(cpu), m_memory(memory), m_ppu(ppu) {}
+
+    // Delete copy constructor and assignment operator
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+
+    // Run at least this many cycles (whole instructions); returns the cycles
+    // run, 0 if the coroutines did not fit the arena (nothing was run)
+    u32 run(u32 cycles);
+
+    // Cycles until the earliest deadline, while a run is going on
+    bool isRunning() const { return m_running; }
+    u32 cyclesUntilEvent() const;
+
+    // Awaitables for the components
+    Deadline until(u64 cycles) { return {*this, cycles, false}; }
+    Deadline nextStep() { return {*this, m_now + 1, false}; }
+    LCDCycles lcdCycles(u32 length) { return {*this, m_modeStart + length}; }
+
+    // Coroutine frame bytes used by the last run
+    size_t getArenaUsed() const { return m_arena.getUsed(); }
+
+private:
+    // A component waiting on the clock; resumed in slot order when due
+    enum Slot { PPU_SLOT, LINE_SLOT, SLOT_COUNT };
+    struct Waiter {
+        std::coroutine_handle<> handle;
+        u64 deadline;
+        bool lcdClock;
+    };
+
+    CPU& m_cpu;
+    Memory& m_memory;
+    PPU& m_ppu;
+
+    // Clocks of the current run: cycles, cycles with the LCD on (starting
+    // at the PPU's mode clock) and with it off
+    u64 m_now = 0;
+    u64 m_end = 0;
+    u64 m_lcdNow = 0;
+    u64 m_lcdOff = 0;
+    u64 m_modeStart = 0;
+    u64 m_lineSynced = 0;
+    const u8* m_lcdc = nullptr;
+
+    // Earliest deadline on each clock
+    u64 m_nextDeadline = 0;
+    u64 m_nextLCDDeadline = 0;
+    std::array<Waiter, SLOT_COUNT> m_waiters{};
+    size_t m_current = 0;
+    bool m_running = false;
+
+    CoroutineArena m_arena;
+
+    // Yield from the CPU back to the run loop
+    struct Yield {
+        bool await_ready() const noexcept { return false; }
+        void await_suspend(std::coroutine_handle<>) const noexcept {}
+        void await_resume() const noexcept {}
+    };
+
+    void park(std::coroutine_handle<> handle, u64 deadline, bool lcdClock);
+    bool isDue(const Waiter& waiter) const {
+        return waiter.handle && (waiter.lcdClock ? m_lcdNow : m_now) >= waiter.deadline;
+    }
+    Task runCPU();
+    Task runLineClock();
+};
@@ -0,0 +1,36 @@
+#pragma once
+
+#include "Common.h"
+
+// Device on the other end of the link port. When a transfer completes, the
+// outgoing byte is shifted out to the device and its reply is shifted in.
+class SerialDevice {
+public:
+    virtual ~SerialDevice() = default;
+
+    // Exchange one byte; return what the device sends back
+    virtual u8 transfer(u8 outgoing) = 0;
+
+    // The game started a transfer on the internal clock; it completes
+    // (transfer is called) Memory::SERIAL_TRANSFER_CYCLES later
+    virtual void startTransfer(u8 outgoing) { (void)outgoing; }
+
+    // Called by the machine between slices at its cycle count; returns the
+    // cycle count it may run up to (a device that has to stay in step with
+    // another machine may block here)
+    virtual u64 synchronize(u64 cycles) { (void)cycles; return ~0ull; }
+};
+
+// Records everything the game sends. Nothing is sent back (0xFF, as with no
+// cable attached). Test ROMs report their results this way.
+class SerialCapture : public SerialDevice {
+public:
+    u8 transfer(u8 outgoing) override;
+
+    const std::vector<u8>& getData() const { return m_data; }
+    std::string getText() const { return std::string(m_data.begin(), m_data.end()); }
+    void clear() { m_data.clear(); }
+
+private:
+    std::vector<u8> m_data;
+};
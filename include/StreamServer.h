@@ -0,0 +1,129 @@
+#pragma once
+
+#include "Common.h"
+#include "FrameCodec.h"
+#include "Histogram.h"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
+// Streaming frontend for browsers on headless hosts: serves
+// resources/index.html over HTTP and pushes frames to every page connected
+// on /ws as binary WebSocket messages (2bpp key frames and deltas), taking
+// input events back. One thread runs the non-blocking sockets with epoll,
+// another encodes the frames the emulation thread submits, so emulation
+// never waits for a client. Pages acknowledge every frame they draw; a client
+// that falls behind skips frames and gets a key frame once it has caught up. Every client gets a
+// bandwidth and latency report when it disconnects or the server stops.
+// POSIX only.
+class StreamServer {
+public:
+    StreamServer();
+    ~StreamServer();
+
+    // Delete copy constructor and assignment operator
+    StreamServer(const StreamServer&) = delete;
+    StreamServer& operator=(const StreamServer&) = delete;
+
+    // Listen on address:port (port 0 picks one) and serve the page
+    bool start(const std::string& address, u16 port, const std::string& pageFile);
+    void stop();
+    bool isRunning() const { return m_running; }
+    u16 getPort() const { return m_port; }
+
+    // Hand over a completed frame (emulation thread); replaces a frame the
+    // encoder has not picked up yet
+    void submitFrame(u64 frame, const u8* shades);
+
+    // Buttons held down by the last client that sent input
+    u8 getButtons() const { return m_buttons.load(std::memory_order_relaxed); }
+
+    // Send queue size or unacknowledged frames above which a client skips frames
+    static constexpr size_t MAX_QUEUED_BYTES = 64 * 1024;
+    static constexpr u32 MAX_FRAMES_IN_FLIGHT = 6;
+
+private:
+    // An encoded frame, shared by every client it is sent to
+    using Message = std::shared_ptr<const std::vector<u8>>;
+
+    struct EncodedFrame {
+        u64 frame;
+        Message key;
+        Message delta;      // Against the frame encoded before (the key frame when that is smaller)
+    };
+
+    // Per-connection state (network thread only)
+    struct Client {
+        int socket = -1;
+        std::string peer;
+        bool webSocket = false;
+        bool closing = false;           // Close once the send queue is empty
+        bool synced = false;            // Received the frame the next delta is based on
+        std::vector<u8> input;
+        std::deque<Message> output;
+        size_t outputOffset = 0;        // Bytes of output.front() already sent
+        size_t queuedBytes = 0;
+        u32 framesInFlight = 0;         // Sent and not acknowledged yet
+        std::chrono::steady_clock::time_point connected;
+
+        // Report
+        u64 keyFrames = 0;
+        u64 deltaFrames = 0;
+        u64 skippedFrames = 0;
+        u64 bytesSent = 0;
+        u64 bytesReceived = 0;
+        u64 inputEvents = 0;
+        std::unique_ptr<LatencyHistogram> latency;  // Send to ack (microseconds)
+    };
+
+    std::atomic<bool> m_running;
+    u16 m_port;
+    std::string m_page;
+    int m_listenSocket;
+    int m_epoll;
+    int m_wakeEvent;
+    std::thread m_networkThread;
+    std::thread m_encoderThread;
+    std::atomic<u8> m_buttons;
+
+    // Submitted frame waiting for the encoder
+    std::mutex m_frameMutex;
+    std::condition_variable m_frameReady;
+    std::vector<u8> m_pendingShades;
+    u64 m_pendingFrame;
+    bool m_hasPending;
+    u64 m_droppedFrames;
+
+    // Encoded frames waiting for the network thread
+    std::mutex m_outboxMutex;
+    std::deque<EncodedFrame> m_outbox;
+
+    std::unordered_map<int, Client> m_clients;
+
+    // Threads
+    void encoderLoop();
+    void networkLoop();
+
+    // Connections (read and write return false when the client has to go)
+    void acceptClients();
+    bool readClient(Client& client);
+    bool writeClient(Client& client);
+    void closeClient(int socket);
+    void updateEvents(const Client& client);
+    void queue(Client& client, Message message);
+    void report(const Client& client) const;
+
+    // HTTP and WebSocket protocol
+    bool handleRequest(Client& client);
+    bool handleWebSocketFrames(Client& client);
+    void handleMessage(Client& client, const u8* data, size_t size);
+    void distributeFrames();
+};
+
+// WebSocket frame header for a server message (unmasked); returns its size
+size_t webSocketHeader(u8 opcode, size_t payloadSize, u8* header);
+
+// Sec-WebSocket-Accept value for a Sec-WebSocket-Key
+std::string webSocketAccept(const std::string& key);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include "Common.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "PPU.h"
+#include "MappedFile.h"
+#include <type_traits>
+
+// Complete machine state in suspend file layout
+struct MachineState {
+    CPU::State cpu;
+    Memory::State memory;
+    PPU::State ppu;
+    Cartridge::State cartridge;
+};
+
+static_assert(std::is_trivially_copyable_v<MachineState>, "MachineState must be a plain block");
+
+// Suspend file header. The file is the header, the MachineState block and
+// the cartridge RAM, all fixed-size and in host byte order, so resuming maps
+// the file and adopts the blocks without a parse step.
+struct SuspendHeader {
+    char magic[8];          // "GBSUSPND"
+    u32 version;
+    u32 stateSize;          // sizeof(MachineState)
+    u64 romHash;            // Hash of the ROM image the state belongs to
+    u64 ramSize;            // Cartridge RAM bytes after the state block
+    u64 checksum;           // Hash of everything after the header (torn writes)
+    u64 frameCount;         // Frames emulated when suspended
+    u8 reserved[16];
+};
+
+static_assert(sizeof(SuspendHeader) == 64, "SuspendHeader must stay 64 bytes");
+
+constexpr char SUSPEND_MAGIC[8] = {'G', 'B', 'S', 'U', 'S', 'P', 'N', 'D'};
+constexpr u32 SUSPEND_VERSION = 2;
+
+// Size of a suspend image (header, state block and cartridge RAM)
+constexpr size_t suspendImageSize(size_t ramSize) {
+    return sizeof(SuspendHeader) + sizeof(MachineState) + ramSize;
+}
+
+// Fill in the format fields and the checksum of a header for this payload
+void finishSuspendHeader(SuspendHeader& header, const MachineState& state, const u8* ram, size_t ramSize);
+
+// Write a suspend file; the data goes to a temporary file that is synced and
+// renamed over the target, so a crash never leaves a half-written file behind
+bool writeSuspendFile(const std::string& filename, SuspendHeader header, const MachineState& state,
+                      const std::vector<u8>& ram);
+
+// Validate a suspend image in memory against the loaded ROM and its cartridge
+// RAM size. On success copies out the header and points state and ram
+// (ramSize bytes) into the image; otherwise returns false with a reason.
+bool validateSuspendImage(const u8* data, size_t size, u64 romHash, SuspendHeader& header,
+                          const MachineState*& state, const u8*& ram, size_t ramSize, std::string& error);
+
+// Validate a mapped suspend file against the loaded ROM and its cartridge RAM size
+bool validateSuspendFile(const MappedFile& file, u64 romHash, SuspendHeader& header,
+                         const MachineState*& state, const u8*& ram, size_t ramSize, std::string& error);
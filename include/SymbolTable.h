@@ -0,0 +1,35 @@
+#pragma once
+
+#include "Common.h"
+
+// Symbols loaded from a .sym file (RGBDS, BGB and no$gmb format):
+//
+//   ; comment
+//   00:0150 Main
+//   01:4000 LevelData
+//
+// Names are stored in one contiguous block and looked up by bank and
+// address with a binary search.
+class SymbolTable {
+public:
+    // Load a .sym file, replacing any previous symbols
+    bool load(const std::string& filename);
+
+    // Add a symbol (keeps the first name for an address)
+    void add(u8 bank, u16 address, const std::string& name);
+
+    // Name at bank:address, falling back to bank 0 for flat ROMs; nullptr if none
+    const char* find(u8 bank, u16 address) const;
+
+    size_t size() const { return m_symbols.size(); }
+    bool empty() const { return m_symbols.empty(); }
+
+private:
+    struct Symbol {
+        u32 key;            // bank << 16 | address
+        u32 nameOffset;     // Offset into m_names
+    };
+
+    std::vector<Symbol> m_symbols;
+    std::string m_names;    // NUL-separated names
+};
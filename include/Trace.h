@@ -0,0 +1,122 @@
+#pragma once
+
+#include "Common.h"
+#include <atomic>
+#include <mutex>
+
+// Trace event recorded into a per-thread buffer
+struct TraceEvent {
+    const char* name;   // Static string, or nullptr for guest markers
+    u64 timestamp;      // Nanoseconds since the trace epoch
+    u64 duration;       // Nanoseconds (complete events only)
+    u8 guestId;         // Guest marker id
+    char phase;         // Chrome trace phase: 'X' complete, 'B' begin, 'E' end, 'i' instant
+};
+
+// Preallocated ring of trace events owned by one thread
+struct TraceBuffer {
+    explicit TraceBuffer(size_t capacity, u32 threadId);
+
+    std::vector<TraceEvent> events;
+    std::atomic<u64> written;
+    u32 threadId;
+    std::string threadName;
+};
+
+// Collects trace events from all threads and exports them as Chrome
+// trace-event JSON (chrome://tracing, ui.perfetto.dev).
+// Each thread records into its own preallocated ring buffer, so recording
+// never locks or allocates; when the ring is full the oldest events are
+// overwritten.
+class Tracer {
+public:
+    // Meyer's Singleton pattern
+    static Tracer& getInstance() {
+        static Tracer instance;
+        return instance;
+    }
+
+    // Delete copy constructor and assignment operator
+    Tracer(const Tracer&) = delete;
+    Tracer& operator=(const Tracer&) = delete;
+
+    // Events per thread buffer
+    static constexpr size_t BUFFER_CAPACITY = 1 << 16;
+
+    // Guest marker ports: writing an id to BEGIN opens a named zone, END closes it
+    static constexpr u16 GUEST_MARKER_BEGIN_PORT = 0xFF7E;
+    static constexpr u16 GUEST_MARKER_END_PORT = 0xFF7F;
+
+    // Runtime control
+    void setEnabled(bool enabled) { m_enabled.store(enabled, std::memory_order_relaxed); }
+    bool isEnabled() const { return m_enabled.load(std::memory_order_relaxed); }
+    void setThreadName(const std::string& name);
+    void setGuestMarkerName(u8 id, const std::string& name);
+
+    // Recording (calling thread)
+    u64 now() const;
+    void complete(const char* name, u64 start, u64 end);
+    void instant(const char* name);
+    void guestMarker(u8 id, bool begin);
+
+    // Export all buffers as Chrome trace-event JSON
+    bool exportChromeJson(const std::string& filename) const;
+    void writeChromeJson(std::ostream& out) const;
+
+    // Drop all recorded events
+    void clear();
+
+private:
+    // Private constructor for singleton
+    Tracer();
+
+    std::atomic<bool> m_enabled;
+    std::chrono::steady_clock::time_point m_epoch;
+
+    // Buffers of all threads that have recorded events
+    mutable std::mutex m_mutex;
+    std::vector<std::unique_ptr<TraceBuffer>> m_buffers;
+    std::array<std::string, 256> m_guestMarkerNames;
+
+    TraceBuffer& threadBuffer();
+    void record(const TraceEvent& event);
+};
+
+// Records a complete event covering its lifetime
+class TraceScope {
+public:
+    explicit TraceScope(const char* name)
+        : m_name(Tracer::getInstance().isEnabled() ? name : nullptr),
+          m_start(m_name ? Tracer::getInstance().now() : 0) {
+    }
+
+    ~TraceScope() {
+        if (m_name) {
+            Tracer& tracer = Tracer::getInstance();
+            tracer.complete(m_name, m_start, tracer.now());
+        }
+    }
+
+    // Delete copy constructor and assignment operator
+    TraceScope(const TraceScope&) = delete;
+    TraceScope& operator=(const TraceScope&) = delete;
+
+private:
+    const char* m_name;
+    u64 m_start;
+};
+
+// Trace points compile to nothing unless GBWV2_ENABLE_TRACE is defined
+#ifdef GBWV2_ENABLE_TRACE
+#define GBWV2_TRACE_CONCAT_INNER(a, b) a##b
+#define GBWV2_TRACE_CONCAT(a, b) GBWV2_TRACE_CONCAT_INNER(a, b)
+#define TRACE_SCOPE(name) TraceScope GBWV2_TRACE_CONCAT(traceScope_, __LINE__)(name)
+#define TRACE_INSTANT(name) \
+    do { if (Tracer::getInstance().isEnabled()) Tracer::getInstance().instant(name); } while (0)
+#define TRACE_GUEST_MARKER(id, begin) \
+    do { if (Tracer::getInstance().isEnabled()) Tracer::getInstance().guestMarker(id, begin); } while (0)
+#else
+#define TRACE_SCOPE(name) do {} while (0)
+#define TRACE_INSTANT(name) do {} while (0)
+#define TRACE_GUEST_MARKER(id, begin) do {} while (0)
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+
+#include "Common.h"
+#include "Disassembler.h"
+#include "ExecutionTrace.h"
+
+// Bulk decoder for binary execution traces. Entries are formatted to text
+// in parallel, one contiguous chunk per worker, and written out in order:
+//
+//   00:0150  2A         LD A,(HL+)           AF=01B0 BC=0013 DE=00D8 HL=014D SP=FFFE
+//
+// Lines are preceded by "Name:" when a symbol starts at their address.
+class TraceDecoder {
+public:
+    explicit TraceDecoder(const Disassembler& disassembler) : m_disassembler(disassembler) {}
+
+    // Load a trace file written by ExecutionTraceWriter
+    bool load(const std::string& filename);
+
+    // Decode all entries to text with the given number of worker threads (0 = hardware threads)
+    void decode(std::ostream& out, unsigned threads = 0) const;
+
+    // Format one entry (with its label line, if any); returns the text length
+    size_t formatEntry(const ExecutionTraceEntry& entry, char* out, size_t outSize) const;
+
+    const std::vector<ExecutionTraceEntry>& getEntries() const { return m_entries; }
+    const std::string& getError() const { return m_error; }
+
+    // Longest formatted line without a label
+    static constexpr size_t MAX_LINE_LENGTH = 96;
+
+private:
+    // Entries formatted by one worker per batch
+    static constexpr size_t CHUNK_ENTRIES = 1 << 16;
+
+    const Disassembler& m_disassembler;
+    std::vector<ExecutionTraceEntry> m_entries;
+    std::string m_error;
+
+    void decodeChunk(size_t first, size_t count, std::string& text) const;
+};
@@ -0,0 +1,146 @@
+/*
+ * libgbcore: C ABI of the emulation core.
+ *
+ * Every machine is independent, so any number can run side by side (one
+ * thread per machine at a time). Nothing is allocated or copied per call:
+ * stepping, input and state functions work on memory owned by the machine or
+ * passed in by the caller, and the framebuffer and RAM views stay valid
+ * until the machine is destroyed.
+ */
+#ifndef GBCORE_H
+#define GBCORE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#if defined(GBCORE_BUILD)
+#define GBCORE_API __declspec(dllexport)
+#else
+#define GBCORE_API __declspec(dllimport)
+#endif
+#else
+#define GBCORE_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Bumped when a function or struct changes incompatibly */
+#define GB_ABI_VERSION 1
+
+#define GB_SCREEN_WIDTH 160
+#define GB_SCREEN_HEIGHT 144
+#define GB_CYCLES_PER_FRAME 70224
+
+typedef struct gb_machine gb_machine;
+
+/* Results of functions that can fail */
+typedef enum gb_result {
+    GB_OK = 0,
+    GB_ERROR_ARGUMENT = -1,   /* NULL machine or buffer */
+    GB_ERROR_ROM = -2,        /* ROM missing, unreadable or invalid */
+    GB_ERROR_NO_ROM = -3,     /* No ROM loaded yet */
+    GB_ERROR_BUFFER = -4,     /* State buffer too small or misaligned */
+    GB_ERROR_STATE = -5       /* State is corrupt or belongs to another ROM */
+} gb_result;
+
+/* Joypad buttons for gb_set_input (set = pressed) */
+enum {
+    GB_BUTTON_RIGHT = 0x01,
+    GB_BUTTON_LEFT = 0x02,
+    GB_BUTTON_UP = 0x04,
+    GB_BUTTON_DOWN = 0x08,
+    GB_BUTTON_A = 0x10,
+    GB_BUTTON_B = 0x20,
+    GB_BUTTON_SELECT = 0x40,
+    GB_BUTTON_START = 0x80
+};
+
+/* Memory regions with direct views */
+typedef enum gb_region {
+    GB_REGION_VRAM = 0,     /* 0x8000 - 0x9FFF, 8 KB */
+    GB_REGION_WRAM = 1,     /* 0xC000 - 0xDFFF, 8 KB */
+    GB_REGION_OAM = 2,      /* 0xFE00 - 0xFE9F, 160 bytes */
+    GB_REGION_IO = 3,       /* 0xFF00 - 0xFF7F, 128 bytes */
+    GB_REGION_HRAM = 4      /* 0xFF80 - 0xFFFE, 127 bytes */
+} gb_region;
+
+/* GB_ABI_VERSION the library was built with */
+GBCORE_API uint32_t gb_abi_version(void);
+
+/*
+ * Create a machine. opcodes_file is the opcode description (NULL for
+ * resources/Opcodes.json relative to the working directory). fast_boot
+ * skips the boot ROM and starts at 0x0100. Returns NULL on failure.
+ */
+GBCORE_API gb_machine* gb_create(const char* opcodes_file, int fast_boot);
+GBCORE_API void gb_destroy(gb_machine* machine);
+
+/* Load a ROM (plain, gzip or zip) and reset; the image in memory is copied */
+GBCORE_API gb_result gb_load_rom_file(gb_machine* machine, const char* path);
+GBCORE_API gb_result gb_load_rom_memory(gb_machine* machine, const void* data, size_t size);
+GBCORE_API void gb_reset(gb_machine* machine);
+
+/* Buttons held down from now on (GB_BUTTON_* mask) */
+GBCORE_API void gb_set_input(gb_machine* machine, uint8_t buttons);
+
+/* Run whole frames, or at least cycles T-cycles; gb_run_cycles returns the cycles run */
+GBCORE_API void gb_run_frames(gb_machine* machine, uint32_t frames);
+GBCORE_API uint32_t gb_run_cycles(gb_machine* machine, uint32_t cycles);
+GBCORE_API uint64_t gb_frame_count(const gb_machine* machine);
+
+/*
+ * Machine state, in the suspend file format. gb_state_size is the buffer
+ * size for the loaded ROM (0 without one); buffers must be 8-byte aligned.
+ */
+GBCORE_API size_t gb_state_size(const gb_machine* machine);
+GBCORE_API gb_result gb_save_state(const gb_machine* machine, void* buffer, size_t size);
+GBCORE_API gb_result gb_load_state(gb_machine* machine, const void* buffer, size_t size);
+
+/* GB_SCREEN_WIDTH x GB_SCREEN_HEIGHT shades (0 = lightest, 3 = darkest), one byte per pixel */
+GBCORE_API const uint8_t* gb_framebuffer(const gb_machine* machine);
+
+/* Writable view of a memory region; size receives its length (may be NULL) */
+GBCORE_API uint8_t* gb_memory(gb_machine* machine, gb_region region, size_t* size);
+
+/*
+ * Observation stage for training jobs: crops the screen, optionally takes
+ * the pixel-wise max with the previous frame, area-resamples it to
+ * width x height grayscale (255 = lightest) and keeps the last stack frames.
+ */
+typedef struct gb_observation_config {
+    uint16_t crop_x;
+    uint16_t crop_y;
+    uint16_t crop_width;        /* 0 for the rest of the screen */
+    uint16_t crop_height;       /* 0 for the rest of the screen */
+    uint16_t width;
+    uint16_t height;
+    uint8_t stack;              /* Frames per observation */
+    uint8_t max_pool;           /* Max with the previous frame seen */
+} gb_observation_config;
+
+typedef struct gb_observer gb_observer;
+
+/* NULL if the crop does not fit the screen or a size is 0 */
+GBCORE_API gb_observer* gb_observer_create(const gb_observation_config* config);
+GBCORE_API void gb_observer_destroy(gb_observer* observer);
+
+/* Bytes written by gb_observe: stack x height x width, oldest frame first */
+GBCORE_API size_t gb_observation_size(const gb_observer* observer);
+
+/* Start a new stack (the next observation repeats its frame) */
+GBCORE_API void gb_observer_reset(gb_observer* observer);
+
+/* Remember the machine's current frame for max-pooling without observing it */
+GBCORE_API void gb_observer_capture(gb_observer* observer, const gb_machine* machine);
+
+/* Add the machine's current frame to the stack and write the stack into out */
+GBCORE_API gb_result gb_observe(gb_observer* observer, const gb_machine* machine, uint8_t* out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
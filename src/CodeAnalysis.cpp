@@ -0,0 +1,446 @@
+#include "CodeAnalysis.h"
+#include "Disassembler.h"
+#include "MappedFile.h"
+#include <cstring>
+#include <filesystem>
+
+namespace fs = std::filesystem;
+
+// Cache file layout: CodeCacheHeader, blockCount CodeCacheBlock records, then
+// entryCount u32 ROM offsets of the entry points added while running.
+// Instruction lengths are decoded again from the blocks on load.
+struct CodeCacheHeader {
+    char magic[8];                  // "GBCODEAN"
+    u32 version;
+    u32 blockCount;
+    u64 romHash;
+    u64 romSize;
+    u32 entryCount;
+    u32 reserved;
+};
+
+struct CodeCacheBlock {
+    u32 offset;
+    u16 length;
+    u16 instructions;
+    u8 end;                         // CodeAnalysis::BlockEnd
+    u8 idleLoop;
+    u16 reserved;
+};
+
+static_assert(sizeof(CodeCacheHeader) == 40, "CodeCacheHeader must be packed");
+static_assert(sizeof(CodeCacheBlock) == 12, "CodeCacheBlock must be 12 bytes");
+
+constexpr char CODE_CACHE_MAGIC[8] = {'G', 'B', 'C', 'O', 'D', 'E', 'A', 'N'};
+constexpr u32 CODE_CACHE_VERSION = 1;
+
+// How an instruction passes control on
+enum class Flow : u8 { NEXT, JUMP, BRANCH, CALL, RETURN, INDIRECT, INVALID };
+
+static Flow flowOf(u8 opcode) {
+    switch (opcode) {
+        case 0x18: case 0xC3:
+            return Flow::JUMP;
+        case 0x20: case 0x28: case 0x30: case 0x38:
+        case 0xC2: case 0xCA: case 0xD2: case 0xDA:
+        case 0xC0: case 0xC8: case 0xD0: case 0xD8:
+            return Flow::BRANCH;
+        case 0xC4: case 0xCC: case 0xCD: case 0xD4: case 0xDC:
+        case 0xC7: case 0xCF: case 0xD7: case 0xDF: case 0xE7: case 0xEF: case 0xF7: case 0xFF:
+            return Flow::CALL;
+        case 0xC9: case 0xD9:
+            return Flow::RETURN;
+        case 0xE9:
+            return Flow::INDIRECT;
+        case 0xD3: case 0xDB: case 0xDD: case 0xE3: case 0xE4: case 0xEB: case 0xEC: case 0xED:
+        case 0xF4: case 0xFC: case 0xFD:
+            return Flow::INVALID;
+        default:
+            return Flow::NEXT;
+    }
+}
+
+// Target of a jump, branch or call at address (false for returns)
+static bool targetOf(const u8* bytes, u16 address, u16& target) {
+    const u8 opcode = bytes[0];
+    if (opcode == 0x18 || (opcode & 0xE7) == 0x20) {
+        target = static_cast<u16>(address + 2 + static_cast<int8_t>(bytes[1]));
+        return true;
+    }
+    if ((opcode & 0xC7) == 0xC7) {
+        target = opcode & 0x38;
+        return true;
+    }
+    if (opcode == 0xC3 || opcode == 0xCD || (opcode & 0xE7) == 0xC2 || (opcode & 0xE7) == 0xC4) {
+        target = static_cast<u16>(bytes[1] | (bytes[2] << 8));
+        return true;
+    }
+    return false;
+}
+
+// Instructions an idle loop may contain: nothing that stores, touches the
+// stack, halts or changes how interrupts are taken
+static bool isReadOnly(const u8* bytes) {
+    const u8 opcode = bytes[0];
+    if (opcode == 0xCB) {
+        // BIT n,(HL) reads; the other (HL) forms write back
+        return (bytes[1] & 0x07) != 0x06 || (bytes[1] >= 0x40 && bytes[1] < 0x80);
+    }
+    if (opcode >= 0x70 && opcode <= 0x77) {
+        return false;
+    }
+    switch (opcode) {
+        case 0x02: case 0x08: case 0x10: case 0x12: case 0x22: case 0x32: case 0x34: case 0x35: case 0x36:
+        case 0x76:
+            return false;
+        case 0xC2: case 0xC3: case 0xC6: case 0xCA: case 0xCE: case 0xD2: case 0xD6: case 0xDA: case 0xDE:
+        case 0xE6: case 0xE8: case 0xEE: case 0xF0: case 0xF2: case 0xF6: case 0xF8: case 0xF9: case 0xFA: case 0xFE:
+            return true;
+        default:
+            return opcode < 0xC0;
+    }
+}
+
+// CodeAnalysis constructor
+CodeAnalysis::CodeAnalysis(const std::vector<u8>& rom, u64 romHash)
+    : m_rom(rom), m_romHash(romHash), m_map(rom.size(), 0), m_idleAddresses(0x10000 / 64, 0),
+      m_dirtyBanks((rom.size() + ROM_BANK_SIZE - 1) / ROM_BANK_SIZE, false), m_fromCache(false) {}
+
+// ROM offset of code at address in a bank (false outside the ROM)
+bool CodeAnalysis::toOffset(u8 bank, u16 address, u32& offset) const {
+    if (address < ROM_BANK_SIZE) {
+        offset = address;
+    } else if (address < 2 * ROM_BANK_SIZE && bank != 0) {
+        offset = static_cast<u32>(bank) * ROM_BANK_SIZE + (address - ROM_BANK_SIZE);
+    } else {
+        return false;
+    }
+    return offset < m_rom.size();
+}
+
+// Walk from the fixed entry points
+void CodeAnalysis::analyze() {
+    std::vector<Location> pending;
+    pending.push_back({0x0100, 0, 1});
+    for (u16 vector = 0x0000; vector <= 0x0060; vector += 8) {
+        pending.push_back({vector, 0, 1});
+    }
+    walk(pending);
+    rebuildBlocks();
+}
+
+// Code reached at run time
+bool CodeAnalysis::addEntryPoint(u16 address, u8 romBank) {
+    const u8 bank = address < ROM_BANK_SIZE ? 0 : romBank;
+    u32 offset;
+    if (!toOffset(bank, address, offset) || (m_map[offset] & CODE)) {
+        return false;
+    }
+
+    m_entryPoints.push_back(offset);
+    std::vector<Location> pending{{address, bank, romBank}};
+    walk(pending);
+    rebuildBlocks();
+    return true;
+}
+
+// Decode everything reachable from the pending locations. Each path stops
+// at code already decoded (marking a block start where it lands) and at
+// bytes that another instruction covers
+void CodeAnalysis::walk(std::vector<Location>& pending) {
+    const u32 banks = static_cast<u32>(m_dirtyBanks.size());
+    while (!pending.empty()) {
+        Location at = pending.back();
+        pending.pop_back();
+
+        bool blockStart = true;
+        int loadedA = -1;           // Value of a LD A,n8 just before, for bank switches
+        for (;;) {
+            u32 offset;
+            if (!toOffset(at.bank, at.address, offset)) {
+                break;
+            }
+            u8& flags = m_map[offset];
+            if (flags & CODE) {
+                if (blockStart && (flags & LENGTH_MASK)) {
+                    flags |= BLOCK_START;
+                    m_dirtyBanks[offset / ROM_BANK_SIZE] = true;
+                }
+                break;
+            }
+
+            // The instruction must fit in its bank and overlap nothing decoded
+            const u32 available = (at.address < ROM_BANK_SIZE ? ROM_BANK_SIZE : 2 * ROM_BANK_SIZE) - at.address;
+            const u8* bytes = m_rom.data() + offset;
+            u8 padded[3] = {bytes[0], 0, 0};
+            for (u32 i = 1; i < 3 && i < available && offset + i < m_rom.size(); i++) {
+                padded[i] = bytes[i];
+            }
+            const u8 length = Disassembler::getInfo(padded).length;
+            if (length == 0 || length > available || offset + length > m_rom.size()) {
+                break;
+            }
+            bool overlaps = false;
+            for (u32 i = 1; i < length; i++) {
+                overlaps = overlaps || (m_map[offset + i] & CODE);
+            }
+            if (overlaps) {
+                break;
+            }
+
+            flags |= length | CODE | (blockStart ? BLOCK_START : 0);
+            for (u32 i = 1; i < length; i++) {
+                m_map[offset + i] |= CODE;
+            }
+            m_dirtyBanks[offset / ROM_BANK_SIZE] = true;
+
+            // LD A,n8 then LD (2000-3FFF),A selects the bank at 0x4000
+            const u8 opcode = padded[0];
+            if (opcode == 0xEA && loadedA >= 0 && padded[2] >= 0x20 && padded[2] < 0x40) {
+                const u32 selected = static_cast<u32>(loadedA) % std::max<u32>(banks, 1);
+                at.mapped = static_cast<u8>(selected == 0 ? 1 : selected);
+            }
+            loadedA = opcode == 0x3E ? padded[1] : -1;
+
+            const Flow flow = flowOf(opcode);
+            u16 target;
+            if ((flow == Flow::JUMP || flow == Flow::BRANCH || flow == Flow::CALL) && targetOf(padded, at.address, target)) {
+                // Bank 0 code calls into whatever bank it mapped; bank n code stays in bank n
+                if (target < ROM_BANK_SIZE) {
+                    pending.push_back({target, 0, at.mapped});
+                } else if (target < 2 * ROM_BANK_SIZE) {
+                    const u8 bank = at.bank != 0 ? at.bank : at.mapped;
+                    pending.push_back({target, bank, bank});
+                }
+            }
+
+            if (flow == Flow::JUMP || flow == Flow::RETURN || flow == Flow::INDIRECT || flow == Flow::INVALID) {
+                break;
+            }
+            blockStart = flow != Flow::NEXT;
+            at.address = static_cast<u16>(at.address + length);
+        }
+    }
+}
+
+// Recut the blocks of every bank the walk changed
+void CodeAnalysis::rebuildBlocks() {
+    for (u32 bank = 0; bank < m_dirtyBanks.size(); bank++) {
+        if (!m_dirtyBanks[bank]) {
+            continue;
+        }
+        m_dirtyBanks[bank] = false;
+
+        const u32 begin = bank * ROM_BANK_SIZE;
+        const u32 end = std::min<u32>(begin + ROM_BANK_SIZE, static_cast<u32>(m_rom.size()));
+        auto byOffset = [](const Block& block, u32 offset) { return block.offset < offset; };
+        auto first = std::lower_bound(m_blocks.begin(), m_blocks.end(), begin, byOffset);
+        auto last = std::lower_bound(first, m_blocks.end(), end, byOffset);
+
+        std::vector<Block> blocks;
+        for (u32 offset = begin; offset < end; offset++) {
+            if (!(m_map[offset] & BLOCK_START) || !(m_map[offset] & LENGTH_MASK)) {
+                continue;
+            }
+
+            // Instructions up to one that passes control, or up to the next block
+            Block block{offset, 0, 0, BlockEnd::FALLTHROUGH, false};
+            bool readOnly = true;
+            u32 at = offset;
+            for (;;) {
+                const u8 length = m_map[at] & LENGTH_MASK;
+                const u8* bytes = m_rom.data() + at;
+                const Flow flow = flowOf(bytes[0]);
+                readOnly = readOnly && isReadOnly(bytes);
+                block.instructions++;
+                at += length;
+
+                if (flow != Flow::NEXT) {
+                    static constexpr BlockEnd ENDS[] = {BlockEnd::FALLTHROUGH, BlockEnd::JUMP, BlockEnd::BRANCH,
+                                                        BlockEnd::CALL, BlockEnd::RETURN, BlockEnd::INDIRECT,
+                                                        BlockEnd::INVALID};
+                    block.end = ENDS[static_cast<u8>(flow)];
+
+                    // Back to its own start (a conditional RET has no target)
+                    const u16 address = static_cast<u16>(bank == 0 ? at - length : ROM_BANK_SIZE + (at - length - begin));
+                    const u16 start = static_cast<u16>(bank == 0 ? offset : ROM_BANK_SIZE + (offset - begin));
+                    u16 target;
+                    block.idleLoop = readOnly && (flow == Flow::JUMP || flow == Flow::BRANCH) &&
+                                     targetOf(bytes, address, target) && target == start;
+                    break;
+                }
+                if (at >= end || !(m_map[at] & LENGTH_MASK)) {
+                    block.end = at >= end || (m_map[at] & CODE) ? BlockEnd::FALLTHROUGH : BlockEnd::INVALID;
+                    break;
+                }
+                if (m_map[at] & BLOCK_START) {
+                    break;
+                }
+            }
+            block.length = static_cast<u16>(at - offset);
+            blocks.push_back(block);
+        }
+
+        first = m_blocks.erase(first, last);
+        m_blocks.insert(first, blocks.begin(), blocks.end());
+    }
+
+    rebuildIdleFilter();
+}
+
+// Mark the CPU address of every idle loop
+void CodeAnalysis::rebuildIdleFilter() {
+    std::fill(m_idleAddresses.begin(), m_idleAddresses.end(), 0);
+    for (const Block& block : m_blocks) {
+        if (block.idleLoop) {
+            const u16 address = static_cast<u16>(block.offset < ROM_BANK_SIZE ? block.offset
+                                                                              : ROM_BANK_SIZE + block.offset % ROM_BANK_SIZE);
+            m_idleAddresses[address >> 6] |= 1ull << (address & 63);
+        }
+    }
+}
+
+// Idle loop starting at address
+const CodeAnalysis::Block* CodeAnalysis::findIdleLoop(u16 address, u8 romBank) const {
+    u32 offset;
+    if (!toOffset(address < ROM_BANK_SIZE ? 0 : romBank, address, offset)) {
+        return nullptr;
+    }
+    auto it = std::lower_bound(m_blocks.begin(), m_blocks.end(), offset,
+                               [](const Block& block, u32 value) { return block.offset < value; });
+    return it != m_blocks.end() && it->offset == offset && it->idleLoop ? &*it : nullptr;
+}
+
+// Totals over the analysis
+CodeAnalysis::Stats CodeAnalysis::getStats() const {
+    Stats stats;
+    stats.blocks = m_blocks.size();
+    stats.entryPoints = m_entryPoints.size();
+    for (const Block& block : m_blocks) {
+        stats.instructions += block.instructions;
+        stats.codeBytes += block.length;
+        stats.idleLoops += block.idleLoop;
+    }
+    return stats;
+}
+
+// Mark the instructions of a cached block
+void CodeAnalysis::decodeBlock(const Block& block) {
+    m_map[block.offset] |= BLOCK_START;
+    u32 at = block.offset;
+    for (u16 i = 0; i < block.instructions; i++) {
+        const u8 length = Disassembler::getInfo(m_rom.data() + at).length;
+        m_map[at] |= length | CODE;
+        for (u32 j = 1; j < length; j++) {
+            m_map[at + j] |= CODE;
+        }
+        at += length;
+    }
+}
+
+// Load a cache file written for this ROM
+bool CodeAnalysis::load(const std::string& filename) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    CodeCacheHeader header;
+    if (file.size() < sizeof(header)) {
+        std::cerr << "Ignoring invalid code cache: " << filename << std::endl;
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const u64 blockBytes = static_cast<u64>(header.blockCount) * sizeof(CodeCacheBlock);
+    if (std::memcmp(header.magic, CODE_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CODE_CACHE_VERSION ||
+        file.size() != sizeof(header) + blockBytes + static_cast<u64>(header.entryCount) * sizeof(u32)) {
+        std::cerr << "Ignoring invalid code cache: " << filename << std::endl;
+        return false;
+    }
+    if (header.romHash != m_romHash || header.romSize != m_rom.size()) {
+        std::cerr << "Ignoring code cache for another ROM: " << filename << std::endl;
+        return false;
+    }
+
+    // Blocks must lie in one bank each and decode to their recorded length
+    std::vector<Block> blocks(header.blockCount);
+    const u8* records = file.data() + sizeof(header);
+    for (u32 i = 0; i < header.blockCount; i++) {
+        CodeCacheBlock record;
+        std::memcpy(&record, records + i * sizeof(CodeCacheBlock), sizeof(record));
+
+        u32 length = 0;
+        const u32 bankEnd = (record.offset / ROM_BANK_SIZE + 1) * ROM_BANK_SIZE;
+        for (u16 j = 0; j < record.instructions && record.offset + length < std::min<u64>(bankEnd, m_rom.size()); j++) {
+            const u32 at = record.offset + length;
+            length += at + 1 < m_rom.size() ? Disassembler::getInfo(m_rom.data() + at).length : 1;
+        }
+        if ((i > 0 && record.offset <= blocks[i - 1].offset) || record.end > static_cast<u8>(BlockEnd::INVALID) ||
+            length != record.length || record.offset + length > std::min<u64>(bankEnd, m_rom.size())) {
+            std::cerr << "Ignoring invalid code cache: " << filename << std::endl;
+            return false;
+        }
+        blocks[i] = {record.offset, record.length, record.instructions, static_cast<BlockEnd>(record.end),
+                     record.idleLoop != 0};
+    }
+
+    std::fill(m_map.begin(), m_map.end(), 0);
+    for (const Block& block : blocks) {
+        decodeBlock(block);
+    }
+    m_blocks = std::move(blocks);
+    // An empty vector may have no storage to copy into
+    m_entryPoints.resize(header.entryCount);
+    if (header.entryCount > 0) {
+        std::memcpy(m_entryPoints.data(), records + blockBytes, header.entryCount * sizeof(u32));
+    }
+
+    std::fill(m_dirtyBanks.begin(), m_dirtyBanks.end(), false);
+    rebuildIdleFilter();
+    m_fromCache = true;
+    return true;
+}
+
+// Write the cache through a temporary file
+bool CodeAnalysis::save(const std::string& filename) const {
+    std::vector<CodeCacheBlock> records(m_blocks.size());
+    for (size_t i = 0; i < m_blocks.size(); i++) {
+        const Block& block = m_blocks[i];
+        records[i] = {block.offset, block.length, block.instructions, static_cast<u8>(block.end),
+                      static_cast<u8>(block.idleLoop), 0};
+    }
+
+    CodeCacheHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, CODE_CACHE_MAGIC, sizeof(header.magic));
+    header.version = CODE_CACHE_VERSION;
+    header.blockCount = static_cast<u32>(records.size());
+    header.romHash = m_romHash;
+    header.romSize = m_rom.size();
+    header.entryCount = static_cast<u32>(m_entryPoints.size());
+
+    const std::string temporary = filename + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(CodeCacheBlock));
+        file.write(reinterpret_cast<const char*>(m_entryPoints.data()), m_entryPoints.size() * sizeof(u32));
+        if (!file.good()) {
+            std::cerr << "Failed to write code cache: " << temporary << std::endl;
+            return false;
+        }
+    }
+
+    // Replace the previous cache in one step
+    std::error_code error;
+    fs::rename(temporary, filename, error);
+    if (error) {
+        std::cerr << "Failed to write code cache: " << filename << " (" << error.message() << ")" << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
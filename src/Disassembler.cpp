@@ -0,0 +1,89 @@
+#include "Disassembler.h"
+#include "SymbolTable.h"
+
+namespace {
+#include "OpcodeInfo.inc"
+}
+
+// Metadata of an opcode (cb selects the 0xCB-prefixed table)
+const OpcodeInfo& Disassembler::getInfo(u8 opcode, bool cb) {
+    return cb ? CB_OPCODE_INFO[opcode] : OPCODE_INFO[opcode];
+}
+
+// Metadata of the instruction starting with these bytes
+const OpcodeInfo& Disassembler::getInfo(const u8* bytes) {
+    return bytes[0] == 0xCB ? CB_OPCODE_INFO[bytes[1]] : OPCODE_INFO[bytes[0]];
+}
+
+// Symbol for an address given the mapped ROM bank
+const char* Disassembler::findSymbol(u16 address, u8 romBank) const {
+    if (!m_symbols) {
+        return nullptr;
+    }
+
+    // Only the switchable ROM area depends on the mapped bank
+    u8 bank = (address >= 0x4000 && address < 0x8000) ? romBank : 0;
+    return m_symbols->find(bank, address);
+}
+
+// Decode one instruction into a caller-provided buffer
+size_t Disassembler::decode(const u8* bytes, u16 pc, u8 romBank, char* out, size_t outSize) const {
+    const OpcodeInfo& info = getInfo(bytes);
+    TextWriter writer(out, outSize);
+
+    // Write an address, or its symbol when there is one
+    auto address = [&](u16 value) {
+        if (const char* symbol = findSymbol(value, romBank)) {
+            writer.put(symbol);
+        } else {
+            writer.put('$');
+            writer.hex(value, 4);
+        }
+    };
+
+    // Immediate operands follow the opcode (0xCB instructions have none);
+    // only the instruction's own bytes are read
+    const u8 low = info.length > 1 ? bytes[1] : 0;
+    const u16 word = info.length > 2 ? static_cast<u16>(bytes[1] | (bytes[2] << 8)) : low;
+
+    for (const char* p = info.format; *p; p++) {
+        if (*p != '%') {
+            writer.put(*p);
+            continue;
+        }
+
+        switch (*++p) {
+            case 'n':
+                writer.put('$');
+                writer.hex(low, 2);
+                break;
+            case 'N':
+                writer.put('$');
+                writer.hex(word, 4);
+                break;
+            case 'a':
+                address(static_cast<u16>(0xFF00 | low));
+                break;
+            case 'A':
+                address(word);
+                break;
+            case 'e':
+                writer.decimal(static_cast<s8>(low));
+                break;
+            case 'o':
+                if (static_cast<s8>(low) >= 0) {
+                    writer.put('+');
+                }
+                writer.decimal(static_cast<s8>(low));
+                break;
+            case 'r':
+                address(static_cast<u16>(pc + info.length + static_cast<s8>(low)));
+                break;
+            default:
+                writer.put('?');
+                break;
+        }
+    }
+
+    return writer.finish();
+}
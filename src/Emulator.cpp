@@ -1,12 +1,17 @@
 #include "Emulator.h"
+#include "Trace.h"
 #include "json.hpp"
+#include <cstdlib>
+#include <filesystem>
 #include <sstream>
 #include <thread>
 
+// Interval between metrics exports
+constexpr auto METRICS_EXPORT_INTERVAL = std::chrono::milliseconds(1000);
+
 // Emulator constructor
-Emulator::Emulator() : m_initialized(false), m_paused(true), 
-                       m_cpu(CPU::getInstance()), m_memory(Memory::getInstance()),
-                       m_ppu(PPU::getInstance()) {
+Emulator::Emulator() : m_initialized(false), m_paused(true), m_inputPending(false),
+                       m_gameBoy(GameBoy::getInstance()), m_ppu(m_gameBoy.getPPU()) {
 }
 
 // Initialize emulator
@@ -25,6 +30,28 @@ bool Emulator::initialize(HWND hwnd) {
     // Initialize PPU
     m_ppu.initialize();
     
+    // Skip the boot ROM if requested
+    if (const char* fastBoot = std::getenv("GBWV2_FAST_BOOT")) {
+        m_gameBoy.setFastBoot(std::string(fastBoot) != "0");
+    }
+    
+    // Suspend on shutdown and resume on ROM load if a suspend file is configured
+    if (const char* suspendFile = std::getenv("GBWV2_SUSPEND")) {
+        m_suspendFile = suspendFile;
+    }
+    
+    // Export metrics if a target is configured (file path or unix:<path>)
+    if (const char* metricsTarget = std::getenv("GBWV2_METRICS")) {
+        m_gameBoy.startMetricsExport(metricsTarget, METRICS_EXPORT_INTERVAL);
+    }
+    
+    // Record trace events if a trace file is configured
+    if (const char* traceFile = std::getenv("GBWV2_TRACE")) {
+        m_traceFile = traceFile;
+        Tracer::getInstance().setThreadName("emulation");
+        Tracer::getInstance().setEnabled(true);
+    }
+    
     m_initialized = true;
     return true;
 }
@@ -35,6 +62,17 @@ void Emulator::shutdown() {
         return;
     }
     
+    // Stop exporting metrics
+    m_gameBoy.stopMetricsExport();
+    
+    // Keep the session for the next start
+    suspend();
+    
+    // Write the trace recorded during the session
+    if (!m_traceFile.empty()) {
+        exportTrace(m_traceFile);
+    }
+    
     // Release WebView2 resources
     if (m_webView) {
         m_webView.Reset();
@@ -57,23 +95,31 @@ bool Emulator::loadROM(const std::string& filename) {
         return false;
     }
     
-    // Load ROM into memory
-    if (!m_memory.loadROM(filename)) {
+    // Load ROM and opcodes into the emulation core
+    if (!m_gameBoy.loadROM(filename)) {
         return false;
     }
     
-    // Load opcodes
-    if (!m_cpu.loadOpcodes("resources/Opcodes.json")) {
-        // If loading opcodes fails, we'll use the hardcoded ones
-        std::cerr << "Using hardcoded opcodes" << std::endl;
-    }
-    
     // Reset emulator
     reset();
     
+    // Continue the previous session of this ROM
+    if (!m_suspendFile.empty() && std::filesystem::exists(m_suspendFile)) {
+        m_gameBoy.resume(m_suspendFile);
+    }
+    
     return true;
 }
 
+// Write the machine state to the suspend file
+bool Emulator::suspend() const {
+    if (m_suspendFile.empty() || m_gameBoy.getFrameCount() == 0) {
+        return false;
+    }
+    
+    return m_gameBoy.suspend(m_suspendFile);
+}
+
 // Reset emulator
 void Emulator::reset() {
     if (!m_initialized) {
@@ -81,9 +127,7 @@ void Emulator::reset() {
     }
     
     // Reset components
-    m_cpu.reset();
-    m_memory.reset();
-    m_ppu.reset();
+    m_gameBoy.reset();
     
     // Reset emulator state
     m_paused = true;
@@ -100,7 +144,17 @@ void Emulator::run() {
     emulateFrame();
     
     // Update screen
+    auto presentStart = std::chrono::steady_clock::now();
     updateScreen();
+    auto presentEnd = std::chrono::steady_clock::now();
+    m_gameBoy.addPresentTime(presentEnd - presentStart);
+    m_frameStats.presentation.record(presentEnd - presentStart);
+    
+    // Input is visible once the frame after it has been presented
+    if (m_inputPending) {
+        m_frameStats.inputToPresent.record(presentEnd - m_inputTime);
+        m_inputPending = false;
+    }
 }
 
 // Pause emulator
@@ -108,35 +162,38 @@ void Emulator::pause() {
     m_paused = true;
 }
 
+// Export the recorded trace events
+bool Emulator::exportTrace(const std::string& filename) const {
+    return Tracer::getInstance().exportChromeJson(filename);
+}
+
+// Host input event
+void Emulator::notifyInput() {
+    // Keep the oldest unpresented input so the latency is not understated
+    if (!m_inputPending) {
+        m_inputTime = std::chrono::steady_clock::now();
+        m_inputPending = true;
+    }
+}
+
 // Emulate one frame
 void Emulator::emulateFrame() {
     // Calculate time since last frame
     auto currentTime = std::chrono::high_resolution_clock::now();
-    auto deltaTime = std::chrono::duration_cast<std::chrono::microseconds>(currentTime - m_lastFrameTime).count();
+    auto deltaTime = std::chrono::duration_cast<std::chrono::nanoseconds>(currentTime - m_lastFrameTime);
     m_lastFrameTime = currentTime;
+    auto frameStart = std::chrono::steady_clock::now();
     
-    // Target 60 FPS (16.67 ms per frame)
-    const u32 targetCycles = 70224; // Cycles per frame at 60 FPS
-    
-    // Emulate CPU cycles
-    u32 cycles = 0;
-    while (cycles < targetCycles) {
-        // Get current cycles
-        u32 currentCycles = m_cpu.getCycles();
-        
-        // Step CPU
-        m_cpu.step();
-        
-        // Get cycles elapsed
-        u32 elapsed = m_cpu.getCycles() - currentCycles;
-        cycles += elapsed;
-        
-        // Update PPU
-        m_ppu.update(elapsed);
-        
-        // Also update the PPU in Memory for compatibility
-        m_memory.updatePPU(elapsed);
+    // Pacing error against the hardware frame rate; gaps longer than a
+    // second come from pauses or ROM loads and are not pacing errors
+    if (m_gameBoy.getFrameCount() > 0 && deltaTime < std::chrono::seconds(1)) {
+        m_frameStats.pacingError.record(deltaTime > FRAME_DURATION ? deltaTime - FRAME_DURATION : FRAME_DURATION - deltaTime);
     }
+    
+    // Run the emulation core for one frame
+    m_gameBoy.emulateFrame();
+    
+    m_frameStats.emulation.record(std::chrono::steady_clock::now() - frameStart);
 }
 
 // Update screen
@@ -287,18 +344,24 @@ void Emulator::sendScreenDataToWebView() {
     // Get screen buffer from PPU
     const auto& screenBuffer = m_ppu.getScreenBuffer();
     
-    // Create JSON message with more efficient format
-    nlohmann::json message;
-    message["type"] = "screenUpdate";
-    
-    // Instead of sending each pixel individually, send a flat array
-    // This significantly reduces JSON overhead
-    message["pixels"] = screenBuffer;
-    
-    // Convert to string
-    std::string messageStr = message.dump();
-    std::wstring messageWstr(messageStr.begin(), messageStr.end());
+    std::wstring messageWstr;
+    {
+        TRACE_SCOPE("encodeFrame");
+        
+        // Create JSON message with more efficient format
+        nlohmann::json message;
+        message["type"] = "screenUpdate";
+        
+        // Instead of sending each pixel individually, send a flat array
+        // This significantly reduces JSON overhead
+        message["pixels"] = screenBuffer;
+        
+        // Convert to string
+        std::string messageStr = message.dump();
+        messageWstr.assign(messageStr.begin(), messageStr.end());
+    }
     
     // Send message to WebView
+    TRACE_SCOPE("presentFrame");
     m_webView->PostWebMessageAsJson(messageWstr.c_str());
 } 
\ No newline at end of file
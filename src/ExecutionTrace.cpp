@@ -0,0 +1,45 @@
+#include "ExecutionTrace.h"
+#include <cstring>
+
+// ExecutionTraceWriter destructor
+ExecutionTraceWriter::~ExecutionTraceWriter() {
+    close();
+}
+
+// Create the trace file and write its header
+bool ExecutionTraceWriter::open(const std::string& filename) {
+    close();
+
+    m_file.open(filename, std::ios::binary | std::ios::trunc);
+    if (!m_file.is_open()) {
+        std::cerr << "Failed to create execution trace: " << filename << std::endl;
+        return false;
+    }
+
+    ExecutionTraceHeader header;
+    std::memcpy(header.magic, EXECUTION_TRACE_MAGIC, sizeof(header.magic));
+    header.version = EXECUTION_TRACE_VERSION;
+    header.entrySize = sizeof(ExecutionTraceEntry);
+    m_file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    m_buffer.reserve(BUFFER_ENTRIES);
+    m_entryCount = 0;
+    return true;
+}
+
+// Flush buffered entries and close the file
+void ExecutionTraceWriter::close() {
+    if (!m_file.is_open()) {
+        return;
+    }
+
+    flush();
+    m_file.close();
+}
+
+// Write buffered entries
+void ExecutionTraceWriter::flush() {
+    m_file.write(reinterpret_cast<const char*>(m_buffer.data()), m_buffer.size() * sizeof(ExecutionTraceEntry));
+    m_entryCount += m_buffer.size();
+    m_buffer.clear();
+}
@@ -0,0 +1,102 @@
+#include "FrameCodec.h"
+#include <cstring>
+
+// Unchanged bytes cheaper to resend than to start a new run for
+constexpr size_t RUN_HEADER_SIZE = 4;
+
+// Write a little-endian u16
+static void putU16(u8* out, size_t value) {
+    out[0] = static_cast<u8>(value);
+    out[1] = static_cast<u8>(value >> 8);
+}
+
+// Pack shades at 2 bits per pixel
+void packFrame(const u8* shades, u8* packed) {
+    for (size_t i = 0; i < PACKED_FRAME_SIZE; i++) {
+        const u8* pixel = shades + i * 4;
+        packed[i] = static_cast<u8>((pixel[0] & 3) | ((pixel[1] & 3) << 2) | ((pixel[2] & 3) << 4) | ((pixel[3] & 3) << 6));
+    }
+}
+
+// Unpack 2 bits per pixel into shades
+void unpackFrame(const u8* packed, u8* shades) {
+    for (size_t i = 0; i < PACKED_FRAME_SIZE; i++) {
+        u8* pixel = shades + i * 4;
+        pixel[0] = packed[i] & 3;
+        pixel[1] = (packed[i] >> 2) & 3;
+        pixel[2] = (packed[i] >> 4) & 3;
+        pixel[3] = (packed[i] >> 6) & 3;
+    }
+}
+
+// Encode the changed runs
+size_t encodeDelta(const u8* previous, const u8* current, u8* out) {
+    size_t size = 0;
+    size_t position = 0;    // End of the previous run
+
+    size_t i = 0;
+    while (i < PACKED_FRAME_SIZE) {
+        // Next changed byte
+        while (i < PACKED_FRAME_SIZE && previous[i] == current[i]) {
+            i++;
+        }
+        if (i == PACKED_FRAME_SIZE) {
+            break;
+        }
+
+        // Extend the run over short unchanged gaps
+        size_t start = i;
+        size_t end = i + 1;
+        size_t gap = 0;
+        for (size_t j = end; j < PACKED_FRAME_SIZE && gap <= RUN_HEADER_SIZE; j++) {
+            if (previous[j] != current[j]) {
+                end = j + 1;
+                gap = 0;
+            } else {
+                gap++;
+            }
+        }
+
+        const size_t length = end - start;
+        if (size + RUN_HEADER_SIZE + length >= PACKED_FRAME_SIZE) {
+            return 0;
+        }
+        putU16(out + size, start - position);
+        putU16(out + size + 2, length);
+        std::memcpy(out + size + RUN_HEADER_SIZE, current + start, length);
+        size += RUN_HEADER_SIZE + length;
+
+        position = end;
+        i = end;
+    }
+
+    // An unchanged frame is one empty run, so every delta has a payload
+    if (size == 0) {
+        putU16(out, 0);
+        putU16(out + 2, 0);
+        size = RUN_HEADER_SIZE;
+    }
+    return size;
+}
+
+// Apply the runs of a delta
+bool applyDelta(const u8* delta, size_t size, u8* packed) {
+    size_t position = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        if (size - offset < RUN_HEADER_SIZE) {
+            return false;
+        }
+        const size_t skip = delta[offset] | (delta[offset + 1] << 8);
+        const size_t length = delta[offset + 2] | (delta[offset + 3] << 8);
+        offset += RUN_HEADER_SIZE;
+
+        if (length > size - offset || position + skip + length > PACKED_FRAME_SIZE) {
+            return false;
+        }
+        std::memcpy(packed + position + skip, delta + offset, length);
+        position += skip + length;
+        offset += length;
+    }
+    return true;
+}
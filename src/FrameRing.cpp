@@ -0,0 +1,253 @@
+#include "FrameRing.h"
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(FrameRingHeader) % alignof(FrameSlot) == 0, "Slots must stay aligned after the header");
+
+// Shared memory names start with a slash
+static std::string sharedName(const std::string& name) {
+    return !name.empty() && name[0] == '/' ? name : "/" + name;
+}
+
+// CLOCK_MONOTONIC in nanoseconds
+u64 monotonicNanos() {
+#ifndef _WIN32
+    timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return static_cast<u64>(now.tv_sec) * 1000000000ull + static_cast<u64>(now.tv_nsec);
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+// FrameRingWriter destructor
+FrameRingWriter::~FrameRingWriter() {
+    close();
+}
+
+// Create the shared ring
+bool FrameRingWriter::open(const std::string& name, u32 slotCount) {
+    close();
+    if (slotCount == 0) {
+        return false;
+    }
+
+#ifndef _WIN32
+    const std::string shmName = sharedName(name);
+    const size_t size = sizeof(FrameRingHeader) + static_cast<size_t>(slotCount) * sizeof(FrameSlot);
+
+    // A ring left behind by a crashed writer is replaced, not reused
+    shm_unlink(shmName.c_str());
+    int fd = shm_open(shmName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create shared memory " << shmName << ": " << std::strerror(errno) << std::endl;
+        return false;
+    }
+
+    if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+        std::cerr << "Failed to size shared memory " << shmName << ": " << std::strerror(errno) << std::endl;
+        ::close(fd);
+        shm_unlink(shmName.c_str());
+        return false;
+    }
+
+    void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        std::cerr << "Failed to map shared memory " << shmName << ": " << std::strerror(errno) << std::endl;
+        shm_unlink(shmName.c_str());
+        return false;
+    }
+
+    // The new object is zeroed: every slot has an even sequence and no frame
+    m_name = shmName;
+    m_size = size;
+    m_header = static_cast<FrameRingHeader*>(address);
+    m_slots = static_cast<u8*>(address) + sizeof(FrameRingHeader);
+
+    m_header->version = FRAME_RING_VERSION;
+    m_header->headerSize = sizeof(FrameRingHeader);
+    m_header->slotCount = slotCount;
+    m_header->slotSize = sizeof(FrameSlot);
+    m_header->width = SCREEN_WIDTH;
+    m_header->height = SCREEN_HEIGHT;
+    m_header->writerPid = static_cast<u32>(getpid());
+
+    // Readers check the magic last
+    std::atomic_thread_fence(std::memory_order_release);
+    m_header->magic = FRAME_RING_MAGIC;
+    return true;
+#else
+    (void)name;
+    std::cerr << "Shared-memory frame rings need POSIX shared memory" << std::endl;
+    return false;
+#endif
+}
+
+// Mark the ring closed and remove its name
+void FrameRingWriter::close() {
+#ifndef _WIN32
+    if (m_header) {
+        m_header->closed.store(1, std::memory_order_release);
+        munmap(m_header, m_size);
+        shm_unlink(m_name.c_str());
+    }
+#endif
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_size = 0;
+    m_name.clear();
+}
+
+// Copy a completed frame into its slot
+void FrameRingWriter::publish(const FrameInfo& info, const u8* pixels) {
+    if (!m_header) {
+        return;
+    }
+
+    FrameSlot& slot = *reinterpret_cast<FrameSlot*>(m_slots + (info.frame % m_header->slotCount) * sizeof(FrameSlot));
+
+    // Odd sequence marks a write in progress
+    u32 sequence = slot.sequence.load(std::memory_order_relaxed);
+    slot.sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    std::memcpy(&slot.info, &info, sizeof(FrameInfo));
+    std::memcpy(slot.pixels, pixels, FRAME_PIXELS);
+
+    slot.sequence.store(sequence + 2, std::memory_order_release);
+    m_header->latest.store(info.frame, std::memory_order_release);
+}
+
+// FrameRingReader destructor
+FrameRingReader::~FrameRingReader() {
+    close();
+}
+
+// Map an existing ring read-only
+bool FrameRingReader::open(const std::string& name) {
+    close();
+
+#ifndef _WIN32
+    int fd = shm_open(sharedName(name).c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(FrameRingHeader)) {
+        ::close(fd);
+        return false;
+    }
+
+    const size_t size = static_cast<size_t>(info.st_size);
+    void* address = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+
+    // Only a ring of this layout, fully set up by its writer
+    const FrameRingHeader* header = static_cast<const FrameRingHeader*>(address);
+    bool valid = header->magic == FRAME_RING_MAGIC;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    valid = valid && header->version == FRAME_RING_VERSION && header->headerSize == sizeof(FrameRingHeader) &&
+            header->slotSize == sizeof(FrameSlot) && header->slotCount > 0 &&
+            sizeof(FrameRingHeader) + static_cast<size_t>(header->slotCount) * sizeof(FrameSlot) <= size;
+    if (!valid) {
+        munmap(address, size);
+        return false;
+    }
+
+    m_header = header;
+    m_slots = static_cast<const u8*>(address) + sizeof(FrameRingHeader);
+    m_size = size;
+    return true;
+#else
+    (void)name;
+    return false;
+#endif
+}
+
+// Unmap the ring
+void FrameRingReader::close() {
+#ifndef _WIN32
+    if (m_header) {
+        munmap(const_cast<FrameRingHeader*>(m_header), m_size);
+    }
+#endif
+    m_header = nullptr;
+    m_slots = nullptr;
+    m_size = 0;
+}
+
+// Slot a frame is written to
+const FrameSlot* FrameRingReader::slot(u64 frame) const {
+    return reinterpret_cast<const FrameSlot*>(m_slots + (frame % m_header->slotCount) * sizeof(FrameSlot));
+}
+
+// Start reading a frame in place
+FrameReadStatus FrameRingReader::acquire(u64 frame, View& view) const {
+    const u64 latest = getLatest();
+    if (frame == 0 || frame > latest) {
+        return FrameReadStatus::NOT_READY;
+    }
+    if (latest - frame >= m_header->slotCount) {
+        return FrameReadStatus::OVERWRITTEN;
+    }
+
+    const FrameSlot* frameSlot = slot(frame);
+    u32 sequence = frameSlot->sequence.load(std::memory_order_acquire);
+    if (sequence & 1) {
+        return FrameReadStatus::TORN;
+    }
+
+    std::memcpy(&view.info, &frameSlot->info, sizeof(FrameInfo));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (frameSlot->sequence.load(std::memory_order_relaxed) != sequence) {
+        return FrameReadStatus::TORN;
+    }
+
+    // The slot may already hold a later frame
+    if (view.info.frame != frame) {
+        return view.info.frame > frame ? FrameReadStatus::OVERWRITTEN : FrameReadStatus::NOT_READY;
+    }
+
+    view.slot = frameSlot;
+    view.sequence = sequence;
+    return FrameReadStatus::OK;
+}
+
+// Whether the slot was left alone since acquire()
+bool FrameRingReader::validate(const View& view) const {
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return view.slot && view.slot->sequence.load(std::memory_order_relaxed) == view.sequence;
+}
+
+// Copy a frame out
+FrameReadStatus FrameRingReader::read(u64 frame, FrameInfo& info, u8* pixels) const {
+    while (true) {
+        View view;
+        FrameReadStatus status = acquire(frame, view);
+        if (status == FrameReadStatus::TORN) {
+            continue;
+        }
+        if (status != FrameReadStatus::OK) {
+            return status;
+        }
+
+        std::memcpy(pixels, view.slot->pixels, FRAME_PIXELS);
+        if (validate(view)) {
+            info = view.info;
+            return FrameReadStatus::OK;
+        }
+    }
+}
@@ -0,0 +1,381 @@
+#include "GameBoy.h"
+#include "FrameRing.h"
+#include "Serial.h"
+#include "SuspendFile.h"
+#include "Trace.h"
+#include <cstring>
+
+// CPU run slice traced as one event (one scanline worth of cycles)
+constexpr u32 CPU_SLICE_CYCLES = 456;
+
+// Per-machine state budget (cartridge RAM aside)
+static_assert(sizeof(GameBoy) < 64 * 1024, "A machine must stay under 64 KB");
+
+// GameBoy constructor
+GameBoy::GameBoy() : m_memory(&m_banks), m_cpu(m_memory), m_ppu(m_memory), m_scheduler(m_cpu, m_memory, m_ppu),
+                     m_coroutineScheduling(false),
+                     m_fastBoot(false), m_startupNanos(0), m_startupFrames(0), m_resetFrame(0), m_romHash(0),
+                     m_frameCount(0), m_cycleCount(0), m_frameNanos(0), m_presentNanos(0),
+                     m_metricsExporter(m_metricsPublisher), m_frameRing(nullptr) {
+    // The banks are constructed last, so the memory is cleared only now
+    m_memory.reset();
+    setLoopIdioms(true);
+    m_cpu.setBusTick(&GameBoy::tickDevices, this);
+}
+
+// Run copy and fill loops in bulk, never past a PPU mode change, the VBlank
+// line or a serial completion (the scheduler's next deadline in its runs)
+void GameBoy::setLoopIdioms(bool enabled) {
+    if (!enabled) {
+        m_cpu.setEventHorizon(nullptr);
+        return;
+    }
+    m_cpu.setEventHorizon([this]() {
+        if (m_scheduler.isRunning()) {
+            return m_scheduler.cyclesUntilEvent();
+        }
+        return std::min(m_ppu.cyclesUntilEvent(), m_memory.cyclesUntilEvent());
+    });
+}
+
+// Load ROM
+bool GameBoy::loadROM(const std::string& filename, const std::string& opcodesFile) {
+    TRACE_SCOPE("loadROM");
+
+    // Load ROM into memory
+    if (!m_memory.loadROM(filename)) {
+        return false;
+    }
+
+    return finishLoad(opcodesFile);
+}
+
+// Load a ROM image from memory
+bool GameBoy::loadROM(const u8* data, size_t size, const std::string& opcodesFile) {
+    TRACE_SCOPE("loadROM");
+
+    if (!m_memory.loadROM(data, size)) {
+        return false;
+    }
+
+    return finishLoad(opcodesFile);
+}
+
+// Hash the new ROM, load opcodes and reset
+bool GameBoy::finishLoad(const std::string& opcodesFile) {
+    // The analysis belonged to the previous ROM
+    m_cpu.setCodeAnalysis(nullptr);
+    m_codeAnalysis.reset();
+
+    // Identifies the ROM in suspend files
+    const auto& rom = m_memory.getCartridge()->getROM();
+    m_romHash = hashBytes(rom.data(), rom.size());
+
+    // Load opcodes
+    if (!m_cpu.loadOpcodes(opcodesFile)) {
+        // If loading opcodes fails, we'll use the hardcoded ones
+        std::cerr << "Using hardcoded opcodes" << std::endl;
+    }
+
+    // Reset components
+    reset();
+
+    return true;
+}
+
+// Analyse the loaded ROM, from the cache file when it matches
+bool GameBoy::analyzeCode(const std::string& cacheFile) {
+    TRACE_SCOPE("analyzeCode");
+    const Cartridge* cartridge = m_memory.getCartridge();
+    if (!cartridge) {
+        return false;
+    }
+
+    m_cpu.setCodeAnalysis(nullptr);
+    m_codeAnalysis = std::make_unique<CodeAnalysis>(cartridge->getROM(), m_romHash);
+    if (cacheFile.empty() || !m_codeAnalysis->load(cacheFile)) {
+        m_codeAnalysis->analyze();
+    }
+    m_cpu.setCodeAnalysis(m_codeAnalysis.get());
+    return true;
+}
+
+// Write the analysis, with the code found while running, to a cache file
+bool GameBoy::saveCodeCache(const std::string& filename) const {
+    return m_codeAnalysis && m_codeAnalysis->save(filename);
+}
+
+// Reset components
+void GameBoy::reset() {
+    m_cpu.reset();
+    m_memory.reset();
+    m_ppu.reset();
+
+    // Fast boot starts at the cartridge entry point with the post-boot state
+    if (m_fastBoot) {
+        m_memory.skipBootROM();
+        m_cpu.skipBootROM(m_memory.peek(0x014D));
+    }
+
+    // Startup is measured again from every reset
+    m_resetTime = std::chrono::steady_clock::now();
+    m_resetFrame = m_frameCount;
+    m_startupNanos = 0;
+    m_startupFrames = 0;
+}
+
+// Write the machine state to a suspend file
+bool GameBoy::suspend(const std::string& filename) const {
+    TRACE_SCOPE("suspend");
+    const Cartridge* cartridge = m_memory.getCartridge();
+    if (!cartridge) {
+        return false;
+    }
+
+    MachineState state;
+    captureState(state);
+
+    SuspendHeader header;
+    header.romHash = m_romHash;
+    header.frameCount = m_frameCount;
+    return writeSuspendFile(filename, header, state, cartridge->getRAM());
+}
+
+// Continue from a suspend file written for the loaded ROM
+bool GameBoy::resume(const std::string& filename) {
+    TRACE_SCOPE("resume");
+    auto resumeStart = std::chrono::steady_clock::now();
+
+    Cartridge* cartridge = m_memory.getCartridge();
+    MappedFile file;
+    if (!cartridge || !file.open(filename)) {
+        return false;
+    }
+
+    SuspendHeader header;
+    const MachineState* state = nullptr;
+    const u8* ram = nullptr;
+    std::string error;
+    if (!validateSuspendFile(file, m_romHash, header, state, ram, cartridge->getRAM().size(), error)) {
+        std::cerr << "Cannot resume from " << filename << ": " << error << std::endl;
+        return false;
+    }
+
+    // Adopt the mapped state blocks
+    restoreState(*state, ram);
+    m_frameCount = header.frameCount;
+
+    // Startup is now measured from the resume
+    m_resetTime = resumeStart;
+    m_resetFrame = m_frameCount;
+    m_startupNanos = 0;
+    m_startupFrames = 0;
+    return true;
+}
+
+// Size of a suspend image for the loaded ROM
+size_t GameBoy::getStateSize() const {
+    const Cartridge* cartridge = m_memory.getCartridge();
+    return cartridge ? suspendImageSize(cartridge->getRAM().size()) : 0;
+}
+
+// Write a suspend image into a caller buffer; returns its size
+size_t GameBoy::saveState(u8* buffer, size_t size) const {
+    const size_t stateSize = getStateSize();
+    if (stateSize == 0 || size < stateSize ||
+        reinterpret_cast<uintptr_t>(buffer + sizeof(SuspendHeader)) % alignof(MachineState) != 0) {
+        return 0;
+    }
+
+    // The state block is written in place, the header last
+    MachineState& state = *reinterpret_cast<MachineState*>(buffer + sizeof(SuspendHeader));
+    captureState(state);
+    const std::vector<u8>& ram = m_memory.getCartridge()->getRAM();
+    u8* stateRAM = buffer + sizeof(SuspendHeader) + sizeof(MachineState);
+    std::copy(ram.begin(), ram.end(), stateRAM);
+
+    SuspendHeader header;
+    header.romHash = m_romHash;
+    header.frameCount = m_frameCount;
+    finishSuspendHeader(header, state, stateRAM, ram.size());
+    std::memcpy(buffer, &header, sizeof(header));
+    return stateSize;
+}
+
+// Continue from a suspend image in a caller buffer
+bool GameBoy::loadState(const u8* buffer, size_t size) {
+    Cartridge* cartridge = m_memory.getCartridge();
+    if (!cartridge) {
+        return false;
+    }
+
+    SuspendHeader header;
+    const MachineState* state = nullptr;
+    const u8* ram = nullptr;
+    std::string error;
+    if (!validateSuspendImage(buffer, size, m_romHash, header, state, ram, cartridge->getRAM().size(), error)) {
+        std::cerr << "Cannot load state: " << error << std::endl;
+        return false;
+    }
+
+    restoreState(*state, ram);
+    m_frameCount = header.frameCount;
+    return true;
+}
+
+// Copy the component states into a state block
+void GameBoy::captureState(MachineState& state) const {
+    // Zeroed so padding bytes are deterministic
+    std::memset(static_cast<void*>(&state), 0, sizeof(state));
+    m_cpu.saveState(state.cpu);
+    m_memory.saveState(state.memory);
+    m_ppu.saveState(state.ppu);
+    m_memory.getCartridge()->saveState(state.cartridge);
+}
+
+// Adopt a state block and the cartridge RAM that goes with it
+void GameBoy::restoreState(const MachineState& state, const u8* ram) {
+    Cartridge* cartridge = m_memory.getCartridge();
+    m_cpu.loadState(state.cpu);
+    m_memory.loadState(state.memory);
+    m_ppu.loadState(state.ppu);
+    cartridge->loadState(state.cartridge);
+    auto& cartridgeRAM = cartridge->getRAM();
+    std::copy(ram, ram + cartridgeRAM.size(), cartridgeRAM.begin());
+}
+
+// Emulate one frame
+void GameBoy::emulateFrame() {
+    TRACE_SCOPE("emulateFrame");
+    auto frameStart = std::chrono::steady_clock::now();
+    const bool bootFinished = !m_memory.isBootROMEnabled();
+
+    // One frame at ~59.73 FPS (16.74 ms per frame)
+    runCycles(CYCLES_PER_FRAME);
+
+    m_frameNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - frameStart).count();
+    m_frameCount++;
+
+    // The first frame run entirely by the game ends startup
+    if (bootFinished && m_startupFrames == 0) {
+        m_startupNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_resetTime).count();
+        m_startupFrames = m_frameCount - m_resetFrame;
+    }
+
+    publishMetrics();
+}
+
+// Run the CPU and the devices for a number of cycles
+u32 GameBoy::runCycles(u32 targetCycles) {
+    // Coroutine scheduling where it applies; the callback loop from then on
+    // if its frames do not fit the arena
+    if constexpr (BUS_TIMING == BusTiming::LUMP_SUM) {
+        if (m_coroutineScheduling && !m_memory.getSerialDevice()) {
+            if (const u32 cycles = m_scheduler.run(targetCycles)) {
+                m_cycleCount += cycles;
+                return cycles;
+            }
+            std::cerr << "Coroutine frames do not fit the scheduler arena, using the callback loop" << std::endl;
+            m_coroutineScheduling = false;
+        }
+    }
+
+    // Emulate CPU cycles in scanline-sized slices
+    u32 cycles = 0;
+    while (cycles < targetCycles) {
+        TRACE_SCOPE("cpuSlice");
+        u32 sliceEnd = std::min(cycles + CPU_SLICE_CYCLES, targetCycles);
+
+        // A linked machine runs no further than the other end allows
+        if (SerialDevice* device = m_memory.getSerialDevice()) {
+            const u64 allowed = device->synchronize(m_cycleCount) - m_cycleCount;
+            sliceEnd = cycles + static_cast<u32>(std::min<u64>(sliceEnd - cycles, allowed));
+        }
+
+        // A loop run in bulk may cross slice boundaries, but not what the link allows
+        const u32 bulkEnd = m_memory.getSerialDevice() ? sliceEnd : targetCycles;
+
+        while (cycles < sliceEnd) {
+            // Get current cycles
+            u32 currentCycles = m_cpu.getCycles();
+
+            // Step CPU
+            m_cpu.step(bulkEnd - cycles);
+
+            // Get cycles elapsed
+            u32 elapsed = m_cpu.getCycles() - currentCycles;
+            cycles += elapsed;
+            m_cycleCount += elapsed;
+
+            // Under M-cycle timing the CPU has advanced the devices itself
+            if constexpr (BUS_TIMING == BusTiming::LUMP_SUM) {
+                advanceDevices(elapsed);
+            }
+        }
+    }
+
+    return cycles;
+}
+
+// Advance the devices by a number of cycles
+void GameBoy::advanceDevices(u32 cycles) {
+    // Update PPU
+    m_ppu.update(cycles);
+
+    // Also update the PPU in Memory for compatibility
+    m_memory.updatePPU(cycles);
+    m_memory.updateSerial(cycles);
+}
+
+// Host time spent presenting a frame, included in the next snapshot
+void GameBoy::addPresentTime(std::chrono::nanoseconds duration) {
+    m_presentNanos += duration.count();
+}
+
+// Start exporting metrics (file path or unix:<path>)
+bool GameBoy::startMetricsExport(const std::string& target, std::chrono::milliseconds interval) {
+    return m_metricsExporter.start(target, interval);
+}
+
+// Sample performance counters around scanline rendering
+void GameBoy::setPerfCounters(PerfCounters* perfCounters) {
+    m_ppu.setPerfCounters(perfCounters);
+}
+
+// Publish the counters of all components
+void GameBoy::publishMetrics() {
+    const auto& cpuCounters = m_cpu.getCounters();
+    const auto& busCounters = m_memory.getBusCounters();
+    const auto& ppuCounters = m_ppu.getCounters();
+
+    MachineMetrics metrics;
+    metrics.frames = m_frameCount;
+    metrics.instructions = cpuCounters.instructions;
+    metrics.haltedCycles = cpuCounters.haltedCycles;
+    metrics.busReads = busCounters.reads;
+    metrics.busWrites = busCounters.writes;
+    metrics.bankSwitches = busCounters.bankSwitches;
+    metrics.scanlinesRendered = ppuCounters.scanlinesRendered;
+    metrics.scanlinesSkipped = ppuCounters.scanlinesSkipped;
+    metrics.interrupts = cpuCounters.interrupts;
+
+    // Scanline rendering happens inside the frame loop, the rest of it is CPU time
+    metrics.ppuNanos = ppuCounters.renderNanos;
+    metrics.cpuNanos = m_frameNanos > ppuCounters.renderNanos ? m_frameNanos - ppuCounters.renderNanos : 0;
+    metrics.presentNanos = m_presentNanos;
+
+    m_metricsPublisher.publish(metrics);
+
+    if (m_frameRing) {
+        TRACE_SCOPE("publishFrame");
+        const auto& screen = m_ppu.getScreenBuffer();
+        FrameInfo info;
+        info.frame = m_frameCount;
+        info.cycles = m_cycleCount;
+        info.input = m_memory.getJoypad();
+        info.metrics = metrics;
+        info.checksum = hashBytes(screen.data(), FRAME_PIXELS);
+        info.publishNanos = monotonicNanos();
+        m_frameRing->publish(info, screen.data());
+    }
+}
@@ -0,0 +1,134 @@
+#include "Histogram.h"
+#include <bit>
+#include <cmath>
+#include <iomanip>
+
+// LatencyHistogram constructor
+LatencyHistogram::LatencyHistogram() : m_max(0) {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Map a value to its bucket
+u32 LatencyHistogram::bucketIndex(u64 value) {
+    // Small values get one bucket each
+    if (value < SUB_BUCKET_COUNT) {
+        return static_cast<u32>(value);
+    }
+
+    // Larger values keep their top SUB_BUCKET_BITS + 1 significant bits
+    u32 exponent = 63 - std::countl_zero(value);
+    u32 shift = exponent - SUB_BUCKET_BITS;
+    u32 mantissa = static_cast<u32>(value >> shift) - SUB_BUCKET_COUNT;
+    return (shift + 1) * SUB_BUCKET_COUNT + mantissa;
+}
+
+// Largest value that maps to a bucket
+u64 LatencyHistogram::bucketUpperBound(u32 index) {
+    if (index < SUB_BUCKET_COUNT) {
+        return index;
+    }
+
+    u32 shift = index / SUB_BUCKET_COUNT - 1;
+    u64 mantissa = SUB_BUCKET_COUNT + (index % SUB_BUCKET_COUNT);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+// Record a value
+void LatencyHistogram::record(u64 value) {
+    m_buckets[bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+
+    u64 currentMax = m_max.load(std::memory_order_relaxed);
+    while (value > currentMax && !m_max.compare_exchange_weak(currentMax, value, std::memory_order_relaxed)) {
+    }
+}
+
+// Clear all buckets
+void LatencyHistogram::reset() {
+    for (auto& bucket : m_buckets) {
+        bucket.store(0, std::memory_order_relaxed);
+    }
+    m_max.store(0, std::memory_order_relaxed);
+}
+
+// Total number of recorded values
+u64 LatencyHistogram::count() const {
+    u64 total = 0;
+    for (const auto& bucket : m_buckets) {
+        total += bucket.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+// Value at a percentile (0-100), reported as the bucket's upper bound
+u64 LatencyHistogram::percentile(double percent) const {
+    std::array<u64, BUCKET_COUNT> counts;
+    u64 total = 0;
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        counts[i] = m_buckets[i].load(std::memory_order_relaxed);
+        total += counts[i];
+    }
+
+    if (total == 0) {
+        return 0;
+    }
+
+    u64 rank = static_cast<u64>(std::ceil(std::clamp(percent, 0.0, 100.0) / 100.0 * total));
+    rank = std::max<u64>(rank, 1);
+
+    u64 seen = 0;
+    for (u32 i = 0; i < BUCKET_COUNT; i++) {
+        seen += counts[i];
+        if (seen >= rank) {
+            // Never report more than the largest recorded value
+            return std::min(bucketUpperBound(i), max());
+        }
+    }
+
+    return max();
+}
+
+// Percentile summary
+LatencyHistogram::Summary LatencyHistogram::summarize() const {
+    Summary summary;
+    summary.count = count();
+    summary.p50 = percentile(50.0);
+    summary.p90 = percentile(90.0);
+    summary.p99 = percentile(99.0);
+    summary.max = max();
+    return summary;
+}
+
+// Clear all frame histograms
+void FrameTimeStats::reset() {
+    emulation.reset();
+    presentation.reset();
+    pacingError.reset();
+    inputToPresent.reset();
+}
+
+// Write a p50/p90/p99/max table in microseconds
+void FrameTimeStats::dump(std::ostream& out) const {
+    auto row = [&out](const char* name, const LatencyHistogram& histogram) {
+        auto summary = histogram.summarize();
+        out << std::left << std::setw(18) << name << std::right
+            << std::setw(10) << summary.count
+            << std::fixed << std::setprecision(1)
+            << std::setw(10) << summary.p50 / 1000.0
+            << std::setw(10) << summary.p90 / 1000.0
+            << std::setw(10) << summary.p99 / 1000.0
+            << std::setw(10) << summary.max / 1000.0 << "\n";
+    };
+
+    out << std::left << std::setw(18) << "histogram (us)" << std::right
+        << std::setw(10) << "count"
+        << std::setw(10) << "p50"
+        << std::setw(10) << "p90"
+        << std::setw(10) << "p99"
+        << std::setw(10) << "max" << "\n";
+    row("frame_emulation", emulation);
+    row("frame_present", presentation);
+    row("pacing_error", pacingError);
+    row("input_to_present", inputToPresent);
+}
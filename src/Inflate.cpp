@@ -0,0 +1,442 @@
+#include "Inflate.h"
+#include <cstring>
+
+namespace {
+
+// CRC-32 lookup tables for slicing by 8 bytes
+constexpr std::array<std::array<u32, 256>, 8> makeCRCTables() {
+    std::array<std::array<u32, 256>, 8> tables{};
+    for (u32 i = 0; i < 256; i++) {
+        u32 crc = i;
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320u : 0);
+        }
+        tables[0][i] = crc;
+    }
+    for (u32 i = 0; i < 256; i++) {
+        for (size_t slice = 1; slice < 8; slice++) {
+            u32 previous = tables[slice - 1][i];
+            tables[slice][i] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+constexpr auto CRC_TABLES = makeCRCTables();
+
+// Huffman code limits
+constexpr int MAX_BITS = 15;
+constexpr int FAST_BITS = 10;
+constexpr int MAX_LITLEN_CODES = 288;
+constexpr int MAX_DIST_CODES = 30;
+
+// Length and distance symbol bases and extra bits
+constexpr u16 LENGTH_BASE[29] = {3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258};
+constexpr u8 LENGTH_EXTRA[29] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0};
+constexpr u16 DIST_BASE[30] = {1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                               257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577};
+constexpr u8 DIST_EXTRA[30] = {0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                               7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13};
+
+// Order of the code length code lengths in a dynamic block header
+constexpr u8 CODE_LENGTH_ORDER[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+// LSB-first bit reader over a memory buffer
+class BitReader {
+public:
+    BitReader(const u8* data, size_t size) : m_data(data), m_size(size), m_pos(0), m_bits(0), m_count(0) {}
+
+    // Make at least n (<= 32) bits available; zeros are read past the end
+    void need(int n) {
+        if (m_count >= n) {
+            return;
+        }
+
+        // Refill a whole word at once away from the end of the input
+        if (m_pos + 8 <= m_size) {
+            u64 word;
+            std::memcpy(&word, m_data + m_pos, sizeof(word));
+            m_bits |= word << m_count;
+            int bytes = (63 - m_count) >> 3;
+            m_pos += bytes;
+            m_count += bytes * 8;
+            return;
+        }
+
+        while (m_count < n) {
+            u64 byte = m_pos < m_size ? m_data[m_pos] : 0;
+            m_pos++;
+            m_bits |= byte << m_count;
+            m_count += 8;
+        }
+    }
+
+    u32 peek(int n) const { return static_cast<u32>(m_bits & ((1ull << n) - 1)); }
+
+    void consume(int n) {
+        m_bits >>= n;
+        m_count -= n;
+    }
+
+    u32 bits(int n) {
+        need(n);
+        u32 value = peek(n);
+        consume(n);
+        return value;
+    }
+
+    // Skip to the next byte boundary
+    void alignToByte() { consume(m_count & 7); }
+
+    // Copy byte-aligned data (stored blocks)
+    bool copyBytes(u8* out, size_t count) {
+        // Give back the whole bytes still buffered and read straight from the input
+        m_pos = consumed();
+        m_bits = 0;
+        m_count = 0;
+
+        if (m_pos > m_size || count > m_size - m_pos) {
+            return false;
+        }
+        std::memcpy(out, m_data + m_pos, count);
+        m_pos += count;
+        return true;
+    }
+
+    // Input bytes actually used
+    size_t consumed() const { return m_pos - static_cast<size_t>(m_count / 8); }
+    bool overrun() const { return consumed() > m_size; }
+
+private:
+    const u8* m_data;
+    size_t m_size;
+    size_t m_pos;
+    u64 m_bits;
+    int m_count;
+};
+
+// Canonical Huffman code with a lookup table for short codes
+struct Huffman {
+    std::array<u16, 1 << FAST_BITS> fast;     // symbol << 4 | length, 0 for longer codes
+    std::array<u16, MAX_BITS + 1> count;
+    std::array<u16, MAX_LITLEN_CODES> symbols;  // Ordered by code
+
+    // Build from code lengths; incomplete codes are allowed, oversubscribed ones are not
+    bool build(const u8* lengths, int n) {
+        count.fill(0);
+        for (int symbol = 0; symbol < n; symbol++) {
+            count[lengths[symbol]]++;
+        }
+        count[0] = 0;
+
+        int left = 1;
+        for (int length = 1; length <= MAX_BITS; length++) {
+            left = (left << 1) - count[length];
+            if (left < 0) {
+                return false;
+            }
+        }
+
+        // Symbols sorted by length, then value
+        std::array<u16, MAX_BITS + 2> offsets{};
+        for (int length = 1; length <= MAX_BITS; length++) {
+            offsets[length + 1] = offsets[length] + count[length];
+        }
+        for (int symbol = 0; symbol < n; symbol++) {
+            if (lengths[symbol]) {
+                symbols[offsets[lengths[symbol]]++] = static_cast<u16>(symbol);
+            }
+        }
+
+        // Lookup table indexed by the next FAST_BITS input bits (codes are stored bit-reversed)
+        fast.fill(0);
+        int code = 0;
+        int index = 0;
+        for (int length = 1; length <= MAX_BITS; length++) {
+            for (int i = 0; i < count[length]; i++, code++) {
+                u16 symbol = symbols[index++];
+                if (length > FAST_BITS) {
+                    continue;
+                }
+
+                int reversed = 0;
+                for (int bit = 0; bit < length; bit++) {
+                    reversed |= ((code >> bit) & 1) << (length - 1 - bit);
+                }
+                for (int entry = reversed; entry < (1 << FAST_BITS); entry += 1 << length) {
+                    fast[entry] = static_cast<u16>((symbol << 4) | length);
+                }
+            }
+            code <<= 1;
+        }
+
+        return true;
+    }
+
+    // Next symbol, -1 for an invalid code
+    int decode(BitReader& reader) const {
+        reader.need(MAX_BITS);
+        u16 entry = fast[reader.peek(FAST_BITS)];
+        if (entry) {
+            reader.consume(entry & 0xF);
+            return entry >> 4;
+        }
+
+        // Long codes: walk the canonical code one bit at a time
+        int code = 0;
+        int first = 0;
+        int index = 0;
+        for (int length = 1; length <= MAX_BITS; length++) {
+            code |= static_cast<int>(reader.bits(1));
+            int codes = count[length];
+            if (code - codes < first) {
+                return symbols[index + (code - first)];
+            }
+            index += codes;
+            first = (first + codes) << 1;
+            code <<= 1;
+        }
+        return -1;
+    }
+};
+
+// Fixed literal/length and distance codes (block type 1)
+struct FixedCodes {
+    Huffman litlen;
+    Huffman dist;
+
+    FixedCodes() {
+        u8 lengths[MAX_LITLEN_CODES];
+        std::memset(lengths, 8, 144);
+        std::memset(lengths + 144, 9, 112);
+        std::memset(lengths + 256, 7, 24);
+        std::memset(lengths + 280, 8, 8);
+        litlen.build(lengths, MAX_LITLEN_CODES);
+
+        std::memset(lengths, 5, MAX_DIST_CODES);
+        dist.build(lengths, MAX_DIST_CODES);
+    }
+};
+
+// Read the code lengths of a dynamic block and build its codes
+bool readDynamicCodes(BitReader& reader, Huffman& litlen, Huffman& dist, std::string& error) {
+    int litlenCount = static_cast<int>(reader.bits(5)) + 257;
+    int distCount = static_cast<int>(reader.bits(5)) + 1;
+    int codeLengthCount = static_cast<int>(reader.bits(4)) + 4;
+    if (litlenCount > 286 || distCount > MAX_DIST_CODES) {
+        error = "bad code counts";
+        return false;
+    }
+
+    u8 lengths[MAX_LITLEN_CODES + MAX_DIST_CODES] = {};
+    for (int i = 0; i < codeLengthCount; i++) {
+        lengths[CODE_LENGTH_ORDER[i]] = static_cast<u8>(reader.bits(3));
+    }
+
+    Huffman codeLengths;
+    if (!codeLengths.build(lengths, 19)) {
+        error = "bad code length code";
+        return false;
+    }
+
+    // Literal/length and distance code lengths share one run-length coded sequence
+    std::memset(lengths, 0, sizeof(lengths));
+    int index = 0;
+    while (index < litlenCount + distCount) {
+        int symbol = codeLengths.decode(reader);
+        if (symbol < 0) {
+            error = "bad code length";
+            return false;
+        }
+
+        if (symbol < 16) {
+            lengths[index++] = static_cast<u8>(symbol);
+            continue;
+        }
+
+        u8 value = 0;
+        int repeat;
+        if (symbol == 16) {
+            if (index == 0) {
+                error = "repeat with no previous length";
+                return false;
+            }
+            value = lengths[index - 1];
+            repeat = 3 + static_cast<int>(reader.bits(2));
+        } else if (symbol == 17) {
+            repeat = 3 + static_cast<int>(reader.bits(3));
+        } else {
+            repeat = 11 + static_cast<int>(reader.bits(7));
+        }
+
+        if (index + repeat > litlenCount + distCount) {
+            error = "too many code lengths";
+            return false;
+        }
+        std::memset(lengths + index, value, repeat);
+        index += repeat;
+    }
+
+    if (lengths[256] == 0) {
+        error = "no end-of-block code";
+        return false;
+    }
+
+    if (!litlen.build(lengths, litlenCount) || !dist.build(lengths + litlenCount, distCount)) {
+        error = "oversubscribed code";
+        return false;
+    }
+    return true;
+}
+
+// Decode the symbols of one compressed block
+bool inflateCodes(BitReader& reader, const Huffman& litlen, const Huffman& dist,
+                  u8* begin, u8*& out, u8* end, std::string& error) {
+    for (;;) {
+        int symbol = litlen.decode(reader);
+        if (symbol < 256) {
+            if (symbol < 0) {
+                error = "bad literal/length code";
+                return false;
+            }
+            if (out == end) {
+                error = "output larger than declared";
+                return false;
+            }
+            *out++ = static_cast<u8>(symbol);
+            continue;
+        }
+
+        if (symbol == 256) {
+            return true;
+        }
+
+        // Length/distance pair
+        symbol -= 257;
+        if (symbol >= 29) {
+            error = "bad length code";
+            return false;
+        }
+        size_t length = LENGTH_BASE[symbol] + reader.bits(LENGTH_EXTRA[symbol]);
+
+        int distSymbol = dist.decode(reader);
+        if (distSymbol < 0 || distSymbol >= MAX_DIST_CODES) {
+            error = "bad distance code";
+            return false;
+        }
+        size_t distance = DIST_BASE[distSymbol] + reader.bits(DIST_EXTRA[distSymbol]);
+
+        if (distance > static_cast<size_t>(out - begin)) {
+            error = "distance too far back";
+            return false;
+        }
+        if (length > static_cast<size_t>(end - out)) {
+            error = "output larger than declared";
+            return false;
+        }
+
+        // Copies closer than their length repeat their own output
+        const u8* from = out - distance;
+        if (distance >= length) {
+            std::memcpy(out, from, length);
+            out += length;
+        } else {
+            while (length--) {
+                *out++ = *from++;
+            }
+        }
+    }
+}
+
+}
+
+// CRC-32, eight bytes at a time
+u32 crc32(const u8* data, size_t size, u32 crc) {
+    crc = ~crc;
+
+    while (size >= 8) {
+        u32 low;
+        u32 high;
+        std::memcpy(&low, data, sizeof(low));
+        std::memcpy(&high, data + 4, sizeof(high));
+        low ^= crc;
+        crc = CRC_TABLES[7][low & 0xFF] ^ CRC_TABLES[6][(low >> 8) & 0xFF] ^
+              CRC_TABLES[5][(low >> 16) & 0xFF] ^ CRC_TABLES[4][low >> 24] ^
+              CRC_TABLES[3][high & 0xFF] ^ CRC_TABLES[2][(high >> 8) & 0xFF] ^
+              CRC_TABLES[1][(high >> 16) & 0xFF] ^ CRC_TABLES[0][high >> 24];
+        data += 8;
+        size -= 8;
+    }
+
+    while (size--) {
+        crc = (crc >> 8) ^ CRC_TABLES[0][(crc ^ *data++) & 0xFF];
+    }
+
+    return ~crc;
+}
+
+// Decode one raw DEFLATE stream
+bool Inflater::inflate(const u8* input, size_t inputSize, u8* output, size_t outputSize,
+                       size_t& written, size_t& consumed, std::string& error) {
+    static const FixedCodes fixedCodes;
+
+    BitReader reader(input, inputSize);
+    u8* out = output;
+    u8* end = output + outputSize;
+    Huffman litlen;
+    Huffman dist;
+
+    bool last = false;
+    while (!last) {
+        last = reader.bits(1) != 0;
+        u32 type = reader.bits(2);
+
+        bool ok = true;
+        switch (type) {
+            case 0: {
+                // Stored block
+                reader.alignToByte();
+                u32 length = reader.bits(16);
+                u32 complement = reader.bits(16);
+                if ((length ^ 0xFFFF) != complement) {
+                    error = "stored block length mismatch";
+                    return false;
+                }
+                if (length > static_cast<size_t>(end - out)) {
+                    error = "output larger than declared";
+                    return false;
+                }
+                if (!reader.copyBytes(out, length)) {
+                    error = "truncated stored block";
+                    return false;
+                }
+                out += length;
+                break;
+            }
+            case 1:
+                ok = inflateCodes(reader, fixedCodes.litlen, fixedCodes.dist, output, out, end, error);
+                break;
+            case 2:
+                ok = readDynamicCodes(reader, litlen, dist, error) &&
+                     inflateCodes(reader, litlen, dist, output, out, end, error);
+                break;
+            default:
+                error = "invalid block type";
+                return false;
+        }
+
+        if (!ok) {
+            return false;
+        }
+        if (reader.overrun()) {
+            error = "truncated stream";
+            return false;
+        }
+    }
+
+    written = static_cast<size_t>(out - output);
+    consumed = reader.consumed();
+    return true;
+}
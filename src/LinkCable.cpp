@@ -0,0 +1,121 @@
+#include "LinkCable.h"
+#include "GameBoy.h"
+#include <thread>
+
+// Spins before a waiting end gives its core away
+constexpr u32 LINK_SPINS = 64;
+
+// LinkCable constructor
+LinkCable::LinkCable(GameBoy& first, GameBoy& second, u32 quantum) {
+    GameBoy* machines[2] = {&first, &second};
+    for (u32 side = 0; side < 2; side++) {
+        Port& port = m_ports[side];
+        port.gameBoy = machines[side];
+        port.other = &m_ports[1 - side];
+        port.base = machines[side]->getCycleCount();
+        port.quantum = std::max<u32>(quantum, 1);
+        machines[side]->setSerialDevice(&port);
+    }
+}
+
+// LinkCable destructor
+LinkCable::~LinkCable() {
+    for (Port& port : m_ports) {
+        port.gameBoy->setSerialDevice(nullptr);
+    }
+}
+
+// Stop holding the other end back
+void LinkCable::leave(u32 side) {
+    m_ports[side].left.store(true, std::memory_order_release);
+    m_ports[side].cycles.store(NO_EVENT, std::memory_order_release);
+}
+
+// Post the transfer to the other end, due when ours completes
+void LinkCable::Port::startTransfer(u8 outgoing) {
+    sending = !other->left.load(std::memory_order_acquire);
+    if (!sending) {
+        return;
+    }
+
+    // The other end is at most a quantum past our last published count, so
+    // it has not reached the completion yet
+    reply.store(NO_REPLY, std::memory_order_relaxed);
+    other->eventData.store(outgoing, std::memory_order_relaxed);
+    other->eventCycles.store(gameBoy->getCycleCount() - base + Memory::SERIAL_TRANSFER_CYCLES, std::memory_order_release);
+    stats.sent++;
+}
+
+// Our transfer completed: wait until the other end has clocked it at the same cycle
+u8 LinkCable::Port::transfer(u8) {
+    if (!sending) {
+        return 0xFF;
+    }
+    sending = false;
+
+    const u64 now = gameBoy->getCycleCount() - base;
+    cycles.store(now, std::memory_order_release);
+    u32 spins = 0;
+    for (;;) {
+        const u32 received = reply.load(std::memory_order_acquire);
+        if (received != NO_REPLY) {
+            return static_cast<u8>(received);
+        }
+        if (other->left.load(std::memory_order_acquire)) {
+            return 0xFF;
+        }
+        // Both ends may be sending at once
+        service(now);
+        wait(spins);
+    }
+}
+
+// Publish our count and return how far we may run
+u64 LinkCable::Port::synchronize(u64 machineCycles) {
+    const u64 now = machineCycles - base;
+    cycles.store(now, std::memory_order_release);
+
+    u32 spins = 0;
+    std::chrono::steady_clock::time_point waitStart;
+    for (;;) {
+        service(now);
+
+        const u64 otherCycles = other->cycles.load(std::memory_order_acquire);
+        const u64 limit = std::min(eventCycles.load(std::memory_order_acquire),
+                                   otherCycles == NO_EVENT ? NO_EVENT : otherCycles + quantum);
+        if (limit > now) {
+            if (spins > 0) {
+                stats.waitNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - waitStart).count();
+            }
+            return limit == NO_EVENT ? NO_EVENT : limit + base;
+        }
+
+        if (spins == 0) {
+            stats.waits++;
+            waitStart = std::chrono::steady_clock::now();
+        }
+        wait(spins);
+    }
+}
+
+// Clock in a transfer from the other end that is due
+void LinkCable::Port::service(u64 now) {
+    if (eventCycles.load(std::memory_order_acquire) > now) {
+        return;
+    }
+
+    // The other end posts nothing new before it has our reply
+    const u8 incoming = eventData.load(std::memory_order_relaxed);
+    eventCycles.store(NO_EVENT, std::memory_order_relaxed);
+    const u8 outgoing = gameBoy->getMemory().receiveSerial(incoming);
+    stats.received++;
+    other->reply.store(outgoing, std::memory_order_release);
+}
+
+// Spin briefly, then let the other end's thread run
+void LinkCable::Port::wait(u32& spins) {
+    if (++spins > LINK_SPINS) {
+        std::this_thread::yield();
+    }
+}
@@ -1,6 +1,7 @@
 #include "MainWindow.h"
 #include <shobjidl.h>
 #include <shlobj.h>
+#include <fstream>
 
 // Menu IDs
 enum MenuID {
@@ -111,8 +112,8 @@ bool MainWindow::create(HINSTANCE hInstance, int nCmdShow) {
 int MainWindow::messageLoop() {
     MSG msg = {};
     
-    // Target 60 FPS (16.67 ms per frame)
-    const auto targetFrameTime = std::chrono::microseconds(16667);
+    // Target the hardware frame rate (~59.73 FPS, 16.74 ms per frame)
+    const auto targetFrameTime = std::chrono::duration_cast<std::chrono::microseconds>(FRAME_DURATION);
     auto lastFrameTime = std::chrono::high_resolution_clock::now();
     
     // Main message loop
@@ -175,7 +176,7 @@ std::string MainWindow::openFileDialog(const std::string& filter) {
     
     // Set file types
     COMDLG_FILTERSPEC fileTypes[] = {
-        { L"GameBoy ROM Files", L"*.gb;*.gbc" },
+        { L"GameBoy ROM Files", L"*.gb;*.gbc;*.gz;*.zip" },
         { L"All Files", L"*.*" }
     };
     pFileOpen->SetFileTypes(ARRAYSIZE(fileTypes), fileTypes);
@@ -320,7 +321,32 @@ void MainWindow::onCommand(int id) {
 
 // On key down
 void MainWindow::onKeyDown(int key) {
+    // Frame timing histograms: F9 dumps, F10 resets
+    if (key == VK_F9) {
+        std::ofstream file("frame_stats.txt", std::ios::app);
+        Emulator::getInstance().dumpFrameStats(file);
+        return;
+    }
+    
+    if (key == VK_F10) {
+        Emulator::getInstance().resetFrameStats();
+        return;
+    }
+    
+    // F7 suspends the session on demand
+    if (key == VK_F7) {
+        Emulator::getInstance().suspend();
+        return;
+    }
+    
+    // F11 exports the recorded trace events
+    if (key == VK_F11) {
+        Emulator::getInstance().exportTrace("trace.json");
+        return;
+    }
+    
     // Handle key down
+    Emulator::getInstance().notifyInput();
 }
 
 // On key up
@@ -331,7 +357,7 @@ void MainWindow::onKeyUp(int key) {
 // On file open
 void MainWindow::onFileOpen() {
     // Open file dialog
-    std::string filename = openFileDialog("GameBoy ROM Files (*.gb;*.gbc)|*.gb;*.gbc|All Files (*.*)|*.*");
+    std::string filename = openFileDialog("GameBoy ROM Files (*.gb;*.gbc;*.gz;*.zip)|*.gb;*.gbc;*.gz;*.zip|All Files (*.*)|*.*");
     if (filename.empty()) {
         return;
     }
@@ -0,0 +1,102 @@
+#include "MappedFile.h"
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+// 64-bit hash of a byte range, a word at a time
+u64 hashBytes(const void* data, size_t size, u64 seed) {
+    constexpr u64 PRIME1 = 0x9E3779B185EBCA87ull;
+    constexpr u64 PRIME2 = 0xC2B2AE3D27D4EB4Full;
+
+    const u8* bytes = static_cast<const u8*>(data);
+    u64 hash = seed ^ (size * PRIME1);
+
+    // Whole words
+    size_t words = size / sizeof(u64);
+    for (size_t i = 0; i < words; i++) {
+        u64 word;
+        std::memcpy(&word, bytes + i * sizeof(u64), sizeof(word));
+        hash ^= word * PRIME2;
+        hash = ((hash << 31) | (hash >> 33)) * PRIME1;
+    }
+
+    // Remaining bytes
+    for (size_t i = words * sizeof(u64); i < size; i++) {
+        hash ^= bytes[i] * PRIME1;
+        hash = ((hash << 11) | (hash >> 53)) * PRIME2;
+    }
+
+    // Final avalanche
+    hash ^= hash >> 33;
+    hash *= PRIME2;
+    hash ^= hash >> 29;
+    return hash;
+}
+
+// MappedFile destructor
+MappedFile::~MappedFile() {
+    close();
+}
+
+// Map a file read-only
+bool MappedFile::open(const std::string& filename) {
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size == 0) {
+        ::close(fd);
+        return false;
+    }
+
+    void* address = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (address == MAP_FAILED) {
+        return false;
+    }
+
+    m_data = static_cast<const u8*>(address);
+    m_size = static_cast<size_t>(info.st_size);
+    m_mapped = true;
+    return true;
+#else
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    m_buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0, std::ios::beg);
+    if (!file.read(reinterpret_cast<char*>(m_buffer.data()), m_buffer.size())) {
+        m_buffer.clear();
+        return false;
+    }
+
+    m_data = m_buffer.data();
+    m_size = m_buffer.size();
+    return true;
+#endif
+}
+
+// Unmap the file
+void MappedFile::close() {
+#ifndef _WIN32
+    if (m_mapped) {
+        munmap(const_cast<u8*>(m_data), m_size);
+    }
+#endif
+    m_buffer.clear();
+    m_data = nullptr;
+    m_size = 0;
+    m_mapped = false;
+}
@@ -1,39 +1,84 @@
 #include "Memory.h"
+#include "MappedFile.h"
+#include "RomLoader.h"
+#include "Serial.h"
+#include "Trace.h"
 #include <fstream>
 #include <iostream>
+#include <mutex>
 
-// Memory constructor
-Memory::Memory() : m_bootROMEnabled(true), m_ppuCycles(0) {
-    reset();
+// I/O registers the emulator models; writes to the others are only stored
+static constexpr std::array<bool, IO_SIZE> HANDLED_IO = [] {
+    constexpr u16 REGISTERS[] = {0xFF00, 0xFF01, 0xFF02, 0xFF0F, 0xFF40, 0xFF41, 0xFF42, 0xFF43, 0xFF44, 0xFF45,
+                                 0xFF47, 0xFF48, 0xFF49, 0xFF4A, 0xFF4B, 0xFF50,
+                                 Tracer::GUEST_MARKER_BEGIN_PORT, Tracer::GUEST_MARKER_END_PORT};
+    std::array<bool, IO_SIZE> handled{};
+    for (u16 address : REGISTERS) {
+        handled[address - 0xFF00] = true;
+    }
+    return handled;
+}();
+
+// Memory constructor; the owner resets the memory once the banks exist
+Memory::Memory(MemoryBanks* banks) : m_banks(*banks), m_ie(0), m_pendingInterrupts(0), m_bootROMEnabled(true),
+                                     m_mappingGeneration(0), m_joypad(0), m_ppuCycles(0), m_serialCycles(0),
+                                     m_serialDevice(nullptr) {
 }
 
 // Reset memory
 void Memory::reset() {
     // Clear memory regions
-    m_vram.fill(0);
-    m_wram.fill(0);
-    m_oam.fill(0);
+    m_banks.vram.fill(0);
+    m_banks.wram.fill(0);
+    m_banks.oam.fill(0);
     m_io.fill(0);
     m_hram.fill(0);
     m_ie = 0;
+    m_pendingInterrupts = 0;
     
     // Reset boot ROM state
     m_bootROMEnabled = true;
+    m_mappingGeneration++;
     
     // Reset PPU state
     m_ppuCycles = 0;
     m_io[0x44] = 0; // LY register starts at 0
+    
+    // No transfer in progress
+    m_serialCycles = 0;
+
+    // Both button groups selected, buttons held down stay held
+    updateJoypad();
 }
 
 // Read from memory
 u8 Memory::read(u16 address) const {
+    return readBus<true>(address);
+}
+
+// Read without touching the bus counters (tracing, debuggers)
+u8 Memory::peek(u16 address) const {
+    return readBus<false>(address);
+}
+
+// Address decoding shared by read and peek
+template <bool CountAccess>
+u8 Memory::readBus(u16 address) const {
+    auto countRead = [this](BusRegion region) {
+        if constexpr (CountAccess) {
+            m_banks.busCounters.reads[static_cast<size_t>(region)]++;
+        }
+    };
+
     // Boot ROM (0x0000 - 0x00FF)
     if (m_bootROMEnabled && address < 0x0100) {
+        countRead(BusRegion::BOOT_ROM);
         return BOOT_ROM[address];
     }
     
     // ROM banks (0x0000 - 0x7FFF)
     if (address < 0x8000) {
+        countRead(address < 0x4000 ? BusRegion::ROM_BANK0 : BusRegion::ROM_BANKN);
         if (m_cartridge) {
             return m_cartridge->read(address);
         }
@@ -42,11 +87,13 @@ u8 Memory::read(u16 address) const {
     
     // Video RAM (0x8000 - 0x9FFF)
     if (address < 0xA000) {
-        return m_vram[address - 0x8000];
+        countRead(BusRegion::VRAM);
+        return m_banks.vram[address - 0x8000];
     }
     
     // External RAM (0xA000 - 0xBFFF)
     if (address < 0xC000) {
+        countRead(BusRegion::EXTERNAL_RAM);
         if (m_cartridge) {
             return m_cartridge->read(address);
         }
@@ -55,35 +102,42 @@ u8 Memory::read(u16 address) const {
     
     // Work RAM (0xC000 - 0xDFFF)
     if (address < 0xE000) {
-        return m_wram[address - 0xC000];
+        countRead(BusRegion::WRAM);
+        return m_banks.wram[address - 0xC000];
     }
     
     // Echo RAM (0xE000 - 0xFDFF) - mirror of 0xC000 - 0xDDFF
     if (address < 0xFE00) {
-        return m_wram[address - 0xE000];
+        countRead(BusRegion::WRAM);
+        return m_banks.wram[address - 0xE000];
     }
     
     // Object Attribute Memory (0xFE00 - 0xFE9F)
     if (address < 0xFEA0) {
-        return m_oam[address - 0xFE00];
+        countRead(BusRegion::OAM);
+        return m_banks.oam[address - 0xFE00];
     }
     
     // Not usable (0xFEA0 - 0xFEFF)
     if (address < 0xFF00) {
+        countRead(BusRegion::UNUSABLE);
         return 0xFF;
     }
     
     // I/O Registers (0xFF00 - 0xFF7F)
     if (address < 0xFF80) {
+        countRead(BusRegion::IO);
         return m_io[address - 0xFF00];
     }
     
     // High RAM (0xFF80 - 0xFFFE)
     if (address < 0xFFFF) {
+        countRead(BusRegion::HRAM);
         return m_hram[address - 0xFF80];
     }
     
     // Interrupt Enable register (0xFFFF)
+    countRead(BusRegion::IE);
     return m_ie;
 }
 
@@ -91,20 +145,31 @@ u8 Memory::read(u16 address) const {
 void Memory::write(u16 address, u8 value) {
     // ROM banks (0x0000 - 0x7FFF)
     if (address < 0x8000) {
+        m_banks.busCounters.writes[static_cast<size_t>(address < 0x4000 ? BusRegion::ROM_BANK0 : BusRegion::ROM_BANKN)]++;
         if (m_cartridge) {
+            u8 romBank = m_cartridge->getROMBank();
+            u8 ramBank = m_cartridge->getRAMBank();
             m_cartridge->write(address, value);
+            
+            // Count writes that actually remap a bank
+            if (m_cartridge->getROMBank() != romBank || m_cartridge->getRAMBank() != ramBank) {
+                m_banks.busCounters.bankSwitches++;
+                m_mappingGeneration++;
+            }
         }
         return;
     }
     
     // Video RAM (0x8000 - 0x9FFF)
     if (address < 0xA000) {
-        m_vram[address - 0x8000] = value;
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::VRAM)]++;
+        m_banks.vram[address - 0x8000] = value;
         return;
     }
     
     // External RAM (0xA000 - 0xBFFF)
     if (address < 0xC000) {
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::EXTERNAL_RAM)]++;
         if (m_cartridge) {
             m_cartridge->write(address, value);
         }
@@ -113,33 +178,43 @@ void Memory::write(u16 address, u8 value) {
     
     // Work RAM (0xC000 - 0xDFFF)
     if (address < 0xE000) {
-        m_wram[address - 0xC000] = value;
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::WRAM)]++;
+        m_banks.wram[address - 0xC000] = value;
         return;
     }
     
     // Echo RAM (0xE000 - 0xFDFF) - mirror of 0xC000 - 0xDDFF
     if (address < 0xFE00) {
-        m_wram[address - 0xE000] = value;
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::WRAM)]++;
+        m_banks.wram[address - 0xE000] = value;
         return;
     }
     
     // Object Attribute Memory (0xFE00 - 0xFE9F)
     if (address < 0xFEA0) {
-        m_oam[address - 0xFE00] = value;
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::OAM)]++;
+        m_banks.oam[address - 0xFE00] = value;
         return;
     }
     
     // Not usable (0xFEA0 - 0xFEFF)
     if (address < 0xFF00) {
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::UNUSABLE)]++;
         return;
     }
     
     // I/O Registers (0xFF00 - 0xFF7F)
     if (address < 0xFF80) {
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::IO)]++;
+        if (!HANDLED_IO[address - 0xFF00]) {
+            m_banks.busCounters.unhandledIOWrites[address - 0xFF00]++;
+        }
+        
         // Special handling for some I/O registers
         if (address == 0xFF50 && value != 0) {
             // Disable boot ROM
             m_bootROMEnabled = false;
+            m_mappingGeneration++;
         }
         
         // LY register (FF44) is read-only
@@ -147,18 +222,60 @@ void Memory::write(u16 address, u8 value) {
             return;
         }
         
+        // Joypad (FF00): only the group select bits are writable
+        if (address == 0xFF00) {
+            m_io[0x00] = (m_io[0x00] & 0x0F) | (value & 0x30);
+            updateJoypad();
+            return;
+        }
+        
+        // Serial control (FF02): a transfer on the internal clock shifts out SB
+        if (address == 0xFF02) {
+            m_io[0x02] = value | 0x7E;
+            if ((value & 0x81) == 0x81) {
+                m_serialCycles = SERIAL_TRANSFER_CYCLES;
+                if (m_serialDevice) {
+                    m_serialDevice->startTransfer(m_io[0x01]);
+                }
+            }
+            return;
+        }
+        
+        // Debug ports used by guest code to emit named trace zones
+        if (address == Tracer::GUEST_MARKER_BEGIN_PORT || address == Tracer::GUEST_MARKER_END_PORT) {
+            TRACE_GUEST_MARKER(value, address == Tracer::GUEST_MARKER_BEGIN_PORT);
+        }
+        
         m_io[address - 0xFF00] = value;
+        if (address == 0xFF0F) {
+            updatePendingInterrupts();
+        }
         return;
     }
     
     // High RAM (0xFF80 - 0xFFFE)
     if (address < 0xFFFF) {
+        m_banks.busCounters.writes[static_cast<size_t>(BusRegion::HRAM)]++;
         m_hram[address - 0xFF80] = value;
         return;
     }
     
     // Interrupt Enable register (0xFFFF)
+    m_banks.busCounters.writes[static_cast<size_t>(BusRegion::IE)]++;
     m_ie = value;
+    updatePendingInterrupts();
+}
+
+// Set an IF bit
+void Memory::requestInterrupt(u8 interrupt) {
+    m_io[0x0F] |= static_cast<u8>(1 << interrupt);
+    updatePendingInterrupts();
+}
+
+// Clear an IF bit (the CPU dispatched it)
+void Memory::acknowledgeInterrupt(u8 interrupt) {
+    m_io[0x0F] &= static_cast<u8>(~(1 << interrupt));
+    updatePendingInterrupts();
 }
 
 // Update PPU state based on CPU cycles
@@ -176,37 +293,256 @@ void Memory::updatePPU(u32 cycles) {
     // If we're entering VBlank, request VBlank interrupt
     if (currentScanline == VBLANK_START) {
         // Set VBlank interrupt flag (bit 0 of IF register)
-        m_io[0x0F] |= 0x01;
+        requestInterrupt(0);
+    }
+}
+
+// Change the buttons held down
+void Memory::setJoypad(u8 buttons) {
+    m_joypad = buttons;
+    updateJoypad();
+}
+
+// Recompute the P1 input lines (low = pressed) from the selected groups; a line
+// going low requests the joypad interrupt
+void Memory::updateJoypad() {
+    const u8 select = m_io[0x00] & 0x30;
+    u8 lines = 0x0F;
+    if (!(select & 0x10)) {
+        lines &= ~m_joypad & 0x0F;
+    }
+    if (!(select & 0x20)) {
+        lines &= ~(m_joypad >> 4) & 0x0F;
+    }
+    
+    if ((m_io[0x00] & 0x0F) & ~lines) {
+        requestInterrupt(4);
     }
+    m_io[0x00] = 0xC0 | select | lines;
+}
+
+// Advance a serial transfer; on completion exchange SB with the device and request the interrupt
+void Memory::clockSerial(u32 cycles) {
+    if (cycles < m_serialCycles) {
+        m_serialCycles -= cycles;
+        return;
+    }
+    
+    m_serialCycles = 0;
+    m_io[0x01] = m_serialDevice ? m_serialDevice->transfer(m_io[0x01]) : 0xFF;
+    m_io[0x02] &= 0x7F;
+    requestInterrupt(3);
+}
+
+// Clocked by the other end: only a transfer waiting on the external clock
+// takes the byte; otherwise the line stays high
+u8 Memory::receiveSerial(u8 incoming) {
+    if ((m_io[0x02] & 0x81) != 0x80) {
+        return 0xFF;
+    }
+
+    const u8 outgoing = m_io[0x01];
+    m_io[0x01] = incoming;
+    m_io[0x02] &= 0x7F;
+    requestInterrupt(3);
+    return outgoing;
+}
+
+// Copy the memory state out
+void Memory::saveState(State& state) const {
+    state.vram = m_banks.vram;
+    state.wram = m_banks.wram;
+    state.oam = m_banks.oam;
+    state.io = m_io;
+    state.hram = m_hram;
+    state.ie = m_ie;
+    state.bootROMEnabled = m_bootROMEnabled;
+    state.ppuCycles = m_ppuCycles;
+    state.serialCycles = m_serialCycles;
+}
+
+// Adopt a saved memory state
+void Memory::loadState(const State& state) {
+    m_banks.vram = state.vram;
+    m_banks.wram = state.wram;
+    m_banks.oam = state.oam;
+    m_io = state.io;
+    m_hram = state.hram;
+    m_ie = state.ie;
+    updatePendingInterrupts();
+    m_bootROMEnabled = state.bootROMEnabled;
+    m_mappingGeneration++;
+    m_ppuCycles = state.ppuCycles;
+    m_serialCycles = state.serialCycles;
 }
 
 // Disable boot ROM
 void Memory::disableBootROM() {
     m_bootROMEnabled = false;
+    m_mappingGeneration++;
+}
+
+// Documented DMG register values when the boot ROM hands over at 0x0100
+static constexpr std::array<std::pair<u16, u8>, 38> POST_BOOT_IO = {{
+    {0xFF00, 0xCF}, {0xFF01, 0x00}, {0xFF02, 0x7E}, {0xFF04, 0xAB}, {0xFF05, 0x00}, {0xFF06, 0x00},
+    {0xFF07, 0xF8}, {0xFF0F, 0xE1}, {0xFF10, 0x80}, {0xFF11, 0xBF}, {0xFF12, 0xF3}, {0xFF13, 0xFF},
+    {0xFF14, 0xBF}, {0xFF16, 0x3F}, {0xFF17, 0x00}, {0xFF18, 0xFF}, {0xFF19, 0xBF}, {0xFF1A, 0x7F},
+    {0xFF1B, 0xFF}, {0xFF1C, 0x9F}, {0xFF1D, 0xFF}, {0xFF1E, 0xBF}, {0xFF20, 0xFF}, {0xFF21, 0x00},
+    {0xFF22, 0x00}, {0xFF23, 0xBF}, {0xFF24, 0x77}, {0xFF25, 0xF3}, {0xFF26, 0xF1}, {0xFF40, 0x91},
+    {0xFF41, 0x85}, {0xFF42, 0x00}, {0xFF43, 0x00}, {0xFF45, 0x00}, {0xFF46, 0xFF}, {0xFF47, 0xFC},
+    {0xFF4A, 0x00}, {0xFF4B, 0x00},
+}};
+
+// Put memory in the state the boot ROM leaves behind, without running it
+void Memory::skipBootROM() {
+    for (const auto& [address, value] : POST_BOOT_IO) {
+        m_io[address - 0xFF00] = value;
+    }
+    m_ie = 0x00;
+    updatePendingInterrupts();
+
+    // Logo tiles at 0x8010: each header nibble becomes two rows with every bit doubled
+    u16 tileAddress = 0x0010;
+    for (u16 address = 0x0104; address < 0x0134; address++) {
+        u8 logo = m_cartridge ? m_cartridge->read(address) : 0;
+        for (int shift = 4; shift >= 0; shift -= 4) {
+            u8 row = 0;
+            for (int bit = 3; bit >= 0; bit--) {
+                row = static_cast<u8>((row << 2) | (((logo >> (shift + bit)) & 1) * 0x03));
+            }
+            m_banks.vram[tileAddress] = row;
+            m_banks.vram[tileAddress + 2] = row;
+            tileAddress += 4;
+        }
+    }
+
+    // Registered trademark tile follows, copied from the boot ROM
+    for (u16 i = 0; i < 8; i++) {
+        m_banks.vram[tileAddress] = BOOT_ROM[0xD8 + i];
+        tileAddress += 2;
+    }
+
+    // Tile map: logo tiles 0x01-0x0C at 0x9904, 0x0D-0x18 at 0x9924, trademark at 0x9910
+    for (u16 i = 0; i < 12; i++) {
+        m_banks.vram[0x1904 + i] = static_cast<u8>(0x01 + i);
+        m_banks.vram[0x1924 + i] = static_cast<u8>(0x0D + i);
+    }
+    m_banks.vram[0x1910] = 0x19;
+
+    // The boot ROM unmaps itself last
+    m_io[0x50] = 0x01;
+    m_bootROMEnabled = false;
+    m_mappingGeneration++;
+}
+
+// ROM bank currently mapped at 0x4000 - 0x7FFF
+u8 Memory::getMappedROMBank() const {
+    return m_cartridge ? m_cartridge->getROMBank() : 0;
+}
+
+// Plain region around an address (size 0 if there is none)
+Memory::Window Memory::getWindow(u16 address) {
+    Window window;
+    BusRegion region;
+    if (m_bootROMEnabled && address < 0x0100) {
+        window.size = 0x0100;
+        window.data = BOOT_ROM.data();
+        region = BusRegion::BOOT_ROM;
+    } else if (address < 0x8000) {
+        // Bank 0 starts after the boot ROM while it is mapped
+        const u16 end = address < 0x4000 ? 0x4000 : 0x8000;
+        window.base = address < 0x4000 ? (m_bootROMEnabled ? 0x0100 : 0x0000) : 0x4000;
+        window.data = m_cartridge ? m_cartridge->getROMSpan(window.base, end - window.base) : nullptr;
+        window.size = window.data ? end - window.base : 0;
+        region = address < 0x4000 ? BusRegion::ROM_BANK0 : BusRegion::ROM_BANKN;
+    } else if (address < 0xA000) {
+        window = {0x8000, VRAM_SIZE, m_banks.vram.data(), m_banks.vram.data()};
+        region = BusRegion::VRAM;
+    } else if (address >= 0xC000 && address < 0xE000) {
+        window = {0xC000, WRAM_SIZE, m_banks.wram.data(), m_banks.wram.data()};
+        region = BusRegion::WRAM;
+    } else if (address >= 0xFF80 && address < 0xFFFF) {
+        window = {0xFF80, HRAM_SIZE, m_hram.data(), m_hram.data()};
+        region = BusRegion::HRAM;
+    } else {
+        return window;
+    }
+
+    window.reads = &m_banks.busCounters.reads[static_cast<size_t>(region)];
+    window.writes = &m_banks.busCounters.writes[static_cast<size_t>(region)];
+    return window;
+}
+
+// Host pointer to bytes of one plain region
+const u8* Memory::getReadSpan(u16 address, u32 length) {
+    const Window window = getWindow(address);
+    const u32 offset = static_cast<u16>(address - window.base);
+    return offset + length <= window.size ? window.data + offset : nullptr;
+}
+
+// Host pointer to bytes of one plain RAM region
+u8* Memory::getWriteSpan(u16 address, u32 length) {
+    const Window window = getWindow(address);
+    const u32 offset = static_cast<u16>(address - window.base);
+    return window.writable && offset + length <= window.size ? window.writable + offset : nullptr;
+}
+
+// Count accesses made in bulk through a span
+void Memory::countAccesses(u16 address, u32 reads, u32 writes) {
+    const Window window = getWindow(address);
+    if (window.size != 0) {
+        *window.reads += reads;
+        *window.writes += writes;
+    }
+}
+
+// Cycles until LY enters VBlank (raising the interrupt) or the serial
+// transfer completes; in between, LY only matters to code that reads it
+u32 Memory::cyclesUntilEvent() const {
+    constexpr u32 frameCycles = SCANLINE_CYCLES * SCANLINE_COUNT;
+    constexpr u32 vblankCycles = SCANLINE_CYCLES * VBLANK_START;
+    const u32 cycleInFrame = m_ppuCycles % frameCycles;
+    const u32 vblank = cycleInFrame < vblankCycles ? vblankCycles - cycleInFrame
+                                                   : frameCycles - cycleInFrame + vblankCycles;
+    return m_serialCycles != 0 ? std::min(vblank, m_serialCycles) : vblank;
 }
 
 // Load ROM file
 bool Memory::loadROM(const std::string& filename) {
-    std::ifstream file(filename, std::ios::binary | std::ios::ate);
-    if (!file.is_open()) {
-        std::cerr << "Failed to open ROM file: " << filename << std::endl;
+    TRACE_SCOPE("readROMFile");
+    
+    // Plain images are copied from the mapping; gzip and zip are decompressed in place
+    std::vector<u8> romData;
+    std::string error;
+    if (!RomLoader::load(filename, romData, error)) {
+        std::cerr << "Failed to read ROM file: " << filename << " (" << error << ")" << std::endl;
         return false;
     }
     
-    // Get file size
-    std::streamsize size = file.tellg();
-    file.seekg(0, std::ios::beg);
+    // Create cartridge
+    try {
+        m_cartridge = std::make_unique<Cartridge>(std::move(romData));
+        m_mappingGeneration++;
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to create cartridge: " << e.what() << std::endl;
+        return false;
+    }
     
-    // Read file data
-    std::vector<u8> romData(size);
-    if (!file.read(reinterpret_cast<char*>(romData.data()), size)) {
-        std::cerr << "Failed to read ROM file: " << filename << std::endl;
+    return true;
+}
+
+// Load a ROM image from memory
+bool Memory::loadROM(const u8* data, size_t size) {
+    std::vector<u8> romData;
+    std::string error;
+    if (!RomLoader::decode(data, size, romData, error)) {
+        std::cerr << "Failed to read ROM image (" << error << ")" << std::endl;
         return false;
     }
     
-    // Create cartridge
     try {
-        m_cartridge = std::make_unique<Cartridge>(romData);
+        m_cartridge = std::make_unique<Cartridge>(std::move(romData));
+        m_mappingGeneration++;
     } catch (const std::exception& e) {
         std::cerr << "Failed to create cartridge: " << e.what() << std::endl;
         return false;
@@ -215,48 +551,130 @@ bool Memory::loadROM(const std::string& filename) {
     return true;
 }
 
-// Cartridge constructor
-Cartridge::Cartridge(const std::vector<u8>& romData) {
-    // Copy ROM data
-    m_rom = romData;
+// Decode the cartridge type and size codes
+void Cartridge::setHeaderCodes(u8 cartridgeType, u8 romSizeCode, u8 ramSizeCode, Header& header) {
+    // Get cartridge type
+    header.cartridgeType = cartridgeType;
+    switch (cartridgeType) {
+        case 0x00: header.type = Type::ROM_ONLY; break;
+        case 0x01: case 0x02: case 0x03: header.type = Type::MBC1; break;
+        case 0x05: case 0x06: header.type = Type::MBC2; break;
+        case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13: header.type = Type::MBC3; break;
+        case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E: header.type = Type::MBC5; break;
+        default: header.type = Type::UNKNOWN; break;
+    }
     
-    // Parse cartridge header
-    if (m_rom.size() < 0x150) {
-        throw EmulatorException("Invalid ROM size");
+    // Get ROM size
+    header.romSizeCode = romSizeCode;
+    header.romBanks = 2 << romSizeCode;
+    
+    // Get RAM size
+    header.ramSizeCode = ramSizeCode;
+    switch (ramSizeCode) {
+        case 0x00: header.ramBanks = 0; break;
+        case 0x01: header.ramBanks = 1; break;  // 2KB
+        case 0x02: header.ramBanks = 1; break;  // 8KB
+        case 0x03: header.ramBanks = 4; break;  // 32KB
+        case 0x04: header.ramBanks = 16; break; // 128KB
+        case 0x05: header.ramBanks = 8; break;  // 64KB
+        default: header.ramBanks = 0; break;
+    }
+}
+
+// Whether the mapper's bank switching is emulated
+bool Cartridge::isSupported(Type type) {
+    return type == Type::ROM_ONLY || type == Type::MBC1;
+}
+
+// Cartridge type name
+const char* Cartridge::typeName(Type type) {
+    switch (type) {
+        case Type::ROM_ONLY: return "ROM";
+        case Type::MBC1: return "MBC1";
+        case Type::MBC2: return "MBC2";
+        case Type::MBC3: return "MBC3";
+        case Type::MBC5: return "MBC5";
+        default: return "unknown";
+    }
+}
+
+// Parse the cartridge header of a ROM image
+bool Cartridge::parseHeader(const u8* data, size_t size, Header& header) {
+    if (size < 0x150) {
+        return false;
     }
     
     // Get cartridge title
-    m_title.reserve(16);
+    header.title.clear();
     for (u16 i = 0x134; i < 0x144; ++i) {
-        if (m_rom[i] == 0) break;
-        m_title.push_back(static_cast<char>(m_rom[i]));
+        if (data[i] == 0) break;
+        header.title.push_back(static_cast<char>(data[i]));
     }
     
-    // Get cartridge type
-    u8 cartridgeType = m_rom[0x147];
-    switch (cartridgeType) {
-        case 0x00: m_type = Type::ROM_ONLY; break;
-        case 0x01: case 0x02: case 0x03: m_type = Type::MBC1; break;
-        case 0x05: case 0x06: m_type = Type::MBC2; break;
-        case 0x0F: case 0x10: case 0x11: case 0x12: case 0x13: m_type = Type::MBC3; break;
-        case 0x19: case 0x1A: case 0x1B: case 0x1C: case 0x1D: case 0x1E: m_type = Type::MBC5; break;
-        default: m_type = Type::UNKNOWN; break;
+    // Get cartridge type, ROM size and RAM size
+    setHeaderCodes(data[0x147], data[0x148], data[0x149], header);
+    
+    // Header checksum over 0x134 - 0x14C, as verified by the boot ROM
+    u8 headerChecksum = 0;
+    for (u16 i = 0x134; i < 0x14D; ++i) {
+        headerChecksum = headerChecksum - data[i] - 1;
     }
+    header.headerChecksum = data[0x14D];
+    header.headerChecksumValid = headerChecksum == header.headerChecksum;
     
-    // Get ROM size
-    u8 romSize = m_rom[0x148];
-    m_romBanks = 2 << romSize;
+    // Global checksum (big-endian) over every byte except itself
+    u16 globalChecksum = 0;
+    for (size_t i = 0; i < size; ++i) {
+        globalChecksum += data[i];
+    }
+    globalChecksum -= data[0x14E] + data[0x14F];
+    header.globalChecksum = static_cast<u16>((data[0x14E] << 8) | data[0x14F]);
+    header.globalChecksumValid = globalChecksum == header.globalChecksum;
     
-    // Get RAM size
-    u8 ramSize = m_rom[0x149];
-    switch (ramSize) {
-        case 0x00: m_ramBanks = 0; break;
-        case 0x01: m_ramBanks = 1; break;  // 2KB
-        case 0x02: m_ramBanks = 1; break;  // 8KB
-        case 0x03: m_ramBanks = 4; break;  // 32KB
-        case 0x04: m_ramBanks = 16; break; // 128KB
-        case 0x05: m_ramBanks = 8; break;  // 64KB
-        default: m_ramBanks = 0; break;
+    return true;
+}
+
+// ROM images never change, so every cartridge made from the same image
+// shares one copy (machines running the same game in one process)
+static std::shared_ptr<const std::vector<u8>> shareROM(std::vector<u8> romData) {
+    static std::mutex imagesMutex;
+    static std::unordered_map<u64, std::weak_ptr<const std::vector<u8>>> images;
+
+    const u64 hash = hashBytes(romData.data(), romData.size());
+    std::lock_guard<std::mutex> lock(imagesMutex);
+    if (auto existing = images[hash].lock(); existing && *existing == romData) {
+        return existing;
+    }
+
+    std::erase_if(images, [](const auto& entry) { return entry.second.expired(); });
+    auto image = std::make_shared<const std::vector<u8>>(std::move(romData));
+    images[hash] = image;
+    return image;
+}
+
+// Cartridge constructor
+Cartridge::Cartridge(std::vector<u8> romData) {
+    // Take over the ROM buffer, or share an identical one already loaded
+    m_rom = shareROM(std::move(romData));
+    m_romData = m_rom->data();
+    m_romSize = m_rom->size();
+    
+    // Parse cartridge header
+    Header header;
+    if (!parseHeader(m_romData, m_romSize, header)) {
+        throw EmulatorException("Invalid ROM size");
+    }
+    
+    m_title = header.title;
+    m_type = header.type;
+    m_cartridgeType = header.cartridgeType;
+    m_romBanks = header.romBanks;
+    m_ramBanks = header.ramBanks;
+    
+    // Unsupported mappers run with bank 1 fixed at 0x4000
+    if (!isSupported(m_type)) {
+        std::cerr << "Warning: cartridge type 0x" << std::hex << static_cast<int>(header.cartridgeType) << std::dec
+                  << " (" << typeName(m_type) << ") is not emulated; bank switching is ignored" << std::endl;
     }
     
     // Initialize RAM
@@ -275,14 +693,14 @@ Cartridge::Cartridge(const std::vector<u8>& romData) {
 u8 Cartridge::read(u16 address) const {
     // ROM bank 0 (0x0000 - 0x3FFF)
     if (address < 0x4000) {
-        return m_rom[address];
+        return m_romData[address];
     }
     
     // ROM bank 1-N (0x4000 - 0x7FFF)
     if (address < 0x8000) {
         u32 romAddress = (m_romBank * ROM_BANK_SIZE) + (address - 0x4000);
-        if (romAddress < m_rom.size()) {
-            return m_rom[romAddress];
+        if (romAddress < m_romSize) {
+            return m_romData[romAddress];
         }
         return 0xFF;
     }
@@ -301,6 +719,16 @@ u8 Cartridge::read(u16 address) const {
     return 0xFF;
 }
 
+// Host pointer to the ROM bytes mapped at an address, nullptr past the image
+const u8* Cartridge::getROMSpan(u16 address, u32 length) const {
+    const u32 end = address < 0x4000 ? 0x4000 : 0x8000;
+    if (address + length > end) {
+        return nullptr;
+    }
+    const size_t offset = address < 0x4000 ? address : m_romBank * ROM_BANK_SIZE + (address - 0x4000);
+    return offset + length <= m_romSize ? m_romData + offset : nullptr;
+}
+
 // Write to cartridge
 void Cartridge::write(u16 address, u8 value) {
     // MBC1 implementation
@@ -345,4 +773,19 @@ void Cartridge::write(u16 address, u8 value) {
             }
         }
     }
-} 
\ No newline at end of file
+} 
+// Copy the MBC state out
+void Cartridge::saveState(State& state) const {
+    state.romBank = m_romBank;
+    state.ramBank = m_ramBank;
+    state.ramEnabled = m_ramEnabled;
+    state.romBankingMode = m_romBankingMode;
+}
+
+// Adopt a saved MBC state
+void Cartridge::loadState(const State& state) {
+    m_romBank = state.romBank;
+    m_ramBank = state.ramBank;
+    m_ramEnabled = state.ramEnabled;
+    m_romBankingMode = state.romBankingMode;
+}
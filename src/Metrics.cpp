@@ -0,0 +1,307 @@
+#include "Metrics.h"
+#include <cstring>
+#include <filesystem>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+// Bus region names
+const char* busRegionName(BusRegion region) {
+    switch (region) {
+        case BusRegion::BOOT_ROM: return "boot_rom";
+        case BusRegion::ROM_BANK0: return "rom_bank0";
+        case BusRegion::ROM_BANKN: return "rom_bankn";
+        case BusRegion::VRAM: return "vram";
+        case BusRegion::EXTERNAL_RAM: return "external_ram";
+        case BusRegion::WRAM: return "wram";
+        case BusRegion::OAM: return "oam";
+        case BusRegion::UNUSABLE: return "unusable";
+        case BusRegion::IO: return "io";
+        case BusRegion::HRAM: return "hram";
+        case BusRegion::IE: return "ie";
+        default: return "unknown";
+    }
+}
+
+// Interrupt source names
+const char* interruptName(size_t interrupt) {
+    switch (interrupt) {
+        case 0: return "vblank";
+        case 1: return "lcd_stat";
+        case 2: return "timer";
+        case 3: return "serial";
+        case 4: return "joypad";
+        default: return "unknown";
+    }
+}
+
+// MetricsPublisher constructor
+MetricsPublisher::MetricsPublisher() : m_sequence(0) {
+    for (auto& word : m_words) {
+        word.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Publish a new snapshot
+void MetricsPublisher::publish(const MachineMetrics& metrics) {
+    std::array<u64, WORD_COUNT> words;
+    std::memcpy(words.data(), &metrics, sizeof(MachineMetrics));
+
+    // Odd sequence marks a write in progress
+    u32 sequence = m_sequence.load(std::memory_order_relaxed);
+    m_sequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    for (size_t i = 0; i < WORD_COUNT; i++) {
+        m_words[i].store(words[i], std::memory_order_relaxed);
+    }
+
+    m_sequence.store(sequence + 2, std::memory_order_release);
+}
+
+// Read the latest consistent snapshot
+MachineMetrics MetricsPublisher::snapshot() const {
+    std::array<u64, WORD_COUNT> words;
+
+    while (true) {
+        u32 before = m_sequence.load(std::memory_order_acquire);
+        if (before & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        for (size_t i = 0; i < WORD_COUNT; i++) {
+            words[i] = m_words[i].load(std::memory_order_relaxed);
+        }
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (m_sequence.load(std::memory_order_relaxed) == before) {
+            break;
+        }
+    }
+
+    MachineMetrics metrics;
+    std::memcpy(static_cast<void*>(&metrics), words.data(), sizeof(MachineMetrics));
+    return metrics;
+}
+
+// MetricsExporter constructor
+MetricsExporter::MetricsExporter(const MetricsPublisher& publisher)
+    : m_publisher(publisher), m_interval(1000), m_running(false), m_socket(-1) {
+}
+
+// MetricsExporter destructor
+MetricsExporter::~MetricsExporter() {
+    stop();
+}
+
+// Start the exporter thread
+bool MetricsExporter::start(const std::string& target, std::chrono::milliseconds interval) {
+    if (m_running) {
+        return false;
+    }
+
+    m_target = target;
+    m_interval = interval;
+
+    // Unix socket targets are prefixed with "unix:"
+    if (m_target.rfind("unix:", 0) == 0) {
+        if (!openSocket(m_target.substr(5))) {
+            return false;
+        }
+    }
+
+    m_running = true;
+    m_thread = std::thread(&MetricsExporter::exportLoop, this);
+    return true;
+}
+
+// Stop the exporter thread
+void MetricsExporter::stop() {
+    if (!m_running) {
+        return;
+    }
+
+    m_running = false;
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+
+    closeSocket();
+}
+
+// Exporter thread body
+void MetricsExporter::exportLoop() {
+    while (m_running) {
+        if (m_socket >= 0) {
+            // Socket mode waits for clients for up to one interval
+            serveSocket();
+        } else {
+            writeFile(format(m_publisher.snapshot()));
+
+            // Sleep in short steps so stop() stays responsive
+            auto deadline = std::chrono::steady_clock::now() + m_interval;
+            while (m_running && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+}
+
+// Write the exposition to the target file
+bool MetricsExporter::writeFile(const std::string& text) {
+    // Write to a temporary file and rename it so readers never see a partial file
+    std::string tempPath = m_target + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::binary | std::ios::trunc);
+        if (!file.is_open()) {
+            std::cerr << "Failed to open metrics file: " << tempPath << std::endl;
+            return false;
+        }
+        file << text;
+    }
+
+    std::error_code error;
+    std::filesystem::rename(tempPath, m_target, error);
+    if (error) {
+        std::cerr << "Failed to write metrics file: " << error.message() << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+#ifndef _WIN32
+
+// Open the listening Unix socket
+bool MetricsExporter::openSocket(const std::string& path) {
+    sockaddr_un address = {};
+    if (path.size() >= sizeof(address.sun_path)) {
+        std::cerr << "Metrics socket path too long: " << path << std::endl;
+        return false;
+    }
+
+    m_socket = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_socket < 0) {
+        std::cerr << "Failed to create metrics socket" << std::endl;
+        return false;
+    }
+
+    // Replace a stale socket left by a previous run
+    unlink(path.c_str());
+
+    address.sun_family = AF_UNIX;
+    std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+    if (bind(m_socket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 ||
+        listen(m_socket, 8) < 0) {
+        std::cerr << "Failed to bind metrics socket: " << path << std::endl;
+        closeSocket();
+        return false;
+    }
+
+    return true;
+}
+
+// Serve the latest snapshot to every waiting client
+void MetricsExporter::serveSocket() {
+    pollfd descriptor = {m_socket, POLLIN, 0};
+
+    // Wake up regularly so stop() stays responsive
+    int timeout = static_cast<int>(std::min<long long>(m_interval.count(), 100));
+    if (poll(&descriptor, 1, timeout) <= 0) {
+        return;
+    }
+
+    int client = accept(m_socket, nullptr, nullptr);
+    if (client < 0) {
+        return;
+    }
+
+    std::string text = format(m_publisher.snapshot());
+    size_t written = 0;
+    while (written < text.size()) {
+        ssize_t result = send(client, text.data() + written, text.size() - written, MSG_NOSIGNAL);
+        if (result <= 0) {
+            break;
+        }
+        written += static_cast<size_t>(result);
+    }
+
+    close(client);
+}
+
+// Close the listening socket
+void MetricsExporter::closeSocket() {
+    if (m_socket >= 0) {
+        close(m_socket);
+        m_socket = -1;
+        unlink(m_target.substr(5).c_str());
+    }
+}
+
+#else
+
+// Unix sockets are not supported on Windows builds
+bool MetricsExporter::openSocket(const std::string& path) {
+    std::cerr << "Metrics socket export is not supported on this platform: " << path << std::endl;
+    return false;
+}
+
+void MetricsExporter::serveSocket() {
+}
+
+void MetricsExporter::closeSocket() {
+}
+
+#endif
+
+// Format a snapshot in the Prometheus text exposition format
+std::string MetricsExporter::format(const MachineMetrics& metrics) {
+    std::ostringstream out;
+
+    auto counter = [&out](const char* name, const char* help, u64 value) {
+        out << "# HELP " << name << " " << help << "\n";
+        out << "# TYPE " << name << " counter\n";
+        out << name << " " << value << "\n";
+    };
+
+    counter("gb_frames_total", "Emulated frames.", metrics.frames);
+    counter("gb_instructions_total", "Instructions executed.", metrics.instructions);
+    counter("gb_halted_cycles_total", "T-cycles spent halted or stopped.", metrics.haltedCycles);
+
+    out << "# HELP gb_bus_reads_total Bus reads by region.\n";
+    out << "# TYPE gb_bus_reads_total counter\n";
+    for (size_t i = 0; i < BUS_REGION_COUNT; i++) {
+        out << "gb_bus_reads_total{region=\"" << busRegionName(static_cast<BusRegion>(i)) << "\"} "
+            << metrics.busReads[i] << "\n";
+    }
+
+    out << "# HELP gb_bus_writes_total Bus writes by region.\n";
+    out << "# TYPE gb_bus_writes_total counter\n";
+    for (size_t i = 0; i < BUS_REGION_COUNT; i++) {
+        out << "gb_bus_writes_total{region=\"" << busRegionName(static_cast<BusRegion>(i)) << "\"} "
+            << metrics.busWrites[i] << "\n";
+    }
+
+    counter("gb_bank_switches_total", "Cartridge ROM/RAM bank switches.", metrics.bankSwitches);
+    counter("gb_scanlines_rendered_total", "Scanlines rendered by the PPU.", metrics.scanlinesRendered);
+    counter("gb_scanlines_skipped_total", "Scanlines elapsed with the LCD disabled.", metrics.scanlinesSkipped);
+
+    out << "# HELP gb_interrupts_total Interrupts dispatched by source.\n";
+    out << "# TYPE gb_interrupts_total counter\n";
+    for (size_t i = 0; i < INTERRUPT_COUNT; i++) {
+        out << "gb_interrupts_total{source=\"" << interruptName(i) << "\"} " << metrics.interrupts[i] << "\n";
+    }
+
+    out << "# HELP gb_host_nanoseconds_total Host time spent per subsystem.\n";
+    out << "# TYPE gb_host_nanoseconds_total counter\n";
+    out << "gb_host_nanoseconds_total{subsystem=\"cpu\"} " << metrics.cpuNanos << "\n";
+    out << "gb_host_nanoseconds_total{subsystem=\"ppu\"} " << metrics.ppuNanos << "\n";
+    out << "gb_host_nanoseconds_total{subsystem=\"present\"} " << metrics.presentNanos << "\n";
+
+    return out.str();
+}
@@ -0,0 +1,467 @@
+#include "Netplay.h"
+#include "GameBoy.h"
+#include "MappedFile.h"
+#include "SuspendFile.h"
+#include <cerrno>
+#include <cstring>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Packet: magic, sender player, input count, reserved, frames of the
+// sender's remote player it has confirmed, frame of the first input, the
+// latest confirmed checksum (frame ~0 for none), then one byte per input
+constexpr u32 NETPLAY_MAGIC = 0x504E4247;   // "GBNP"
+constexpr size_t NETPLAY_HEADER_SIZE = 40;
+constexpr u64 NO_CHECKSUM = ~0ull;
+
+// NetplaySocket destructor
+NetplaySocket::~NetplaySocket() {
+    close();
+}
+
+// Simulated network conditions
+void NetplaySocket::setImpairment(u32 delayMillis, u32 jitterMillis, double lossRate, u32 seed) {
+    m_delayMillis = delayMillis;
+    m_jitterMillis = std::min(jitterMillis, delayMillis);
+    m_lossRate = lossRate;
+    m_random.seed(seed);
+}
+
+// Send now, or once the simulated delay has passed
+void NetplaySocket::send(const u8* data, size_t size) {
+    if (m_lossRate > 0 && std::uniform_real_distribution<double>(0.0, 1.0)(m_random) < m_lossRate) {
+        m_dropped++;
+        return;
+    }
+    if (m_delayMillis == 0) {
+        transmit(data, size);
+        return;
+    }
+
+    const i32 jitter = m_jitterMillis > 0 ? std::uniform_int_distribution<i32>(-static_cast<i32>(m_jitterMillis),
+                                                                                static_cast<i32>(m_jitterMillis))(m_random)
+                                          : 0;
+    DelayedPacket packet;
+    packet.due = std::chrono::steady_clock::now() + std::chrono::milliseconds(static_cast<i32>(m_delayMillis) + jitter);
+    packet.data.assign(data, data + size);
+    m_delayed.push_back(std::move(packet));
+    flush();
+}
+
+// Send the delayed packets that are due (jitter may reorder them)
+void NetplaySocket::flush() {
+    const auto now = std::chrono::steady_clock::now();
+    for (auto it = m_delayed.begin(); it != m_delayed.end();) {
+        if (it->due <= now) {
+            transmit(it->data.data(), it->data.size());
+            it = m_delayed.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+#ifndef _WIN32
+
+// Bind locally and fix the peer address
+bool NetplaySocket::open(const std::string& localAddress, u16 localPort, const std::string& remoteAddress,
+                         u16 remotePort) {
+    close();
+
+    sockaddr_in local{}, remote{};
+    local.sin_family = remote.sin_family = AF_INET;
+    local.sin_port = htons(localPort);
+    remote.sin_port = htons(remotePort);
+    if (inet_pton(AF_INET, localAddress.c_str(), &local.sin_addr) != 1 ||
+        inet_pton(AF_INET, remoteAddress.c_str(), &remote.sin_addr) != 1) {
+        std::cerr << "Invalid netplay address" << std::endl;
+        return false;
+    }
+
+    m_socket = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (m_socket < 0 || bind(m_socket, reinterpret_cast<sockaddr*>(&local), sizeof(local)) < 0 ||
+        connect(m_socket, reinterpret_cast<sockaddr*>(&remote), sizeof(remote)) < 0) {
+        std::cerr << "Failed to open netplay socket on port " << localPort << ": " << std::strerror(errno) << std::endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+// Close the socket and forget delayed packets
+void NetplaySocket::close() {
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+    m_delayed.clear();
+}
+
+// Put a datagram on the wire; a peer that is not up yet just misses it
+void NetplaySocket::transmit(const u8* data, size_t size) {
+    if (m_socket >= 0 && ::send(m_socket, data, size, 0) == static_cast<ssize_t>(size)) {
+        m_sent++;
+    }
+}
+
+// Next waiting datagram
+size_t NetplaySocket::receive(u8* buffer, size_t capacity) {
+    while (m_socket >= 0) {
+        ssize_t received = recv(m_socket, buffer, capacity, 0);
+        if (received > 0) {
+            m_received++;
+            return static_cast<size_t>(received);
+        }
+        // Refusals from packets sent before the peer was up are reported here
+        if (received < 0 && errno == ECONNREFUSED) {
+            continue;
+        }
+        break;
+    }
+    return 0;
+}
+
+#else
+
+// Netplay sockets are POSIX only
+bool NetplaySocket::open(const std::string&, u16, const std::string&, u16) {
+    std::cerr << "Netplay is not supported on this platform" << std::endl;
+    return false;
+}
+
+void NetplaySocket::close() {
+}
+
+void NetplaySocket::transmit(const u8*, size_t) {
+}
+
+size_t NetplaySocket::receive(u8*, size_t) {
+    return 0;
+}
+
+#endif
+
+// NetplaySession constructor
+NetplaySession::NetplaySession(GameBoy& player1, GameBoy& player2, NetplaySocket& socket, const NetplayConfig& config)
+    : m_machines{&player1, &player2}, m_socket(socket), m_config(config),
+      m_remotePlayer(config.localPlayer == 0 ? 1 : 0),
+      m_frame(0), m_localFrames(0), m_remoteFrames(0), m_peerAcked(0), m_rollbackFrame(0),
+      m_imageSizes{0, 0}, m_imageSize(0), m_stateSlots(0),
+      m_nextChecksum(0), m_checkedFrames(0), m_desynced(false), m_desyncFrame(0) {
+    m_config.maxRollback = std::clamp<u32>(m_config.maxRollback, 1, INPUT_HISTORY / 4);
+    m_config.inputDelay = std::min<u32>(m_config.inputDelay, INPUT_HISTORY / 4);
+    m_config.checksumInterval = std::max<u32>(m_config.checksumInterval, 1);
+}
+
+// Allocate the state ring and start at frame 0
+bool NetplaySession::start() {
+    for (size_t i = 0; i < 2; i++) {
+        m_imageSizes[i] = m_machines[i]->getStateSize();
+        if (m_imageSizes[i] == 0) {
+            return false;
+        }
+    }
+
+    // Images stay 8-byte aligned inside a slot
+    m_imageSize = (std::max(m_imageSizes[0], m_imageSizes[1]) + 7) & ~static_cast<size_t>(7);
+    m_stateSlots = m_config.maxRollback + 2;
+    m_states.assign(m_stateSlots * 2 * m_imageSize / sizeof(u64), 0);
+
+    // Nobody has input for the frames before the input delay
+    m_inputs.fill(FrameInput());
+    for (u64 frame = 0; frame < m_config.inputDelay; frame++) {
+        FrameInput& entry = input(frame);
+        entry.confirmed[0] = entry.confirmed[1] = true;
+    }
+
+    m_frame = 0;
+    m_localFrames = m_remoteFrames = m_peerAcked = m_config.inputDelay;
+    m_rollbackFrame = 0;
+    m_checksums.clear();
+    m_peerChecksums.clear();
+    m_nextChecksum = 0;
+    m_checkedFrames = 0;
+    m_desynced = false;
+    m_desyncFrame = 0;
+    return true;
+}
+
+// Input entry of a frame, cleared when the ring slot is reused
+NetplaySession::FrameInput& NetplaySession::input(u64 frame) {
+    FrameInput& entry = m_inputs[frame % INPUT_HISTORY];
+    if (entry.frame != frame) {
+        entry = FrameInput();
+        entry.frame = frame;
+    }
+    return entry;
+}
+
+// State slot of a frame
+u8* NetplaySession::stateSlot(u64 frame) {
+    return reinterpret_cast<u8*>(m_states.data()) + (frame % m_stateSlots) * 2 * m_imageSize;
+}
+
+// Run one host frame
+bool NetplaySession::advanceFrame(u8 localInput) {
+    receivePackets();
+
+    // Every local input the peer has not confirmed must stay in the ring
+    // until it does
+    if (m_localFrames - m_peerAcked >= INPUT_HISTORY) {
+        m_stats.stalls++;
+        sendPacket();
+        return false;
+    }
+
+    // The local input applies inputDelay frames from now
+    if (m_localFrames == m_frame + m_config.inputDelay) {
+        FrameInput& entry = input(m_localFrames);
+        entry.buttons[m_config.localPlayer] = localInput;
+        entry.confirmed[m_config.localPlayer] = true;
+        m_localFrames++;
+    }
+
+    if (m_rollbackFrame < m_frame) {
+        rollback();
+    }
+    recordChecksums();
+
+    // Too far ahead of the remote peer to roll back if the prediction fails
+    if (m_frame >= m_remoteFrames + m_config.maxRollback) {
+        m_stats.stalls++;
+        sendPacket();
+        return false;
+    }
+
+    saveFrame(m_frame);
+    simulateFrame(m_frame);
+    m_frame++;
+    m_rollbackFrame = m_frame;
+    m_stats.frames++;
+
+    recordChecksums();
+    sendPacket();
+    return true;
+}
+
+// Exchange packets only
+void NetplaySession::poll() {
+    receivePackets();
+    sendPacket();
+}
+
+// Go back to the first mispredicted frame and simulate up to the present
+void NetplaySession::rollback() {
+    auto start = std::chrono::steady_clock::now();
+    const u64 depth = m_frame - m_rollbackFrame;
+
+    loadFrame(m_rollbackFrame);
+    for (u64 frame = m_rollbackFrame; frame < m_frame; frame++) {
+        if (frame != m_rollbackFrame) {
+            saveFrame(frame);
+        }
+        simulateFrame(frame);
+    }
+    m_rollbackFrame = m_frame;
+
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    m_stats.rollbacks++;
+    m_stats.resimulatedFrames += depth;
+    m_stats.rollbackDepth.record(depth);
+    m_stats.resimulationNanos.record(std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed));
+    if (elapsed > FRAME_DURATION) {
+        m_stats.overBudget++;
+    }
+}
+
+// Run both machines for a frame with confirmed or predicted input
+void NetplaySession::simulateFrame(u64 frame) {
+    FrameInput& entry = input(frame);
+    const u8 local = m_config.localPlayer;
+    const u8 remote = m_remotePlayer;
+
+    // An unconfirmed remote player keeps pressing what it pressed last
+    entry.used[local] = entry.buttons[local];
+    entry.used[remote] = entry.confirmed[remote] ? entry.buttons[remote]
+                                                 : m_inputs[(m_remoteFrames - 1) % INPUT_HISTORY].buttons[remote];
+
+    for (size_t i = 0; i < 2; i++) {
+        m_machines[i]->setJoypad(entry.used[i]);
+        m_machines[i]->emulateFrame();
+    }
+}
+
+// Save both machines at the start of a frame
+void NetplaySession::saveFrame(u64 frame) {
+    auto start = std::chrono::steady_clock::now();
+    u8* slot = stateSlot(frame);
+    for (size_t i = 0; i < 2; i++) {
+        m_machines[i]->saveState(slot + i * m_imageSize, m_imageSizes[i]);
+    }
+    m_stats.saves++;
+    m_stats.saveNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Restore both machines to the start of a frame
+void NetplaySession::loadFrame(u64 frame) {
+    auto start = std::chrono::steady_clock::now();
+    u8* slot = stateSlot(frame);
+    for (size_t i = 0; i < 2; i++) {
+        m_machines[i]->loadState(slot + i * m_imageSize, m_imageSizes[i]);
+    }
+    m_stats.restores++;
+    m_stats.restoreNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Checksum the states that can no longer change (every input before them confirmed)
+void NetplaySession::recordChecksums() {
+    while (m_nextChecksum < m_frame && m_nextChecksum <= m_remoteFrames) {
+        const u64 frame = m_nextChecksum;
+        m_nextChecksum += m_config.checksumInterval;
+        if (m_frame - frame >= m_stateSlots) {
+            continue;
+        }
+
+        // The suspend headers already carry a hash of each payload
+        u64 checksums[2];
+        const u8* slot = stateSlot(frame);
+        for (size_t i = 0; i < 2; i++) {
+            std::memcpy(&checksums[i], slot + i * m_imageSize + offsetof(SuspendHeader, checksum), sizeof(u64));
+        }
+        m_checksums.emplace_back(frame, hashBytes(checksums, sizeof(checksums)));
+        if (m_checksums.size() > CHECKSUM_HISTORY) {
+            m_checksums.pop_front();
+        }
+    }
+    compareChecksums();
+}
+
+// Match the peer's checksums against ours
+void NetplaySession::compareChecksums() {
+    for (auto it = m_peerChecksums.begin(); it != m_peerChecksums.end();) {
+        u64 ours;
+        const bool known = getChecksum(it->first, ours);
+        if (!known && (m_checksums.empty() || it->first > m_checksums.back().first)) {
+            ++it;   // Not confirmed here yet
+            continue;
+        }
+
+        if (known) {
+            m_stats.checksumsCompared++;
+            m_checkedFrames = std::max(m_checkedFrames, it->first + 1);
+            if (ours != it->second && !m_desynced) {
+                m_desynced = true;
+                m_desyncFrame = it->first;
+                std::cerr << "Netplay desync at frame " << it->first << std::endl;
+            }
+        }
+        it = m_peerChecksums.erase(it);
+    }
+}
+
+// Our checksum of a frame
+bool NetplaySession::getChecksum(u64 frame, u64& checksum) const {
+    for (const auto& [checksumFrame, value] : m_checksums) {
+        if (checksumFrame == frame) {
+            checksum = value;
+            return true;
+        }
+    }
+    return false;
+}
+
+// Take in remote inputs, acks and checksums
+void NetplaySession::receivePackets() {
+    u8 packet[NETPLAY_HEADER_SIZE + 256];
+    size_t size;
+    while ((size = m_socket.receive(packet, sizeof(packet))) > 0) {
+        if (size < NETPLAY_HEADER_SIZE) {
+            continue;
+        }
+        u32 magic;
+        u64 acked, first, checksumFrame, checksum;
+        std::memcpy(&magic, packet, sizeof(magic));
+        const u8 player = packet[4];
+        const u8 count = packet[5];
+        if (magic != NETPLAY_MAGIC || player != m_remotePlayer || size < NETPLAY_HEADER_SIZE + count) {
+            continue;
+        }
+        std::memcpy(&acked, packet + 8, sizeof(acked));
+        std::memcpy(&first, packet + 16, sizeof(first));
+        std::memcpy(&checksumFrame, packet + 24, sizeof(checksumFrame));
+        std::memcpy(&checksum, packet + 32, sizeof(checksum));
+
+        m_peerAcked = std::clamp(acked, m_peerAcked, m_localFrames);
+
+        // Inputs: packets overlap, so anything confirmed already is skipped
+        for (u32 i = 0; i < count; i++) {
+            const u64 frame = first + i;
+            if (frame < m_remoteFrames || frame >= m_remoteFrames + INPUT_HISTORY / 2) {
+                continue;
+            }
+            FrameInput& entry = input(frame);
+            if (entry.confirmed[m_remotePlayer]) {
+                continue;
+            }
+            const u8 buttons = packet[NETPLAY_HEADER_SIZE + i];
+            entry.buttons[m_remotePlayer] = buttons;
+            entry.confirmed[m_remotePlayer] = true;
+
+            // Already simulated with a different guess
+            if (frame < m_frame && entry.used[m_remotePlayer] != buttons) {
+                m_stats.mispredictions++;
+                m_rollbackFrame = std::min(m_rollbackFrame, frame);
+            }
+        }
+        while (input(m_remoteFrames).confirmed[m_remotePlayer]) {
+            m_remoteFrames++;
+        }
+
+        if (checksumFrame != NO_CHECKSUM && checksumFrame >= m_checkedFrames &&
+            std::none_of(m_peerChecksums.begin(), m_peerChecksums.end(),
+                         [checksumFrame](const auto& entry) { return entry.first == checksumFrame; })) {
+            m_peerChecksums.emplace_back(checksumFrame, checksum);
+            if (m_peerChecksums.size() > CHECKSUM_HISTORY) {
+                m_peerChecksums.pop_front();
+            }
+        }
+    }
+    compareChecksums();
+}
+
+// Send every local input the peer has not confirmed, our ack and checksum
+void NetplaySession::sendPacket() {
+    u8 packet[NETPLAY_HEADER_SIZE + MAX_INPUTS_PER_PACKET];
+    const u64 first = m_peerAcked;
+    u8 count = static_cast<u8>(std::min<u64>(m_localFrames - first, MAX_INPUTS_PER_PACKET));
+
+    // Only inputs the ring still holds for their frame go out
+    for (u8 i = 0; i < count; i++) {
+        if (m_inputs[(first + i) % INPUT_HISTORY].frame != first + i) {
+            count = i;
+            break;
+        }
+    }
+    const u64 checksumFrame = m_checksums.empty() ? NO_CHECKSUM : m_checksums.back().first;
+    const u64 checksum = m_checksums.empty() ? 0 : m_checksums.back().second;
+
+    std::memset(packet, 0, NETPLAY_HEADER_SIZE);
+    std::memcpy(packet, &NETPLAY_MAGIC, sizeof(NETPLAY_MAGIC));
+    packet[4] = m_config.localPlayer;
+    packet[5] = count;
+    std::memcpy(packet + 8, &m_remoteFrames, sizeof(m_remoteFrames));
+    std::memcpy(packet + 16, &first, sizeof(first));
+    std::memcpy(packet + 24, &checksumFrame, sizeof(checksumFrame));
+    std::memcpy(packet + 32, &checksum, sizeof(checksum));
+    for (u32 i = 0; i < count; i++) {
+        packet[NETPLAY_HEADER_SIZE + i] = m_inputs[(first + i) % INPUT_HISTORY].buttons[m_config.localPlayer];
+    }
+
+    m_socket.send(packet, NETPLAY_HEADER_SIZE + count);
+    m_socket.flush();
+}
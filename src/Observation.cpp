@@ -0,0 +1,303 @@
+#include "Observation.h"
+#include <cstring>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define OBSERVATION_AVX2 1
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#include <immintrin.h>
+#endif
+
+// Fixed-point weights sum to this on each axis (8.8)
+constexpr i32 WEIGHT_ONE = 256;
+
+// Shades are averaged as shade x 256 x 256; gray = 255 - 85 x shade, rounded
+constexpr u32 GRAY_PER_SHADE = 85;
+constexpr u32 GRAY_ROUNDING = 1 << 15;
+
+// Gray value of a horizontal filter sum
+static inline u8 grayFromSum(u32 sum) {
+    return static_cast<u8>(255 - ((sum * GRAY_PER_SHADE + GRAY_ROUNDING) >> 16));
+}
+
+// Scalar passes (the reference for the AVX2 ones)
+
+static void maxPoolScalar(const u8* current, u8* previous, u8* pooled, u32 width) {
+    for (u32 x = 0; x < width; x++) {
+        pooled[x] = std::max(current[x], previous[x]);
+        previous[x] = current[x];
+    }
+}
+
+static void verticalScalar(const u8* source, size_t stride, u32 width, const i16* weights, u32 taps, u16* line) {
+    for (u32 x = 0; x < width; x++) {
+        u32 sum = 0;
+        for (u32 t = 0; t < taps; t++) {
+            sum += static_cast<u32>(weights[t]) * source[t * stride + x];
+        }
+        line[x] = static_cast<u16>(sum);
+    }
+}
+
+static void horizontalScalar(const u16* line, const i32* starts, const i32* pairWeights, u32 pairCount,
+                             u32 paddedWidth, u32 begin, u32 end, u8* out) {
+    for (u32 x = begin; x < end; x++) {
+        u32 sum = 0;
+        for (u32 p = 0; p < pairCount; p++) {
+            const u32 weights = static_cast<u32>(pairWeights[p * paddedWidth + x]);
+            const u16* pixels = line + starts[x] + 2 * p;
+            sum += (weights & 0xFFFF) * pixels[0] + (weights >> 16) * pixels[1];
+        }
+        out[x] = grayFromSum(sum);
+    }
+}
+
+#ifdef OBSERVATION_AVX2
+
+// 32 pixels per step
+TARGET_AVX2 static void maxPoolAVX2(const u8* current, u8* previous, u8* pooled, u32 width) {
+    u32 x = 0;
+    for (; x + 32 <= width; x += 32) {
+        const __m256i now = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(current + x));
+        const __m256i before = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(previous + x));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(pooled + x), _mm256_max_epu8(now, before));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(previous + x), now);
+    }
+    maxPoolScalar(current + x, previous + x, pooled + x, width - x);
+}
+
+// 16 columns per step, widened to 16 bits
+TARGET_AVX2 static void verticalAVX2(const u8* source, size_t stride, u32 width, const i16* weights, u32 taps,
+                                     u16* line) {
+    u32 x = 0;
+    for (; x + 16 <= width; x += 16) {
+        __m256i sum = _mm256_setzero_si256();
+        for (u32 t = 0; t < taps; t++) {
+            const __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + t * stride + x));
+            sum = _mm256_add_epi16(sum, _mm256_mullo_epi16(_mm256_cvtepu8_epi16(bytes), _mm256_set1_epi16(weights[t])));
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(line + x), sum);
+    }
+    verticalScalar(source + x, stride, width - x, weights, taps, line + x);
+}
+
+// 8 outputs per step: each gather fetches two adjacent 16-bit taps per output,
+// which one multiply-add weights and sums
+TARGET_AVX2 static void horizontalAVX2(const u16* line, const i32* starts, const i32* pairWeights, u32 pairCount,
+                                       u32 paddedWidth, u32 width, u8* out) {
+    const __m256i two = _mm256_set1_epi32(2);
+    const __m256i grayPerShade = _mm256_set1_epi32(GRAY_PER_SHADE);
+    const __m256i rounding = _mm256_set1_epi32(GRAY_ROUNDING);
+    const __m256i white = _mm256_set1_epi32(255);
+    const __m256i firstDwords = _mm256_setr_epi32(0, 4, 0, 4, 0, 4, 0, 4);
+    const int* base = reinterpret_cast<const int*>(line);
+
+    u32 x = 0;
+    for (; x + 8 <= width; x += 8) {
+        __m256i index = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(starts + x));
+        __m256i sum = _mm256_setzero_si256();
+        for (u32 p = 0; p < pairCount; p++) {
+            const __m256i pixels = _mm256_i32gather_epi32(base, index, 2);
+            const __m256i weights = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(pairWeights + p * paddedWidth + x));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(pixels, weights));
+            index = _mm256_add_epi32(index, two);
+        }
+
+        const __m256i shade = _mm256_srli_epi32(_mm256_add_epi32(_mm256_mullo_epi32(sum, grayPerShade), rounding), 16);
+        __m256i gray = _mm256_sub_epi32(white, shade);
+        gray = _mm256_packus_epi32(gray, gray);
+        gray = _mm256_packus_epi16(gray, gray);
+        gray = _mm256_permutevar8x32_epi32(gray, firstDwords);
+        _mm_storel_epi64(reinterpret_cast<__m128i*>(out + x), _mm256_castsi256_si128(gray));
+    }
+    horizontalScalar(line, starts, pairWeights, pairCount, paddedWidth, x, width, out);
+}
+
+#endif
+
+// Whether the CPU runs AVX2 (checked once)
+bool ObservationPipeline::hasAVX2() {
+#ifdef OBSERVATION_AVX2
+    static const bool supported = __builtin_cpu_supports("avx2");
+    return supported;
+#else
+    return false;
+#endif
+}
+
+// Area filter: each output averages the source span it covers, partially
+// covered pixels weighted by their overlap
+void ObservationPipeline::buildFilter(u32 sourceSize, u32 outputSize, AxisFilter& filter) {
+    // Positions in units of 1/outputSize source pixels, so spans are exact
+    auto firstPixel = [&](u32 o) { return o * sourceSize / outputSize; };
+    auto lastPixel = [&](u32 o) { return ((o + 1) * sourceSize + outputSize - 1) / outputSize - 1; };
+
+    filter.tapCount = 0;
+    for (u32 o = 0; o < outputSize; o++) {
+        filter.tapCount = std::max(filter.tapCount, lastPixel(o) - firstPixel(o) + 1);
+    }
+
+    const u32 taps = filter.tapCount;
+    filter.starts.assign(outputSize, 0);
+    filter.weights.assign(static_cast<size_t>(outputSize) * taps, 0);
+
+    for (u32 o = 0; o < outputSize; o++) {
+        // Every output reads taps pixels; near the end the window is shifted back
+        const u32 first = firstPixel(o);
+        const u32 start = std::min(first, sourceSize - taps);
+        filter.starts[o] = static_cast<i32>(start);
+
+        i16* weights = &filter.weights[static_cast<size_t>(o) * taps];
+        i32 total = 0;
+        u32 largest = first - start;
+        for (u32 s = first; s <= lastPixel(o); s++) {
+            const u32 overlap = std::min((s + 1) * outputSize, (o + 1) * sourceSize) - std::max(s * outputSize, o * sourceSize);
+            const i32 weight = static_cast<i32>(overlap * WEIGHT_ONE / sourceSize);
+            weights[s - start] = static_cast<i16>(weight);
+            total += weight;
+            if (weight > weights[largest]) {
+                largest = s - start;
+            }
+        }
+
+        // Rounding loss goes to the heaviest tap so flat areas stay exact
+        weights[largest] = static_cast<i16>(weights[largest] + WEIGHT_ONE - total);
+    }
+}
+
+// ObservationPipeline constructor
+ObservationPipeline::ObservationPipeline(const ObservationConfig& config)
+    : m_config(config), m_valid(false), m_vectorized(hasAVX2()), m_planeSize(0), m_pairCount(0), m_paddedWidth(0),
+      m_hasPrevious(false), m_newest(0), m_frames(0) {
+    m_valid = config.cropWidth > 0 && config.cropHeight > 0 && config.width > 0 && config.height > 0 &&
+              config.stack > 0 && config.cropX + config.cropWidth <= SCREEN_WIDTH &&
+              config.cropY + config.cropHeight <= SCREEN_HEIGHT;
+    if (!m_valid) {
+        return;
+    }
+
+    buildFilter(config.cropHeight, config.height, m_vertical);
+    buildFilter(config.cropWidth, config.width, m_horizontal);
+
+    // Horizontal taps as (even, odd) weight pairs, outputs padded to 8
+    const u32 taps = m_horizontal.tapCount;
+    m_pairCount = (taps + 1) / 2;
+    m_paddedWidth = (config.width + 7u) & ~7u;
+    m_horizontal.starts.resize(m_paddedWidth, 0);
+    m_pairWeights.assign(static_cast<size_t>(m_pairCount) * m_paddedWidth, 0);
+    for (u32 x = 0; x < config.width; x++) {
+        const i16* weights = &m_horizontal.weights[static_cast<size_t>(x) * taps];
+        for (u32 p = 0; p < m_pairCount; p++) {
+            const u32 even = static_cast<u16>(weights[2 * p]);
+            const u32 odd = 2 * p + 1 < taps ? static_cast<u16>(weights[2 * p + 1]) : 0;
+            m_pairWeights[static_cast<size_t>(p) * m_paddedWidth + x] = static_cast<i32>(even | (odd << 16));
+        }
+    }
+
+    // The last pair may read one entry past the crop (with a zero weight)
+    m_line.assign(config.cropWidth + 2, 0);
+
+    if (config.maxPool) {
+        m_previous.assign(static_cast<size_t>(config.cropWidth) * config.cropHeight, 0);
+        m_pooled.assign(m_previous.size(), 0);
+    }
+
+    m_planeSize = static_cast<size_t>(config.width) * config.height;
+    m_ring.assign(m_planeSize * config.stack, 0);
+    reset();
+}
+
+// Start a new stack
+void ObservationPipeline::reset() {
+    m_hasPrevious = false;
+    m_frames = 0;
+    m_newest = m_config.stack ? m_config.stack - 1u : 0;
+}
+
+// Keep the crop of a frame for the next max-pool
+void ObservationPipeline::capture(const u8* screen) {
+    if (!m_valid || !m_config.maxPool) {
+        return;
+    }
+
+    for (u32 y = 0; y < m_config.cropHeight; y++) {
+        const u8* row = screen + (m_config.cropY + y) * SCREEN_WIDTH + m_config.cropX;
+        std::memcpy(&m_previous[static_cast<size_t>(y) * m_config.cropWidth], row, m_config.cropWidth);
+    }
+    m_hasPrevious = true;
+}
+
+// Max of this frame's crop and the previous one; this frame becomes the previous
+void ObservationPipeline::poolFrame(const u8* screen) {
+    if (!m_hasPrevious) {
+        capture(screen);
+    }
+
+    for (u32 y = 0; y < m_config.cropHeight; y++) {
+        const u8* row = screen + (m_config.cropY + y) * SCREEN_WIDTH + m_config.cropX;
+        const size_t offset = static_cast<size_t>(y) * m_config.cropWidth;
+#ifdef OBSERVATION_AVX2
+        if (m_vectorized) {
+            maxPoolAVX2(row, &m_previous[offset], &m_pooled[offset], m_config.cropWidth);
+            continue;
+        }
+#endif
+        maxPoolScalar(row, &m_previous[offset], &m_pooled[offset], m_config.cropWidth);
+    }
+}
+
+// Resample a crop into one plane, a vertically filtered row at a time
+void ObservationPipeline::resample(const u8* source, size_t stride, u8* plane) {
+    const u32 taps = m_vertical.tapCount;
+    for (u32 y = 0; y < m_config.height; y++) {
+        const u8* rows = source + static_cast<size_t>(m_vertical.starts[y]) * stride;
+        const i16* weights = &m_vertical.weights[static_cast<size_t>(y) * taps];
+        u8* out = plane + static_cast<size_t>(y) * m_config.width;
+#ifdef OBSERVATION_AVX2
+        if (m_vectorized) {
+            verticalAVX2(rows, stride, m_config.cropWidth, weights, taps, m_line.data());
+            horizontalAVX2(m_line.data(), m_horizontal.starts.data(), m_pairWeights.data(), m_pairCount,
+                           m_paddedWidth, m_config.width, out);
+            continue;
+        }
+#endif
+        verticalScalar(rows, stride, m_config.cropWidth, weights, taps, m_line.data());
+        horizontalScalar(m_line.data(), m_horizontal.starts.data(), m_pairWeights.data(), m_pairCount,
+                         m_paddedWidth, 0, m_config.width, out);
+    }
+}
+
+// Add a frame to the stack and write the stack out
+void ObservationPipeline::observe(const u8* screen, u8* out) {
+    if (!m_valid) {
+        return;
+    }
+
+    const u8* source = screen + m_config.cropY * SCREEN_WIDTH + m_config.cropX;
+    size_t stride = SCREEN_WIDTH;
+    if (m_config.maxPool) {
+        poolFrame(screen);
+        source = m_pooled.data();
+        stride = m_config.cropWidth;
+    }
+
+    const u32 stack = m_config.stack;
+    m_newest = (m_newest + 1) % stack;
+    u8* plane = &m_ring[m_newest * m_planeSize];
+    resample(source, stride, plane);
+
+    // A new stack starts out as copies of its first frame
+    if (m_frames == 0) {
+        for (u32 slot = 0; slot < stack; slot++) {
+            if (slot != m_newest) {
+                std::memcpy(&m_ring[slot * m_planeSize], plane, m_planeSize);
+            }
+        }
+    }
+    m_frames = std::min(m_frames + 1, stack);
+
+    // Oldest first
+    for (u32 i = 0; i < stack; i++) {
+        const u32 slot = (m_newest + 1 + i) % stack;
+        std::memcpy(out + i * m_planeSize, &m_ring[slot * m_planeSize], m_planeSize);
+    }
+}
@@ -1,7 +1,11 @@
 #include "PPU.h"
+#include "Trace.h"
+#include "PerfCounters.h"
+#include <chrono>
 
 // PPU constructor
-PPU::PPU() : m_memory(Memory::getInstance()), m_mode(Mode::OAM_SCAN), m_scanline(0), m_modeClock(0) {
+PPU::PPU(Memory& memory) : m_memory(memory), m_mode(Mode::OAM_SCAN), m_scanline(0), m_modeClock(0), m_disabledClock(0),
+             m_perfCounters(nullptr) {
     // Initialize screen buffer to white
     m_screenBuffer.fill(0);
 }
@@ -16,13 +20,49 @@ void PPU::reset() {
     m_mode = Mode::OAM_SCAN;
     m_scanline = 0;
     m_modeClock = 0;
+    m_disabledClock = 0;
     m_screenBuffer.fill(0);
 }
 
+// Copy the PPU state out
+void PPU::saveState(State& state) const {
+    state.screenBuffer = m_screenBuffer;
+    state.mode = m_mode;
+    state.scanline = m_scanline;
+    state.modeClock = m_modeClock;
+    state.disabledClock = m_disabledClock;
+}
+
+// Adopt a saved PPU state
+void PPU::loadState(const State& state) {
+    m_screenBuffer = state.screenBuffer;
+    m_mode = state.mode;
+    m_scanline = state.scanline;
+    m_modeClock = state.modeClock;
+    m_disabledClock = state.disabledClock;
+}
+
+// Cycles until the next mode change (~0u while the LCD is off)
+u32 PPU::cyclesUntilEvent() const {
+    if (!(m_memory.peek(0xFF40) & 0x80)) {
+        return ~0u;
+    }
+
+    u32 length = SCANLINE_CYCLES;
+    switch (m_mode) {
+        case Mode::OAM_SCAN: length = OAM_SCAN_CYCLES; break;
+        case Mode::PIXEL_TRANSFER: length = PIXEL_TRANSFER_CYCLES; break;
+        case Mode::HBLANK: length = HBLANK_CYCLES; break;
+        case Mode::VBLANK: length = SCANLINE_CYCLES; break;
+    }
+    return m_modeClock < length ? length - m_modeClock : 0;
+}
+
 // Update PPU state based on CPU cycles
 void PPU::update(u32 cycles) {
     // If LCD is disabled, don't do anything
     if (!isLCDEnabled()) {
+        countDisabledCycles(cycles);
         return;
     }
     
@@ -32,75 +72,115 @@ void PPU::update(u32 cycles) {
     // Process based on current mode
     switch (m_mode) {
         case Mode::OAM_SCAN:
-            // OAM scan takes 80 cycles
-            if (m_modeClock >= 80) {
-                m_modeClock -= 80;
-                m_mode = Mode::PIXEL_TRANSFER;
-                updateLCDStatus();
+            if (m_modeClock >= OAM_SCAN_CYCLES) {
+                m_modeClock -= OAM_SCAN_CYCLES;
+                finishOAMScan();
             }
             break;
             
         case Mode::PIXEL_TRANSFER:
-            // Pixel transfer takes 172 cycles
-            if (m_modeClock >= 172) {
-                m_modeClock -= 172;
-                m_mode = Mode::HBLANK;
-                updateLCDStatus();
-                
-                // Render the current scanline
-                renderScanline();
+            if (m_modeClock >= PIXEL_TRANSFER_CYCLES) {
+                m_modeClock -= PIXEL_TRANSFER_CYCLES;
+                finishPixelTransfer();
             }
             break;
             
         case Mode::HBLANK:
-            // HBlank takes 204 cycles
-            if (m_modeClock >= 204) {
-                m_modeClock -= 204;
-                
-                // Increment scanline
-                m_scanline++;
-                
-                // Check if we've reached VBlank
-                if (m_scanline == 144) {
-                    m_mode = Mode::VBLANK;
-                    
-                    // Request VBlank interrupt
-                    m_memory.write(0xFF0F, m_memory.read(0xFF0F) | 0x01);
-                } else {
-                    m_mode = Mode::OAM_SCAN;
-                }
-                
-                updateLCDStatus();
+            if (m_modeClock >= HBLANK_CYCLES) {
+                m_modeClock -= HBLANK_CYCLES;
+                finishHBlank();
             }
             break;
             
         case Mode::VBLANK:
             // Each scanline in VBlank takes 456 cycles
-            if (m_modeClock >= 456) {
-                m_modeClock -= 456;
-                
-                // Increment scanline
-                m_scanline++;
-                
-                // Check if VBlank is done
-                if (m_scanline > 153) {
-                    m_scanline = 0;
-                    m_mode = Mode::OAM_SCAN;
-                }
-                
-                updateLCDStatus();
+            if (m_modeClock >= SCANLINE_CYCLES) {
+                m_modeClock -= SCANLINE_CYCLES;
+                finishVBlankLine();
             }
             break;
     }
-    
-    // Update LY register (current scanline)
-    m_memory.write(0xFF44, m_scanline);
+}
+
+// Mode cycle as straight-line code: each mode waits out its length on the
+// LCD clock, then hands over to the next. Starts in whatever mode the PPU is in
+Scheduler::Task PPU::run(Scheduler& scheduler) {
+    for (;;) {
+        if (m_mode == Mode::OAM_SCAN) {
+            co_await scheduler.lcdCycles(OAM_SCAN_CYCLES);
+            finishOAMScan();
+        }
+        if (m_mode == Mode::PIXEL_TRANSFER) {
+            co_await scheduler.lcdCycles(PIXEL_TRANSFER_CYCLES);
+            finishPixelTransfer();
+        }
+        if (m_mode == Mode::HBLANK) {
+            co_await scheduler.lcdCycles(HBLANK_CYCLES);
+            finishHBlank();
+        }
+        while (m_mode == Mode::VBLANK) {
+            co_await scheduler.lcdCycles(SCANLINE_CYCLES);
+            finishVBlankLine();
+        }
+    }
+}
+
+// Take back the clocks a scheduled run kept
+void PPU::endScheduledRun(u32 modeClock, u32 disabledCycles) {
+    m_modeClock = modeClock;
+    countDisabledCycles(disabledCycles);
+}
+
+// OAM scan done: pixel transfer
+void PPU::finishOAMScan() {
+    m_mode = Mode::PIXEL_TRANSFER;
+    updateLCDStatus();
+}
+
+// Pixel transfer done: the line is rendered, HBlank
+void PPU::finishPixelTransfer() {
+    m_mode = Mode::HBLANK;
+    updateLCDStatus();
+    renderScanline();
+}
+
+// HBlank done: the next line, or VBlank after the last one
+void PPU::finishHBlank() {
+    m_scanline++;
+    if (m_scanline == 144) {
+        m_mode = Mode::VBLANK;
+        
+        // Request VBlank interrupt
+        m_memory.requestInterrupt(0);
+    } else {
+        m_mode = Mode::OAM_SCAN;
+    }
+    updateLCDStatus();
+}
+
+// A VBlank line done: the next one, or back to the first line
+void PPU::finishVBlankLine() {
+    m_scanline++;
+    if (m_scanline > 153) {
+        m_scanline = 0;
+        m_mode = Mode::OAM_SCAN;
+    }
+    updateLCDStatus();
+}
+
+// Count the scanlines that go by without being rendered
+void PPU::countDisabledCycles(u32 cycles) {
+    m_disabledClock += cycles;
+    while (m_disabledClock >= SCANLINE_CYCLES) {
+        m_disabledClock -= SCANLINE_CYCLES;
+        m_counters.scanlinesSkipped++;
+    }
 }
 
 // Update LCD Status register
 void PPU::updateLCDStatus() {
     // Get current STAT register value
-    u8 stat = m_memory.read(0xFF41);
+    u8 stat = m_memory.peek(0xFF41);
     
     // Clear mode bits (0-1)
     stat &= 0xFC;
@@ -109,12 +189,12 @@ void PPU::updateLCDStatus() {
     stat |= static_cast<u8>(m_mode);
     
     // Set coincidence flag (bit 2)
-    if (m_scanline == m_memory.read(0xFF45)) {
+    if (m_scanline == m_memory.peek(0xFF45)) {
         stat |= 0x04;
         
         // Request STAT interrupt if coincidence interrupt is enabled
         if (stat & 0x40) {
-            m_memory.write(0xFF0F, m_memory.read(0xFF0F) | 0x02);
+            m_memory.requestInterrupt(1);
         }
     } else {
         stat &= ~0x04;
@@ -124,15 +204,21 @@ void PPU::updateLCDStatus() {
     if ((m_mode == Mode::HBLANK && (stat & 0x08)) ||
         (m_mode == Mode::VBLANK && (stat & 0x10)) ||
         (m_mode == Mode::OAM_SCAN && (stat & 0x20))) {
-        m_memory.write(0xFF0F, m_memory.read(0xFF0F) | 0x02);
+        m_memory.requestInterrupt(1);
     }
     
-    // Write updated STAT register
-    m_memory.write(0xFF41, stat);
+    // Write updated STAT register (a plain I/O byte, not a bus access)
+    m_memory.getIO()[0x41] = stat;
 }
 
 // Render current scanline
 void PPU::renderScanline() {
+    TRACE_SCOPE("renderScanline");
+    auto startTime = std::chrono::steady_clock::now();
+    if (m_perfCounters) {
+        m_perfCounters->switchPhase(PerfPhase::PPU);
+    }
+    
     if (isBGWindowEnabled()) {
         renderBackground();
         
@@ -144,19 +230,24 @@ void PPU::renderScanline() {
     if (isSpritesEnabled()) {
         renderSprites();
     }
+    
+    if (m_perfCounters) {
+        m_perfCounters->switchPhase(PerfPhase::CPU);
+    }
+    
+    m_counters.scanlinesRendered++;
+    m_counters.renderNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - startTime).count();
 }
 
 // Render background for current scanline
 void PPU::renderBackground() {
-    // Get LCDC register
-    u8 lcdc = m_memory.read(0xFF40);
-    
     // Get background palette
-    u8 bgp = m_memory.read(0xFF47);
+    u8 bgp = m_memory.peek(0xFF47);
     
     // Get scroll positions
-    u8 scrollY = m_memory.read(0xFF42);
-    u8 scrollX = m_memory.read(0xFF43);
+    u8 scrollY = m_memory.peek(0xFF42);
+    u8 scrollX = m_memory.peek(0xFF43);
     
     // Calculate which tile row to use from background map
     u16 tileMapAddress = isBGTileMapHigh() ? 0x9C00 : 0x9800;
@@ -174,7 +265,7 @@ void PPU::renderBackground() {
         // Get tile index from background map
         u16 tileCol = xPos / 8;
         u16 tileAddress = tileMapAddress + tileRow + tileCol;
-        u8 tileIndex = m_memory.read(tileAddress);
+        u8 tileIndex = m_memory.peek(tileAddress);
         
         // Get tile data address
         u16 tileDataAddress;
@@ -188,8 +279,8 @@ void PPU::renderBackground() {
         
         // Get the specific byte for the current pixel row (each tile row is 2 bytes)
         u16 tileDataRowAddress = tileDataAddress + (tilePixelRow * 2);
-        u8 tileLowByte = m_memory.read(tileDataRowAddress);
-        u8 tileHighByte = m_memory.read(tileDataRowAddress + 1);
+        u8 tileLowByte = m_memory.peek(tileDataRowAddress);
+        u8 tileHighByte = m_memory.peek(tileDataRowAddress + 1);
         
         // Get the specific bit for the current pixel column
         u8 tilePixelCol = 7 - (xPos % 8);
@@ -208,19 +299,16 @@ void PPU::renderBackground() {
 // Render window for current scanline
 void PPU::renderWindow() {
     // Get window position
-    u8 windowX = m_memory.read(0xFF4B) - 7;
-    u8 windowY = m_memory.read(0xFF4A);
+    u8 windowX = m_memory.peek(0xFF4B) - 7;
+    u8 windowY = m_memory.peek(0xFF4A);
     
     // Check if window is visible on this scanline
     if (windowY > m_scanline) {
         return;
     }
     
-    // Get LCDC register
-    u8 lcdc = m_memory.read(0xFF40);
-    
     // Get background palette
-    u8 bgp = m_memory.read(0xFF47);
+    u8 bgp = m_memory.peek(0xFF47);
     
     // Calculate which tile row to use from window map
     u16 tileMapAddress = isWindowTileMapHigh() ? 0x9C00 : 0x9800;
@@ -243,7 +331,7 @@ void PPU::renderWindow() {
         // Get tile index from window map
         u16 tileCol = xPos / 8;
         u16 tileAddress = tileMapAddress + tileRow + tileCol;
-        u8 tileIndex = m_memory.read(tileAddress);
+        u8 tileIndex = m_memory.peek(tileAddress);
         
         // Get tile data address
         u16 tileDataAddress;
@@ -257,8 +345,8 @@ void PPU::renderWindow() {
         
         // Get the specific byte for the current pixel row (each tile row is 2 bytes)
         u16 tileDataRowAddress = tileDataAddress + (tilePixelRow * 2);
-        u8 tileLowByte = m_memory.read(tileDataRowAddress);
-        u8 tileHighByte = m_memory.read(tileDataRowAddress + 1);
+        u8 tileLowByte = m_memory.peek(tileDataRowAddress);
+        u8 tileHighByte = m_memory.peek(tileDataRowAddress + 1);
         
         // Get the specific bit for the current pixel column
         u8 tilePixelCol = 7 - (xPos % 8);
@@ -276,12 +364,9 @@ void PPU::renderWindow() {
 
 // Render sprites for current scanline
 void PPU::renderSprites() {
-    // Get LCDC register
-    u8 lcdc = m_memory.read(0xFF40);
-    
     // Get sprite palettes
-    u8 obp0 = m_memory.read(0xFF48);
-    u8 obp1 = m_memory.read(0xFF49);
+    u8 obp0 = m_memory.peek(0xFF48);
+    u8 obp1 = m_memory.peek(0xFF49);
     
     // Determine sprite height (8x8 or 8x16)
     u8 spriteHeight = isSpriteSizeLarge() ? 16 : 8;
@@ -293,10 +378,10 @@ void PPU::renderSprites() {
     for (u16 i = 0; i < 40; i++) {
         // Get sprite attributes from OAM
         u16 oamAddress = 0xFE00 + (i * 4);
-        u8 spriteY = m_memory.read(oamAddress) - 16;
-        u8 spriteX = m_memory.read(oamAddress + 1) - 8;
-        u8 tileIndex = m_memory.read(oamAddress + 2);
-        u8 attributes = m_memory.read(oamAddress + 3);
+        u8 spriteY = m_memory.peek(oamAddress) - 16;
+        u8 spriteX = m_memory.peek(oamAddress + 1) - 8;
+        u8 tileIndex = m_memory.peek(oamAddress + 2);
+        u8 attributes = m_memory.peek(oamAddress + 3);
         
         // Check if sprite is on current scanline
         if (m_scanline < spriteY || m_scanline >= spriteY + spriteHeight) {
@@ -334,8 +419,8 @@ void PPU::renderSprites() {
         
         // Get tile data address (sprites always use 0x8000 addressing mode)
         u16 tileDataAddress = 0x8000 + (tileIndex * 16) + (tileRow * 2);
-        u8 tileLowByte = m_memory.read(tileDataAddress);
-        u8 tileHighByte = m_memory.read(tileDataAddress + 1);
+        u8 tileLowByte = m_memory.peek(tileDataAddress);
+        u8 tileHighByte = m_memory.peek(tileDataAddress + 1);
         
         // Get palette
         u8 palette = usePalette1 ? obp1 : obp0;
@@ -385,33 +470,33 @@ void PPU::setPixel(u16 x, u16 y, u8 colorId) {
 
 // LCDC register bit checks
 bool PPU::isLCDEnabled() const {
-    return (m_memory.read(0xFF40) & 0x80) != 0;
+    return (m_memory.peek(0xFF40) & 0x80) != 0;
 }
 
 bool PPU::isWindowTileMapHigh() const {
-    return (m_memory.read(0xFF40) & 0x40) != 0;
+    return (m_memory.peek(0xFF40) & 0x40) != 0;
 }
 
 bool PPU::isWindowEnabled() const {
-    return (m_memory.read(0xFF40) & 0x20) != 0;
+    return (m_memory.peek(0xFF40) & 0x20) != 0;
 }
 
 bool PPU::isBGWindowTileDataHigh() const {
-    return (m_memory.read(0xFF40) & 0x10) != 0;
+    return (m_memory.peek(0xFF40) & 0x10) != 0;
 }
 
 bool PPU::isBGTileMapHigh() const {
-    return (m_memory.read(0xFF40) & 0x08) != 0;
+    return (m_memory.peek(0xFF40) & 0x08) != 0;
 }
 
 bool PPU::isSpriteSizeLarge() const {
-    return (m_memory.read(0xFF40) & 0x04) != 0;
+    return (m_memory.peek(0xFF40) & 0x04) != 0;
 }
 
 bool PPU::isSpritesEnabled() const {
-    return (m_memory.read(0xFF40) & 0x02) != 0;
+    return (m_memory.peek(0xFF40) & 0x02) != 0;
 }
 
 bool PPU::isBGWindowEnabled() const {
-    return (m_memory.read(0xFF40) & 0x01) != 0;
+    return (m_memory.peek(0xFF40) & 0x01) != 0;
 } 
\ No newline at end of file
@@ -0,0 +1,279 @@
+#include "PerfCounters.h"
+#include <cstring>
+#include <iomanip>
+
+#ifdef __linux__
+#include <cerrno>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+// PerfCounters constructor
+PerfCounters::PerfCounters() : m_groupFd(-1), m_groupSize(0), m_phase(PerfPhase::CPU), m_lastEnabled(0),
+                               m_lastRunning(0) {
+    m_fds.fill(-1);
+    m_groupIndex.fill(-1);
+    m_last.fill(0);
+    resetTotals();
+}
+
+// PerfCounters destructor
+PerfCounters::~PerfCounters() {
+    close();
+}
+
+// Counter names
+const char* PerfCounters::eventName(PerfEvent event) {
+    switch (event) {
+        case PerfEvent::CYCLES: return "cycles";
+        case PerfEvent::INSTRUCTIONS: return "instructions";
+        case PerfEvent::BRANCH_MISSES: return "branch-misses";
+        case PerfEvent::L1D_MISSES: return "L1d-misses";
+        case PerfEvent::L1I_MISSES: return "L1i-misses";
+        case PerfEvent::LLC_MISSES: return "LLC-misses";
+        default: return "unknown";
+    }
+}
+
+// Phase names
+const char* PerfCounters::phaseName(PerfPhase phase) {
+    switch (phase) {
+        case PerfPhase::CPU: return "cpu";
+        case PerfPhase::PPU: return "ppu";
+        default: return "unknown";
+    }
+}
+
+// Any counter open
+bool PerfCounters::anyAvailable() const {
+    return m_groupFd >= 0;
+}
+
+// Clear accumulated counts
+void PerfCounters::resetTotals() {
+    for (auto& phase : m_totals) {
+        phase.fill(0);
+    }
+    m_timeEnabled.fill(0);
+    m_timeRunning.fill(0);
+}
+
+#ifdef __linux__
+
+// perf_event_open has no libc wrapper
+static int perfEventOpen(perf_event_attr& attr, int groupFd) {
+    return static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+// Cache miss event encoding
+static u64 cacheMissConfig(u64 cache) {
+    return cache | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16);
+}
+
+// Open the counters for the calling thread
+bool PerfCounters::open() {
+    close();
+
+    for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        switch (static_cast<PerfEvent>(i)) {
+            case PerfEvent::CYCLES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_CPU_CYCLES;
+                break;
+            case PerfEvent::INSTRUCTIONS:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+                break;
+            case PerfEvent::BRANCH_MISSES:
+                attr.type = PERF_TYPE_HARDWARE;
+                attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+                break;
+            case PerfEvent::L1D_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_L1D);
+                break;
+            case PerfEvent::L1I_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_L1I);
+                break;
+            case PerfEvent::LLC_MISSES:
+                attr.type = PERF_TYPE_HW_CACHE;
+                attr.config = cacheMissConfig(PERF_COUNT_HW_CACHE_LL);
+                break;
+            default:
+                break;
+        }
+
+        // The first counter that opens leads the group and starts disabled
+        attr.disabled = m_groupFd < 0 ? 1 : 0;
+
+        int fd = perfEventOpen(attr, m_groupFd);
+        if (fd < 0) {
+            m_errors[i] = std::strerror(errno);
+            continue;
+        }
+
+        m_fds[i] = fd;
+        m_groupIndex[i] = static_cast<int>(m_groupSize++);
+        if (m_groupFd < 0) {
+            m_groupFd = fd;
+        }
+    }
+
+    if (m_groupFd < 0) {
+        return false;
+    }
+
+    ioctl(m_groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+    ioctl(m_groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+    m_phase = PerfPhase::CPU;
+    readGroup(m_last, m_lastEnabled, m_lastRunning);
+    return true;
+}
+
+// Close all counters
+void PerfCounters::close() {
+    for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (m_fds[i] >= 0) {
+            ::close(m_fds[i]);
+            m_fds[i] = -1;
+        }
+        m_groupIndex[i] = -1;
+    }
+    m_groupFd = -1;
+    m_groupSize = 0;
+}
+
+// Read all counters with one syscall, with the time the group was enabled
+// and the time it was actually on the PMU
+bool PerfCounters::readGroup(std::array<u64, PERF_EVENT_COUNT>& values, u64& timeEnabled, u64& timeRunning) const {
+    // Group read layout: { nr, time_enabled, time_running, values[nr] }
+    std::array<u64, PERF_EVENT_COUNT + 3> buffer;
+    ssize_t size = read(m_groupFd, buffer.data(), sizeof(buffer));
+    if (size < static_cast<ssize_t>(3 * sizeof(u64)) || buffer[0] != m_groupSize) {
+        return false;
+    }
+
+    timeEnabled = buffer[1];
+    timeRunning = buffer[2];
+    for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+        values[i] = m_groupIndex[i] >= 0 ? buffer[3 + m_groupIndex[i]] : 0;
+    }
+    return true;
+}
+
+#else
+
+// Hardware counters are only supported on Linux
+bool PerfCounters::open() {
+    for (auto& error : m_errors) {
+        error = "not supported on this platform";
+    }
+    return false;
+}
+
+void PerfCounters::close() {
+}
+
+bool PerfCounters::readGroup(std::array<u64, PERF_EVENT_COUNT>& values, u64& timeEnabled, u64& timeRunning) const {
+    values.fill(0);
+    timeEnabled = timeRunning = 0;
+    return false;
+}
+
+#endif
+
+// Attribute the counts since the last switch to the current phase
+void PerfCounters::switchPhase(PerfPhase phase) {
+    if (m_groupFd < 0) {
+        m_phase = phase;
+        return;
+    }
+
+    std::array<u64, PERF_EVENT_COUNT> now;
+    u64 enabled, running;
+    if (readGroup(now, enabled, running)) {
+        // A group the PMU could only schedule part of the time is scaled up
+        // to the whole interval; one it never scheduled counts nothing
+        const u64 enabledDelta = enabled - m_lastEnabled;
+        const u64 runningDelta = running - m_lastRunning;
+        const size_t phaseIndex = static_cast<size_t>(m_phase);
+        auto& totals = m_totals[phaseIndex];
+        if (runningDelta != 0) {
+            const double scale = static_cast<double>(enabledDelta) / runningDelta;
+            for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+                totals[i] += static_cast<u64>(static_cast<double>(now[i] - m_last[i]) * scale + 0.5);
+            }
+        }
+        m_timeEnabled[phaseIndex] += enabledDelta;
+        m_timeRunning[phaseIndex] += runningDelta;
+        m_last = now;
+        m_lastEnabled = enabled;
+        m_lastRunning = running;
+    }
+
+    m_phase = phase;
+}
+
+// Report per emulated frame and per million guest instructions
+void PerfCounters::report(std::ostream& out, u64 frames, u64 guestInstructions) const {
+    for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+        if (m_fds[i] < 0) {
+            out << "perf: " << eventName(static_cast<PerfEvent>(i)) << " unavailable ("
+                << (m_errors[i].empty() ? "not opened" : m_errors[i]) << ")\n";
+        }
+    }
+
+    if (m_groupFd < 0) {
+        return;
+    }
+
+    out << std::left << std::setw(8) << "phase" << std::setw(16) << "event" << std::right
+        << std::setw(18) << "total" << std::setw(16) << "per frame" << std::setw(20) << "per M guest instr" << "\n";
+
+    for (size_t phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+        const bool counted = m_timeRunning[phase] != 0;
+        for (size_t i = 0; i < PERF_EVENT_COUNT; i++) {
+            if (m_fds[i] < 0) {
+                continue;
+            }
+
+            if (!counted) {
+                out << std::left << std::setw(8) << phaseName(static_cast<PerfPhase>(phase))
+                    << std::setw(16) << eventName(static_cast<PerfEvent>(i)) << std::right
+                    << std::setw(18) << "not counted" << "\n";
+                continue;
+            }
+
+            u64 total = m_totals[phase][i];
+            double perFrame = frames ? static_cast<double>(total) / frames : 0.0;
+            double perMillion = guestInstructions ? static_cast<double>(total) * 1e6 / guestInstructions : 0.0;
+
+            out << std::left << std::setw(8) << phaseName(static_cast<PerfPhase>(phase))
+                << std::setw(16) << eventName(static_cast<PerfEvent>(i)) << std::right
+                << std::setw(18) << total
+                << std::fixed << std::setprecision(1)
+                << std::setw(16) << perFrame
+                << std::setw(20) << perMillion << "\n";
+        }
+    }
+
+    // Counts from a group that shared the PMU with other events are estimates
+    for (size_t phase = 0; phase < PERF_PHASE_COUNT; phase++) {
+        if (m_timeRunning[phase] != 0 && m_timeRunning[phase] < m_timeEnabled[phase]) {
+            out << "perf: " << phaseName(static_cast<PerfPhase>(phase)) << " counters ran "
+                << std::fixed << std::setprecision(1) << 100.0 * m_timeRunning[phase] / m_timeEnabled[phase]
+                << "% of the time, scaled up\n";
+        }
+    }
+}
@@ -0,0 +1,199 @@
+#include "ProcessPool.h"
+#include <limits>
+#include <thread>
+
+#ifndef _WIN32
+#include <poll.h>
+#include <csignal>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#ifndef _WIN32
+namespace {
+
+// Running child
+struct Child {
+    pid_t pid;
+    int fd;
+    size_t index;
+    std::chrono::steady_clock::time_point start;
+    bool killed;
+    std::string output;
+};
+
+// Write the whole result to the parent
+void writeAll(int fd, const std::string& data) {
+    size_t written = 0;
+    while (written < data.size()) {
+        ssize_t n = ::write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return;
+        }
+        written += static_cast<size_t>(n);
+    }
+}
+
+// Fork a child for one job
+bool startChild(size_t index, const ProcessPool::Job& job, Child& child) {
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return false;
+    }
+
+    // Buffered output would otherwise be written by both processes
+    std::cout.flush();
+    std::cerr.flush();
+
+    pid_t pid = fork();
+    if (pid < 0) {
+        ::close(fds[0]);
+        ::close(fds[1]);
+        return false;
+    }
+
+    if (pid == 0) {
+        ::close(fds[0]);
+        std::string result = job(index);
+        writeAll(fds[1], result);
+        ::close(fds[1]);
+
+        // Skip static destructors; the parent owns everything outside this job
+        _exit(0);
+    }
+
+    ::close(fds[1]);
+    child.pid = pid;
+    child.fd = fds[0];
+    child.index = index;
+    child.start = std::chrono::steady_clock::now();
+    child.killed = false;
+    child.output.clear();
+    return true;
+}
+
+// Reap a child whose pipe has closed
+void finishChild(Child& child, ProcessPool::Result& result) {
+    ::close(child.fd);
+
+    int status = 0;
+    while (waitpid(child.pid, &status, 0) < 0 && errno == EINTR) {
+    }
+
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - child.start).count();
+    result.completed = WIFEXITED(status) && WEXITSTATUS(status) == 0;
+    result.exitSignal = WIFSIGNALED(status) ? WTERMSIG(status) : 0;
+    result.timedOut = child.killed;
+    result.output = std::move(child.output);
+}
+
+}
+#endif
+
+// Run jobs on a pool of child processes
+std::vector<ProcessPool::Result> ProcessPool::run(size_t count, unsigned workers, double timeLimit, const Job& job,
+                                                  const std::function<void(size_t, const Result&)>& onDone) {
+    std::vector<Result> results(count);
+    if (workers == 0) {
+        workers = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+#ifndef _WIN32
+    std::vector<Child> running;
+    std::vector<pollfd> fds;
+    size_t next = 0;
+    char buffer[65536];
+
+    while (next < count || !running.empty()) {
+        // Keep every worker busy
+        while (next < count && running.size() < workers) {
+            Child child;
+            if (!startChild(next, job, child)) {
+                std::cerr << "Failed to start a worker process for job " << next << std::endl;
+                if (onDone) {
+                    onDone(next, results[next]);
+                }
+                next++;
+                continue;
+            }
+            running.push_back(std::move(child));
+            next++;
+        }
+
+        if (running.empty()) {
+            break;
+        }
+
+        // Drain pipes as children write, so large results never block them;
+        // wake up in time for the earliest deadline
+        const auto limit = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(timeLimit));
+        auto now = std::chrono::steady_clock::now();
+        int timeout = -1;
+        fds.resize(running.size());
+        for (size_t i = 0; i < running.size(); i++) {
+            fds[i] = {running[i].fd, POLLIN, 0};
+            if (timeLimit > 0.0 && !running[i].killed) {
+                auto left = std::chrono::ceil<std::chrono::milliseconds>(running[i].start + limit - now).count();
+                int wait = static_cast<int>(std::clamp<decltype(left)>(left, 0, std::numeric_limits<int>::max()));
+                timeout = timeout < 0 ? wait : std::min(timeout, wait);
+            }
+        }
+        if (poll(fds.data(), fds.size(), timeout) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+
+        // A child past its deadline is killed; its pipe then closes below
+        now = std::chrono::steady_clock::now();
+        for (Child& child : running) {
+            if (timeLimit > 0.0 && !child.killed && now - child.start >= limit) {
+                ::kill(child.pid, SIGKILL);
+                child.killed = true;
+            }
+        }
+
+        for (size_t i = running.size(); i-- > 0;) {
+            if (fds[i].revents == 0) {
+                continue;
+            }
+
+            ssize_t n = ::read(running[i].fd, buffer, sizeof(buffer));
+            if (n > 0) {
+                running[i].output.append(buffer, static_cast<size_t>(n));
+                continue;
+            }
+            if (n < 0 && errno == EINTR) {
+                continue;
+            }
+
+            // End of file: the child is done
+            Result& result = results[running[i].index];
+            finishChild(running[i], result);
+            if (onDone) {
+                onDone(running[i].index, result);
+            }
+            running.erase(running.begin() + static_cast<std::ptrdiff_t>(i));
+        }
+    }
+#else
+    for (size_t index = 0; index < count; index++) {
+        auto start = std::chrono::steady_clock::now();
+        Result& result = results[index];
+        result.output = job(index);
+        result.completed = true;
+        result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        if (onDone) {
+            onDone(index, result);
+        }
+    }
+#endif
+
+    return results;
+}
@@ -0,0 +1,284 @@
+#include "RomLibrary.h"
+#include "MappedFile.h"
+#include "RomLoader.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+// RomLibrary constructor
+RomLibrary::RomLibrary(const std::string& root) : m_root(root) {
+}
+
+// Files considered ROM images
+bool RomLibrary::isROMFile(const std::string& path) {
+    std::string extension = fs::path(path).extension().string();
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension == ".gb" || extension == ".gbc" || RomLoader::isArchiveExtension(extension);
+}
+
+// Map a ROM, read its header and hash its contents (archives are decompressed first)
+bool RomLibrary::indexFile(const std::string& filename, RomInfo& info) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        return false;
+    }
+
+    info.fileSize = file.size();
+    if (RomLoader::detect(file.data(), file.size()) == RomContainer::RAW) {
+        info.contentHash = hashBytes(file.data(), file.size());
+        info.headerValid = Cartridge::parseHeader(file.data(), file.size(), info.header);
+        return true;
+    }
+
+    // Archives are identified by the ROM image inside them
+    std::vector<u8> rom;
+    std::string error;
+    if (!RomLoader::decode(file.data(), file.size(), rom, error)) {
+        return false;
+    }
+    info.contentHash = hashBytes(rom.data(), rom.size());
+    info.headerValid = Cartridge::parseHeader(rom.data(), rom.size(), info.header);
+    return true;
+}
+
+// Load a previously saved index
+bool RomLibrary::load(const std::string& indexFile) {
+    m_entries.clear();
+    m_unreadable.clear();
+
+    MappedFile file;
+    if (!file.open(indexFile)) {
+        return false;
+    }
+
+    RomIndexHeader header;
+    if (file.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, file.data(), sizeof(header));
+
+    const u64 entryBytes = static_cast<u64>(header.entryCount) * sizeof(RomIndexEntry);
+    if (std::memcmp(header.magic, ROM_INDEX_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != ROM_INDEX_VERSION ||
+        file.size() != sizeof(header) + entryBytes + header.pathBytes) {
+        std::cerr << "Ignoring invalid ROM index: " << indexFile << std::endl;
+        return false;
+    }
+
+    const u8* records = file.data() + sizeof(header);
+    const char* paths = reinterpret_cast<const char*>(records + entryBytes);
+
+    m_entries.reserve(header.entryCount);
+    for (u32 i = 0; i < header.entryCount; i++) {
+        RomIndexEntry entry;
+        std::memcpy(&entry, records + i * sizeof(RomIndexEntry), sizeof(entry));
+        if (static_cast<u64>(entry.pathOffset) + entry.pathLength > header.pathBytes) {
+            std::cerr << "Ignoring invalid ROM index: " << indexFile << std::endl;
+            m_entries.clear();
+            m_unreadable.clear();
+            return false;
+        }
+
+        const bool readable = (entry.flags & ROM_INDEX_UNREADABLE) == 0;
+        RomInfo& info = (readable ? m_entries : m_unreadable).emplace_back();
+        info.path.assign(paths + entry.pathOffset, entry.pathLength);
+        info.modifiedTime = entry.modifiedTime;
+        info.fileSize = entry.fileSize;
+        info.contentHash = entry.contentHash;
+        info.headerValid = (entry.flags & ROM_INDEX_HEADER_VALID) != 0;
+        info.readable = readable;
+
+        Cartridge::Header& cartridge = info.header;
+        cartridge.title.assign(entry.title, strnlen(entry.title, sizeof(entry.title)));
+        Cartridge::setHeaderCodes(entry.cartridgeType, entry.romSizeCode, entry.ramSizeCode, cartridge);
+        cartridge.headerChecksum = entry.headerChecksum;
+        cartridge.globalChecksum = entry.globalChecksum;
+        cartridge.headerChecksumValid = (entry.flags & ROM_INDEX_HEADER_CHECKSUM_VALID) != 0;
+        cartridge.globalChecksumValid = (entry.flags & ROM_INDEX_GLOBAL_CHECKSUM_VALID) != 0;
+    }
+
+    return true;
+}
+
+// Write the index through a temporary file
+bool RomLibrary::save(const std::string& indexFile) const {
+    std::vector<RomIndexEntry> records(m_entries.size() + m_unreadable.size());
+    std::string paths;
+
+    for (size_t i = 0; i < records.size(); i++) {
+        const RomInfo& info = i < m_entries.size() ? m_entries[i] : m_unreadable[i - m_entries.size()];
+        RomIndexEntry& entry = records[i];
+        std::memset(&entry, 0, sizeof(entry));
+
+        entry.modifiedTime = info.modifiedTime;
+        entry.fileSize = info.fileSize;
+        entry.contentHash = info.contentHash;
+        entry.pathOffset = static_cast<u32>(paths.size());
+        entry.pathLength = static_cast<u16>(std::min<size_t>(info.path.size(), 0xFFFF));
+        paths.append(info.path, 0, entry.pathLength);
+        paths.push_back('\0');
+
+        if (info.headerValid) {
+            const Cartridge::Header& cartridge = info.header;
+            std::memcpy(entry.title, cartridge.title.data(), std::min(cartridge.title.size(), sizeof(entry.title)));
+            entry.cartridgeType = cartridge.cartridgeType;
+            entry.romSizeCode = cartridge.romSizeCode;
+            entry.ramSizeCode = cartridge.ramSizeCode;
+            entry.headerChecksum = cartridge.headerChecksum;
+            entry.globalChecksum = cartridge.globalChecksum;
+            entry.flags = ROM_INDEX_HEADER_VALID |
+                          (cartridge.headerChecksumValid ? ROM_INDEX_HEADER_CHECKSUM_VALID : 0) |
+                          (cartridge.globalChecksumValid ? ROM_INDEX_GLOBAL_CHECKSUM_VALID : 0);
+        }
+        if (!info.readable) {
+            entry.flags |= ROM_INDEX_UNREADABLE;
+        }
+    }
+
+    RomIndexHeader header;
+    std::memcpy(header.magic, ROM_INDEX_MAGIC, sizeof(header.magic));
+    header.version = ROM_INDEX_VERSION;
+    header.entryCount = static_cast<u32>(records.size());
+    header.pathBytes = paths.size();
+
+    const std::string temporary = indexFile + ".tmp";
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(RomIndexEntry));
+        file.write(paths.data(), paths.size());
+        if (!file.good()) {
+            std::cerr << "Failed to write ROM index: " << temporary << std::endl;
+            return false;
+        }
+    }
+
+    // Replace the previous index in one step
+    std::error_code error;
+    fs::rename(temporary, indexFile, error);
+    if (error) {
+        std::cerr << "Failed to write ROM index: " << indexFile << " (" << error.message() << ")" << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Bring the library up to date with the directory tree
+RomLibrary::ScanStats RomLibrary::scan(unsigned threads) {
+    ScanStats stats;
+
+    // Previous entries and unreadable files by path
+    std::unordered_map<std::string, RomInfo*> previous;
+    previous.reserve(m_entries.size() + m_unreadable.size());
+    for (RomInfo& info : m_entries) {
+        previous.emplace(info.path, &info);
+    }
+    for (RomInfo& info : m_unreadable) {
+        previous.emplace(info.path, &info);
+    }
+
+    // Walk the tree; unchanged files keep their entry (or their failure),
+    // the rest become jobs
+    std::vector<RomInfo> entries;
+    std::vector<RomInfo> unreadable;
+    std::vector<size_t> jobs;
+    std::error_code error;
+    for (fs::recursive_directory_iterator it(m_root, fs::directory_options::skip_permission_denied, error), end;
+         it != end; it.increment(error)) {
+        if (error) {
+            break;
+        }
+
+        std::error_code statusError;
+        if (!it->is_regular_file(statusError) || !isROMFile(it->path().string())) {
+            continue;
+        }
+
+        RomInfo info{};
+        info.path = fs::relative(it->path(), m_root, statusError).generic_string();
+        info.fileSize = it->file_size(statusError);
+        info.modifiedTime = static_cast<u64>(it->last_write_time(statusError).time_since_epoch().count());
+        if (statusError) {
+            stats.failed++;
+            continue;
+        }
+
+        auto found = previous.find(info.path);
+        if (found != previous.end()) {
+            RomInfo& old = *found->second;
+            if (old.modifiedTime == info.modifiedTime && old.fileSize == info.fileSize) {
+                if (old.readable) {
+                    entries.push_back(std::move(old));
+                    stats.reused++;
+                } else {
+                    unreadable.push_back(std::move(old));
+                    stats.failed++;
+                }
+                previous.erase(found);
+                continue;
+            }
+            previous.erase(found);
+        }
+
+        jobs.push_back(entries.size());
+        entries.push_back(std::move(info));
+    }
+    stats.removed = previous.size();
+
+    // Index new and changed files on a pool of workers
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = static_cast<unsigned>(std::min<size_t>(threads, std::max<size_t>(jobs.size(), 1)));
+
+    enum class Status : u8 { REUSED, INDEXED, FAILED };
+    std::vector<Status> status(entries.size(), Status::REUSED);
+    std::atomic<size_t> nextJob{0};
+    auto worker = [&]() {
+        for (size_t job = nextJob++; job < jobs.size(); job = nextJob++) {
+            RomInfo& info = entries[jobs[job]];
+            info.readable = indexFile((fs::path(m_root) / info.path).string(), info);
+            status[jobs[job]] = info.readable ? Status::INDEXED : Status::FAILED;
+        }
+    };
+
+    std::vector<std::thread> pool;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.emplace_back(worker);
+    }
+    for (auto& thread : pool) {
+        thread.join();
+    }
+
+    // Keep what could be read; failures are remembered with their size and
+    // modification time
+    std::vector<RomInfo> result;
+    result.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (status[i] == Status::FAILED) {
+            stats.failed++;
+            unreadable.push_back(std::move(entries[i]));
+            continue;
+        }
+        if (status[i] == Status::INDEXED) {
+            stats.indexed++;
+            stats.bytesHashed += entries[i].fileSize;
+        }
+        result.push_back(std::move(entries[i]));
+    }
+
+    auto byPath = [](const RomInfo& a, const RomInfo& b) { return a.path < b.path; };
+    std::sort(result.begin(), result.end(), byPath);
+    std::sort(unreadable.begin(), unreadable.end(), byPath);
+    m_entries = std::move(result);
+    m_unreadable = std::move(unreadable);
+    stats.files = m_entries.size();
+    return stats;
+}
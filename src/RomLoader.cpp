@@ -0,0 +1,268 @@
+#include "RomLoader.h"
+#include "Inflate.h"
+#include "MappedFile.h"
+
+namespace {
+
+// gzip header (RFC 1952)
+constexpr u8 GZIP_MAGIC[3] = {0x1F, 0x8B, 0x08};   // ID1, ID2, CM = deflate
+constexpr size_t GZIP_HEADER_SIZE = 10;
+constexpr size_t GZIP_TRAILER_SIZE = 8;
+constexpr u8 GZIP_FHCRC = 0x02;
+constexpr u8 GZIP_FEXTRA = 0x04;
+constexpr u8 GZIP_FNAME = 0x08;
+constexpr u8 GZIP_FCOMMENT = 0x10;
+
+// zip records (APPNOTE 4.3)
+constexpr u32 ZIP_LOCAL_SIGNATURE = 0x04034B50;
+constexpr u32 ZIP_CENTRAL_SIGNATURE = 0x02014B50;
+constexpr u32 ZIP_END_SIGNATURE = 0x06054B50;
+constexpr size_t ZIP_LOCAL_SIZE = 30;
+constexpr size_t ZIP_CENTRAL_SIZE = 46;
+constexpr size_t ZIP_END_SIZE = 22;
+constexpr u16 ZIP_STORED = 0;
+constexpr u16 ZIP_DEFLATE = 8;
+constexpr u16 ZIP_ENCRYPTED = 0x0001;
+
+u16 readLE16(const u8* data) {
+    return static_cast<u16>(data[0] | (data[1] << 8));
+}
+
+u32 readLE32(const u8* data) {
+    return static_cast<u32>(data[0]) | (static_cast<u32>(data[1]) << 8) |
+           (static_cast<u32>(data[2]) << 16) | (static_cast<u32>(data[3]) << 24);
+}
+
+// Lower-case extension of a file name, including the dot
+std::string extensionOf(const std::string& name) {
+    size_t slash = name.find_last_of("/\\");
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) {
+        return {};
+    }
+
+    std::string extension = name.substr(dot);
+    std::transform(extension.begin(), extension.end(), extension.begin(),
+                   [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    return extension;
+}
+
+// Size the ROM buffer once, before anything is decoded into it
+bool allocateROM(size_t size, std::vector<u8>& rom, std::string& error) {
+    if (size == 0 || size > RomLoader::MAX_ROM_SIZE) {
+        error = "unexpected ROM size " + std::to_string(size);
+        return false;
+    }
+    rom.resize(size);
+    return true;
+}
+
+// Inflate a raw deflate stream into the whole ROM buffer
+bool inflateInto(const u8* data, size_t size, std::vector<u8>& rom, std::string& error) {
+    size_t written = 0;
+    size_t consumed = 0;
+    if (!Inflater::inflate(data, size, rom.data(), rom.size(), written, consumed, error)) {
+        return false;
+    }
+    if (written != rom.size()) {
+        error = "decompressed size does not match the header";
+        return false;
+    }
+    return true;
+}
+
+}
+
+// Container format from the leading magic bytes
+RomContainer RomLoader::detect(const u8* data, size_t size) {
+    if (size >= GZIP_HEADER_SIZE + GZIP_TRAILER_SIZE && std::equal(GZIP_MAGIC, GZIP_MAGIC + 3, data)) {
+        return RomContainer::GZIP;
+    }
+    if (size >= ZIP_END_SIZE && readLE32(data) == ZIP_LOCAL_SIGNATURE) {
+        return RomContainer::ZIP;
+    }
+    return RomContainer::RAW;
+}
+
+const char* RomLoader::containerName(RomContainer container) {
+    switch (container) {
+        case RomContainer::GZIP: return "gzip";
+        case RomContainer::ZIP: return "zip";
+        default: return "raw";
+    }
+}
+
+// Archive extensions accepted next to .gb and .gbc
+bool RomLoader::isArchiveExtension(const std::string& extension) {
+    return extension == ".gz" || extension == ".zip";
+}
+
+// Load a ROM image from a plain, gzip or zip file
+bool RomLoader::load(const std::string& filename, std::vector<u8>& rom, std::string& error) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        error = "cannot open file";
+        return false;
+    }
+    return decode(file.data(), file.size(), rom, error);
+}
+
+// Load a ROM image from bytes already in memory
+bool RomLoader::decode(const u8* data, size_t size, std::vector<u8>& rom, std::string& error) {
+    switch (detect(data, size)) {
+        case RomContainer::GZIP:
+            return decodeGzip(data, size, rom, error);
+        case RomContainer::ZIP:
+            return decodeZip(data, size, rom, error);
+        default:
+            if (!allocateROM(size, rom, error)) {
+                return false;
+            }
+            std::copy(data, data + size, rom.begin());
+            return true;
+    }
+}
+
+// gzip: header, deflate stream, CRC-32 and size trailer
+bool RomLoader::decodeGzip(const u8* data, size_t size, std::vector<u8>& rom, std::string& error) {
+    const u8 flags = data[3];
+    size_t offset = GZIP_HEADER_SIZE;
+    const size_t streamEnd = size - GZIP_TRAILER_SIZE;
+
+    // Optional header fields
+    if (flags & GZIP_FEXTRA) {
+        if (offset + 2 > streamEnd) {
+            error = "truncated gzip header";
+            return false;
+        }
+        offset += 2 + readLE16(data + offset);
+    }
+    for (u8 field : {GZIP_FNAME, GZIP_FCOMMENT}) {
+        if (flags & field) {
+            while (offset < streamEnd && data[offset] != 0) {
+                offset++;
+            }
+            offset++;
+        }
+    }
+    if (flags & GZIP_FHCRC) {
+        offset += 2;
+    }
+    if (offset > streamEnd) {
+        error = "truncated gzip header";
+        return false;
+    }
+
+    // The trailer gives the uncompressed size (mod 2^32) and its CRC
+    const u32 expectedCRC = readLE32(data + streamEnd);
+    const u32 expectedSize = readLE32(data + streamEnd + 4);
+    if (!allocateROM(expectedSize, rom, error) ||
+        !inflateInto(data + offset, streamEnd - offset, rom, error)) {
+        return false;
+    }
+
+    if (crc32(rom.data(), rom.size()) != expectedCRC) {
+        error = "gzip CRC mismatch";
+        return false;
+    }
+    return true;
+}
+
+// zip: pick a ROM from the central directory and decode its local entry
+bool RomLoader::decodeZip(const u8* data, size_t size, std::vector<u8>& rom, std::string& error) {
+    // End of central directory record, followed by at most a 64 KB comment
+    size_t end = size - ZIP_END_SIZE + 1;
+    const size_t searchLimit = size > ZIP_END_SIZE + 0xFFFF ? size - ZIP_END_SIZE - 0xFFFF : 0;
+    do {
+        end--;
+    } while (end > searchLimit && readLE32(data + end) != ZIP_END_SIGNATURE);
+    if (readLE32(data + end) != ZIP_END_SIGNATURE) {
+        error = "zip end of central directory not found";
+        return false;
+    }
+
+    const u16 entries = readLE16(data + end + 10);
+    const u32 directoryOffset = readLE32(data + end + 16);
+
+    // First .gb/.gbc entry, else the first file
+    const u8* chosen = nullptr;
+    bool chosenIsROM = false;
+    size_t offset = directoryOffset;
+    for (u16 i = 0; i < entries; i++) {
+        if (offset + ZIP_CENTRAL_SIZE > size || readLE32(data + offset) != ZIP_CENTRAL_SIGNATURE) {
+            error = "corrupt zip central directory";
+            return false;
+        }
+
+        const u8* record = data + offset;
+        const u16 nameLength = readLE16(record + 28);
+        if (offset + ZIP_CENTRAL_SIZE + nameLength > size) {
+            error = "corrupt zip central directory";
+            return false;
+        }
+
+        std::string name(reinterpret_cast<const char*>(record + ZIP_CENTRAL_SIZE), nameLength);
+        std::string extension = extensionOf(name);
+        bool isROM = extension == ".gb" || extension == ".gbc";
+        bool isDirectory = !name.empty() && name.back() == '/';
+        if (!isDirectory && (!chosen || (isROM && !chosenIsROM))) {
+            chosen = record;
+            chosenIsROM = isROM;
+        }
+
+        offset += ZIP_CENTRAL_SIZE + nameLength + readLE16(record + 30) + readLE16(record + 32);
+    }
+
+    if (!chosen) {
+        error = "zip archive has no files";
+        return false;
+    }
+
+    const u16 entryFlags = readLE16(chosen + 8);
+    const u16 method = readLE16(chosen + 10);
+    const u32 expectedCRC = readLE32(chosen + 16);
+    const u32 compressedSize = readLE32(chosen + 20);
+    const u32 uncompressedSize = readLE32(chosen + 24);
+    const u32 localOffset = readLE32(chosen + 42);
+
+    if (entryFlags & ZIP_ENCRYPTED) {
+        error = "encrypted zip entries are not supported";
+        return false;
+    }
+    if (method != ZIP_STORED && method != ZIP_DEFLATE) {
+        error = "unsupported zip compression method " + std::to_string(method);
+        return false;
+    }
+
+    // Local header; its name and extra field lengths may differ from the central copy
+    if (static_cast<size_t>(localOffset) + ZIP_LOCAL_SIZE > size ||
+        readLE32(data + localOffset) != ZIP_LOCAL_SIGNATURE) {
+        error = "corrupt zip local header";
+        return false;
+    }
+    const size_t payload = localOffset + ZIP_LOCAL_SIZE + readLE16(data + localOffset + 26) +
+                           readLE16(data + localOffset + 28);
+    if (payload + compressedSize > size) {
+        error = "truncated zip entry";
+        return false;
+    }
+
+    if (!allocateROM(uncompressedSize, rom, error)) {
+        return false;
+    }
+    if (method == ZIP_STORED) {
+        if (compressedSize != uncompressedSize) {
+            error = "stored zip entry size mismatch";
+            return false;
+        }
+        std::copy(data + payload, data + payload + compressedSize, rom.begin());
+    } else if (!inflateInto(data + payload, compressedSize, rom, error)) {
+        return false;
+    }
+
+    if (crc32(rom.data(), rom.size()) != expectedCRC) {
+        error = "zip CRC mismatch";
+        return false;
+    }
+    return true;
+}
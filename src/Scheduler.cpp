@@ -0,0 +1,124 @@
+#include "Scheduler.h"
+#include "CPU.h"
+#include "Memory.h"
+#include "PPU.h"
+
+// Carve a frame off the block, keeping the alignment operator new promises
+void* CoroutineArena::allocate(size_t size) {
+    constexpr size_t alignment = alignof(std::max_align_t);
+    const size_t start = (m_used + alignment - 1) & ~(alignment - 1);
+    if (start + size > SIZE) {
+        return nullptr;
+    }
+    m_used = start + size;
+    return m_buffer.data() + start;
+}
+
+// Run the coroutines for a number of cycles
+u32 Scheduler::run(u32 cycles) {
+    // Clocks start from the component state
+    m_arena.reset();
+    m_now = 0;
+    m_end = cycles;
+    m_lcdNow = m_ppu.getModeClock();
+    m_lcdOff = 0;
+    m_modeStart = 0;
+    m_lineSynced = 0;
+    m_lcdc = m_memory.getIO() + 0x40;
+    m_waiters = {};
+    m_nextDeadline = ~0ull;
+    m_nextLCDDeadline = ~0ull;
+
+    Task cpu = runCPU();
+    Task ppu = m_ppu.run(*this);
+    Task line = runLineClock();
+    if (!cpu || !ppu || !line) {
+        return 0;
+    }
+
+    // The devices go to their first deadlines
+    m_running = true;
+    m_current = PPU_SLOT;
+    ppu.getHandle().resume();
+    m_current = LINE_SLOT;
+    line.getHandle().resume();
+
+    while (m_now < m_end) {
+        // The CPU runs up to the earliest deadline, then every device due
+        // there gets one turn, in slot order (the callback loop's order)
+        cpu.getHandle().resume();
+        for (size_t slot = 0; slot < SLOT_COUNT; slot++) {
+            if (isDue(m_waiters[slot])) {
+                m_current = slot;
+                m_waiters[slot].handle.resume();
+            }
+        }
+    }
+    m_running = false;
+
+    // Hand the clocks back
+    m_ppu.endScheduledRun(static_cast<u32>(m_lcdNow - m_modeStart), static_cast<u32>(m_lcdOff));
+    if (m_now != m_lineSynced) {
+        m_memory.updatePPU(static_cast<u32>(m_now - m_lineSynced));
+    }
+    return static_cast<u32>(m_now);
+}
+
+// Cycles until the earliest deadline (or a serial completion)
+u32 Scheduler::cyclesUntilEvent() const {
+    u64 cycles = std::min<u64>(m_nextDeadline - m_now, m_memory.cyclesUntilEvent());
+    if (*m_lcdc & 0x80) {
+        cycles = std::min(cycles, m_nextLCDDeadline - m_lcdNow);
+    }
+    return static_cast<u32>(cycles);
+}
+
+// The running device waits for a deadline
+void Scheduler::park(std::coroutine_handle<> handle, u64 deadline, bool lcdClock) {
+    m_waiters[m_current] = {handle, deadline, lcdClock};
+
+    m_nextDeadline = ~0ull;
+    m_nextLCDDeadline = ~0ull;
+    for (const Waiter& waiter : m_waiters) {
+        if (waiter.handle) {
+            u64& next = waiter.lcdClock ? m_nextLCDDeadline : m_nextDeadline;
+            next = std::min(next, waiter.deadline);
+        }
+    }
+}
+
+// CPU: instructions back to back until a device is due or the run is over
+Scheduler::Task Scheduler::runCPU() {
+    for (;;) {
+        do {
+            const u32 before = m_cpu.getCycles();
+            m_cpu.step(static_cast<u32>(m_end - m_now));
+            const u32 elapsed = m_cpu.getCycles() - before;
+
+            // An instruction counts on the LCD clock when it ends with the LCD on
+            m_now += elapsed;
+            if (*m_lcdc & 0x80) {
+                m_lcdNow += elapsed;
+            } else {
+                m_lcdOff += elapsed;
+            }
+            m_memory.updateSerial(elapsed);
+        } while (m_now < m_nextDeadline && m_lcdNow < m_nextLCDDeadline && m_now < m_end);
+
+        co_await Yield{};
+    }
+}
+
+// LY clock (the memory's compatibility timing): wakes at each line change,
+// and after every instruction on the line that keeps requesting VBlank
+Scheduler::Task Scheduler::runLineClock() {
+    for (;;) {
+        if (m_memory.isVBlankLine()) {
+            co_await nextStep();
+        } else {
+            co_await until(m_lineSynced + m_memory.cyclesUntilNextLine());
+        }
+        m_memory.updatePPU(static_cast<u32>(m_now - m_lineSynced));
+        m_lineSynced = m_now;
+    }
+}
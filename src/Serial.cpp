@@ -0,0 +1,7 @@
+#include "Serial.h"
+
+// Keep the byte; the line stays high
+u8 SerialCapture::transfer(u8 outgoing) {
+    m_data.push_back(outgoing);
+    return 0xFF;
+}
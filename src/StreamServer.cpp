@@ -0,0 +1,682 @@
+#include "StreamServer.h"
+#include "MappedFile.h"
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Largest request header and client message accepted
+constexpr size_t MAX_REQUEST_SIZE = 8192;
+constexpr size_t MAX_CLIENT_MESSAGE = 1024;
+
+// WebSocket opcodes
+constexpr u8 WS_TEXT = 0x1;
+constexpr u8 WS_BINARY = 0x2;
+constexpr u8 WS_CLOSE = 0x8;
+constexpr u8 WS_PING = 0x9;
+constexpr u8 WS_PONG = 0xA;
+
+// Steady clock in microseconds (frame send times)
+static u64 nowMicros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// SHA-1 digest (WebSocket handshake only)
+static std::array<u8, 20> sha1(const std::string& text) {
+    u32 state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+
+    // Message, 0x80, zero padding and the bit length fill whole 64-byte blocks
+    std::vector<u8> message(text.begin(), text.end());
+    const u64 bitLength = static_cast<u64>(text.size()) * 8;
+    message.push_back(0x80);
+    while (message.size() % 64 != 56) {
+        message.push_back(0);
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        message.push_back(static_cast<u8>(bitLength >> shift));
+    }
+
+    auto rotate = [](u32 value, int bits) { return (value << bits) | (value >> (32 - bits)); };
+    for (size_t block = 0; block < message.size(); block += 64) {
+        u32 words[80];
+        for (int i = 0; i < 16; i++) {
+            const u8* bytes = &message[block + i * 4];
+            words[i] = (static_cast<u32>(bytes[0]) << 24) | (bytes[1] << 16) | (bytes[2] << 8) | bytes[3];
+        }
+        for (int i = 16; i < 80; i++) {
+            words[i] = rotate(words[i - 3] ^ words[i - 8] ^ words[i - 14] ^ words[i - 16], 1);
+        }
+
+        u32 a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+        for (int i = 0; i < 80; i++) {
+            u32 f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            u32 temp = rotate(a, 5) + f + e + k + words[i];
+            e = d;
+            d = c;
+            c = rotate(b, 30);
+            b = a;
+            a = temp;
+        }
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+
+    std::array<u8, 20> digest;
+    for (int i = 0; i < 20; i++) {
+        digest[i] = static_cast<u8>(state[i / 4] >> (24 - (i % 4) * 8));
+    }
+    return digest;
+}
+
+// Base64 with padding
+static std::string base64(const u8* data, size_t size) {
+    static const char ALPHABET[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string text;
+    for (size_t i = 0; i < size; i += 3) {
+        u32 group = data[i] << 16;
+        if (i + 1 < size) group |= data[i + 1] << 8;
+        if (i + 2 < size) group |= data[i + 2];
+        text += ALPHABET[(group >> 18) & 63];
+        text += ALPHABET[(group >> 12) & 63];
+        text += i + 1 < size ? ALPHABET[(group >> 6) & 63] : '=';
+        text += i + 2 < size ? ALPHABET[group & 63] : '=';
+    }
+    return text;
+}
+
+// Sec-WebSocket-Accept for a key
+std::string webSocketAccept(const std::string& key) {
+    const auto digest = sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11");
+    return base64(digest.data(), digest.size());
+}
+
+// Header of an unmasked, unfragmented server frame
+size_t webSocketHeader(u8 opcode, size_t payloadSize, u8* header) {
+    header[0] = static_cast<u8>(0x80 | opcode);
+    if (payloadSize < 126) {
+        header[1] = static_cast<u8>(payloadSize);
+        return 2;
+    }
+    if (payloadSize <= 0xFFFF) {
+        header[1] = 126;
+        header[2] = static_cast<u8>(payloadSize >> 8);
+        header[3] = static_cast<u8>(payloadSize);
+        return 4;
+    }
+    header[1] = 127;
+    for (int i = 0; i < 8; i++) {
+        header[2 + i] = static_cast<u8>(static_cast<u64>(payloadSize) >> (56 - i * 8));
+    }
+    return 10;
+}
+
+// A complete server frame
+static std::shared_ptr<std::vector<u8>> webSocketFrame(u8 opcode, const u8* payload, size_t size) {
+    auto frame = std::make_shared<std::vector<u8>>(10 + size);
+    const size_t headerSize = webSocketHeader(opcode, size, frame->data());
+    if (size > 0) {
+        std::memcpy(frame->data() + headerSize, payload, size);
+    }
+    frame->resize(headerSize + size);
+    return frame;
+}
+
+// A frame message: stream header followed by a payload
+static std::shared_ptr<std::vector<u8>> frameMessage(StreamMessage type, u64 frame, u32 checksum, u64 sendMicros,
+                                                     const u8* payload, size_t size) {
+    std::vector<u8> body(STREAM_HEADER_SIZE + size, 0);
+    body[0] = type;
+    const u32 frameNumber = static_cast<u32>(frame);
+    std::memcpy(&body[4], &frameNumber, sizeof(frameNumber));
+    std::memcpy(&body[8], &checksum, sizeof(checksum));
+    std::memcpy(&body[12], &sendMicros, sizeof(sendMicros));
+    std::memcpy(&body[STREAM_HEADER_SIZE], payload, size);
+    return webSocketFrame(WS_BINARY, body.data(), body.size());
+}
+
+// StreamServer constructor
+StreamServer::StreamServer()
+    : m_running(false), m_port(0), m_listenSocket(-1), m_epoll(-1), m_wakeEvent(-1), m_buttons(0),
+      m_pendingShades(static_cast<size_t>(SCREEN_WIDTH) * SCREEN_HEIGHT), m_pendingFrame(0), m_hasPending(false),
+      m_droppedFrames(0) {
+}
+
+// StreamServer destructor
+StreamServer::~StreamServer() {
+    stop();
+}
+
+#ifndef _WIN32
+
+// Start listening and the server threads
+bool StreamServer::start(const std::string& address, u16 port, const std::string& pageFile) {
+    stop();
+
+    MappedFile page;
+    if (!page.open(pageFile)) {
+        std::cerr << "Failed to read stream page: " << pageFile << std::endl;
+        return false;
+    }
+    m_page.assign(reinterpret_cast<const char*>(page.data()), page.size());
+
+    sockaddr_in socketAddress{};
+    socketAddress.sin_family = AF_INET;
+    socketAddress.sin_port = htons(port);
+    if (inet_pton(AF_INET, address.c_str(), &socketAddress.sin_addr) != 1) {
+        std::cerr << "Invalid stream address: " << address << std::endl;
+        return false;
+    }
+
+    m_listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int reuse = 1;
+    if (m_listenSocket < 0 || setsockopt(m_listenSocket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse)) < 0 ||
+        bind(m_listenSocket, reinterpret_cast<sockaddr*>(&socketAddress), sizeof(socketAddress)) < 0 ||
+        listen(m_listenSocket, 16) < 0) {
+        std::cerr << "Failed to listen on " << address << ":" << port << ": " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+
+    socklen_t length = sizeof(socketAddress);
+    getsockname(m_listenSocket, reinterpret_cast<sockaddr*>(&socketAddress), &length);
+    m_port = ntohs(socketAddress.sin_port);
+
+    // The encoder wakes the network thread through an eventfd
+    m_epoll = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeEvent = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epoll < 0 || m_wakeEvent < 0) {
+        std::cerr << "Failed to set up epoll: " << std::strerror(errno) << std::endl;
+        stop();
+        return false;
+    }
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = m_listenSocket;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_listenSocket, &event);
+    event.data.fd = m_wakeEvent;
+    epoll_ctl(m_epoll, EPOLL_CTL_ADD, m_wakeEvent, &event);
+
+    m_running = true;
+    m_encoderThread = std::thread(&StreamServer::encoderLoop, this);
+    m_networkThread = std::thread(&StreamServer::networkLoop, this);
+    return true;
+}
+
+// Stop the threads, report and close every connection
+void StreamServer::stop() {
+    if (m_running.exchange(false)) {
+        m_frameReady.notify_all();
+        const u64 wake = 1;
+        (void)write(m_wakeEvent, &wake, sizeof(wake));
+        m_encoderThread.join();
+        m_networkThread.join();
+    }
+
+    while (!m_clients.empty()) {
+        closeClient(m_clients.begin()->first);
+    }
+    for (int* descriptor : {&m_listenSocket, &m_wakeEvent, &m_epoll}) {
+        if (*descriptor >= 0) {
+            close(*descriptor);
+            *descriptor = -1;
+        }
+    }
+
+    m_outbox.clear();
+    m_hasPending = false;
+    if (m_droppedFrames > 0) {
+        std::cout << "stream: " << m_droppedFrames << " frames replaced before the encoder took them" << std::endl;
+        m_droppedFrames = 0;
+    }
+}
+
+// Hand a frame to the encoder
+void StreamServer::submitFrame(u64 frame, const u8* shades) {
+    if (!m_running) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_frameMutex);
+        std::memcpy(m_pendingShades.data(), shades, m_pendingShades.size());
+        if (m_hasPending) {
+            m_droppedFrames++;
+        }
+        m_pendingFrame = frame;
+        m_hasPending = true;
+    }
+    m_frameReady.notify_one();
+}
+
+// Pack and delta-encode submitted frames
+void StreamServer::encoderLoop() {
+    std::vector<u8> shades(m_pendingShades.size());
+    std::vector<u8> previous(PACKED_FRAME_SIZE);
+    std::vector<u8> current(PACKED_FRAME_SIZE);
+    std::vector<u8> delta(PACKED_FRAME_SIZE);
+    bool hasPrevious = false;
+
+    while (true) {
+        u64 frame;
+        {
+            std::unique_lock<std::mutex> lock(m_frameMutex);
+            m_frameReady.wait(lock, [this] { return m_hasPending || !m_running; });
+            if (!m_running) {
+                return;
+            }
+            shades.swap(m_pendingShades);
+            frame = m_pendingFrame;
+            m_hasPending = false;
+        }
+
+        packFrame(shades.data(), current.data());
+        const u32 checksum = static_cast<u32>(hashBytes(current.data(), current.size()));
+        const u64 sendMicros = nowMicros();
+
+        EncodedFrame encoded;
+        encoded.frame = frame;
+        encoded.key = frameMessage(STREAM_KEY_FRAME, frame, checksum, sendMicros, current.data(), current.size());
+        const size_t deltaSize = hasPrevious ? encodeDelta(previous.data(), current.data(), delta.data()) : 0;
+        encoded.delta = deltaSize > 0 ? frameMessage(STREAM_DELTA_FRAME, frame, checksum, sendMicros, delta.data(), deltaSize)
+                                      : encoded.key;
+
+        {
+            std::lock_guard<std::mutex> lock(m_outboxMutex);
+            m_outbox.push_back(std::move(encoded));
+        }
+        const u64 wake = 1;
+        (void)write(m_wakeEvent, &wake, sizeof(wake));
+
+        previous.swap(current);
+        hasPrevious = true;
+    }
+}
+
+// Serve connections until stopped
+void StreamServer::networkLoop() {
+    epoll_event events[64];
+    while (m_running) {
+        int count = epoll_wait(m_epoll, events, 64, 100);
+        for (int i = 0; i < count; i++) {
+            const int descriptor = events[i].data.fd;
+            if (descriptor == m_listenSocket) {
+                acceptClients();
+                continue;
+            }
+            if (descriptor == m_wakeEvent) {
+                u64 value;
+                (void)read(m_wakeEvent, &value, sizeof(value));
+                distributeFrames();
+                continue;
+            }
+
+            auto it = m_clients.find(descriptor);
+            if (it == m_clients.end()) {
+                continue;
+            }
+            Client& client = it->second;
+            bool open = (events[i].events & EPOLLERR) == 0;
+            if (open && (events[i].events & (EPOLLIN | EPOLLHUP))) {
+                open = readClient(client);
+            }
+            if (open && (events[i].events & EPOLLOUT)) {
+                open = writeClient(client);
+            }
+            if (!open) {
+                closeClient(descriptor);
+            }
+        }
+    }
+}
+
+// Accept every pending connection
+void StreamServer::acceptClients() {
+    while (true) {
+        sockaddr_in address{};
+        socklen_t length = sizeof(address);
+        int descriptor = accept4(m_listenSocket, reinterpret_cast<sockaddr*>(&address), &length,
+                                 SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (descriptor < 0) {
+            return;
+        }
+
+        // Frames are small and latency matters more than packet count
+        int noDelay = 1;
+        setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+
+        char host[INET_ADDRSTRLEN] = "?";
+        inet_ntop(AF_INET, &address.sin_addr, host, sizeof(host));
+
+        Client& client = m_clients[descriptor];
+        client.socket = descriptor;
+        client.peer = std::string(host) + ":" + std::to_string(ntohs(address.sin_port));
+        client.connected = std::chrono::steady_clock::now();
+
+        epoll_event event{};
+        event.events = EPOLLIN | EPOLLRDHUP;
+        event.data.fd = descriptor;
+        epoll_ctl(m_epoll, EPOLL_CTL_ADD, descriptor, &event);
+    }
+}
+
+// Read what arrived and handle complete requests or messages
+bool StreamServer::readClient(Client& client) {
+    u8 buffer[4096];
+    while (true) {
+        ssize_t received = recv(client.socket, buffer, sizeof(buffer), 0);
+        if (received == 0) {
+            return false;
+        }
+        if (received < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        client.bytesReceived += static_cast<u64>(received);
+        client.input.insert(client.input.end(), buffer, buffer + received);
+        if (client.input.size() > MAX_REQUEST_SIZE + MAX_CLIENT_MESSAGE) {
+            return false;
+        }
+    }
+
+    if (!client.webSocket && !handleRequest(client)) {
+        return false;
+    }
+    if (client.webSocket && !handleWebSocketFrames(client)) {
+        return false;
+    }
+    return writeClient(client);
+}
+
+// Send as much of the queue as the socket takes
+bool StreamServer::writeClient(Client& client) {
+    while (!client.output.empty()) {
+        const std::vector<u8>& message = *client.output.front();
+        ssize_t sent = send(client.socket, message.data() + client.outputOffset, message.size() - client.outputOffset,
+                            MSG_NOSIGNAL);
+        if (sent < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+
+        client.bytesSent += static_cast<u64>(sent);
+        client.queuedBytes -= static_cast<size_t>(sent);
+        client.outputOffset += static_cast<size_t>(sent);
+        if (client.outputOffset == message.size()) {
+            client.output.pop_front();
+            client.outputOffset = 0;
+        }
+    }
+
+    if (client.closing && client.output.empty()) {
+        return false;
+    }
+    updateEvents(client);
+    return true;
+}
+
+// Wait for writability only while something is queued
+void StreamServer::updateEvents(const Client& client) {
+    epoll_event event{};
+    event.events = EPOLLIN | EPOLLRDHUP | (client.output.empty() ? 0u : static_cast<u32>(EPOLLOUT));
+    event.data.fd = client.socket;
+    epoll_ctl(m_epoll, EPOLL_CTL_MOD, client.socket, &event);
+}
+
+// Report and drop a connection
+void StreamServer::closeClient(int socket) {
+    auto it = m_clients.find(socket);
+    if (it == m_clients.end()) {
+        return;
+    }
+    if (it->second.webSocket) {
+        report(it->second);
+    }
+    epoll_ctl(m_epoll, EPOLL_CTL_DEL, socket, nullptr);
+    close(socket);
+    m_clients.erase(it);
+}
+
+// Append a message to a client's send queue
+void StreamServer::queue(Client& client, Message message) {
+    client.queuedBytes += message->size();
+    client.output.push_back(std::move(message));
+}
+
+// Hand encoded frames to the clients that can take them
+void StreamServer::distributeFrames() {
+    std::deque<EncodedFrame> frames;
+    {
+        std::lock_guard<std::mutex> lock(m_outboxMutex);
+        frames.swap(m_outbox);
+    }
+
+    for (const EncodedFrame& frame : frames) {
+        for (auto& [socket, client] : m_clients) {
+            if (!client.webSocket || client.closing) {
+                continue;
+            }
+
+            // A slow client skips frames, then needs a key frame
+            if (client.queuedBytes > MAX_QUEUED_BYTES || client.framesInFlight >= MAX_FRAMES_IN_FLIGHT) {
+                client.skippedFrames++;
+                client.synced = false;
+                continue;
+            }
+
+            const bool useDelta = client.synced && frame.delta != frame.key;
+            queue(client, useDelta ? frame.delta : frame.key);
+            (useDelta ? client.deltaFrames : client.keyFrames)++;
+            client.framesInFlight++;
+            client.synced = true;
+        }
+    }
+
+    std::vector<int> failed;
+    for (auto& [socket, client] : m_clients) {
+        if (!client.output.empty() && !writeClient(client)) {
+            failed.push_back(socket);
+        }
+    }
+    for (int socket : failed) {
+        closeClient(socket);
+    }
+}
+
+// Serve the page or upgrade to a WebSocket
+bool StreamServer::handleRequest(Client& client) {
+    const std::string text(client.input.begin(), client.input.end());
+    const size_t headerEnd = text.find("\r\n\r\n");
+    if (headerEnd == std::string::npos) {
+        return client.input.size() <= MAX_REQUEST_SIZE;
+    }
+
+    // Request line and headers (names lowercased)
+    std::istringstream request(text.substr(0, headerEnd));
+    std::string method, path, version, line;
+    request >> method >> path >> version;
+    std::getline(request, line);
+    std::unordered_map<std::string, std::string> headers;
+    while (std::getline(request, line)) {
+        const size_t colon = line.find(':');
+        if (colon == std::string::npos) {
+            continue;
+        }
+        std::string name = line.substr(0, colon);
+        std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return std::tolower(c); });
+        const size_t valueStart = line.find_first_not_of(' ', colon + 1);
+        const size_t valueEnd = line.find_last_not_of("\r ");
+        headers[name] = valueStart == std::string::npos ? "" : line.substr(valueStart, valueEnd - valueStart + 1);
+    }
+    client.input.erase(client.input.begin(), client.input.begin() + headerEnd + 4);
+
+    auto respond = [&](const std::string& status, const std::string& type, const std::string& body) {
+        std::string response = "HTTP/1.1 " + status + "\r\nContent-Type: " + type +
+                               "\r\nContent-Length: " + std::to_string(body.size()) +
+                               "\r\nCache-Control: no-store\r\nConnection: close\r\n\r\n" + body;
+        queue(client, std::make_shared<std::vector<u8>>(response.begin(), response.end()));
+        client.closing = true;
+        return true;
+    };
+
+    if (method != "GET") {
+        return respond("405 Method Not Allowed", "text/plain", "GET only\n");
+    }
+
+    auto key = headers.find("sec-websocket-key");
+    if (path == "/ws" && key != headers.end()) {
+        std::string response = "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                               "Sec-WebSocket-Accept: " + webSocketAccept(key->second) + "\r\n\r\n";
+        queue(client, std::make_shared<std::vector<u8>>(response.begin(), response.end()));
+        client.webSocket = true;
+        client.latency = std::make_unique<LatencyHistogram>();
+        client.connected = std::chrono::steady_clock::now();
+        return true;
+    }
+
+    if (path == "/" || path == "/index.html") {
+        return respond("200 OK", "text/html; charset=utf-8", m_page);
+    }
+    return respond("404 Not Found", "text/plain", "Not found\n");
+}
+
+// Handle the complete client frames in the input buffer
+bool StreamServer::handleWebSocketFrames(Client& client) {
+    size_t offset = 0;
+    std::vector<u8> payload;
+    while (client.input.size() - offset >= 2) {
+        const u8* frame = client.input.data() + offset;
+        const size_t available = client.input.size() - offset;
+        const bool final = (frame[0] & 0x80) != 0;
+        const u8 opcode = frame[0] & 0x0F;
+        const bool masked = (frame[1] & 0x80) != 0;
+        size_t length = frame[1] & 0x7F;
+        size_t headerSize = 2;
+
+        if (length == 126) {
+            if (available < 4) break;
+            length = (frame[2] << 8) | frame[3];
+            headerSize = 4;
+        } else if (length == 127) {
+            // Nothing a client sends is that large
+            return false;
+        }
+
+        // Client frames are masked, and these are never fragmented
+        if (!masked || !final || opcode == 0 || length > MAX_CLIENT_MESSAGE) {
+            return false;
+        }
+        if (available < headerSize + 4 + length) {
+            break;
+        }
+
+        const u8* mask = frame + headerSize;
+        payload.resize(length);
+        for (size_t i = 0; i < length; i++) {
+            payload[i] = frame[headerSize + 4 + i] ^ mask[i & 3];
+        }
+        offset += headerSize + 4 + length;
+
+        switch (opcode) {
+            case WS_BINARY:
+                handleMessage(client, payload.data(), payload.size());
+                break;
+            case WS_PING:
+                queue(client, webSocketFrame(WS_PONG, payload.data(), payload.size()));
+                break;
+            case WS_CLOSE:
+                queue(client, webSocketFrame(WS_CLOSE, payload.data(), std::min<size_t>(payload.size(), 2)));
+                client.closing = true;
+                break;
+            case WS_TEXT:
+            case WS_PONG:
+            default:
+                break;
+        }
+    }
+
+    client.input.erase(client.input.begin(), client.input.begin() + offset);
+    return true;
+}
+
+// Acks and input events
+void StreamServer::handleMessage(Client& client, const u8* data, size_t size) {
+    if (size >= STREAM_ACK_SIZE && data[0] == STREAM_ACK) {
+        u64 sendMicros;
+        std::memcpy(&sendMicros, data + 8, sizeof(sendMicros));
+        const u64 now = nowMicros();
+        client.framesInFlight -= client.framesInFlight > 0 ? 1 : 0;
+        if (sendMicros <= now) {
+            client.latency->record(now - sendMicros);
+        }
+    } else if (size >= 2 && data[0] == STREAM_INPUT) {
+        m_buttons.store(data[1], std::memory_order_relaxed);
+        client.inputEvents++;
+    }
+}
+
+// Bandwidth and latency of one client
+void StreamServer::report(const Client& client) const {
+    const double seconds =
+        std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - client.connected).count(), 1e-9);
+    const u64 frames = client.keyFrames + client.deltaFrames;
+    const LatencyHistogram::Summary latency = client.latency->summarize();
+
+    std::ostringstream text;
+    text << std::fixed << std::setprecision(1) << "stream client " << client.peer << ": " << frames << " frames ("
+         << client.keyFrames << " key, " << client.deltaFrames << " delta, " << client.skippedFrames << " skipped) in "
+         << seconds << " s, " << client.bytesSent / 1024.0 << " KB sent, " << client.bytesSent / 1024.0 / seconds
+         << " KB/s, " << (frames > 0 ? static_cast<double>(client.bytesSent) / frames : 0.0) << " bytes/frame, "
+         << client.inputEvents << " input events, ack latency ms p50 " << latency.p50 / 1000.0 << " p99 "
+         << latency.p99 / 1000.0 << " max " << latency.max / 1000.0 << " (" << latency.count << " acks)\n";
+    std::cout << text.str() << std::flush;
+}
+
+#else
+
+// Sockets and epoll are POSIX only
+bool StreamServer::start(const std::string& address, u16 port, const std::string&) {
+    std::cerr << "Streaming is not supported on this platform: " << address << ":" << port << std::endl;
+    return false;
+}
+
+void StreamServer::stop() {
+}
+
+void StreamServer::submitFrame(u64, const u8*) {
+}
+
+#endif
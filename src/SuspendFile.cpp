@@ -0,0 +1,143 @@
+#include "SuspendFile.h"
+#include <cstdio>
+#include <cstring>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+// Checksum of the state block followed by the cartridge RAM
+static u64 payloadChecksum(const void* state, const u8* ram, size_t ramSize) {
+    return hashBytes(ram, ramSize, hashBytes(state, sizeof(MachineState)));
+}
+
+// Fill in the format fields and the payload checksum
+void finishSuspendHeader(SuspendHeader& header, const MachineState& state, const u8* ram, size_t ramSize) {
+    std::memcpy(header.magic, SUSPEND_MAGIC, sizeof(header.magic));
+    header.version = SUSPEND_VERSION;
+    header.stateSize = sizeof(MachineState);
+    header.ramSize = ramSize;
+    header.checksum = payloadChecksum(&state, ram, ramSize);
+    std::memset(header.reserved, 0, sizeof(header.reserved));
+}
+
+// Write a suspend file through a temporary file
+bool writeSuspendFile(const std::string& filename, SuspendHeader header, const MachineState& state,
+                      const std::vector<u8>& ram) {
+    finishSuspendHeader(header, state, ram.data(), ram.size());
+
+    const std::string temporary = filename + ".tmp";
+
+#ifndef _WIN32
+    int fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        std::cerr << "Failed to create suspend file: " << temporary << std::endl;
+        return false;
+    }
+
+    // Write everything, retrying short writes
+    auto writeAll = [fd](const void* data, size_t size) {
+        const u8* bytes = static_cast<const u8*>(data);
+        while (size > 0) {
+            ssize_t written = ::write(fd, bytes, size);
+            if (written <= 0) {
+                return false;
+            }
+            bytes += written;
+            size -= static_cast<size_t>(written);
+        }
+        return true;
+    };
+
+    bool ok = writeAll(&header, sizeof(header)) && writeAll(&state, sizeof(state)) &&
+              writeAll(ram.data(), ram.size()) && fsync(fd) == 0;
+    ok = ::close(fd) == 0 && ok;
+#else
+    bool ok;
+    {
+        std::ofstream file(temporary, std::ios::binary | std::ios::trunc);
+        file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        file.write(reinterpret_cast<const char*>(&state), sizeof(state));
+        file.write(reinterpret_cast<const char*>(ram.data()), ram.size());
+        file.flush();
+        ok = file.good();
+    }
+    std::remove(filename.c_str());
+#endif
+
+    if (!ok || std::rename(temporary.c_str(), filename.c_str()) != 0) {
+        std::cerr << "Failed to write suspend file: " << filename << std::endl;
+        std::remove(temporary.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+// Validate a suspend image against the loaded ROM
+bool validateSuspendImage(const u8* data, size_t size, u64 romHash, SuspendHeader& header,
+                          const MachineState*& state, const u8*& ram, size_t ramSize, std::string& error) {
+    if (size < sizeof(SuspendHeader)) {
+        error = "file too small";
+        return false;
+    }
+
+    std::memcpy(&header, data, sizeof(header));
+
+    if (std::memcmp(header.magic, SUSPEND_MAGIC, sizeof(header.magic)) != 0) {
+        error = "not a suspend file";
+        return false;
+    }
+
+    if (header.version != SUSPEND_VERSION) {
+        error = "unsupported format version " + std::to_string(header.version);
+        return false;
+    }
+
+    if (header.stateSize != sizeof(MachineState)) {
+        error = "state size " + std::to_string(header.stateSize) + ", expected " +
+                std::to_string(sizeof(MachineState));
+        return false;
+    }
+
+    if (header.romHash != romHash) {
+        error = "state belongs to a different ROM";
+        return false;
+    }
+
+    // ramSize is untrusted: compare it with what the image holds rather
+    // than adding it to anything
+    if (size - sizeof(SuspendHeader) < sizeof(MachineState) ||
+        header.ramSize != size - sizeof(SuspendHeader) - sizeof(MachineState)) {
+        error = "truncated file";
+        return false;
+    }
+
+    if (header.ramSize != ramSize) {
+        error = "cartridge RAM size mismatch";
+        return false;
+    }
+
+    // The state block is adopted in place
+    const u8* payload = data + sizeof(SuspendHeader);
+    if (reinterpret_cast<uintptr_t>(payload) % alignof(MachineState) != 0) {
+        error = "state block is not aligned";
+        return false;
+    }
+
+    if (payloadChecksum(payload, payload + sizeof(MachineState), header.ramSize) != header.checksum) {
+        error = "checksum mismatch (torn write)";
+        return false;
+    }
+
+    state = reinterpret_cast<const MachineState*>(payload);
+    ram = payload + sizeof(MachineState);
+    return true;
+}
+
+// Validate a mapped suspend file against the loaded ROM
+bool validateSuspendFile(const MappedFile& file, u64 romHash, SuspendHeader& header,
+                         const MachineState*& state, const u8*& ram, size_t ramSize, std::string& error) {
+    return validateSuspendImage(file.data(), file.size(), romHash, header, state, ram, ramSize, error);
+}
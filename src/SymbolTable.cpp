@@ -0,0 +1,97 @@
+#include "SymbolTable.h"
+#include <charconv>
+
+// Symbol lookup key
+static u32 symbolKey(u8 bank, u16 address) {
+    return (static_cast<u32>(bank) << 16) | address;
+}
+
+// Load a .sym file, replacing any previous symbols
+bool SymbolTable::load(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open symbol file: " << filename << std::endl;
+        return false;
+    }
+
+    m_symbols.clear();
+    m_names.clear();
+
+    std::string line;
+    size_t lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+
+        // Strip comments and surrounding whitespace
+        line = line.substr(0, line.find(';'));
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos) {
+            continue;
+        }
+        size_t last = line.find_last_not_of(" \t\r");
+        std::string_view text(line.data() + first, last - first + 1);
+
+        // "BB:AAAA Name"
+        size_t colon = text.find(':');
+        size_t space = text.find_first_of(" \t");
+        if (colon == std::string_view::npos || space == std::string_view::npos || colon > space) {
+            std::cerr << filename << ":" << lineNumber << ": malformed symbol" << std::endl;
+            continue;
+        }
+
+        unsigned bank = 0;
+        unsigned address = 0;
+        auto bankResult = std::from_chars(text.data(), text.data() + colon, bank, 16);
+        auto addressResult = std::from_chars(text.data() + colon + 1, text.data() + space, address, 16);
+        if (bankResult.ec != std::errc() || addressResult.ec != std::errc() || bank > 0xFF || address > 0xFFFF) {
+            std::cerr << filename << ":" << lineNumber << ": malformed symbol" << std::endl;
+            continue;
+        }
+
+        std::string_view name = text.substr(space);
+        name.remove_prefix(name.find_first_not_of(" \t"));
+
+        m_symbols.push_back({symbolKey(static_cast<u8>(bank), static_cast<u16>(address)),
+                             static_cast<u32>(m_names.size())});
+        m_names.append(name);
+        m_names.push_back('\0');
+    }
+
+    // Sort by address, keeping the first name given for duplicates
+    std::stable_sort(m_symbols.begin(), m_symbols.end(),
+                     [](const Symbol& a, const Symbol& b) { return a.key < b.key; });
+    m_symbols.erase(std::unique(m_symbols.begin(), m_symbols.end(),
+                                [](const Symbol& a, const Symbol& b) { return a.key == b.key; }),
+                    m_symbols.end());
+
+    return true;
+}
+
+// Add a symbol (keeps the first name for an address)
+void SymbolTable::add(u8 bank, u16 address, const std::string& name) {
+    u32 key = symbolKey(bank, address);
+    auto it = std::lower_bound(m_symbols.begin(), m_symbols.end(), key,
+                               [](const Symbol& symbol, u32 value) { return symbol.key < value; });
+    if (it != m_symbols.end() && it->key == key) {
+        return;
+    }
+
+    m_symbols.insert(it, {key, static_cast<u32>(m_names.size())});
+    m_names.append(name);
+    m_names.push_back('\0');
+}
+
+// Name at bank:address, falling back to bank 0 for flat ROMs; nullptr if none
+const char* SymbolTable::find(u8 bank, u16 address) const {
+    for (u32 key : {symbolKey(bank, address), symbolKey(0, address)}) {
+        auto it = std::lower_bound(m_symbols.begin(), m_symbols.end(), key,
+                                   [](const Symbol& symbol, u32 value) { return symbol.key < value; });
+        if (it != m_symbols.end() && it->key == key) {
+            return m_names.data() + it->nameOffset;
+        }
+        if (bank == 0) {
+            break;
+        }
+    }
+    return nullptr;
+}
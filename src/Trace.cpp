@@ -0,0 +1,155 @@
+#include "Trace.h"
+#include <cstdio>
+
+// TraceBuffer constructor
+TraceBuffer::TraceBuffer(size_t capacity, u32 threadId)
+    : events(capacity), written(0), threadId(threadId), threadName("thread " + std::to_string(threadId)) {
+}
+
+// Tracer constructor
+Tracer::Tracer() : m_enabled(false), m_epoch(std::chrono::steady_clock::now()) {
+    for (size_t i = 0; i < m_guestMarkerNames.size(); i++) {
+        m_guestMarkerNames[i] = "guest " + std::to_string(i);
+    }
+}
+
+// Nanoseconds since the trace epoch
+u64 Tracer::now() const {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_epoch).count();
+}
+
+// Buffer of the calling thread, allocated on its first event
+TraceBuffer& Tracer::threadBuffer() {
+    thread_local TraceBuffer* buffer = nullptr;
+    if (!buffer) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_buffers.push_back(std::make_unique<TraceBuffer>(BUFFER_CAPACITY, static_cast<u32>(m_buffers.size() + 1)));
+        buffer = m_buffers.back().get();
+    }
+    return *buffer;
+}
+
+// Name the calling thread in exported traces
+void Tracer::setThreadName(const std::string& name) {
+    TraceBuffer& buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(m_mutex);
+    buffer.threadName = name;
+}
+
+// Name a guest marker id
+void Tracer::setGuestMarkerName(u8 id, const std::string& name) {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_guestMarkerNames[id] = name;
+}
+
+// Append an event to the calling thread's ring
+void Tracer::record(const TraceEvent& event) {
+    TraceBuffer& buffer = threadBuffer();
+    u64 index = buffer.written.load(std::memory_order_relaxed);
+    buffer.events[index % buffer.events.size()] = event;
+    buffer.written.store(index + 1, std::memory_order_release);
+}
+
+// Record a complete event
+void Tracer::complete(const char* name, u64 start, u64 end) {
+    record({name, start, end - start, 0, 'X'});
+}
+
+// Record an instant event
+void Tracer::instant(const char* name) {
+    record({name, now(), 0, 0, 'i'});
+}
+
+// Record a guest marker written through the debug ports
+void Tracer::guestMarker(u8 id, bool begin) {
+    record({nullptr, now(), 0, id, begin ? 'B' : 'E'});
+}
+
+// Drop all recorded events
+void Tracer::clear() {
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto& buffer : m_buffers) {
+        buffer->written.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Export all buffers to a file
+bool Tracer::exportChromeJson(const std::string& filename) const {
+    std::ofstream file(filename, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open trace file: " << filename << std::endl;
+        return false;
+    }
+
+    writeChromeJson(file);
+    return true;
+}
+
+// Write all buffers as Chrome trace-event JSON
+void Tracer::writeChromeJson(std::ostream& out) const {
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // Escape names for JSON strings
+    auto writeString = [&out](const std::string& value) {
+        out << '"';
+        for (char c : value) {
+            if (c == '"' || c == '\\') {
+                out << '\\' << c;
+            } else if (static_cast<unsigned char>(c) < 0x20) {
+                char escaped[8];
+                std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+                out << escaped;
+            } else {
+                out << c;
+            }
+        }
+        out << '"';
+    };
+
+    // Timestamps are in microseconds with nanosecond fractions
+    auto writeMicros = [&out](u64 nanos) {
+        char text[32];
+        std::snprintf(text, sizeof(text), "%llu.%03llu",
+            static_cast<unsigned long long>(nanos / 1000), static_cast<unsigned long long>(nanos % 1000));
+        out << text;
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+    bool first = true;
+
+    for (const auto& buffer : m_buffers) {
+        // Thread name metadata
+        if (!first) {
+            out << ",\n";
+        }
+        first = false;
+        out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"args\":{\"name\":";
+        writeString(buffer->threadName);
+        out << "}}";
+
+        // Oldest surviving event to newest
+        u64 written = buffer->written.load(std::memory_order_acquire);
+        u64 capacity = buffer->events.size();
+        u64 begin = written > capacity ? written - capacity : 0;
+
+        for (u64 i = begin; i < written; i++) {
+            const TraceEvent& event = buffer->events[i % capacity];
+
+            out << ",\n{\"name\":";
+            writeString(event.name ? std::string(event.name) : m_guestMarkerNames[event.guestId]);
+            out << ",\"cat\":\"" << (event.name ? "emulator" : "guest") << "\",\"ph\":\"" << event.phase
+                << "\",\"pid\":1,\"tid\":" << buffer->threadId << ",\"ts\":";
+            writeMicros(event.timestamp);
+
+            if (event.phase == 'X') {
+                out << ",\"dur\":";
+                writeMicros(event.duration);
+            } else if (event.phase == 'i') {
+                out << ",\"s\":\"t\"";
+            }
+            out << "}";
+        }
+    }
+
+    out << "\n]}\n";
+}
@@ -0,0 +1,125 @@
+#include "TraceDecoder.h"
+#include <cstring>
+#include <thread>
+
+// Load a trace file written by ExecutionTraceWriter
+bool TraceDecoder::load(const std::string& filename) {
+    m_entries.clear();
+    m_error.clear();
+
+    std::ifstream file(filename, std::ios::binary | std::ios::ate);
+    if (!file.is_open()) {
+        m_error = "cannot open " + filename;
+        return false;
+    }
+
+    std::streamsize size = file.tellg();
+    file.seekg(0, std::ios::beg);
+
+    ExecutionTraceHeader header;
+    if (size < static_cast<std::streamsize>(sizeof(header)) ||
+        !file.read(reinterpret_cast<char*>(&header), sizeof(header)) ||
+        std::memcmp(header.magic, EXECUTION_TRACE_MAGIC, sizeof(header.magic)) != 0) {
+        m_error = filename + " is not an execution trace";
+        return false;
+    }
+
+    if (header.version != EXECUTION_TRACE_VERSION || header.entrySize != sizeof(ExecutionTraceEntry)) {
+        m_error = filename + ": unsupported trace version " + std::to_string(header.version);
+        return false;
+    }
+
+    // A truncated last entry (interrupted writer) is dropped
+    size_t count = static_cast<size_t>(size - sizeof(header)) / sizeof(ExecutionTraceEntry);
+    m_entries.resize(count);
+    if (!file.read(reinterpret_cast<char*>(m_entries.data()), count * sizeof(ExecutionTraceEntry))) {
+        m_error = "failed to read " + filename;
+        m_entries.clear();
+        return false;
+    }
+
+    return true;
+}
+
+// Format one entry (with its label line, if any)
+size_t TraceDecoder::formatEntry(const ExecutionTraceEntry& entry, char* out, size_t outSize) const {
+    TextWriter writer(out, outSize);
+    const u8 romBank = entry.romBank;
+
+    // Label line
+    if (const char* label = m_disassembler.findSymbol(entry.pc, romBank)) {
+        writer.put(label);
+        writer.put(":\n");
+    }
+    const size_t lineStart = writer.length();
+
+    // Location
+    writer.hex(entry.pc >= 0x4000 && entry.pc < 0x8000 ? romBank : 0, 2);
+    writer.put(':');
+    writer.hex(entry.pc, 4);
+    writer.put("  ");
+
+    // Instruction bytes
+    const u8 length = std::min<u8>(Disassembler::getInfo(entry.bytes).length, 3);
+    for (u8 i = 0; i < length; i++) {
+        writer.hex(entry.bytes[i], 2);
+        writer.put(' ');
+    }
+    writer.padTo(lineStart + 19);
+
+    // Instruction text
+    char text[64];
+    m_disassembler.decode(entry.bytes, entry.pc, romBank, text, sizeof(text));
+    writer.put(text);
+    writer.padTo(lineStart + 40);
+
+    // Registers
+    static constexpr const char* NAMES[] = {"AF=", " BC=", " DE=", " HL=", " SP="};
+    const u16 values[] = {entry.af, entry.bc, entry.de, entry.hl, entry.sp};
+    for (size_t i = 0; i < 5; i++) {
+        writer.put(NAMES[i]);
+        writer.hex(values[i], 4);
+    }
+    writer.put('\n');
+
+    return writer.finish();
+}
+
+// Format a contiguous range of entries
+void TraceDecoder::decodeChunk(size_t first, size_t count, std::string& text) const {
+    text.clear();
+    text.reserve(count * 80);
+
+    char line[MAX_LINE_LENGTH + 256];
+    for (size_t i = first; i < first + count; i++) {
+        size_t length = formatEntry(m_entries[i], line, sizeof(line));
+        text.append(line, length);
+    }
+}
+
+// Decode all entries, formatting chunks in parallel and writing them in order
+void TraceDecoder::decode(std::ostream& out, unsigned threads) const {
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+
+    std::vector<std::string> chunks(threads);
+    size_t next = 0;
+    while (next < m_entries.size()) {
+        // One chunk per worker per batch
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < threads && next < m_entries.size(); i++) {
+            size_t count = std::min(CHUNK_ENTRIES, m_entries.size() - next);
+            workers.emplace_back(&TraceDecoder::decodeChunk, this, next, count, std::ref(chunks[i]));
+            next += count;
+        }
+
+        for (auto& worker : workers) {
+            worker.join();
+        }
+
+        for (size_t i = 0; i < workers.size(); i++) {
+            out.write(chunks[i].data(), static_cast<std::streamsize>(chunks[i].size()));
+        }
+    }
+}
@@ -0,0 +1,204 @@
+#include "gbcore.h"
+#include "GameBoy.h"
+#include "Observation.h"
+#include <new>
+
+// A machine and the settings it loads ROMs with
+struct gb_machine {
+    GameBoy gameBoy;
+    std::string opcodesFile;
+};
+
+// An observation pipeline
+struct gb_observer {
+    explicit gb_observer(const ObservationConfig& config) : pipeline(config) {}
+    ObservationPipeline pipeline;
+};
+
+static_assert(GB_SCREEN_WIDTH == SCREEN_WIDTH && GB_SCREEN_HEIGHT == SCREEN_HEIGHT, "Screen size mismatch");
+static_assert(GB_CYCLES_PER_FRAME == CYCLES_PER_FRAME, "Frame length mismatch");
+static_assert(GB_BUTTON_RIGHT == static_cast<int>(JOYPAD_RIGHT) && GB_BUTTON_START == static_cast<int>(JOYPAD_START),
+              "Button mask mismatch");
+
+// ABI version of this build
+uint32_t gb_abi_version(void) {
+    return GB_ABI_VERSION;
+}
+
+// Create a machine
+gb_machine* gb_create(const char* opcodes_file, int fast_boot) {
+    gb_machine* machine = new (std::nothrow) gb_machine;
+    if (!machine) {
+        return nullptr;
+    }
+    machine->opcodesFile = opcodes_file ? opcodes_file : GameBoy::DEFAULT_OPCODES_FILE;
+    machine->gameBoy.setFastBoot(fast_boot != 0);
+    return machine;
+}
+
+// Destroy a machine (NULL is ignored)
+void gb_destroy(gb_machine* machine) {
+    delete machine;
+}
+
+// Load a ROM file
+gb_result gb_load_rom_file(gb_machine* machine, const char* path) {
+    if (!machine || !path) {
+        return GB_ERROR_ARGUMENT;
+    }
+    return machine->gameBoy.loadROM(path, machine->opcodesFile) ? GB_OK : GB_ERROR_ROM;
+}
+
+// Load a ROM image from memory
+gb_result gb_load_rom_memory(gb_machine* machine, const void* data, size_t size) {
+    if (!machine || !data) {
+        return GB_ERROR_ARGUMENT;
+    }
+    return machine->gameBoy.loadROM(static_cast<const u8*>(data), size, machine->opcodesFile) ? GB_OK : GB_ERROR_ROM;
+}
+
+// Reset the machine
+void gb_reset(gb_machine* machine) {
+    if (machine) {
+        machine->gameBoy.reset();
+    }
+}
+
+// Buttons held down
+void gb_set_input(gb_machine* machine, uint8_t buttons) {
+    if (machine) {
+        machine->gameBoy.setJoypad(buttons);
+    }
+}
+
+// Run whole frames
+void gb_run_frames(gb_machine* machine, uint32_t frames) {
+    if (!machine || !machine->gameBoy.getMemory().getCartridge()) {
+        return;
+    }
+    for (uint32_t i = 0; i < frames; i++) {
+        machine->gameBoy.emulateFrame();
+    }
+}
+
+// Run at least a number of cycles
+uint32_t gb_run_cycles(gb_machine* machine, uint32_t cycles) {
+    if (!machine || !machine->gameBoy.getMemory().getCartridge()) {
+        return 0;
+    }
+    return machine->gameBoy.runCycles(cycles);
+}
+
+// Frames run since the machine was created
+uint64_t gb_frame_count(const gb_machine* machine) {
+    return machine ? machine->gameBoy.getFrameCount() : 0;
+}
+
+// State buffer size for the loaded ROM
+size_t gb_state_size(const gb_machine* machine) {
+    return machine ? machine->gameBoy.getStateSize() : 0;
+}
+
+// Save the machine state into a caller buffer
+gb_result gb_save_state(const gb_machine* machine, void* buffer, size_t size) {
+    if (!machine || !buffer) {
+        return GB_ERROR_ARGUMENT;
+    }
+    if (machine->gameBoy.getStateSize() == 0) {
+        return GB_ERROR_NO_ROM;
+    }
+    return machine->gameBoy.saveState(static_cast<u8*>(buffer), size) ? GB_OK : GB_ERROR_BUFFER;
+}
+
+// Load the machine state from a caller buffer
+gb_result gb_load_state(gb_machine* machine, const void* buffer, size_t size) {
+    if (!machine || !buffer) {
+        return GB_ERROR_ARGUMENT;
+    }
+    if (machine->gameBoy.getStateSize() == 0) {
+        return GB_ERROR_NO_ROM;
+    }
+    return machine->gameBoy.loadState(static_cast<const u8*>(buffer), size) ? GB_OK : GB_ERROR_STATE;
+}
+
+// Shades of the last rendered screen
+const uint8_t* gb_framebuffer(const gb_machine* machine) {
+    return machine ? machine->gameBoy.getPPU().getScreenBuffer().data() : nullptr;
+}
+
+// View of a memory region
+uint8_t* gb_memory(gb_machine* machine, gb_region region, size_t* size) {
+    u8* data = nullptr;
+    size_t length = 0;
+    if (machine) {
+        Memory& memory = machine->gameBoy.getMemory();
+        switch (region) {
+            case GB_REGION_VRAM: data = memory.getVRAM(); length = VRAM_SIZE; break;
+            case GB_REGION_WRAM: data = memory.getWRAM(); length = WRAM_SIZE; break;
+            case GB_REGION_OAM: data = memory.getOAM(); length = OAM_SIZE; break;
+            case GB_REGION_IO: data = memory.getIO(); length = IO_SIZE; break;
+            case GB_REGION_HRAM: data = memory.getHRAM(); length = HRAM_SIZE; break;
+        }
+    }
+    if (size) {
+        *size = length;
+    }
+    return data;
+}
+
+// Create an observation pipeline
+gb_observer* gb_observer_create(const gb_observation_config* config) {
+    if (!config || config->crop_x >= SCREEN_WIDTH || config->crop_y >= SCREEN_HEIGHT) {
+        return nullptr;
+    }
+
+    ObservationConfig observation;
+    observation.cropX = config->crop_x;
+    observation.cropY = config->crop_y;
+    observation.cropWidth = config->crop_width ? config->crop_width : static_cast<u16>(SCREEN_WIDTH - config->crop_x);
+    observation.cropHeight = config->crop_height ? config->crop_height : static_cast<u16>(SCREEN_HEIGHT - config->crop_y);
+    observation.width = config->width;
+    observation.height = config->height;
+    observation.stack = config->stack;
+    observation.maxPool = config->max_pool != 0;
+
+    gb_observer* observer = new (std::nothrow) gb_observer(observation);
+    if (observer && !observer->pipeline.isValid()) {
+        delete observer;
+        return nullptr;
+    }
+    return observer;
+}
+
+// Destroy an observation pipeline (NULL is ignored)
+void gb_observer_destroy(gb_observer* observer) {
+    delete observer;
+}
+
+// Observation size in bytes
+size_t gb_observation_size(const gb_observer* observer) {
+    return observer ? observer->pipeline.getObservationSize() : 0;
+}
+
+// Start a new stack
+void gb_observer_reset(gb_observer* observer) {
+    if (observer) {
+        observer->pipeline.reset();
+    }
+}
+
+// Remember the current frame for max-pooling
+void gb_observer_capture(gb_observer* observer, const gb_machine* machine) {
+    if (observer && machine) {
+        observer->pipeline.capture(machine->gameBoy.getPPU().getScreenBuffer().data());
+    }
+}
+
+// Observe the current frame
+gb_result gb_observe(gb_observer* observer, const gb_machine* machine, uint8_t* out) {
+    if (!observer || !machine || !out) {
+        return GB_ERROR_ARGUMENT;
+    }
+    observer->pipeline.observe(machine->gameBoy.getPPU().getScreenBuffer().data(), out);
+    return GB_OK;
+}
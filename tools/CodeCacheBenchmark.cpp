@@ -0,0 +1,205 @@
+#include "GameBoy.h"
+#include <filesystem>
+#include <iomanip>
+
+namespace fs = std::filesystem;
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    std::string cacheFile = (fs::temp_directory_path() / "GameBoyCodeBench.cache").string();
+    u64 frames = 3000;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>       Frames per run (default 3000)\n"
+              << "  --cache <file>     Code cache written and read back (default in the temp directory)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--cache" && hasValue) {
+            options.cacheFile = argv[++i];
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.frames > 0;
+}
+
+// VBlank handler at 0x40: flag the frame at C000
+constexpr u8 VBLANK_HANDLER[] = {
+    0xF5,                   // push af
+    0x3E, 0x01,             // ld a,1
+    0xEA, 0x00, 0xC0,       // ld (C000),a
+    0xF1,                   // pop af
+    0xD9,                   // reti
+};
+
+// Start at 0x150: LCD and the VBlank interrupt on, then into bank 1
+// through JP HL, which the static walk cannot follow
+constexpr u8 START_PROGRAM[] = {
+    0xF3,                   // di
+    0x31, 0xFE, 0xFF,       // ld sp,FFFE
+    0x3E, 0x01,             // ld a,01
+    0xE0, 0xFF,             // ldh (IE),a
+    0x3E, 0x91,             // ld a,91
+    0xE0, 0x40,             // ldh (LCDC),a
+    0xFB,                   // ei
+    0x21, 0x00, 0x40,       // ld hl,4000
+    0xE9,                   // jp hl
+};
+
+// Frame loop at 0x4000: wait for the VBlank flag, count the frame, spin a
+// while, then wait for line 16 by polling LY
+constexpr u8 FRAME_PROGRAM[] = {
+    0xAF,                   // loop: xor a
+    0xEA, 0x00, 0xC0,       // ld (C000),a
+    0xFA, 0x00, 0xC0,       // wait: ld a,(C000)
+    0xA7,                   // and a
+    0x28, 0xFA,             // jr z,wait
+    0x21, 0x01, 0xC0,       // ld hl,C001
+    0x34,                   // inc (hl)
+    0x06, 0xC8,             // ld b,200
+    0x05,                   // spin: dec b
+    0x20, 0xFD,             // jr nz,spin
+    0xF0, 0x44,             // line: ldh a,(LY)
+    0xFE, 0x10,             // cp 16
+    0x20, 0xFA,             // jr nz,line
+    0x18, 0xE5,             // jr loop
+};
+
+// 32 KB ROM-only image running the frame loop
+static std::vector<u8> buildROM() {
+    std::vector<u8> rom(0x8000, 0x00);
+    const u8 entry[] = {0x00, 0xC3, 0x50, 0x01};    // nop; jp 0150
+    std::copy(entry, entry + sizeof(entry), rom.begin() + 0x100);
+    const char title[] = "IDLEBENCH";
+    std::copy(title, title + sizeof(title) - 1, rom.begin() + 0x134);
+    std::copy(VBLANK_HANDLER, VBLANK_HANDLER + sizeof(VBLANK_HANDLER), rom.begin() + 0x40);
+    std::copy(START_PROGRAM, START_PROGRAM + sizeof(START_PROGRAM), rom.begin() + 0x150);
+    std::copy(FRAME_PROGRAM, FRAME_PROGRAM + sizeof(FRAME_PROGRAM), rom.begin() + 0x4000);
+
+    u8 checksum = 0;
+    for (size_t i = 0x134; i < 0x14D; i++) {
+        checksum = static_cast<u8>(checksum - rom[i] - 1);
+    }
+    rom[0x14D] = checksum;
+    return rom;
+}
+
+// How a run gets its code analysis
+enum class Analysis { NONE, COLD, WARM };
+
+// One machine's run
+struct Run {
+    double analysisSeconds = 0.0;
+    double seconds = 0.0;
+    u64 instructions = 0;
+    u64 idleIterations = 0;
+    CodeAnalysis::Stats stats;
+    std::vector<u8> state;
+};
+
+// Run frames; a cold run walks the ROM and saves the cache a warm run loads
+static bool runMachine(const std::vector<u8>& rom, const Options& options, bool fastBoot, Analysis analysis,
+                       Run& run) {
+    auto gameBoy = std::make_unique<GameBoy>();
+    gameBoy->setFastBoot(fastBoot);
+    if (!gameBoy->loadROM(rom.data(), rom.size(), options.opcodesFile)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    if (analysis != Analysis::NONE) {
+        gameBoy->analyzeCode(analysis == Analysis::WARM ? options.cacheFile : "");
+        if ((analysis == Analysis::WARM) != gameBoy->getCodeAnalysis()->isFromCache()) {
+            return false;
+        }
+    }
+    run.analysisSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (u64 frame = 0; frame < options.frames; frame++) {
+        gameBoy->emulateFrame();
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    run.instructions = gameBoy->getCPU().getCounters().instructions;
+    run.idleIterations = gameBoy->getCPU().getCounters().idleIterations;
+    if (analysis != Analysis::NONE) {
+        run.stats = gameBoy->getCodeAnalysis()->getStats();
+    }
+    if (analysis == Analysis::COLD && !gameBoy->saveCodeCache(options.cacheFile)) {
+        return false;
+    }
+    run.state.resize(gameBoy->getStateSize());
+    return gameBoy->saveState(run.state.data(), run.state.size()) != 0;
+}
+
+// Compare a ROM without analysis, analysed cold and loaded from the cache;
+// false if the machines differ
+static bool compare(const char* name, const std::vector<u8>& rom, const Options& options, bool fastBoot) {
+    Run plain, cold, warm;
+    if (!runMachine(rom, options, fastBoot, Analysis::NONE, plain) ||
+        !runMachine(rom, options, fastBoot, Analysis::COLD, cold) ||
+        !runMachine(rom, options, fastBoot, Analysis::WARM, warm)) {
+        std::cerr << name << ": failed to run" << std::endl;
+        return false;
+    }
+
+    const bool same = plain.instructions == cold.instructions && plain.instructions == warm.instructions &&
+                      plain.state == cold.state && plain.state == warm.state;
+    auto report = [&options, &plain](const char* label, const Run& run) {
+        std::cout << label << std::setprecision(3) << run.analysisSeconds * 1e3 << " ms analysis, "
+                  << std::setprecision(1) << options.frames / run.seconds << " frames/s ("
+                  << std::setprecision(2) << plain.seconds / run.seconds << "x), " << run.idleIterations
+                  << " idle passes skipped\n";
+    };
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << name << ": " << options.frames << " frames, " << plain.instructions << " instructions\n";
+    std::cout << "  code: " << warm.stats.blocks << " blocks, " << warm.stats.instructions << " instructions, "
+              << warm.stats.idleLoops << " idle loops, " << cold.stats.entryPoints << " entry points found while running\n";
+    std::cout << "  no analysis: " << options.frames / plain.seconds << " frames/s\n";
+    report("  cold:        ", cold);
+    report("  warm:        ", warm);
+    std::cout << "  state: " << (same ? "identical" : "DIFFERENT") << std::endl;
+    return same;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(options.romPath, std::ios::binary);
+    const std::vector<u8> userROM((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (userROM.empty()) {
+        std::cerr << "Failed to read " << options.romPath << std::endl;
+        return 1;
+    }
+
+    // The user ROM from the boot ROM; the built-in one has no logo for it
+    bool ok = compare(options.romPath.c_str(), userROM, options, false);
+    ok = compare("idle loops", buildROM(), options, true) && ok;
+    std::remove(options.cacheFile.c_str());
+    return ok ? 0 : 1;
+}
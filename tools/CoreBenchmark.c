@@ -0,0 +1,199 @@
+/*
+ * Steps many machines through the libgbcore C ABI, one frame per call, and
+ * measures the cost of the calls themselves. Also checks that the views stay
+ * put while stepping and that a saved state replays deterministically.
+ */
+#include "gbcore.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* Frames replayed by the state check */
+#define REPLAY_FRAMES 10
+
+/* Seconds on a monotonic-enough clock */
+static double now(void) {
+    struct timespec ts;
+    timespec_get(&ts, TIME_UTC);
+    return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+/* Read a whole file */
+static unsigned char* readFile(const char* path, size_t* size) {
+    FILE* file = fopen(path, "rb");
+    unsigned char* data = NULL;
+    long length;
+    if (!file) {
+        return NULL;
+    }
+    if (fseek(file, 0, SEEK_END) == 0 && (length = ftell(file)) > 0 && fseek(file, 0, SEEK_SET) == 0) {
+        data = (unsigned char*)malloc((size_t)length);
+        if (data && fread(data, 1, (size_t)length, file) != (size_t)length) {
+            free(data);
+            data = NULL;
+        }
+        *size = (size_t)length;
+    }
+    fclose(file);
+    return data;
+}
+
+/* FNV-1a over a memory view */
+static uint64_t hashView(const uint8_t* data, size_t size) {
+    uint64_t hash = 14695981039346656037ULL;
+    size_t i;
+    for (i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+/* Save, run, restore and run again; both runs must end in the same state */
+static int checkReplay(gb_machine* machine) {
+    size_t size = gb_state_size(machine);
+    size_t wramSize = 0;
+    const uint8_t* wram = gb_memory(machine, GB_REGION_WRAM, &wramSize);
+    void* state = malloc(size);
+    uint64_t first, second, frame;
+    int ok;
+
+    if (!state || gb_save_state(machine, state, size) != GB_OK) {
+        free(state);
+        return 0;
+    }
+    gb_run_frames(machine, REPLAY_FRAMES);
+    first = hashView(wram, wramSize) ^ hashView(gb_framebuffer(machine), GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT);
+    frame = gb_frame_count(machine);
+
+    ok = gb_load_state(machine, state, size) == GB_OK;
+    gb_run_frames(machine, REPLAY_FRAMES);
+    second = hashView(wram, wramSize) ^ hashView(gb_framebuffer(machine), GB_SCREEN_WIDTH * GB_SCREEN_HEIGHT);
+
+    free(state);
+    return ok && first == second && gb_frame_count(machine) == frame + REPLAY_FRAMES;
+}
+
+int main(int argc, char** argv) {
+    const char* romPath = NULL;
+    const char* opcodesFile = NULL;
+    unsigned machineCount = 1000;
+    unsigned frames = 1000;
+    gb_machine** machines;
+    const uint8_t** framebuffers;
+    const uint8_t** wrams;
+    unsigned char* rom;
+    size_t romSize = 0;
+    unsigned i, frame;
+    unsigned long long calls;
+    double start, createSeconds, stepSeconds, callSeconds;
+    int moved = 0;
+    int status = 0;
+
+    for (i = 1; i < (unsigned)argc; i++) {
+        if (strcmp(argv[i], "--machines") == 0 && i + 1 < (unsigned)argc) {
+            machineCount = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < (unsigned)argc) {
+            frames = (unsigned)strtoul(argv[++i], NULL, 10);
+        } else if (strcmp(argv[i], "--opcodes") == 0 && i + 1 < (unsigned)argc) {
+            opcodesFile = argv[++i];
+        } else if (argv[i][0] != '-' && !romPath) {
+            romPath = argv[i];
+        } else {
+            romPath = NULL;
+            break;
+        }
+    }
+
+    if (!romPath || machineCount == 0 || frames == 0) {
+        fprintf(stderr, "Usage: %s <rom> [--machines <n>] [--frames <n>] [--opcodes <file>]\n"
+                        "  Steps <n> machines (default 1000) one frame per call for <n> frames (default 1000)\n",
+                argv[0]);
+        return 1;
+    }
+
+    if (gb_abi_version() != GB_ABI_VERSION) {
+        fprintf(stderr, "libgbcore ABI %u, built against %u\n", gb_abi_version(), GB_ABI_VERSION);
+        return 1;
+    }
+
+    rom = readFile(romPath, &romSize);
+    if (!rom) {
+        fprintf(stderr, "Cannot read %s\n", romPath);
+        return 1;
+    }
+
+    machines = (gb_machine**)calloc(machineCount, sizeof(*machines));
+    framebuffers = (const uint8_t**)calloc(machineCount, sizeof(*framebuffers));
+    wrams = (const uint8_t**)calloc(machineCount, sizeof(*wrams));
+    if (!machines || !framebuffers || !wrams) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    /* Every machine loads the same image from memory */
+    start = now();
+    for (i = 0; i < machineCount; i++) {
+        machines[i] = gb_create(opcodesFile, 1);
+        if (!machines[i] || gb_load_rom_memory(machines[i], rom, romSize) != GB_OK) {
+            fprintf(stderr, "Cannot create machine %u\n", i);
+            return 1;
+        }
+        framebuffers[i] = gb_framebuffer(machines[i]);
+        wrams[i] = gb_memory(machines[i], GB_REGION_WRAM, NULL);
+    }
+    createSeconds = now() - start;
+
+    /* Round-robin, one frame per call, like an environment stepping a batch */
+    start = now();
+    for (frame = 0; frame < frames; frame++) {
+        for (i = 0; i < machineCount; i++) {
+            gb_set_input(machines[i], (uint8_t)(frame & 0x80 ? GB_BUTTON_A : 0));
+            gb_run_frames(machines[i], 1);
+        }
+    }
+    stepSeconds = now() - start;
+
+    for (i = 0; i < machineCount; i++) {
+        moved |= gb_framebuffer(machines[i]) != framebuffers[i] || gb_memory(machines[i], GB_REGION_WRAM, NULL) != wrams[i];
+    }
+
+    /* The same number of calls that run nothing: what the ABI itself costs */
+    calls = (unsigned long long)machineCount * frames;
+    start = now();
+    for (frame = 0; frame < frames; frame++) {
+        for (i = 0; i < machineCount; i++) {
+            gb_run_cycles(machines[i], 0);
+        }
+    }
+    callSeconds = now() - start;
+
+    printf("machines:     %u, %u frames each\n", machineCount, frames);
+    printf("create:       %.3f s (%.1f us per machine)\n", createSeconds, createSeconds * 1e6 / machineCount);
+    printf("step:         %.3f s, %.0f frames/s (%.1fx real time per core)\n", stepSeconds,
+           (double)calls / stepSeconds, (double)calls / stepSeconds / (4194304.0 / GB_CYCLES_PER_FRAME));
+    printf("call:         %.1f ns per empty call\n", callSeconds * 1e9 / (double)calls);
+    printf("state:        %zu bytes\n", gb_state_size(machines[0]));
+
+    if (moved) {
+        printf("views:        MOVED while stepping\n");
+        status = 1;
+    } else {
+        printf("views:        stable\n");
+    }
+    if (checkReplay(machines[0])) {
+        printf("replay:       deterministic\n");
+    } else {
+        printf("replay:       MISMATCH after loading state\n");
+        status = 1;
+    }
+
+    for (i = 0; i < machineCount; i++) {
+        gb_destroy(machines[i]);
+    }
+    free(machines);
+    free(framebuffers);
+    free(wrams);
+    free(rom);
+    return status;
+}
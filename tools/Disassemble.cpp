@@ -0,0 +1,148 @@
+#include "Disassembler.h"
+#include "SymbolTable.h"
+#include "TraceDecoder.h"
+#include <cstring>
+
+// Command line options
+struct Options {
+    std::string input;
+    std::string symbolFile;
+    std::string outputFile;
+    bool trace = false;
+    unsigned threads = 0;
+    u32 start = 0x0100;
+    u32 count = 64;
+    u8 bank = 1;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "       " << program << " --trace <trace> [options]\n"
+              << "  --sym <file>       Substitute symbols from a .sym file\n"
+              << "  --output <file>    Write to a file instead of stdout\n"
+              << "ROM options:\n"
+              << "  --start <addr>     First address in hex (default 0100)\n"
+              << "  --count <n>        Instructions to disassemble (default 64)\n"
+              << "  --bank <n>         ROM bank mapped at 4000-7FFF (default 1)\n"
+              << "Trace options:\n"
+              << "  --threads <n>      Decoder threads (default: hardware threads)\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--trace" && hasValue) {
+            options.trace = true;
+            options.input = argv[++i];
+        } else if (arg == "--sym" && hasValue) {
+            options.symbolFile = argv[++i];
+        } else if (arg == "--output" && hasValue) {
+            options.outputFile = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--start" && hasValue) {
+            options.start = static_cast<u32>(std::stoul(argv[++i], nullptr, 16));
+        } else if (arg == "--count" && hasValue) {
+            options.count = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--bank" && hasValue) {
+            options.bank = static_cast<u8>(std::stoul(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-' && options.input.empty()) {
+            options.input = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.input.empty() && options.start <= 0xFFFF;
+}
+
+// Linear disassembly of a ROM image
+static bool disassembleROM(const Options& options, const Disassembler& disassembler, std::ostream& out) {
+    std::ifstream file(options.input, std::ios::binary);
+    if (!file.is_open()) {
+        std::cerr << "Failed to open ROM: " << options.input << std::endl;
+        return false;
+    }
+    std::vector<u8> rom((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+    // Bytes as the CPU sees them with the selected bank mapped
+    auto romByte = [&](u32 address) -> u8 {
+        size_t offset = address < 0x4000 ? address : options.bank * ROM_BANK_SIZE + (address - 0x4000);
+        return address < 0x8000 && offset < rom.size() ? rom[offset] : 0xFF;
+    };
+
+    u32 address = options.start;
+    char text[128];
+    char line[192];
+    for (u32 i = 0; i < options.count && address < 0x8000; i++) {
+        const u8 bytes[3] = {romByte(address), romByte(address + 1), romByte(address + 2)};
+        const u16 pc = static_cast<u16>(address);
+
+        if (const char* label = disassembler.findSymbol(pc, options.bank)) {
+            out << label << ":\n";
+        }
+
+        disassembler.decode(bytes, pc, options.bank, text, sizeof(text));
+
+        TextWriter writer(line, sizeof(line));
+        writer.hex(address >= 0x4000 ? options.bank : 0, 2);
+        writer.put(':');
+        writer.hex(pc, 4);
+        writer.put("  ");
+        writer.put(text);
+        writer.put('\n');
+        out.write(line, static_cast<std::streamsize>(writer.finish()));
+
+        address += Disassembler::getInfo(bytes).length;
+    }
+
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    SymbolTable symbols;
+    if (!options.symbolFile.empty() && !symbols.load(options.symbolFile)) {
+        return 1;
+    }
+    Disassembler disassembler(symbols.empty() ? nullptr : &symbols);
+
+    std::ofstream outputFile;
+    if (!options.outputFile.empty()) {
+        outputFile.open(options.outputFile, std::ios::binary | std::ios::trunc);
+        if (!outputFile.is_open()) {
+            std::cerr << "Failed to create " << options.outputFile << std::endl;
+            return 1;
+        }
+    }
+    std::ostream& out = outputFile.is_open() ? outputFile : std::cout;
+
+    if (!options.trace) {
+        return disassembleROM(options, disassembler, out) ? 0 : 1;
+    }
+
+    TraceDecoder decoder(disassembler);
+    if (!decoder.load(options.input)) {
+        std::cerr << decoder.getError() << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    decoder.decode(out, options.threads);
+    out.flush();
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t entries = decoder.getEntries().size();
+    std::cerr << "decoded " << entries << " entries in " << elapsed << " s ("
+              << (elapsed > 0 ? entries / elapsed / 1e6 : 0.0) << " M entries/s)" << std::endl;
+    return 0;
+}
@@ -0,0 +1,146 @@
+#include "GameBoy.h"
+#include <iomanip>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    u32 instances = 256;
+    u64 frames = 60;
+    size_t budget = 64 * 1024;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --instances <n>    Machines to create (default 256)\n"
+              << "  --frames <n>       Frames each machine runs before measuring (default 60)\n"
+              << "  --budget <bytes>   Resident bytes allowed per machine besides cartridge RAM (default 65536)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--instances" && hasValue) {
+            options.instances = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--budget" && hasValue) {
+            options.budget = std::stoull(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.instances > 0;
+}
+
+// Resident bytes of this process (0 where it cannot be read)
+static size_t residentBytes() {
+#ifdef __linux__
+    std::ifstream statm("/proc/self/statm");
+    size_t total = 0, resident = 0;
+    if (statm >> total >> resident) {
+        return resident * static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    }
+#endif
+    return 0;
+}
+
+// Heap bytes handed out by malloc (0 where it cannot be read); unlike the
+// resident size this does not depend on which pages the machines touched
+static size_t allocatedBytes() {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+    const struct mallinfo2 info = mallinfo2();
+    return info.uordblks + info.hblkhd;
+#else
+    return 0;
+#endif
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // The first machine pays for what is shared: opcode tables and the ROM image
+    std::vector<std::unique_ptr<GameBoy>> machines;
+    auto create = [&options, &machines]() {
+        auto gameBoy = std::make_unique<GameBoy>();
+        gameBoy->setFastBoot(true);
+        if (!gameBoy->loadROM(options.romPath, options.opcodesFile)) {
+            return false;
+        }
+        for (u64 frame = 0; frame < options.frames; frame++) {
+            gameBoy->emulateFrame();
+        }
+        machines.push_back(std::move(gameBoy));
+        return true;
+    };
+    if (!create()) {
+        return 1;
+    }
+
+    machines.reserve(options.instances);
+    const size_t before = residentBytes();
+    const size_t allocatedBefore = allocatedBytes();
+    for (u32 i = 1; i < options.instances; i++) {
+        if (!create()) {
+            return 1;
+        }
+    }
+    const size_t after = residentBytes();
+    const size_t allocatedAfter = allocatedBytes();
+
+    const Cartridge* cartridge = machines.front()->getMemory().getCartridge();
+    const size_t ramBytes = cartridge->getRAM().size();
+    const u32 measured = options.instances - 1;
+
+    std::cout << "layout:       GameBoy " << sizeof(GameBoy) << " bytes (CPU " << sizeof(CPU) << ", Memory "
+              << sizeof(Memory) << ", PPU " << sizeof(PPU) << ", banks " << sizeof(MemoryBanks)
+              << "), aligned to " << alignof(GameBoy) << "\n";
+
+    // Where the components sit in the object, hottest first
+    GameBoy& first = *machines.front();
+    auto offset = [&first](const void* member) {
+        return static_cast<const u8*>(member) - reinterpret_cast<const u8*>(&first);
+    };
+    std::cout << "offsets:      Memory " << offset(&first.getMemory()) << ", CPU " << offset(&first.getCPU())
+              << ", PPU " << offset(&first.getPPU()) << ", Scheduler " << offset(&first.getScheduler())
+              << ", banks " << offset(first.getMemory().getOAM()) << "\n";
+    std::cout << "shared:       ROM image " << cartridge->getROM().size() << " bytes, cartridge RAM " << ramBytes
+              << " bytes per machine\n";
+    if (allocatedBefore != 0 && measured != 0) {
+        std::cout << "heap:         " << (allocatedAfter - allocatedBefore) / measured
+                  << " bytes per machine\n";
+    }
+
+    if (before == 0 || measured == 0) {
+        std::cout << "resident:     not measured" << std::endl;
+        return sizeof(GameBoy) <= options.budget ? 0 : 1;
+    }
+
+    const double perMachine = static_cast<double>(after - before) / measured;
+    const double withoutRAM = perMachine - static_cast<double>(ramBytes);
+    std::cout << std::fixed << std::setprecision(0);
+    std::cout << "resident:     " << perMachine << " bytes per machine over " << measured << " machines, "
+              << withoutRAM << " besides cartridge RAM (budget " << options.budget << ")" << std::endl;
+    return withoutRAM <= static_cast<double>(options.budget) ? 0 : 1;
+}
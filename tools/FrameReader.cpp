@@ -0,0 +1,172 @@
+#include "FrameRing.h"
+#include "Histogram.h"
+#include "MappedFile.h"
+#include <thread>
+
+// Command line options
+struct Options {
+    std::string name;
+    u64 frames = 0;
+    double timeout = 10.0;
+    bool copy = false;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <name> [options]\n"
+              << "  --frames <n>     Stop after reading n frames (default: until the writer closes)\n"
+              << "  --timeout <s>    Give up when no ring or frame shows up for s seconds (default 10)\n"
+              << "  --copy           Copy frames out instead of checking them in place\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--timeout" && hasValue) {
+            options.timeout = std::stod(argv[++i]);
+        } else if (arg == "--copy") {
+            options.copy = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.name.empty()) {
+            options.name = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.name.empty();
+}
+
+// What the reader saw
+struct ReadStats {
+    u64 frames = 0;
+    u64 skipped = 0;            // Overwritten before they were read
+    u64 torn = 0;               // Reads retried because the writer was in the slot
+    u64 checksumErrors = 0;
+    u64 orderErrors = 0;        // Frame numbers, cycles or metrics going backwards
+    LatencyHistogram latency;   // Publication to a verified read
+};
+
+// Check a frame in place; false if the slot changed underneath
+static bool checkInPlace(const FrameRingReader& reader, const FrameRingReader::View& view, bool& checksumOK) {
+    checksumOK = hashBytes(view.slot->pixels, FRAME_PIXELS) == view.info.checksum;
+    return reader.validate(view);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto timeout = std::chrono::duration<double>(options.timeout);
+
+    // The writer may start after the reader
+    FrameRingReader reader;
+    auto waitStart = Clock::now();
+    while (!reader.open(options.name)) {
+        if (Clock::now() - waitStart > timeout) {
+            std::cerr << "No frame ring named " << options.name << std::endl;
+            return 1;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::cout << "ring:         " << options.name << " (" << reader.getSlotCount() << " slots, writer pid "
+              << reader.getWriterPid() << ")\n";
+
+    ReadStats stats;
+    std::vector<u8> pixels(FRAME_PIXELS);
+    FrameInfo previous;
+    u64 next = 0;
+    auto lastProgress = Clock::now();
+
+    while (options.frames == 0 || stats.frames < options.frames) {
+        const u64 latest = reader.getLatest();
+
+        // Start with the newest frame when attaching
+        if (next == 0) {
+            next = latest;
+        }
+        if (next == 0 || next > latest) {
+            if (reader.isClosed() && reader.getLatest() < std::max<u64>(next, 1)) {
+                break;
+            }
+            if (Clock::now() - lastProgress > timeout) {
+                std::cerr << "No new frame for " << options.timeout << " s" << std::endl;
+                break;
+            }
+            std::this_thread::yield();
+            continue;
+        }
+
+        FrameInfo info;
+        FrameReadStatus status;
+        bool checksumOK = true;
+        if (options.copy) {
+            status = reader.read(next, info, pixels.data());
+            checksumOK = status != FrameReadStatus::OK || hashBytes(pixels.data(), FRAME_PIXELS) == info.checksum;
+        } else {
+            FrameRingReader::View view;
+            status = reader.acquire(next, view);
+            if (status == FrameReadStatus::OK && !checkInPlace(reader, view, checksumOK)) {
+                status = FrameReadStatus::TORN;
+            }
+            info = view.info;
+        }
+
+        if (status == FrameReadStatus::TORN) {
+            stats.torn++;
+            continue;
+        }
+        if (status == FrameReadStatus::OVERWRITTEN) {
+            // Skip to the oldest frame that is still safe to read
+            const u64 latestNow = reader.getLatest();
+            const u64 resume = latestNow >= reader.getSlotCount() ? latestNow - reader.getSlotCount() + 2 : next + 1;
+            const u64 target = std::max(resume, next + 1);
+            stats.skipped += target - next;
+            next = target;
+            continue;
+        }
+        if (status != FrameReadStatus::OK) {
+            continue;
+        }
+
+        stats.latency.record(monotonicNanos() - info.publishNanos);
+        stats.frames++;
+        if (!checksumOK) {
+            stats.checksumErrors++;
+        }
+        if (previous.frame != 0 && (info.frame <= previous.frame || info.cycles <= previous.cycles ||
+                                    info.metrics.instructions < previous.metrics.instructions)) {
+            stats.orderErrors++;
+        }
+        if (info.metrics.frames != info.frame) {
+            stats.orderErrors++;
+        }
+
+        previous = info;
+        next++;
+        lastProgress = Clock::now();
+    }
+
+    LatencyHistogram::Summary latency = stats.latency.summarize();
+    std::cout << "frames read:  " << stats.frames << "\n"
+              << "skipped:      " << stats.skipped << "\n"
+              << "torn retries: " << stats.torn << "\n"
+              << "checksum:     " << stats.checksumErrors << " errors\n"
+              << "ordering:     " << stats.orderErrors << " errors\n"
+              << "latency (us): p50 " << latency.p50 / 1000.0 << "  p90 " << latency.p90 / 1000.0 << "  p99 "
+              << latency.p99 / 1000.0 << "  max " << latency.max / 1000.0 << "\n";
+    if (previous.frame != 0) {
+        std::cout << "last frame:   " << previous.frame << " (cycle " << previous.cycles << ", input 0x" << std::hex
+                  << static_cast<u32>(previous.input) << std::dec << ")\n";
+    }
+
+    return stats.checksumErrors == 0 && stats.orderErrors == 0 && stats.frames > 0 ? 0 : 1;
+}
@@ -0,0 +1,288 @@
+#include "GameBoy.h"
+#include "ExecutionTrace.h"
+#include "FrameRing.h"
+#include "PerfCounters.h"
+#include "Serial.h"
+#include "StreamServer.h"
+#include "Trace.h"
+#include <cstring>
+#include <thread>
+
+// Command line options
+struct Options {
+    std::string romFile;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    std::string metricsTarget;
+    std::string traceFile;
+    std::string executionTraceFile;
+    std::string resumeFile;
+    std::string suspendFile;
+    std::string codeCacheFile;
+    std::string publishName;
+    u32 publishSlots = FRAME_RING_DEFAULT_SLOTS;
+    std::string streamAddress = "127.0.0.1";
+    std::string streamPage = "resources/index.html";
+    int streamPort = -1;
+    u64 frames = 600;
+    bool perf = false;
+    bool fastBoot = false;
+    bool startup = false;
+    bool serial = false;
+    bool coroutines = false;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>       Frames to emulate (default 600)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n"
+              << "  --fast-boot        Skip the boot ROM and start at 0x0100\n"
+              << "  --startup          Compare startup time with and without the boot ROM\n"
+              << "  --resume <file>    Continue from a suspend file\n"
+              << "  --suspend <file>   Write a suspend file after the run\n"
+              << "  --code-cache <file> Skip idle loops, with the code analysis cached in this file\n"
+              << "  --coroutines       Run the CPU, PPU and LY clock as coroutines on a shared scheduler\n"
+              << "  --serial           Print what the ROM sent over the serial port\n"
+              << "  --perf             Report hardware performance counters (Linux)\n"
+              << "  --metrics <target> Export metrics to a file or unix:<path>\n"
+              << "  --publish <name>   Publish every frame to a shared-memory ring (read with GameBoyFrameReader)\n"
+              << "  --slots <n>        Frames kept in the shared-memory ring (default " << FRAME_RING_DEFAULT_SLOTS << ")\n"
+              << "  --serve <port>     Stream to browsers over WebSocket, in real time (0 picks a port)\n"
+              << "  --bind <address>   Address to serve on (default 127.0.0.1)\n"
+              << "  --page <file>      Page served to browsers (default resources/index.html)\n"
+              << "  --trace <file>     Write a Chrome trace (needs GBWV2_ENABLE_TRACE)\n"
+              << "  --exec-trace <file> Record every instruction (decode with GameBoyDisasm --trace)\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            options.metricsTarget = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            options.traceFile = argv[++i];
+        } else if (arg == "--resume" && hasValue) {
+            options.resumeFile = argv[++i];
+        } else if (arg == "--suspend" && hasValue) {
+            options.suspendFile = argv[++i];
+        } else if (arg == "--code-cache" && hasValue) {
+            options.codeCacheFile = argv[++i];
+        } else if (arg == "--publish" && hasValue) {
+            options.publishName = argv[++i];
+        } else if (arg == "--slots" && hasValue) {
+            options.publishSlots = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--serve" && hasValue) {
+            options.streamPort = std::stoi(argv[++i]);
+        } else if (arg == "--bind" && hasValue) {
+            options.streamAddress = argv[++i];
+        } else if (arg == "--page" && hasValue) {
+            options.streamPage = argv[++i];
+        } else if (arg == "--exec-trace" && hasValue) {
+            options.executionTraceFile = argv[++i];
+        } else if (arg == "--serial") {
+            options.serial = true;
+        } else if (arg == "--coroutines") {
+            options.coroutines = true;
+        } else if (arg == "--perf") {
+            options.perf = true;
+        } else if (arg == "--fast-boot") {
+            options.fastBoot = true;
+        } else if (arg == "--startup") {
+            options.startup = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.romFile.empty()) {
+            options.romFile = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romFile.empty();
+}
+
+// Print the startup time of the last reset
+static void printStartup(const char* label, const GameBoy& gameBoy) {
+    std::cout << label << std::chrono::duration<double, std::micro>(gameBoy.getStartupTime()).count()
+              << " us (" << gameBoy.getStartupFrames() << " frames)\n";
+}
+
+// Run from reset to the first game frame with and without the boot ROM
+static void compareStartup(GameBoy& gameBoy, u64 maxFrames) {
+    for (bool fastBoot : {false, true}) {
+        gameBoy.setFastBoot(fastBoot);
+        gameBoy.reset();
+
+        for (u64 frame = 0; frame < maxFrames && gameBoy.getStartupFrames() == 0; frame++) {
+            gameBoy.emulateFrame();
+        }
+
+        if (gameBoy.getStartupFrames() == 0) {
+            std::cout << (fastBoot ? "fast boot:    " : "boot ROM:     ") << "no game frame within " << maxFrames << " frames\n";
+        } else {
+            printStartup(fastBoot ? "fast boot:    " : "boot ROM:     ", gameBoy);
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    GameBoy& gameBoy = GameBoy::getInstance();
+
+    if (!options.traceFile.empty()) {
+        Tracer::getInstance().setThreadName("emulation");
+        Tracer::getInstance().setEnabled(true);
+    }
+
+    gameBoy.setFastBoot(options.fastBoot);
+    gameBoy.setCoroutineScheduling(options.coroutines);
+    if (!gameBoy.loadROM(options.romFile, options.opcodesFile)) {
+        std::cerr << "Failed to load ROM: " << options.romFile << std::endl;
+        return 1;
+    }
+
+    if (!options.resumeFile.empty() && !gameBoy.resume(options.resumeFile)) {
+        std::cerr << "Failed to resume from " << options.resumeFile << std::endl;
+        return 1;
+    }
+
+    if (options.startup) {
+        compareStartup(gameBoy, options.frames);
+        return 0;
+    }
+
+    // Analysed (or loaded from the cache) before the clock starts
+    if (!options.codeCacheFile.empty()) {
+        auto analysisStart = std::chrono::steady_clock::now();
+        gameBoy.analyzeCode(options.codeCacheFile);
+        const double analysisMs =
+            std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - analysisStart).count();
+        const CodeAnalysis::Stats stats = gameBoy.getCodeAnalysis()->getStats();
+        std::cout << "code:         " << stats.blocks << " blocks, " << stats.instructions << " instructions, "
+                  << stats.idleLoops << " idle loops ("
+                  << (gameBoy.getCodeAnalysis()->isFromCache() ? "cached, " : "analysed, ") << analysisMs << " ms)\n";
+    }
+
+    if (!options.metricsTarget.empty()) {
+        gameBoy.startMetricsExport(options.metricsTarget, std::chrono::milliseconds(1000));
+    }
+
+    ExecutionTraceWriter executionTrace;
+    if (!options.executionTraceFile.empty()) {
+        if (!executionTrace.open(options.executionTraceFile)) {
+            return 1;
+        }
+        gameBoy.getCPU().setExecutionTrace(&executionTrace);
+    }
+
+    SerialCapture serialCapture;
+    if (options.serial) {
+        gameBoy.setSerialDevice(&serialCapture);
+    }
+
+    FrameRingWriter frameRing;
+    if (!options.publishName.empty()) {
+        if (!frameRing.open(options.publishName, options.publishSlots)) {
+            return 1;
+        }
+        gameBoy.setFrameRing(&frameRing);
+    }
+
+    // Streaming runs at the GameBoy frame rate with input from the browsers
+    StreamServer streamServer;
+    if (options.streamPort >= 0) {
+        if (!streamServer.start(options.streamAddress, static_cast<u16>(options.streamPort), options.streamPage)) {
+            return 1;
+        }
+        std::cout << "Serving http://" << options.streamAddress << ":" << streamServer.getPort() << "/" << std::endl;
+    }
+
+    // Hardware counters degrade to an unmeasured run when unavailable
+    PerfCounters perfCounters;
+    if (options.perf) {
+        if (perfCounters.open()) {
+            gameBoy.setPerfCounters(&perfCounters);
+        } else {
+            std::cerr << "perf: no hardware counters available, running unmeasured" << std::endl;
+        }
+    }
+
+    // Counters are attributed from the first emulated frame onwards
+    perfCounters.switchPhase(PerfPhase::CPU);
+    perfCounters.resetTotals();
+
+    auto start = std::chrono::steady_clock::now();
+    for (u64 frame = 0; frame < options.frames; frame++) {
+        if (streamServer.isRunning()) {
+            gameBoy.setJoypad(streamServer.getButtons());
+        }
+
+        gameBoy.emulateFrame();
+
+        if (streamServer.isRunning()) {
+            streamServer.submitFrame(gameBoy.getFrameCount(), gameBoy.getPPU().getScreenBuffer().data());
+            std::this_thread::sleep_until(start + FRAME_DURATION * (frame + 1));
+        }
+    }
+    auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Close the last CPU phase
+    perfCounters.switchPhase(PerfPhase::CPU);
+    gameBoy.setPerfCounters(nullptr);
+    gameBoy.stopMetricsExport();
+    gameBoy.getCPU().setExecutionTrace(nullptr);
+    gameBoy.setSerialDevice(nullptr);
+    gameBoy.setFrameRing(nullptr);
+    frameRing.close();
+    streamServer.stop();
+    executionTrace.close();
+
+    MachineMetrics metrics = gameBoy.getMetrics().snapshot();
+    std::cout << "bus timing:   " << (BUS_TIMING == BusTiming::MCYCLE ? "M-cycle" : "lump-sum") << "\n"
+              << "scheduling:   " << (gameBoy.isCoroutineScheduling() ? "coroutines" : "callbacks") << "\n"
+              << "frames:       " << options.frames << "\n"
+              << "instructions: " << metrics.instructions << "\n"
+              << "seconds:      " << elapsed << "\n"
+              << "frames/sec:   " << (elapsed > 0 ? options.frames / elapsed : 0.0) << "\n";
+    if (gameBoy.getStartupFrames() > 0) {
+        printStartup(options.resumeFile.empty() ? "startup:      " : "resume:       ", gameBoy);
+    }
+
+    if (options.serial) {
+        std::cout << "serial:\n" << serialCapture.getText() << "\n";
+    }
+
+    if (!options.suspendFile.empty() && !gameBoy.suspend(options.suspendFile)) {
+        return 1;
+    }
+
+    // Keep what the run discovered for the next one
+    if (!options.codeCacheFile.empty()) {
+        const CodeAnalysis::Stats stats = gameBoy.getCodeAnalysis()->getStats();
+        std::cout << "idle passes:  " << gameBoy.getCPU().getCounters().idleIterations << " skipped, "
+                  << stats.entryPoints << " entry points found while running\n";
+        if (!gameBoy.saveCodeCache(options.codeCacheFile)) {
+            return 1;
+        }
+    }
+
+    if (options.perf) {
+        perfCounters.report(std::cout, options.frames, metrics.instructions);
+    }
+
+    if (!options.traceFile.empty()) {
+        Tracer::getInstance().exportChromeJson(options.traceFile);
+    }
+
+    return 0;
+}
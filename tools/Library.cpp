@@ -0,0 +1,106 @@
+#include "RomLibrary.h"
+#include <filesystem>
+#include <iomanip>
+
+// Default index file inside the library root
+constexpr const char* DEFAULT_INDEX_FILE = ".gblibrary";
+
+// Command line options
+struct Options {
+    std::string root;
+    std::string indexFile;
+    unsigned threads = 0;
+    bool list = false;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <directory> [options]\n"
+              << "  --index <file>     Index file (default <directory>/" << DEFAULT_INDEX_FILE << ")\n"
+              << "  --threads <n>      Indexer threads (default: hardware threads)\n"
+              << "  --list             Print the library\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--index" && hasValue) {
+            options.indexFile = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            options.threads = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--list") {
+            options.list = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.root.empty()) {
+            options.root = arg;
+        } else {
+            return false;
+        }
+    }
+
+    if (options.indexFile.empty() && !options.root.empty()) {
+        options.indexFile = (std::filesystem::path(options.root) / DEFAULT_INDEX_FILE).string();
+    }
+    return !options.root.empty();
+}
+
+// Milliseconds since a start time
+static double millisecondsSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Print one line per ROM
+static void printLibrary(const RomLibrary& library) {
+    std::cout << std::left << std::setw(17) << "title" << std::setw(9) << "mapper" << std::right
+              << std::setw(6) << "banks" << std::setw(5) << "ram" << "  chk  " << std::setw(16) << "hash" << "  path\n";
+
+    for (const RomInfo& info : library.getEntries()) {
+        const Cartridge::Header& header = info.header;
+        if (!info.headerValid) {
+            std::cout << std::left << std::setw(17) << "(no header)" << std::setw(9) << "-" << std::right
+                      << std::setw(6) << "-" << std::setw(5) << "-" << "  ---  ";
+        } else {
+            std::cout << std::left << std::setw(17) << header.title << std::setw(9) << Cartridge::typeName(header.type)
+                      << std::right << std::setw(6) << static_cast<int>(header.romBanks)
+                      << std::setw(5) << static_cast<int>(header.ramBanks) << "  "
+                      << (header.headerChecksumValid ? 'H' : '-') << (header.globalChecksumValid ? 'G' : '-') << "   ";
+        }
+        std::cout << std::hex << std::setfill('0') << std::setw(16) << info.contentHash << std::dec << std::setfill(' ')
+                  << "  " << info.path << "\n";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    RomLibrary library(options.root);
+
+    // Opening the library is one read of the index
+    auto start = std::chrono::steady_clock::now();
+    bool loaded = library.load(options.indexFile);
+    double loadTime = millisecondsSince(start);
+
+    start = std::chrono::steady_clock::now();
+    RomLibrary::ScanStats stats = library.scan(options.threads);
+    double scanTime = millisecondsSince(start);
+
+    if (!library.save(options.indexFile)) {
+        return 1;
+    }
+
+    if (options.list) {
+        printLibrary(library);
+    }
+
+    std::cerr << "index:  " << (loaded ? "loaded" : "new") << " in " << loadTime << " ms\n"
+              << "scan:   " << stats.files << " ROMs (" << stats.reused << " unchanged, " << stats.indexed
+              << " indexed, " << stats.removed << " removed, " << stats.failed << " unreadable) in "
+              << scanTime << " ms, " << stats.bytesHashed / (1024.0 * 1024.0) << " MiB hashed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,209 @@
+#include "GameBoy.h"
+#include "LinkCable.h"
+#include <iomanip>
+#include <thread>
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    u64 frames = 3000;
+    u32 quantum = LinkCable::DEFAULT_QUANTUM;
+    double minRatio = 0.9;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>       Frames per machine (default 3000)\n"
+              << "  --quantum <n>      Cycles a machine may run ahead of the other (default "
+              << LinkCable::DEFAULT_QUANTUM << ")\n"
+              << "  --min-ratio <r>    Linked throughput required against independent machines (default 0.9)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--quantum" && hasValue) {
+            options.quantum = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--min-ratio" && hasValue) {
+            options.minRatio = std::stod(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.frames > 0 && options.quantum > 0;
+}
+
+// Transfer test programs at 0x150. The sender clocks 0, 1, ... 255 out on
+// the internal clock and stores each reply at C000+i; the receiver waits on
+// the external clock, stores each byte at C000+i and answers the next one
+// with it plus one. Both ends end up with C000+i == i.
+constexpr u8 SENDER_PROGRAM[] = {
+    0xF3,                   // di
+    0x06, 0x00,             // ld b,0
+    0x21, 0x00, 0xC0,       // ld hl,C000
+    0x78,                   // loop: ld a,b
+    0xE0, 0x01,             // ldh (SB),a
+    0x3E, 0x81,             // ld a,81 (start, internal clock)
+    0xE0, 0x02,             // ldh (SC),a
+    0xF0, 0x02,             // wait: ldh a,(SC)
+    0xCB, 0x7F,             // bit 7,a
+    0x20, 0xFA,             // jr nz,wait
+    0xF0, 0x01,             // ldh a,(SB)
+    0x77,                   // ld (hl),a
+    0x04,                   // inc b
+    0x2C,                   // inc l
+    0x20, 0xEC,             // jr nz,loop
+    0x18, 0xFE,             // jr $
+};
+
+constexpr u8 RECEIVER_PROGRAM[] = {
+    0xF3,                   // di
+    0x21, 0x00, 0xC0,       // ld hl,C000
+    0xAF,                   // xor a
+    0xE0, 0x01,             // ldh (SB),a
+    0x3E, 0x80,             // loop: ld a,80 (start, external clock)
+    0xE0, 0x02,             // ldh (SC),a
+    0xF0, 0x02,             // wait: ldh a,(SC)
+    0xCB, 0x7F,             // bit 7,a
+    0x20, 0xFA,             // jr nz,wait
+    0xF0, 0x01,             // ldh a,(SB)
+    0x77,                   // ld (hl),a
+    0x2C,                   // inc l
+    0x3C,                   // inc a
+    0xE0, 0x01,             // ldh (SB),a
+    0x18, 0xED,             // jr loop
+};
+
+// 32 KB ROM-only image running a program
+static std::vector<u8> buildROM(const u8* program, size_t size) {
+    std::vector<u8> rom(0x8000, 0x00);
+    const u8 entry[] = {0x00, 0xC3, 0x50, 0x01};    // nop; jp 0150
+    std::copy(entry, entry + sizeof(entry), rom.begin() + 0x100);
+    const char title[] = "LINKTEST";
+    std::copy(title, title + sizeof(title) - 1, rom.begin() + 0x134);
+    std::copy(program, program + size, rom.begin() + 0x150);
+
+    u8 checksum = 0;
+    for (size_t i = 0x134; i < 0x14D; i++) {
+        checksum = static_cast<u8>(checksum - rom[i] - 1);
+    }
+    rom[0x14D] = checksum;
+    return rom;
+}
+
+// Run each machine on its own thread; returns the wall time
+static double runPair(GameBoy& first, GameBoy& second, u64 frames, LinkCable* cable) {
+    auto run = [frames, cable](GameBoy& gameBoy, u32 side) {
+        for (u64 frame = 0; frame < frames; frame++) {
+            gameBoy.emulateFrame();
+        }
+        if (cable) {
+            cable->leave(side);
+        }
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    std::thread firstThread(run, std::ref(first), 0);
+    std::thread secondThread(run, std::ref(second), 1);
+    firstThread.join();
+    secondThread.join();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Two fresh machines running a ROM
+static bool loadPair(const Options& options, std::unique_ptr<GameBoy> (&machines)[2]) {
+    for (auto& gameBoy : machines) {
+        gameBoy = std::make_unique<GameBoy>();
+        gameBoy->setFastBoot(true);
+        if (!gameBoy->loadROM(options.romPath, options.opcodesFile)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Exchange 256 bytes between the test programs and check both ends
+static bool checkTransfers(const Options& options) {
+    const std::vector<u8> senderROM = buildROM(SENDER_PROGRAM, sizeof(SENDER_PROGRAM));
+    const std::vector<u8> receiverROM = buildROM(RECEIVER_PROGRAM, sizeof(RECEIVER_PROGRAM));
+
+    bool ok = true;
+    for (u32 senderSide = 0; senderSide < 2; senderSide++) {
+        GameBoy machines[2];
+        for (u32 side = 0; side < 2; side++) {
+            const std::vector<u8>& rom = side == senderSide ? senderROM : receiverROM;
+            machines[side].setFastBoot(true);
+            if (!machines[side].loadROM(rom.data(), rom.size(), options.opcodesFile)) {
+                return false;
+            }
+        }
+
+        // About 15 frames of transfers at 8192 Hz
+        LinkCable cable(machines[0], machines[1], options.quantum);
+        const double seconds = runPair(machines[0], machines[1], 30, &cable);
+
+        u32 errors = 0;
+        for (u32 i = 0; i < 256; i++) {
+            for (GameBoy& gameBoy : machines) {
+                errors += gameBoy.getMemory().peek(static_cast<u16>(0xC000 + i)) != i;
+            }
+        }
+        const LinkCable::Stats& sender = cable.getStats(senderSide);
+        const LinkCable::Stats& receiver = cable.getStats(1 - senderSide);
+        std::cout << "transfers (sender " << senderSide << "): " << sender.sent << " sent, " << receiver.received
+                  << " received, " << errors << " wrong bytes, " << std::fixed << std::setprecision(1)
+                  << sender.sent / seconds << " transfers/s" << std::endl;
+        ok = ok && errors == 0 && sender.sent == 256 && receiver.received == 256;
+    }
+    return ok;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    const bool transfersOK = checkTransfers(options);
+
+    // Same ROM, same frames: independent, then linked
+    std::unique_ptr<GameBoy> independent[2];
+    std::unique_ptr<GameBoy> linked[2];
+    if (!loadPair(options, independent) || !loadPair(options, linked)) {
+        return 1;
+    }
+    const double independentSeconds = runPair(*independent[0], *independent[1], options.frames, nullptr);
+
+    LinkCable cable(*linked[0], *linked[1], options.quantum);
+    const double linkedSeconds = runPair(*linked[0], *linked[1], options.frames, &cable);
+
+    const double independentFPS = 2 * options.frames / independentSeconds;
+    const double linkedFPS = 2 * options.frames / linkedSeconds;
+    const double ratio = linkedFPS / independentFPS;
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "independent:  " << independentFPS << " frames/s (2 machines, " << options.frames << " frames each)\n";
+    std::cout << "linked:       " << linkedFPS << " frames/s (quantum " << options.quantum << " cycles)\n";
+    for (u32 side = 0; side < 2; side++) {
+        const LinkCable::Stats& stats = cable.getStats(side);
+        std::cout << "  machine " << side << ": " << stats.waits << " waits, " << stats.waitNanos / 1e6 << " ms waiting\n";
+    }
+    std::cout << std::setprecision(3) << "ratio:        " << ratio << (ratio >= options.minRatio ? "" : " (below minimum)")
+              << std::endl;
+
+    return transfersOK && ratio >= options.minRatio ? 0 : 1;
+}
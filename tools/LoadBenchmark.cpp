@@ -0,0 +1,121 @@
+#include "RomLoader.h"
+#include "MappedFile.h"
+#include <iomanip>
+
+// Command line options
+struct Options {
+    std::vector<std::string> files;
+    u32 iterations = 200;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [<rom.gz> <rom.zip> ...] [options]\n"
+              << "  --iterations <n>   Loads per file (default 200)\n"
+              << "Each file is loaded through RomLoader; the first is the baseline, and\n"
+              << "all of them must decode to the same image.\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--iterations" && hasValue) {
+            options.iterations = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.files.push_back(arg);
+        } else {
+            return false;
+        }
+    }
+
+    return !options.files.empty() && options.iterations > 0;
+}
+
+// Load timings of one file
+struct LoadResult {
+    RomContainer container;
+    size_t fileSize;
+    size_t romSize;
+    u64 romHash;
+    double bestMicros;
+    double meanMicros;
+};
+
+// Load a file repeatedly; each load starts from an empty buffer like a fresh ROM load
+static bool benchmarkFile(const std::string& filename, u32 iterations, LoadResult& result) {
+    MappedFile file;
+    if (!file.open(filename)) {
+        std::cerr << "Failed to open " << filename << std::endl;
+        return false;
+    }
+    result.container = RomLoader::detect(file.data(), file.size());
+    result.fileSize = file.size();
+    file.close();
+
+    double total = 0.0;
+    result.bestMicros = 0.0;
+    for (u32 i = 0; i < iterations; i++) {
+        std::vector<u8> rom;
+        std::string error;
+
+        auto start = std::chrono::steady_clock::now();
+        bool ok = RomLoader::load(filename, rom, error);
+        double micros = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+        if (!ok) {
+            std::cerr << filename << ": " << error << std::endl;
+            return false;
+        }
+        if (i == 0) {
+            result.romSize = rom.size();
+            result.romHash = hashBytes(rom.data(), rom.size());
+            result.bestMicros = micros;
+        }
+        result.bestMicros = std::min(result.bestMicros, micros);
+        total += micros;
+    }
+
+    result.meanMicros = total / iterations;
+    return true;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::cout << std::left << std::setw(8) << "format" << std::right << std::setw(10) << "file KB"
+              << std::setw(10) << "ROM KB" << std::setw(11) << "best us" << std::setw(11) << "mean us"
+              << std::setw(10) << "MB/s" << std::setw(8) << "x base" << "  path\n";
+
+    double baseline = 0.0;
+    u64 baselineHash = 0;
+    bool mismatch = false;
+    for (size_t i = 0; i < options.files.size(); i++) {
+        LoadResult result;
+        if (!benchmarkFile(options.files[i], options.iterations, result)) {
+            return 1;
+        }
+        if (i == 0) {
+            baseline = result.meanMicros;
+            baselineHash = result.romHash;
+        } else if (result.romHash != baselineHash) {
+            mismatch = true;
+        }
+
+        std::cout << std::left << std::setw(8) << RomLoader::containerName(result.container) << std::right
+                  << std::fixed << std::setprecision(1)
+                  << std::setw(10) << result.fileSize / 1024.0 << std::setw(10) << result.romSize / 1024.0
+                  << std::setw(11) << result.bestMicros << std::setw(11) << result.meanMicros
+                  << std::setw(10) << result.romSize / result.meanMicros << std::setprecision(2)
+                  << std::setw(8) << result.meanMicros / baseline << "  " << options.files[i]
+                  << (result.romHash != baselineHash ? "  (image differs)" : "") << "\n";
+    }
+
+    return mismatch ? 1 : 0;
+}
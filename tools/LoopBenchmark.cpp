@@ -0,0 +1,166 @@
+#include "GameBoy.h"
+#include <iomanip>
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    u64 frames = 600;
+    u64 bootFrames = 600;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>       Frames of the copy benchmark (default 600)\n"
+              << "  --boot-frames <n>  Most frames the boot ROM may take on <rom> (default 600)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--boot-frames" && hasValue) {
+            options.bootFrames = std::stoull(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.frames > 0;
+}
+
+// Copy benchmark at 0x150: over and over, copy 4 KB of ROM bank 1 to WRAM,
+// 6 KB of WRAM to VRAM and fill a 256-byte WRAM page with a pass counter.
+// The LCD byte patched at LCD_OFFSET decides whether the PPU runs meanwhile
+constexpr u8 COPY_PROGRAM[] = {
+    0xF3,                   // di
+    0x3E, 0x00,             // ld a,LCDC
+    0xE0, 0x40,             // ldh (LCDC),a
+    0x21, 0x00, 0x40,       // loop: ld hl,4000
+    0x11, 0x00, 0xC0,       // ld de,C000
+    0x01, 0x00, 0x10,       // ld bc,1000
+    0x2A, 0x12, 0x13, 0x0B, // copy: ld a,(hl+); ld (de),a; inc de; dec bc
+    0x78, 0xB1, 0x20, 0xF8, // ld a,b; or c; jr nz,copy
+    0x21, 0x00, 0xC0,       // ld hl,C000
+    0x11, 0x00, 0x80,       // ld de,8000
+    0x01, 0x00, 0x18,       // ld bc,1800
+    0x2A, 0x12, 0x13, 0x0B, // copy: ld a,(hl+); ld (de),a; inc de; dec bc
+    0x78, 0xB1, 0x20, 0xF8, // ld a,b; or c; jr nz,copy
+    0x21, 0x00, 0xD0,       // ld hl,D000
+    0xFA, 0x00, 0xDF,       // ld a,(DF00)
+    0x06, 0x00,             // ld b,0
+    0x22, 0x05, 0x20, 0xFC, // fill: ld (hl+),a; dec b; jr nz,fill
+    0x21, 0x00, 0xDF,       // ld hl,DF00
+    0x34,                   // inc (hl)
+    0x18, 0xCC,             // jr loop
+};
+constexpr size_t LCD_OFFSET = 2;
+
+// 32 KB ROM-only image running the copy benchmark
+static std::vector<u8> buildROM(u8 lcdc) {
+    std::vector<u8> rom(0x8000, 0x00);
+    const u8 entry[] = {0x00, 0xC3, 0x50, 0x01};    // nop; jp 0150
+    std::copy(entry, entry + sizeof(entry), rom.begin() + 0x100);
+    const char title[] = "LOOPBENCH";
+    std::copy(title, title + sizeof(title) - 1, rom.begin() + 0x134);
+    std::copy(COPY_PROGRAM, COPY_PROGRAM + sizeof(COPY_PROGRAM), rom.begin() + 0x150);
+    rom[0x150 + LCD_OFFSET] = lcdc;
+    for (size_t i = 0x4000; i < 0x8000; i++) {
+        rom[i] = static_cast<u8>(i * 7 + (i >> 8));
+    }
+
+    u8 checksum = 0;
+    for (size_t i = 0x134; i < 0x14D; i++) {
+        checksum = static_cast<u8>(checksum - rom[i] - 1);
+    }
+    rom[0x14D] = checksum;
+    return rom;
+}
+
+// One machine's run
+struct Run {
+    double seconds = 0.0;
+    u64 frames = 0;
+    u64 cycles = 0;
+    u64 instructions = 0;
+    u64 loopIterations = 0;
+    std::vector<u8> state;
+};
+
+// Run frames (or until the boot ROM unmaps) with the idioms on or off
+static bool runMachine(const std::vector<u8>& rom, const Options& options, bool fastBoot, bool untilBooted,
+                       u64 frames, bool loopIdioms, Run& run) {
+    auto gameBoy = std::make_unique<GameBoy>();
+    gameBoy->setFastBoot(fastBoot);
+    gameBoy->setLoopIdioms(loopIdioms);
+    if (!gameBoy->loadROM(rom.data(), rom.size(), options.opcodesFile)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    while (run.frames < frames && !(untilBooted && !gameBoy->getMemory().isBootROMEnabled())) {
+        gameBoy->emulateFrame();
+        run.frames++;
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    run.cycles = gameBoy->getCycleCount();
+    run.instructions = gameBoy->getCPU().getCounters().instructions;
+    run.loopIterations = gameBoy->getCPU().getCounters().loopIterations;
+    run.state.resize(gameBoy->getStateSize());
+    return gameBoy->saveState(run.state.data(), run.state.size()) != 0;
+}
+
+// Compare a workload with and without the idioms; false if the machines differ
+static bool compare(const char* name, const std::vector<u8>& rom, const Options& options, bool fastBoot,
+                    bool untilBooted, u64 frames) {
+    Run stepped, bulk;
+    if (!runMachine(rom, options, fastBoot, untilBooted, frames, false, stepped) ||
+        !runMachine(rom, options, fastBoot, untilBooted, frames, true, bulk)) {
+        std::cerr << name << ": failed to run" << std::endl;
+        return false;
+    }
+
+    const bool same = stepped.frames == bulk.frames && stepped.cycles == bulk.cycles &&
+                      stepped.instructions == bulk.instructions && stepped.state == bulk.state;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << name << ": " << bulk.frames << " frames, " << bulk.instructions << " instructions, "
+              << bulk.loopIterations << " loop iterations in bulk\n";
+    std::cout << "  instruction by instruction: " << stepped.seconds * 1e3 << " ms, " << stepped.frames / stepped.seconds
+              << " frames/s\n";
+    std::cout << "  loop idioms:                " << bulk.seconds * 1e3 << " ms, " << bulk.frames / bulk.seconds
+              << " frames/s (" << std::setprecision(2) << stepped.seconds / bulk.seconds << "x)\n";
+    std::cout << "  state: " << (same ? "identical" : "DIFFERENT") << std::endl;
+    return same;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::ifstream file(options.romPath, std::ios::binary);
+    const std::vector<u8> userROM((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (userROM.empty()) {
+        std::cerr << "Failed to read " << options.romPath << std::endl;
+        return 1;
+    }
+
+    // The boot ROM clears VRAM with the LCD off, then scrolls the logo
+    bool ok = compare("boot ROM", userROM, options, false, true, options.bootFrames);
+    ok = compare("copy, LCD off", buildROM(0x00), options, true, false, options.frames) && ok;
+    ok = compare("copy, LCD on", buildROM(0x91), options, true, false, options.frames) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,237 @@
+#include "GameBoy.h"
+#include "MappedFile.h"
+#include "Netplay.h"
+#include <atomic>
+#include <iomanip>
+#include <sstream>
+#include <thread>
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    u16 port = 47800;
+    u64 frames = 1200;
+    u32 delayMillis = 0;
+    u32 jitterMillis = 0;
+    double lossRate = 0.0;
+    u32 inputDelay = 1;
+    u32 maxRollback = 8;
+    i64 desyncAt = -1;          // Frame from which peer 1 corrupts its state
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>         Frames both peers must confirm (default 1200)\n"
+              << "  --port <n>           UDP port of peer 0; peer 1 uses the next one (default 47800)\n"
+              << "  --delay <ms>         One-way packet delay (default 0)\n"
+              << "  --jitter <ms>        Random delay variation, up to the delay (default 0)\n"
+              << "  --loss <fraction>    Packets dropped, 0 to 1 (default 0)\n"
+              << "  --input-delay <n>    Frames of local input delay (default 1)\n"
+              << "  --max-rollback <n>   Frames to predict before stalling (default 8)\n"
+              << "  --desync-at <n>      Corrupt peer 1's state from this frame on (the run must detect it)\n"
+              << "  --opcodes <file>     Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--port" && hasValue) {
+            options.port = static_cast<u16>(std::stoul(argv[++i]));
+        } else if (arg == "--delay" && hasValue) {
+            options.delayMillis = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--jitter" && hasValue) {
+            options.jitterMillis = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--loss" && hasValue) {
+            options.lossRate = std::stod(argv[++i]);
+        } else if (arg == "--input-delay" && hasValue) {
+            options.inputDelay = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--max-rollback" && hasValue) {
+            options.maxRollback = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--desync-at" && hasValue) {
+            options.desyncAt = std::stoll(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.frames > 0 && options.port < 0xFFFF;
+}
+
+// Buttons a player holds on a frame: a new random combination every 15 frames,
+// so the remote prediction fails at every change
+static u8 scriptedInput(u8 player, u64 frame) {
+    const u64 key[2] = {player, frame / 15};
+    return static_cast<u8>(hashBytes(key, sizeof(key)) & 0xFF);
+}
+
+// Shared between the peers so each knows when the other is done
+struct Progress {
+    std::atomic<u64> confirmed[2] = {0, 0};
+};
+
+// Outcome of one peer
+struct PeerResult {
+    bool started = false;
+    bool finished = false;
+    bool desynced = false;
+    u64 desyncFrame = 0;
+    u64 checksumFrame = 0;
+    u64 checksum = 0;
+    bool hasChecksum = false;
+    std::string report;
+};
+
+// Milliseconds with two decimals
+static std::string millis(u64 nanos) {
+    std::ostringstream stream;
+    stream << std::fixed << std::setprecision(2) << nanos / 1e6 << " ms";
+    return stream.str();
+}
+
+// Describe what a peer went through
+static std::string describe(u8 player, const NetplaySession& session, const NetplaySocket& socket) {
+    const NetplayStats& stats = session.getStats();
+    const LatencyHistogram::Summary depth = stats.rollbackDepth.summarize();
+    const LatencyHistogram::Summary resimulation = stats.resimulationNanos.summarize();
+    const double stateMB = session.getStateSize() / (1024.0 * 1024.0);
+
+    std::ostringstream out;
+    out << std::fixed << std::setprecision(1);
+    out << "peer " << static_cast<u32>(player) << ": " << stats.frames << " frames, " << stats.stalls << " stalls, "
+        << stats.rollbacks << " rollbacks (" << stats.resimulatedFrames << " frames resimulated, "
+        << stats.mispredictions << " mispredictions), " << stats.overBudget << " over the frame budget\n";
+    out << "  rollback depth:   p50 " << depth.p50 << "  p90 " << depth.p90 << "  p99 " << depth.p99 << "  max "
+        << depth.max << " frames\n";
+    out << "  resimulation:     p50 " << millis(resimulation.p50) << "  p90 " << millis(resimulation.p90) << "  p99 "
+        << millis(resimulation.p99) << "  max " << millis(resimulation.max) << "\n";
+    out << "  state:            " << session.getStateSize() << " bytes for both machines\n";
+    if (stats.saves > 0) {
+        out << "  save:             " << stats.saveNanos / 1e3 / stats.saves << " us each, "
+            << stateMB * stats.saves / (stats.saveNanos / 1e9) << " MB/s (" << stats.saves << ")\n";
+    }
+    if (stats.restores > 0) {
+        out << "  restore:          " << stats.restoreNanos / 1e3 / stats.restores << " us each, "
+            << stateMB * stats.restores / (stats.restoreNanos / 1e9) << " MB/s (" << stats.restores << ")\n";
+    }
+    out << "  packets:          " << socket.getSent() << " sent, " << socket.getDropped() << " dropped, "
+        << socket.getReceived() << " received\n";
+    out << "  checksums:        " << stats.checksumsCompared << " compared, "
+        << (session.isDesynced() ? "DESYNC at frame " + std::to_string(session.getDesyncFrame()) : "in sync") << "\n";
+    return out.str();
+}
+
+// One peer: both players' machines, its own buttons and the network
+static void runPeer(const Options& options, u8 player, Progress& progress, PeerResult& result) {
+    auto first = std::make_unique<GameBoy>();
+    auto second = std::make_unique<GameBoy>();
+    for (GameBoy* gameBoy : {first.get(), second.get()}) {
+        gameBoy->setFastBoot(true);
+        if (!gameBoy->loadROM(options.romPath, options.opcodesFile)) {
+            return;
+        }
+    }
+
+    NetplaySocket socket;
+    if (!socket.open("127.0.0.1", static_cast<u16>(options.port + player), "127.0.0.1",
+                     static_cast<u16>(options.port + 1 - player))) {
+        return;
+    }
+    socket.setImpairment(options.delayMillis, options.jitterMillis, options.lossRate, 1 + player);
+
+    NetplayConfig config;
+    config.localPlayer = player;
+    config.inputDelay = options.inputDelay;
+    config.maxRollback = options.maxRollback;
+    NetplaySession session(*first, *second, socket, config);
+    if (!session.start()) {
+        return;
+    }
+    result.started = true;
+
+    // Real time, so delay and jitter mean what they say
+    const auto deadline = std::chrono::steady_clock::now() + FRAME_DURATION * options.frames * 4 + std::chrono::seconds(10);
+    auto next = std::chrono::steady_clock::now();
+    const u8 other = 1 - player;
+    while (progress.confirmed[player].load() < options.frames || progress.confirmed[other].load() < options.frames) {
+        if (std::chrono::steady_clock::now() > deadline) {
+            break;
+        }
+
+        if (session.getFrame() < options.frames) {
+            if (player == 1 && options.desyncAt >= 0 && session.getFrame() >= static_cast<u64>(options.desyncAt)) {
+                first->getMemory().getWRAM()[0x1F00]++;
+            }
+            session.advanceFrame(scriptedInput(player, session.getFrame() + options.inputDelay));
+        } else {
+            session.poll();
+        }
+        progress.confirmed[player].store(session.getConfirmedFrames());
+
+        next += FRAME_DURATION;
+        std::this_thread::sleep_until(next);
+    }
+
+    result.finished = session.getConfirmedFrames() >= options.frames;
+    result.desynced = session.isDesynced();
+    result.desyncFrame = session.getDesyncFrame();
+    const u64 interval = config.checksumInterval;
+    result.checksumFrame = (session.getConfirmedFrames() - 1) / interval * interval;
+    result.hasChecksum = session.getChecksum(result.checksumFrame, result.checksum);
+    result.report = describe(player, session, socket);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::cout << "netplay: " << options.frames << " frames over loopback, delay " << options.delayMillis << " ms +- "
+              << options.jitterMillis << " ms, loss " << options.lossRate * 100 << "%, input delay "
+              << options.inputDelay << ", max rollback " << options.maxRollback << std::endl;
+
+    Progress progress;
+    PeerResult results[2];
+    std::thread peers[2];
+    for (u8 player = 0; player < 2; player++) {
+        peers[player] = std::thread(runPeer, std::cref(options), player, std::ref(progress), std::ref(results[player]));
+    }
+    for (auto& peer : peers) {
+        peer.join();
+    }
+
+    for (const PeerResult& result : results) {
+        if (!result.started) {
+            std::cerr << "A peer failed to start" << std::endl;
+            return 1;
+        }
+        std::cout << result.report;
+    }
+
+    // Both ends must agree on the last confirmed state
+    const bool finished = results[0].finished && results[1].finished;
+    const bool checksumsMatch = results[0].hasChecksum && results[1].hasChecksum &&
+                                results[0].checksumFrame == results[1].checksumFrame &&
+                                results[0].checksum == results[1].checksum;
+    std::cout << "final checksum at frame " << results[0].checksumFrame << ": "
+              << (checksumsMatch ? "match" : "MISMATCH") << (finished ? "" : " (timed out)") << std::endl;
+
+    if (options.desyncAt >= 0) {
+        const bool detected = results[0].desynced && results[0].desyncFrame >= static_cast<u64>(options.desyncAt);
+        std::cout << "injected desync " << (detected ? "detected" : "NOT detected") << std::endl;
+        return detected ? 0 : 1;
+    }
+    return finished && checksumsMatch && !results[0].desynced && !results[1].desynced ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#include "GameBoy.h"
+#include "MappedFile.h"
+#include "Observation.h"
+#include <iomanip>
+
+// Command line options
+struct Options {
+    std::string romFile;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    std::string pgmFile;
+    ObservationConfig config;
+    u32 frames = 300;
+    u32 iterations = 20000;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --size <w>x<h>      Observation size (default 84x84)\n"
+              << "  --crop <x,y,w,h>    Screen area to observe (default the whole screen)\n"
+              << "  --stack <k>         Frames per observation (default 4)\n"
+              << "  --frames <n>        Frames to run before measuring (default 300)\n"
+              << "  --iterations <n>    Observations per measurement (default 20000)\n"
+              << "  --pgm <file>        Write the newest frame of the last observation\n"
+              << "  --opcodes <file>    Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--size" && hasValue) {
+            unsigned width = 0, height = 0;
+            if (std::sscanf(argv[++i], "%ux%u", &width, &height) != 2) {
+                return false;
+            }
+            options.config.width = static_cast<u16>(width);
+            options.config.height = static_cast<u16>(height);
+        } else if (arg == "--crop" && hasValue) {
+            unsigned x = 0, y = 0, width = 0, height = 0;
+            if (std::sscanf(argv[++i], "%u,%u,%u,%u", &x, &y, &width, &height) != 4) {
+                return false;
+            }
+            options.config.cropX = static_cast<u16>(x);
+            options.config.cropY = static_cast<u16>(y);
+            options.config.cropWidth = static_cast<u16>(width);
+            options.config.cropHeight = static_cast<u16>(height);
+        } else if (arg == "--stack" && hasValue) {
+            options.config.stack = static_cast<u8>(std::stoul(argv[++i]));
+        } else if (arg == "--frames" && hasValue) {
+            options.frames = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--iterations" && hasValue) {
+            options.iterations = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--pgm" && hasValue) {
+            options.pgmFile = argv[++i];
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romFile.empty()) {
+            options.romFile = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romFile.empty() && options.iterations > 0;
+}
+
+// Timing and output of one pipeline setting
+struct Measurement {
+    double seconds;
+    u64 outputHash;
+    std::vector<u8> observation;
+};
+
+// Observe alternating screens; both paths see the same sequence
+static Measurement measure(const ObservationConfig& config, bool vectorized, const std::vector<u8>* screens,
+                           u32 iterations) {
+    ObservationPipeline pipeline(config);
+    pipeline.setVectorized(vectorized);
+
+    Measurement result;
+    result.observation.assign(pipeline.getObservationSize(), 0);
+    result.outputHash = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (u32 i = 0; i < iterations; i++) {
+        pipeline.observe(screens[i & 1].data(), result.observation.data());
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.outputHash = hashBytes(result.observation.data(), result.observation.size());
+    return result;
+}
+
+// Write one plane as a binary PGM
+static bool writePGM(const std::string& filename, const u8* plane, u32 width, u32 height) {
+    std::ofstream file(filename, std::ios::binary);
+    file << "P5\n" << width << " " << height << "\n255\n";
+    file.write(reinterpret_cast<const char*>(plane), static_cast<std::streamsize>(width) * height);
+    return file.good();
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    ObservationConfig& config = options.config;
+    if (!ObservationPipeline(config).isValid()) {
+        std::cerr << "Invalid observation layout" << std::endl;
+        return 1;
+    }
+
+    // Two consecutive frames of the game, so max-pooling has something to do
+    GameBoy& gameBoy = GameBoy::getInstance();
+    gameBoy.setFastBoot(true);
+    if (!gameBoy.loadROM(options.romFile, options.opcodesFile)) {
+        return 1;
+    }
+    std::vector<u8> screens[2];
+    for (u32 i = 0; i < options.frames + 2; i++) {
+        gameBoy.emulateFrame();
+        if (i >= options.frames) {
+            const auto& screen = gameBoy.getPPU().getScreenBuffer();
+            screens[i - options.frames].assign(screen.begin(), screen.end());
+        }
+    }
+
+    std::cout << "observation: " << static_cast<u32>(config.stack) << " x " << config.height << " x " << config.width << " from "
+              << config.cropWidth << "x" << config.cropHeight << " at " << config.cropX << "," << config.cropY
+              << (ObservationPipeline::hasAVX2() ? "" : " (no AVX2 on this CPU)") << "\n";
+    std::cout << std::left << std::setw(10) << "max-pool" << std::setw(8) << "path" << std::right << std::setw(12)
+              << "obs/s" << std::setw(10) << "us/obs" << "\n";
+
+    bool consistent = true;
+    Measurement last;
+    for (bool maxPool : {false, true}) {
+        config.maxPool = maxPool;
+        Measurement scalar = measure(config, false, screens, options.iterations);
+        std::vector<std::pair<const char*, Measurement*>> rows = {{"scalar", &scalar}};
+
+        Measurement vectorized;
+        if (ObservationPipeline::hasAVX2()) {
+            vectorized = measure(config, true, screens, options.iterations);
+            rows.push_back({"avx2", &vectorized});
+            consistent = consistent && vectorized.outputHash == scalar.outputHash;
+        }
+
+        for (const auto& [name, measurement] : rows) {
+            std::cout << std::left << std::setw(10) << (maxPool ? "on" : "off") << std::setw(8) << name << std::right
+                      << std::fixed << std::setprecision(0) << std::setw(12) << options.iterations / measurement->seconds
+                      << std::setprecision(2) << std::setw(10) << measurement->seconds * 1e6 / options.iterations << "\n";
+        }
+        last = std::move(rows.back().second == &scalar ? scalar : vectorized);
+    }
+
+    std::cout << "scalar and AVX2 outputs " << (consistent ? "match" : "DIFFER") << std::endl;
+
+    if (!options.pgmFile.empty()) {
+        const size_t planeSize = static_cast<size_t>(config.width) * config.height;
+        if (!writePGM(options.pgmFile, last.observation.data() + (config.stack - 1) * planeSize, config.width,
+                      config.height)) {
+            std::cerr << "Failed to write " << options.pgmFile << std::endl;
+            return 1;
+        }
+    }
+    return consistent ? 0 : 1;
+}
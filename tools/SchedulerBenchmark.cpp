@@ -0,0 +1,195 @@
+#include "GameBoy.h"
+#include <iomanip>
+
+// Command line options
+struct Options {
+    std::string romPath;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    u64 frames = 3000;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom> [options]\n"
+              << "  --frames <n>       Frames per run (default 3000)\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (!arg.empty() && arg[0] != '-' && options.romPath.empty()) {
+            options.romPath = arg;
+        } else {
+            return false;
+        }
+    }
+
+    return !options.romPath.empty() && options.frames > 0;
+}
+
+// VBlank handler at 0x40: flag the frame at C000
+constexpr u8 VBLANK_HANDLER[] = {
+    0xF5,                   // push af
+    0x3E, 0x01,             // ld a,1
+    0xEA, 0x00, 0xC0,       // ld (C000),a
+    0xF1,                   // pop af
+    0xD9,                   // reti
+};
+
+// STAT handler at 0x48: count the LYC matches at C002
+constexpr u8 STAT_HANDLER[] = {
+    0xF5,                   // push af
+    0xFA, 0x02, 0xC0,       // ld a,(C002)
+    0x3C,                   // inc a
+    0xEA, 0x02, 0xC0,       // ld (C002),a
+    0xF1,                   // pop af
+    0xD9,                   // reti
+};
+
+// Start at 0x150: VBlank and the LYC interrupt on line 64, LCD on
+constexpr u8 START_PROGRAM[] = {
+    0xF3,                   // di
+    0x31, 0xFE, 0xFF,       // ld sp,FFFE
+    0x3E, 0x03,             // ld a,03
+    0xE0, 0xFF,             // ldh (IE),a
+    0x3E, 0x40,             // ld a,40
+    0xE0, 0x41,             // ldh (STAT),a
+    0x3E, 0x40,             // ld a,40
+    0xE0, 0x45,             // ldh (LYC),a
+    0x3E, 0x91,             // ld a,91
+    0xE0, 0x40,             // ldh (LCDC),a
+    0xFB,                   // ei
+    0xC3, 0x00, 0x02,       // jp 0200
+};
+
+// Frame loop at 0x200: wait for the VBlank flag, count the frame, and every
+// eighth frame switch the LCD off for a while
+constexpr u8 FRAME_PROGRAM[] = {
+    0xAF,                   // loop: xor a
+    0xEA, 0x00, 0xC0,       // ld (C000),a
+    0xFA, 0x00, 0xC0,       // wait: ld a,(C000)
+    0xA7,                   // and a
+    0x28, 0xFA,             // jr z,wait
+    0x21, 0x01, 0xC0,       // ld hl,C001
+    0x34,                   // inc (hl)
+    0x7E,                   // ld a,(hl)
+    0xE6, 0x07,             // and 07
+    0x20, 0xED,             // jr nz,loop
+    0x3E, 0x11,             // ld a,11
+    0xE0, 0x40,             // ldh (LCDC),a
+    0x06, 0x00,             // ld b,0
+    0x05,                   // spin: dec b
+    0x20, 0xFD,             // jr nz,spin
+    0x3E, 0x91,             // ld a,91
+    0xE0, 0x40,             // ldh (LCDC),a
+    0x18, 0xDE,             // jr loop
+};
+
+// 32 KB ROM-only image running the frame loop
+static std::vector<u8> buildROM() {
+    std::vector<u8> rom(0x8000, 0x00);
+    const u8 entry[] = {0x00, 0xC3, 0x50, 0x01};    // nop; jp 0150
+    std::copy(entry, entry + sizeof(entry), rom.begin() + 0x100);
+    const char title[] = "SCHEDBENCH";
+    std::copy(title, title + sizeof(title) - 1, rom.begin() + 0x134);
+    std::copy(VBLANK_HANDLER, VBLANK_HANDLER + sizeof(VBLANK_HANDLER), rom.begin() + 0x40);
+    std::copy(STAT_HANDLER, STAT_HANDLER + sizeof(STAT_HANDLER), rom.begin() + 0x48);
+    std::copy(START_PROGRAM, START_PROGRAM + sizeof(START_PROGRAM), rom.begin() + 0x150);
+    std::copy(FRAME_PROGRAM, FRAME_PROGRAM + sizeof(FRAME_PROGRAM), rom.begin() + 0x200);
+
+    u8 checksum = 0;
+    for (size_t i = 0x134; i < 0x14D; i++) {
+        checksum = static_cast<u8>(checksum - rom[i] - 1);
+    }
+    rom[0x14D] = checksum;
+    return rom;
+}
+
+// One machine's run
+struct Run {
+    double seconds = 0.0;
+    u64 instructions = 0;
+    u64 scanlinesSkipped = 0;
+    size_t arenaUsed = 0;
+    std::vector<u8> state;
+};
+
+// Run frames under the callback loop or the coroutine scheduler
+static bool runMachine(const std::vector<u8>& rom, const Options& options, bool fastBoot, bool coroutines, Run& run) {
+    auto gameBoy = std::make_unique<GameBoy>();
+    gameBoy->setFastBoot(fastBoot);
+    gameBoy->setCoroutineScheduling(coroutines);
+    if (!gameBoy->loadROM(rom.data(), rom.size(), options.opcodesFile)) {
+        return false;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    for (u64 frame = 0; frame < options.frames; frame++) {
+        gameBoy->emulateFrame();
+    }
+    run.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // A run that fell back to the callback loop measures nothing
+    if (coroutines != gameBoy->isCoroutineScheduling()) {
+        return false;
+    }
+    run.instructions = gameBoy->getCPU().getCounters().instructions;
+    run.scanlinesSkipped = gameBoy->getPPU().getCounters().scanlinesSkipped;
+    run.arenaUsed = gameBoy->getScheduler().getArenaUsed();
+    run.state.resize(gameBoy->getStateSize());
+    return gameBoy->saveState(run.state.data(), run.state.size()) != 0;
+}
+
+// Compare a ROM under both schedulers; false if the machines differ
+static bool compare(const char* name, const std::vector<u8>& rom, const Options& options, bool fastBoot) {
+    Run callbacks, coroutines;
+    if (!runMachine(rom, options, fastBoot, false, callbacks) || !runMachine(rom, options, fastBoot, true, coroutines)) {
+        std::cerr << name << ": failed to run" << std::endl;
+        return false;
+    }
+
+    const bool same = callbacks.instructions == coroutines.instructions &&
+                      callbacks.scanlinesSkipped == coroutines.scanlinesSkipped && callbacks.state == coroutines.state;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << name << ": " << options.frames << " frames, " << callbacks.instructions << " instructions, "
+              << callbacks.scanlinesSkipped << " scanlines with the LCD off\n";
+    std::cout << "  callbacks:  " << options.frames / callbacks.seconds << " frames/s\n";
+    std::cout << "  coroutines: " << options.frames / coroutines.seconds << " frames/s (" << std::setprecision(2)
+              << callbacks.seconds / coroutines.seconds << "x), " << coroutines.arenaUsed << " of "
+              << CoroutineArena::SIZE << " arena bytes\n";
+    std::cout << "  state: " << (same ? "identical" : "DIFFERENT") << std::endl;
+    return same;
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if constexpr (BUS_TIMING == BusTiming::MCYCLE) {
+        std::cerr << "Coroutine scheduling is not available under M-cycle timing" << std::endl;
+        return 1;
+    }
+
+    std::ifstream file(options.romPath, std::ios::binary);
+    const std::vector<u8> userROM((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (userROM.empty()) {
+        std::cerr << "Failed to read " << options.romPath << std::endl;
+        return 1;
+    }
+
+    // The user ROM from the boot ROM; the built-in one has no logo for it
+    bool ok = compare(options.romPath.c_str(), userROM, options, false);
+    ok = compare("LCD toggling", buildROM(), options, true) && ok;
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,325 @@
+#include "FrameCodec.h"
+#include "MappedFile.h"
+#include "Memory.h"
+#include <cstring>
+#include <iomanip>
+#include <mutex>
+#include <thread>
+
+#ifndef _WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+// Command line options
+struct Options {
+    std::string host = "127.0.0.1";
+    u16 port = 0;
+    u32 clients = 4;
+    double seconds = 10.0;
+    u32 slowMillis = 0;         // Delay per frame of the last client
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <port> [options]\n"
+              << "  --host <address>   Server address (default 127.0.0.1)\n"
+              << "  --clients <n>      Connections (default 4)\n"
+              << "  --seconds <s>      How long to watch (default 10)\n"
+              << "  --slow <ms>        Make the last client take this long per frame\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--host" && hasValue) {
+            options.host = argv[++i];
+        } else if (arg == "--clients" && hasValue) {
+            options.clients = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (arg == "--seconds" && hasValue) {
+            options.seconds = std::stod(argv[++i]);
+        } else if (arg == "--slow" && hasValue) {
+            options.slowMillis = static_cast<u32>(std::stoul(argv[++i]));
+        } else if (!arg.empty() && arg[0] != '-' && options.port == 0) {
+            options.port = static_cast<u16>(std::stoul(arg));
+        } else {
+            return false;
+        }
+    }
+
+    return options.port != 0 && options.clients > 0;
+}
+
+#ifndef _WIN32
+
+// What one connection saw
+struct ClientStats {
+    u64 keyFrames = 0;
+    u64 deltaFrames = 0;
+    u64 gaps = 0;               // Frame numbers missing (skipped by the server)
+    u64 bytes = 0;
+    u64 checksumErrors = 0;
+    u64 protocolErrors = 0;
+    u64 inputEvents = 0;
+    double seconds = 0;
+    bool connected = false;
+};
+
+// Blocking send of a whole buffer
+static bool sendAll(int socket, const u8* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(socket, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= static_cast<size_t>(sent);
+    }
+    return true;
+}
+
+// Blocking receive of exactly size bytes
+static bool receiveAll(int socket, u8* data, size_t size) {
+    while (size > 0) {
+        ssize_t received = recv(socket, data, size, 0);
+        if (received <= 0) {
+            return false;
+        }
+        data += received;
+        size -= static_cast<size_t>(received);
+    }
+    return true;
+}
+
+// Connect with a receive timeout
+static int connectTo(const Options& options) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_port = htons(options.port);
+    if (inet_pton(AF_INET, options.host.c_str(), &address.sin_addr) != 1) {
+        return -1;
+    }
+
+    int descriptor = socket(AF_INET, SOCK_STREAM, 0);
+    if (descriptor < 0) {
+        return -1;
+    }
+    timeval timeout = {2, 0};
+    setsockopt(descriptor, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    int noDelay = 1;
+    setsockopt(descriptor, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+    if (connect(descriptor, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        close(descriptor);
+        return -1;
+    }
+    return descriptor;
+}
+
+// Send an HTTP request and read the response header (the body stays in the socket)
+static std::string request(int socket, const std::string& text) {
+    if (!sendAll(socket, reinterpret_cast<const u8*>(text.data()), text.size())) {
+        return "";
+    }
+    std::string response;
+    char c;
+    while (response.size() < 8192 && recv(socket, &c, 1, 0) == 1) {
+        response += c;
+        if (response.size() >= 4 && response.compare(response.size() - 4, 4, "\r\n\r\n") == 0) {
+            break;
+        }
+    }
+    return response;
+}
+
+// The page has to come back as HTML
+static bool checkPage(const Options& options) {
+    int descriptor = connectTo(options);
+    if (descriptor < 0) {
+        return false;
+    }
+    std::string header = request(descriptor, "GET / HTTP/1.1\r\nHost: " + options.host + "\r\n\r\n");
+    std::string body;
+    char buffer[4096];
+    ssize_t received;
+    while ((received = recv(descriptor, buffer, sizeof(buffer), 0)) > 0) {
+        body.append(buffer, static_cast<size_t>(received));
+    }
+    close(descriptor);
+    return header.rfind("HTTP/1.1 200", 0) == 0 && body.find("new WebSocket") != std::string::npos;
+}
+
+// Send a masked client message
+static bool sendMessage(int socket, u8 opcode, const u8* payload, size_t size) {
+    std::vector<u8> frame = {static_cast<u8>(0x80 | opcode), static_cast<u8>(0x80 | size), 0x12, 0x34, 0x56, 0x78};
+    for (size_t i = 0; i < size; i++) {
+        frame.push_back(payload[i] ^ frame[2 + (i & 3)]);
+    }
+    return sendAll(socket, frame.data(), frame.size());
+}
+
+// Watch the stream, decoding and checking every frame
+static void runClient(const Options& options, u32 index, ClientStats& stats) {
+    int descriptor = connectTo(options);
+    if (descriptor < 0) {
+        return;
+    }
+
+    // Handshake with the RFC 6455 sample key
+    const std::string key = "dGhlIHNhbXBsZSBub25jZQ==";
+    std::string response = request(descriptor, "GET /ws HTTP/1.1\r\nHost: " + options.host +
+                                                   "\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                                                   "Sec-WebSocket-Key: " + key + "\r\nSec-WebSocket-Version: 13\r\n\r\n");
+    if (response.rfind("HTTP/1.1 101", 0) != 0 ||
+        response.find("Sec-WebSocket-Accept: s3pPLMBiTxaQ9kYGzzhZRbK+xOo=") == std::string::npos) {
+        close(descriptor);
+        stats.protocolErrors++;
+        return;
+    }
+    stats.connected = true;
+
+    const bool slow = options.slowMillis > 0 && index == options.clients - 1;
+    std::vector<u8> packed(PACKED_FRAME_SIZE);
+    std::vector<u8> payload;
+    bool hasKeyFrame = false;
+    u32 lastFrame = 0;
+    u8 buttons = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    auto nextInput = start + std::chrono::milliseconds(500);
+    const auto end = start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                                 std::chrono::duration<double>(options.seconds));
+
+    while (std::chrono::steady_clock::now() < end) {
+        // Server frames are unmasked
+        u8 header[10];
+        if (!receiveAll(descriptor, header, 2)) {
+            break;
+        }
+        size_t length = header[1] & 0x7F;
+        if (length == 126) {
+            if (!receiveAll(descriptor, header + 2, 2)) break;
+            length = (header[2] << 8) | header[3];
+        } else if (length == 127) {
+            if (!receiveAll(descriptor, header + 2, 8)) break;
+            length = 0;
+            for (int i = 0; i < 8; i++) {
+                length = (length << 8) | header[2 + i];
+            }
+        }
+        payload.resize(length);
+        if (!receiveAll(descriptor, payload.data(), length)) {
+            break;
+        }
+        stats.bytes += length + 2;
+        if ((header[0] & 0x0F) != 0x2 || length < STREAM_HEADER_SIZE) {
+            continue;
+        }
+
+        u32 frame, checksum;
+        std::memcpy(&frame, &payload[4], sizeof(frame));
+        std::memcpy(&checksum, &payload[8], sizeof(checksum));
+        const u8* body = payload.data() + STREAM_HEADER_SIZE;
+        const size_t bodySize = length - STREAM_HEADER_SIZE;
+
+        if (payload[0] == STREAM_KEY_FRAME && bodySize == PACKED_FRAME_SIZE) {
+            std::memcpy(packed.data(), body, PACKED_FRAME_SIZE);
+            hasKeyFrame = true;
+            stats.keyFrames++;
+        } else if (payload[0] == STREAM_DELTA_FRAME && hasKeyFrame && applyDelta(body, bodySize, packed.data())) {
+            stats.deltaFrames++;
+        } else {
+            stats.protocolErrors++;
+            continue;
+        }
+
+        if (static_cast<u32>(hashBytes(packed.data(), packed.size())) != checksum) {
+            stats.checksumErrors++;
+        }
+        if (lastFrame != 0 && frame != lastFrame + 1) {
+            stats.gaps += frame > lastFrame ? frame - lastFrame - 1 : 0;
+        }
+        lastFrame = frame;
+
+        // Ack with the frame number and send time
+        u8 ack[STREAM_ACK_SIZE] = {STREAM_ACK};
+        std::memcpy(ack + 4, &payload[4], 4);
+        std::memcpy(ack + 8, &payload[12], 8);
+        if (!sendMessage(descriptor, 0x2, ack, sizeof(ack))) {
+            break;
+        }
+
+        // The first client taps START now and then
+        if (index == 0 && std::chrono::steady_clock::now() >= nextInput) {
+            buttons ^= JOYPAD_START;
+            const u8 input[2] = {STREAM_INPUT, buttons};
+            sendMessage(descriptor, 0x2, input, sizeof(input));
+            stats.inputEvents++;
+            nextInput += std::chrono::milliseconds(500);
+        }
+
+        if (slow) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(options.slowMillis));
+        }
+    }
+
+    stats.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const u8 status[2] = {0x03, 0xE8};
+    sendMessage(descriptor, 0x8, status, sizeof(status));
+    close(descriptor);
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (!checkPage(options)) {
+        std::cerr << "No stream page at " << options.host << ":" << options.port << std::endl;
+        return 1;
+    }
+
+    std::vector<ClientStats> stats(options.clients);
+    std::vector<std::thread> threads;
+    for (u32 i = 0; i < options.clients; i++) {
+        threads.emplace_back(runClient, std::cref(options), i, std::ref(stats[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    bool ok = true;
+    for (u32 i = 0; i < options.clients; i++) {
+        const ClientStats& client = stats[i];
+        const u64 frames = client.keyFrames + client.deltaFrames;
+        std::cout << std::fixed << std::setprecision(1) << "client " << i
+                  << (options.slowMillis > 0 && i == options.clients - 1 ? " (slow)" : "") << ": " << frames
+                  << " frames (" << client.keyFrames << " key, " << client.deltaFrames << " delta, " << client.gaps
+                  << " skipped), " << client.bytes / 1024.0 << " KB, "
+                  << (client.seconds > 0 ? client.bytes / 1024.0 / client.seconds : 0.0) << " KB/s, "
+                  << client.checksumErrors << " checksum errors, " << client.protocolErrors << " protocol errors\n";
+        ok = ok && client.connected && frames > 0 && client.checksumErrors == 0 && client.protocolErrors == 0;
+    }
+    return ok ? 0 : 1;
+}
+
+#else
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+    std::cerr << "The stream client needs POSIX sockets" << std::endl;
+    return 1;
+}
+
+#endif
@@ -0,0 +1,395 @@
+#include "GameBoy.h"
+#include "ProcessPool.h"
+#include "RomLibrary.h"
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <numeric>
+
+namespace fs = std::filesystem;
+
+// Lock-up detection: the PC stays within a few bytes for this many frames
+// without a single interrupt being serviced
+constexpr u32 LOCKUP_FRAMES = 120;
+constexpr u16 LOCKUP_PC_SPAN = 16;
+
+// LCDC is on after the boot ROM until the game turns it off, so the LCD only
+// counts as enabled by the game after its first second
+constexpr u64 LCD_SETTLE_FRAMES = 60;
+
+// Emulated frames per second (4194304 Hz / 70224 cycles)
+constexpr double REAL_TIME_FPS = 4194304.0 / CYCLES_PER_FRAME;
+
+// How a run ended
+enum class RunStatus : u8 {
+    OK,
+    LOCKUP,         // PC stuck with no interrupts
+    LOAD_FAILED,
+    CRASHED,        // Worker process died
+    TIMED_OUT       // Worker killed at the time limit
+};
+
+// Fixed part of what a worker sends back; the opcode and I/O lists follow it
+struct SweepRecord {
+    RunStatus status;
+    u8 cartridgeType;
+    bool mapperSupported;
+    bool lcdEnabled;            // LCDC bit 7 seen set at a frame boundary after settling
+    u16 lockupPC;
+    u64 frames;
+    u64 lockupFrame;
+    double seconds;             // Host time spent emulating
+    u32 unimplementedOpcodes;   // Distinct opcodes
+    u64 unimplementedHits;
+    u32 unhandledIORegisters;   // Distinct registers
+    u64 unhandledIOWrites;
+    char title[17];
+};
+
+// One row of the report
+struct SweepRow {
+    std::string path;
+    SweepRecord record;
+    std::string opcodes;        // "D3@1234x5 CB37@0200x1"
+    std::string ioRegisters;    // "FF04x10 FF26x3"
+
+    double fps() const { return record.seconds > 0 ? record.frames / record.seconds : 0.0; }
+
+    // Problems that make a title unplayable
+    u32 issues() const {
+        return record.unimplementedOpcodes + (record.mapperSupported ? 0 : 1) +
+               (record.lcdEnabled || record.frames == 0 ? 0 : 1) + (record.status == RunStatus::OK ? 0 : 1);
+    }
+};
+
+// Command line options
+struct Options {
+    std::string root;
+    std::string indexFile;
+    std::string csvFile;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    std::string sort = "issues";
+    u64 frames = 600;
+    unsigned jobs = 0;
+    double timeLimit = 300.0;
+    bool bootROM = false;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <directory> [options]\n"
+              << "  --frames <n>       Frames per ROM (default 600)\n"
+              << "  --jobs <n>         Parallel ROMs (default: hardware threads)\n"
+              << "  --time-limit <s>   Wall-clock seconds before a worker is killed (default 300, 0 = none)\n"
+              << "  --sort <key>       issues (default), fps, io, mapper, title or path\n"
+              << "  --csv <file>       Also write the report as CSV\n"
+              << "  --index <file>     Library index to reuse (default <directory>/.gblibrary)\n"
+              << "  --boot-rom         Run the boot ROM instead of starting at 0x0100\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        } else if (arg == "--jobs" && hasValue) {
+            options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--time-limit" && hasValue) {
+            options.timeLimit = std::stod(argv[++i]);
+        } else if (arg == "--sort" && hasValue) {
+            options.sort = argv[++i];
+        } else if (arg == "--csv" && hasValue) {
+            options.csvFile = argv[++i];
+        } else if (arg == "--index" && hasValue) {
+            options.indexFile = argv[++i];
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (arg == "--boot-rom") {
+            options.bootROM = true;
+        } else if (!arg.empty() && arg[0] != '-' && options.root.empty()) {
+            options.root = arg;
+        } else {
+            return false;
+        }
+    }
+
+    static const std::vector<std::string> SORT_KEYS = {"issues", "fps", "io", "mapper", "title", "path"};
+    if (std::find(SORT_KEYS.begin(), SORT_KEYS.end(), options.sort) == SORT_KEYS.end()) {
+        return false;
+    }
+    if (options.indexFile.empty() && !options.root.empty()) {
+        options.indexFile = (fs::path(options.root) / ".gblibrary").string();
+    }
+    return !options.root.empty() && options.timeLimit >= 0.0;
+}
+
+// Hex text with a fixed number of digits
+static std::string hex(u32 value, int digits) {
+    std::ostringstream stream;
+    stream << std::uppercase << std::hex << std::setfill('0') << std::setw(digits) << value;
+    return stream.str();
+}
+
+// Run one ROM and collect what went wrong (in a worker process)
+static std::string sweepROM(const std::string& path, const Options& options) {
+    GameBoy& gameBoy = GameBoy::getInstance();
+    gameBoy.setFastBoot(!options.bootROM);
+
+    // Everything the core would warn about ends up in the report
+    std::cerr.rdbuf(nullptr);
+
+    SweepRecord record;
+    std::memset(&record, 0, sizeof(record));
+    if (!gameBoy.loadROM(path, options.opcodesFile)) {
+        record.status = RunStatus::LOAD_FAILED;
+        return std::string(reinterpret_cast<const char*>(&record), sizeof(record));
+    }
+
+    const Cartridge* cartridge = gameBoy.getMemory().getCartridge();
+    record.cartridgeType = cartridge->getCartridgeType();
+    record.mapperSupported = Cartridge::isSupported(cartridge->getType());
+    std::strncpy(record.title, cartridge->getTitle().c_str(), sizeof(record.title) - 1);
+
+    const CPU& cpu = gameBoy.getCPU();
+    Memory& memory = gameBoy.getMemory();
+    auto interruptsServiced = [&cpu]() {
+        const auto& interrupts = cpu.getCounters().interrupts;
+        return std::accumulate(interrupts.begin(), interrupts.end(), u64{0});
+    };
+
+    // Lock-up window: PC range and interrupt count since the window started
+    u16 windowLow = 0xFFFF;
+    u16 windowHigh = 0;
+    u64 windowInterrupts = interruptsServiced();
+    u64 windowStart = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    while (record.frames < options.frames) {
+        gameBoy.emulateFrame();
+        record.frames++;
+
+        if (record.frames > std::min(LCD_SETTLE_FRAMES, options.frames / 2)) {
+            record.lcdEnabled |= (memory.peek(0xFF40) & 0x80) != 0;
+        }
+
+        const u16 pc = cpu.getRegisters().pc;
+        windowLow = std::min(windowLow, pc);
+        windowHigh = std::max(windowHigh, pc);
+        const u64 interrupts = interruptsServiced();
+        if (windowHigh - windowLow >= LOCKUP_PC_SPAN || interrupts != windowInterrupts) {
+            windowLow = windowHigh = pc;
+            windowInterrupts = interrupts;
+            windowStart = record.frames;
+        } else if (record.frames - windowStart >= LOCKUP_FRAMES) {
+            record.status = RunStatus::LOCKUP;
+            record.lockupPC = pc;
+            record.lockupFrame = windowStart;
+            break;
+        }
+    }
+    record.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    // Unimplemented opcodes with the first address they ran at
+    std::string opcodes;
+    const UnimplementedOpcodeCounters& unimplemented = cpu.getUnimplementedOpcodes();
+    for (size_t slot = 0; slot < OPCODE_SLOTS; slot++) {
+        if (unimplemented.hits[slot] == 0) {
+            continue;
+        }
+        record.unimplementedOpcodes++;
+        record.unimplementedHits += unimplemented.hits[slot];
+        opcodes += (opcodes.empty() ? "" : " ") + std::string(slot >= 256 ? "CB" : "") + hex(slot & 0xFF, 2) + "@" +
+                   hex(unimplemented.firstPC[slot], 4) + "x" + std::to_string(unimplemented.hits[slot]);
+    }
+
+    // Writes to registers that are stored but not emulated
+    std::string ioRegisters;
+    const auto& unhandled = memory.getBusCounters().unhandledIOWrites;
+    for (size_t i = 0; i < unhandled.size(); i++) {
+        if (unhandled[i] == 0) {
+            continue;
+        }
+        record.unhandledIORegisters++;
+        record.unhandledIOWrites += unhandled[i];
+        ioRegisters += (ioRegisters.empty() ? "" : " ") + hex(0xFF00 + static_cast<u32>(i), 4) + "x" +
+                       std::to_string(unhandled[i]);
+    }
+
+    std::string output(reinterpret_cast<const char*>(&record), sizeof(record));
+    output += opcodes;
+    output.push_back('\0');
+    output += ioRegisters;
+    return output;
+}
+
+// Status text for the report
+static std::string statusText(const SweepRecord& record) {
+    switch (record.status) {
+        case RunStatus::LOCKUP:
+            return "lockup@" + hex(record.lockupPC, 4) + " f" + std::to_string(record.lockupFrame);
+        case RunStatus::LOAD_FAILED: return "load failed";
+        case RunStatus::CRASHED: return "crashed";
+        case RunStatus::TIMED_OUT: return "timed out";
+        default: return "ok";
+    }
+}
+
+// Mapper column: cartridge type code and name, starred when not emulated
+static std::string mapperText(const SweepRecord& record) {
+    Cartridge::Header header;
+    Cartridge::setHeaderCodes(record.cartridgeType, 0, 0, header);
+    return std::string(Cartridge::typeName(header.type)) + (record.mapperSupported ? "" : "*");
+}
+
+// Order rows for the chosen key
+static void sortRows(std::vector<SweepRow>& rows, const std::string& key) {
+    auto byPath = [](const SweepRow& a, const SweepRow& b) { return a.path < b.path; };
+    std::stable_sort(rows.begin(), rows.end(), [&](const SweepRow& a, const SweepRow& b) {
+        if (key == "issues") {
+            // Most broken first, slowest first among equals
+            if (a.issues() != b.issues()) {
+                return a.issues() > b.issues();
+            }
+            return a.fps() < b.fps();
+        }
+        if (key == "fps") {
+            return a.fps() < b.fps();
+        }
+        if (key == "io") {
+            return a.record.unhandledIORegisters > b.record.unhandledIORegisters;
+        }
+        if (key == "mapper") {
+            return a.record.cartridgeType < b.record.cartridgeType;
+        }
+        if (key == "title") {
+            return std::strcmp(a.record.title, b.record.title) < 0;
+        }
+        return byPath(a, b);
+    });
+}
+
+// Quote a CSV field
+static std::string csvField(const std::string& text) {
+    std::string quoted = "\"";
+    for (char c : text) {
+        quoted += c == '"' ? std::string("\"\"") : std::string(1, c);
+    }
+    return quoted + "\"";
+}
+
+// Write the report as CSV
+static bool writeCSV(const std::string& filename, const std::vector<SweepRow>& rows) {
+    std::ofstream file(filename, std::ios::trunc);
+    file << "path,title,mapper,cartridge_type,mapper_supported,status,lcd_enabled,frames,fps,issues,"
+            "unimplemented_opcodes,unimplemented_hits,unhandled_io_registers,unhandled_io_writes,opcodes,io_registers\n";
+    for (const SweepRow& row : rows) {
+        const SweepRecord& record = row.record;
+        file << csvField(row.path) << ',' << csvField(record.title) << ',' << mapperText(record) << ",0x"
+             << hex(record.cartridgeType, 2) << ',' << record.mapperSupported << ',' << csvField(statusText(record)) << ','
+             << record.lcdEnabled << ',' << record.frames << ',' << std::fixed << std::setprecision(1) << row.fps() << ','
+             << row.issues() << ',' << record.unimplementedOpcodes << ',' << record.unimplementedHits << ','
+             << record.unhandledIORegisters << ',' << record.unhandledIOWrites << ',' << csvField(row.opcodes) << ','
+             << csvField(row.ioRegisters) << '\n';
+    }
+    if (!file.good()) {
+        std::cerr << "Failed to write " << filename << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// Print the report as a table
+static void printTable(const std::vector<SweepRow>& rows) {
+    std::cout << std::left << std::setw(17) << "title" << std::setw(10) << "mapper" << std::right
+              << std::setw(9) << "fps" << std::setw(7) << "issues" << std::setw(7) << "opcode" << std::setw(5) << "io"
+              << "  lcd  " << std::left << std::setw(22) << "status" << "path\n";
+
+    for (const SweepRow& row : rows) {
+        const SweepRecord& record = row.record;
+        std::cout << std::left << std::setw(17) << record.title << std::setw(10) << mapperText(record) << std::right
+                  << std::fixed << std::setprecision(1) << std::setw(9) << row.fps() << std::setw(7) << row.issues()
+                  << std::setw(7) << record.unimplementedOpcodes << std::setw(5) << record.unhandledIORegisters
+                  << "  " << (record.lcdEnabled ? "on " : "off") << "  " << std::left << std::setw(22)
+                  << statusText(record) << row.path << "\n";
+        if (!row.opcodes.empty()) {
+            std::cout << "    opcodes: " << row.opcodes << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Without the opcode table every instruction would run as NOP
+    if (!std::ifstream(options.opcodesFile).good()) {
+        std::cerr << "Cannot open opcode file: " << options.opcodesFile << std::endl;
+        return 1;
+    }
+
+    // The library index, when present, saves re-reading unchanged files
+    RomLibrary library(options.root);
+    library.load(options.indexFile);
+    library.scan(options.jobs);
+    const std::vector<RomInfo>& entries = library.getEntries();
+    if (entries.empty()) {
+        std::cerr << "No ROMs found under " << options.root << std::endl;
+        return 1;
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    auto results = ProcessPool::run(entries.size(), options.jobs, options.timeLimit, [&](size_t index) {
+        return sweepROM((fs::path(options.root) / entries[index].path).string(), options);
+    });
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<SweepRow> rows(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        SweepRow& row = rows[i];
+        row.path = entries[i].path;
+        std::memset(&row.record, 0, sizeof(row.record));
+
+        const ProcessPool::Result& result = results[i];
+        if (result.completed && result.output.size() >= sizeof(SweepRecord)) {
+            std::memcpy(&row.record, result.output.data(), sizeof(SweepRecord));
+            std::string lists = result.output.substr(sizeof(SweepRecord));
+            size_t separator = lists.find('\0');
+            row.opcodes = lists.substr(0, separator);
+            if (separator != std::string::npos) {
+                row.ioRegisters = lists.substr(separator + 1);
+            }
+        } else {
+            row.record.status = result.timedOut ? RunStatus::TIMED_OUT : RunStatus::CRASHED;
+        }
+
+        // ROMs that never ran keep what the index knows about them
+        if (row.record.status == RunStatus::CRASHED || row.record.status == RunStatus::TIMED_OUT ||
+            row.record.status == RunStatus::LOAD_FAILED) {
+            const Cartridge::Header& header = entries[i].header;
+            row.record.cartridgeType = header.cartridgeType;
+            row.record.mapperSupported = Cartridge::isSupported(header.type);
+            std::strncpy(row.record.title, header.title.c_str(), sizeof(row.record.title) - 1);
+        }
+    }
+
+    sortRows(rows, options.sort);
+    printTable(rows);
+    if (!options.csvFile.empty() && !writeCSV(options.csvFile, rows)) {
+        return 1;
+    }
+
+    size_t broken = std::count_if(rows.begin(), rows.end(), [](const SweepRow& row) { return row.issues() > 0; });
+    size_t slow = std::count_if(rows.begin(), rows.end(), [](const SweepRow& row) {
+        return row.record.frames > 0 && row.fps() < REAL_TIME_FPS;
+    });
+    std::cout << rows.size() << " ROMs: " << broken << " with issues, " << slow << " below real time; "
+              << std::setprecision(2) << wallSeconds << " s" << std::endl;
+    return 0;
+}
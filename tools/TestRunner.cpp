@@ -0,0 +1,323 @@
+#include "GameBoy.h"
+#include "ProcessPool.h"
+#include "RomLibrary.h"
+#include "Serial.h"
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+
+namespace fs = std::filesystem;
+
+// Emulated frames per second (4194304 Hz / 70224 cycles)
+constexpr double FRAMES_PER_SECOND = 4194304.0 / CYCLES_PER_FRAME;
+
+// Mooneye-style result signatures: Fibonacci numbers in B, C, D, E, H, L (and
+// sent over serial) for a pass, 0x42 everywhere for a failure
+constexpr u8 FIBONACCI_SIGNATURE[6] = {3, 5, 8, 13, 21, 34};
+constexpr u8 FAILURE_SIGNATURE = 0x42;
+
+// Blargg-style result block in cartridge RAM: status at A000, signature at A001
+constexpr u16 RESULT_STATUS_ADDRESS = 0xA000;
+constexpr u8 RESULT_SIGNATURE[3] = {0xDE, 0xB0, 0x61};
+constexpr u8 RESULT_RUNNING = 0x80;
+constexpr size_t MAX_DETAIL = 120;
+
+// Outcome of a test ROM
+enum class Verdict : u8 {
+    PASS,
+    FAIL,
+    TIMEOUT,
+    ERROR
+};
+
+// Fixed part of what a worker sends back; the detail text follows it
+struct TestReport {
+    Verdict verdict;
+    u64 frames;
+};
+
+// Command line options
+struct Options {
+    std::vector<std::string> inputs;
+    std::string opcodesFile = GameBoy::DEFAULT_OPCODES_FILE;
+    unsigned jobs = 0;
+    double timeout = 30.0;
+    double timeLimit = 300.0;
+    bool bootROM = false;
+    bool verbose = false;
+};
+
+// Print usage
+static void printUsage(const char* program) {
+    std::cerr << "Usage: " << program << " <rom|directory>... [options]\n"
+              << "  --jobs <n>         Parallel ROMs (default: hardware threads)\n"
+              << "  --timeout <s>      Emulated seconds before a ROM times out (default 30)\n"
+              << "  --time-limit <s>   Wall-clock seconds before a worker is killed (default 300, 0 = none)\n"
+              << "  --boot-rom         Run the boot ROM instead of starting at 0x0100\n"
+              << "  --opcodes <file>   Opcode description file (default " << GameBoy::DEFAULT_OPCODES_FILE << ")\n"
+              << "  --verbose          Print the serial output of ROMs that did not pass\n"
+              << "A ROM passes or fails when it prints \"Passed\"/\"Failed\" over serial, writes\n"
+              << "the Fibonacci (or 0x42) signature to B-L or serial, or posts a result at A000.\n";
+}
+
+// Parse command line options
+static bool parseOptions(int argc, char** argv, Options& options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+
+        if (arg == "--jobs" && hasValue) {
+            options.jobs = static_cast<unsigned>(std::stoul(argv[++i]));
+        } else if (arg == "--timeout" && hasValue) {
+            options.timeout = std::stod(argv[++i]);
+        } else if (arg == "--time-limit" && hasValue) {
+            options.timeLimit = std::stod(argv[++i]);
+        } else if (arg == "--opcodes" && hasValue) {
+            options.opcodesFile = argv[++i];
+        } else if (arg == "--boot-rom") {
+            options.bootROM = true;
+        } else if (arg == "--verbose") {
+            options.verbose = true;
+        } else if (!arg.empty() && arg[0] != '-') {
+            options.inputs.push_back(arg);
+        } else {
+            return false;
+        }
+    }
+
+    return !options.inputs.empty() && options.timeout > 0.0 && options.timeLimit >= 0.0;
+}
+
+// ROM files named on the command line or found under directories, sorted
+static std::vector<std::string> collectROMs(const std::vector<std::string>& inputs) {
+    std::vector<std::string> roms;
+    for (const std::string& input : inputs) {
+        std::error_code error;
+        if (!fs::is_directory(input, error)) {
+            roms.push_back(input);
+            continue;
+        }
+
+        for (fs::recursive_directory_iterator it(input, fs::directory_options::skip_permission_denied, error), end;
+             it != end; it.increment(error)) {
+            if (error) {
+                break;
+            }
+            std::error_code statusError;
+            if (it->is_regular_file(statusError) && RomLibrary::isROMFile(it->path().string())) {
+                roms.push_back(it->path().generic_string());
+            }
+        }
+    }
+
+    std::sort(roms.begin(), roms.end());
+    return roms;
+}
+
+// Last non-empty line of serial text, shortened for the report
+static std::string lastLine(const std::string& text) {
+    size_t end = text.find_last_not_of("\r\n ");
+    if (end == std::string::npos) {
+        return {};
+    }
+    size_t begin = text.find_last_of('\n', end);
+    begin = begin == std::string::npos ? 0 : begin + 1;
+    return text.substr(begin, std::min(end + 1 - begin, MAX_DETAIL));
+}
+
+// Whether the last bytes of a sequence all match a signature
+static bool endsWith(const std::vector<u8>& data, const u8* signature, size_t size) {
+    return data.size() >= size && std::equal(signature, signature + size, data.end() - static_cast<std::ptrdiff_t>(size));
+}
+
+// Look for a pass/fail pattern; false while the test is still running
+static bool checkVerdict(GameBoy& gameBoy, const SerialCapture& serial, Verdict& verdict, std::string& detail) {
+    // Text results over serial
+    const std::vector<u8>& data = serial.getData();
+    if (!data.empty()) {
+        std::string text = serial.getText();
+        if (text.find("Passed") != std::string::npos) {
+            verdict = Verdict::PASS;
+            detail = lastLine(text);
+            return true;
+        }
+        if (text.find("Failed") != std::string::npos) {
+            verdict = Verdict::FAIL;
+            detail = lastLine(text);
+            return true;
+        }
+
+        // Signature bytes over serial
+        const u8 failure[6] = {FAILURE_SIGNATURE, FAILURE_SIGNATURE, FAILURE_SIGNATURE,
+                               FAILURE_SIGNATURE, FAILURE_SIGNATURE, FAILURE_SIGNATURE};
+        if (endsWith(data, FIBONACCI_SIGNATURE, sizeof(FIBONACCI_SIGNATURE))) {
+            verdict = Verdict::PASS;
+            detail = "serial signature";
+            return true;
+        }
+        if (endsWith(data, failure, sizeof(failure))) {
+            verdict = Verdict::FAIL;
+            detail = "serial failure signature";
+            return true;
+        }
+    }
+
+    // Signature registers
+    const CPU::Registers& registers = gameBoy.getCPU().getRegisters();
+    const u8 values[6] = {registers.b, registers.c, registers.d, registers.e, registers.h, registers.l};
+    if (std::equal(values, values + 6, FIBONACCI_SIGNATURE)) {
+        verdict = Verdict::PASS;
+        detail = "register signature";
+        return true;
+    }
+    if (std::all_of(values, values + 6, [](u8 value) { return value == FAILURE_SIGNATURE; })) {
+        verdict = Verdict::FAIL;
+        detail = "register failure signature";
+        return true;
+    }
+
+    // Result block in cartridge RAM
+    Memory& memory = gameBoy.getMemory();
+    for (u16 i = 0; i < sizeof(RESULT_SIGNATURE); i++) {
+        if (memory.peek(static_cast<u16>(RESULT_STATUS_ADDRESS + 1 + i)) != RESULT_SIGNATURE[i]) {
+            return false;
+        }
+    }
+    u8 status = memory.peek(RESULT_STATUS_ADDRESS);
+    if (status == RESULT_RUNNING) {
+        return false;
+    }
+
+    std::string text;
+    for (u16 address = RESULT_STATUS_ADDRESS + 4; address < 0xC000 && text.size() < 4096; address++) {
+        u8 value = memory.peek(address);
+        if (value == 0) {
+            break;
+        }
+        text.push_back(static_cast<char>(value));
+    }
+    verdict = status == 0 ? Verdict::PASS : Verdict::FAIL;
+    detail = lastLine(text);
+    if (detail.empty()) {
+        detail = "result code " + std::to_string(status);
+    }
+    return true;
+}
+
+// Run one ROM to a verdict (in a worker process)
+static std::string runTest(const std::string& path, const Options& options) {
+    GameBoy& gameBoy = GameBoy::getInstance();
+    SerialCapture serial;
+    gameBoy.setSerialDevice(&serial);
+    gameBoy.setFastBoot(!options.bootROM);
+
+    TestReport report{Verdict::ERROR, 0};
+    std::string detail = "cannot load ROM";
+    if (gameBoy.loadROM(path, options.opcodesFile)) {
+        const u64 maxFrames = static_cast<u64>(options.timeout * FRAMES_PER_SECOND);
+        report.verdict = Verdict::TIMEOUT;
+        detail = "no result";
+        while (report.frames < maxFrames) {
+            gameBoy.emulateFrame();
+            report.frames++;
+            if (checkVerdict(gameBoy, serial, report.verdict, detail)) {
+                break;
+            }
+        }
+        if (report.verdict == Verdict::TIMEOUT && !serial.getData().empty()) {
+            detail = lastLine(serial.getText());
+        }
+    }
+
+    gameBoy.setSerialDevice(nullptr);
+
+    std::string output(reinterpret_cast<const char*>(&report), sizeof(report));
+    output += detail;
+    output.push_back('\0');
+    output += serial.getText();
+    return output;
+}
+
+// Verdict names
+static const char* verdictName(Verdict verdict) {
+    switch (verdict) {
+        case Verdict::PASS: return "PASS";
+        case Verdict::FAIL: return "FAIL";
+        case Verdict::TIMEOUT: return "TIMEOUT";
+        default: return "ERROR";
+    }
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    // Without the opcode table every instruction would run as NOP
+    if (!std::ifstream(options.opcodesFile).good()) {
+        std::cerr << "Cannot open opcode file: " << options.opcodesFile << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> roms = collectROMs(options.inputs);
+    if (roms.empty()) {
+        std::cerr << "No ROMs found" << std::endl;
+        return 1;
+    }
+
+    // Every ROM runs in a process of its own
+    auto start = std::chrono::steady_clock::now();
+    auto results = ProcessPool::run(roms.size(), options.jobs, options.timeLimit,
+                                    [&](size_t index) { return runTest(roms[index], options); });
+    double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::array<size_t, 4> totals{};
+    double cpuSeconds = 0.0;
+    std::cout << std::left << std::setw(9) << "result" << std::right << std::setw(10) << "time ms"
+              << std::setw(10) << "emu s" << "  rom\n";
+
+    for (size_t i = 0; i < roms.size(); i++) {
+        const ProcessPool::Result& result = results[i];
+        TestReport report{Verdict::ERROR, 0};
+        std::string detail;
+        std::string serialText;
+
+        if (result.completed && result.output.size() >= sizeof(report)) {
+            std::memcpy(&report, result.output.data(), sizeof(report));
+            std::string rest = result.output.substr(sizeof(report));
+            size_t separator = rest.find('\0');
+            detail = rest.substr(0, separator);
+            if (separator != std::string::npos) {
+                serialText = rest.substr(separator + 1);
+            }
+        } else if (result.timedOut) {
+            // A worker that hung in host code never reached the emulated timeout
+            report.verdict = Verdict::TIMEOUT;
+            detail = "killed after " + std::to_string(static_cast<int>(options.timeLimit)) + " s";
+        } else {
+            detail = result.exitSignal ? "crashed (signal " + std::to_string(result.exitSignal) + ")"
+                                       : "worker failed";
+        }
+
+        totals[static_cast<size_t>(report.verdict)]++;
+        cpuSeconds += result.seconds;
+        std::cout << std::left << std::setw(9) << verdictName(report.verdict) << std::right << std::fixed
+                  << std::setprecision(1) << std::setw(10) << result.seconds * 1000.0
+                  << std::setw(10) << report.frames / FRAMES_PER_SECOND << "  " << roms[i];
+        if (!detail.empty()) {
+            std::cout << "  (" << detail << ")";
+        }
+        std::cout << "\n";
+
+        if (options.verbose && report.verdict != Verdict::PASS && !serialText.empty()) {
+            std::cout << serialText << "\n";
+        }
+    }
+
+    std::cout << totals[0] << " passed, " << totals[1] << " failed, " << totals[2] << " timed out, "
+              << totals[3] << " errors; " << std::setprecision(2) << wallSeconds << " s wall, "
+              << cpuSeconds << " s in workers" << std::endl;
+    return totals[0] == roms.size() ? 0 : 1;
+}